@@ -0,0 +1,407 @@
+#pragma once
+// asset pack classes defined here
+// every file the demo needs (shaders, textures) is baked into one pack file that is memory mapped at startup,
+// loading an asset is a binary search over the table of contents and a pointer into the mapping, no open() or read() per file
+//
+// layout, all integers little endian:
+//   PackHeader
+//   PackEntry[entry_count]   sorted by name hash
+//   name table               the original names, used to rule out hash collisions and for listing
+//   blobs                    each one starts on a PACK_ALIGNMENT boundary
+//
+// a blob is either stored as is, then the view points straight into the mapping, or LZ4 compressed (see lz4_block.h),
+// then it is decompressed once on first access and kept in memory for as long as the pack is open
+
+#include <lz4_block.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifdef APIENTRY
+#undef APIENTRY // glad's definition, windows.h defines the same thing again
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const char PACK_MAGIC[8] = { 'D', 'V', 'D', 'P', 'A', 'C', 'K', '\0' };
+const uint32_t PACK_VERSION = 1;
+const size_t PACK_ALIGNMENT = 64; // cache line, also keeps every blob aligned for SIMD and GPU copies
+
+const uint32_t PACK_STORED = 0;
+const uint32_t PACK_LZ4 = 1;
+
+struct PackHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_count;
+	uint64_t names_offset;
+	uint64_t names_size;
+};
+
+struct PackEntry {
+	uint64_t hash;        // hashString() of the name
+	uint64_t offset;      // of the blob from the start of the file
+	uint64_t stored_size; // bytes in the file
+	uint64_t size;        // bytes once decompressed
+	uint32_t name_offset; // into the name table
+	uint32_t name_length;
+	uint32_t compression; // PACK_STORED or PACK_LZ4
+	uint32_t reserved;
+};
+
+static_assert(sizeof(PackHeader) == 32, "PackHeader must match the file layout");
+static_assert(sizeof(PackEntry) == 48, "PackEntry must match the file layout");
+
+// 64 bit FNV-1a
+inline uint64_t hashString(const std::string& text) {
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned char c : text) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// names inside a pack are relative paths with forward slashes, "./glsl/../dvd.png" is stored and looked up as "dvd.png"
+inline std::string packName(const std::string& path) {
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+// read only view of a whole file through the OS page cache
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile() {
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+			memory = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (memory == nullptr) {
+			close();
+			return false;
+		}
+		length = (size_t)file_size.QuadPart;
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return false;
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+			::close(descriptor);
+			return false;
+		}
+		void* address = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		::close(descriptor); // the mapping keeps its own reference to the file
+		if (address == MAP_FAILED)
+			return false;
+		memory = (const unsigned char*)address;
+		length = (size_t)status.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (memory != nullptr)
+			UnmapViewOfFile(memory);
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (memory != nullptr)
+			munmap((void*)memory, length);
+#endif
+		memory = nullptr;
+		length = 0;
+	}
+
+	const unsigned char* data() const {
+		return memory;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+private:
+	const unsigned char* memory = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+};
+
+// bytes of one asset, valid for as long as the pack that returned it stays open
+struct AssetView {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+	explicit operator bool() const {
+		return data != nullptr;
+	}
+};
+
+class AssetPack {
+public:
+	AssetPack() = default;
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	// map a pack and check its table of contents, nothing else is read until an asset is asked for
+	bool open(const std::string& path) {
+		close();
+		if (!file.open(path))
+			return false;
+
+		const unsigned char* base = file.data();
+		size_t size = file.size();
+		PackHeader header;
+		if (size < sizeof(PackHeader)) {
+			std::cout << "ERROR::ASSET_PACK::TRUNCATED: " << path << std::endl;
+			close();
+			return false;
+		}
+		std::memcpy(&header, base, sizeof(PackHeader));
+		if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != PACK_VERSION) {
+			std::cout << "ERROR::ASSET_PACK::NOT_A_PACK: " << path << std::endl;
+			close();
+			return false;
+		}
+
+		size_t toc_end = sizeof(PackHeader) + (size_t)header.entry_count * sizeof(PackEntry);
+		// sums of untrusted sizes can wrap, every range is checked as an offset and the room left after it
+		if (toc_end > size || header.names_offset < toc_end || header.names_offset > size || header.names_size > size - header.names_offset) {
+			std::cout << "ERROR::ASSET_PACK::TRUNCATED: " << path << std::endl;
+			close();
+			return false;
+		}
+		// the table is 8 byte aligned inside a page aligned mapping, it can be used in place
+		entries = (const PackEntry*)(base + sizeof(PackHeader));
+		count = header.entry_count;
+		names = (const char*)(base + header.names_offset);
+
+		for (size_t i = 0; i < count; i++) {
+			const PackEntry& entry = entries[i];
+			bool sorted = i == 0 || entries[i - 1].hash <= entry.hash;
+			bool valid = entry.offset <= size && entry.stored_size <= size - entry.offset
+				&& entry.name_offset + (uint64_t)entry.name_length <= header.names_size
+				&& (entry.compression == PACK_LZ4 || (entry.compression == PACK_STORED && entry.stored_size == entry.size));
+			if (!sorted || !valid) {
+				std::cout << "ERROR::ASSET_PACK::CORRUPT_ENTRY: " << path << std::endl;
+				close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		decompressed.clear();
+		file.close();
+		entries = nullptr;
+		names = nullptr;
+		count = 0;
+	}
+
+	bool isOpen() const {
+		return entries != nullptr;
+	}
+
+	size_t entryCount() const {
+		return count;
+	}
+
+	std::string name(size_t index) const {
+		return std::string(names + entries[index].name_offset, entries[index].name_length);
+	}
+
+	bool contains(const std::string& path) const {
+		return findEntry(packName(path)) != nullptr;
+	}
+
+	// look an asset up by path, empty view if the pack does not have it
+	// safe to call from several threads at once, texture decodes on the job system do
+	AssetView find(const std::string& path) {
+		const PackEntry* entry = findEntry(packName(path));
+		if (entry == nullptr)
+			return AssetView();
+		if (entry->compression == PACK_STORED)
+			return { file.data() + entry->offset, (size_t)entry->size };
+
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t index = (size_t)(entry - entries);
+		auto it = decompressed.find(index);
+		if (it == decompressed.end()) {
+			// an LZ4 sequence expands at most about 255 to 1, a larger size is corrupt and must not be allocated
+			if (entry->size / 255 > entry->stored_size) {
+				std::cout << "ERROR::ASSET_PACK::CORRUPT_BLOB: " << path << std::endl;
+				return AssetView();
+			}
+			std::unique_ptr<unsigned char[]> bytes(new unsigned char[entry->size > 0 ? entry->size : 1]);
+			if (!lz4Decompress(file.data() + entry->offset, (size_t)entry->stored_size, bytes.get(), (size_t)entry->size)) {
+				std::cout << "ERROR::ASSET_PACK::CORRUPT_BLOB: " << path << std::endl;
+				return AssetView();
+			}
+			it = decompressed.emplace(index, std::move(bytes)).first;
+		}
+		return { it->second.get(), (size_t)entry->size };
+	}
+
+private:
+	MappedFile file;
+	const PackEntry* entries = nullptr;
+	const char* names = nullptr;
+	size_t count = 0;
+
+	std::mutex mutex;
+	std::unordered_map<size_t, std::unique_ptr<unsigned char[]>> decompressed; // LZ4 blobs already unpacked, by entry index
+
+	const PackEntry* findEntry(const std::string& name) const {
+		uint64_t hash = hashString(name);
+		const PackEntry* end = entries + count;
+		const PackEntry* entry = std::lower_bound(entries, end, hash,
+			[](const PackEntry& e, uint64_t h) { return e.hash < h; });
+		for (; entry != end && entry->hash == hash; ++entry)
+			if (entry->name_length == name.size() && std::memcmp(names + entry->name_offset, name.data(), name.size()) == 0)
+				return entry;
+		return nullptr;
+	}
+};
+
+// write 'files' into a pack at 'output_path', names are the paths as given (normalized by packName())
+// blobs are LZ4 compressed when 'compress' is set and it saves at least an eighth of their size, already compressed
+// formats like png barely shrink and are stored as they are so they stay zero copy
+inline bool buildAssetPack(const std::string& output_path, const std::vector<std::string>& files, bool compress = true) {
+	struct Item {
+		std::string name;
+		std::vector<unsigned char> blob;
+		PackEntry entry;
+	};
+	std::vector<Item> items;
+	for (const std::string& path : files) {
+		std::ifstream input(path, std::ios::binary);
+		if (!input) {
+			std::cout << "ERROR::ASSET_PACK::FAILED_TO_READ: " << path << std::endl;
+			return false;
+		}
+		Item item;
+		item.name = packName(path);
+		item.blob.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+		std::memset(&item.entry, 0, sizeof(PackEntry));
+		item.entry.hash = hashString(item.name);
+		item.entry.size = item.blob.size();
+		item.entry.compression = PACK_STORED;
+
+		bool duplicate = std::any_of(items.begin(), items.end(), [&](const Item& other) { return other.name == item.name; });
+		if (duplicate) {
+			std::cout << "ERROR::ASSET_PACK::DUPLICATE_NAME: " << item.name << std::endl;
+			return false;
+		}
+
+		if (compress && !item.blob.empty()) {
+			std::vector<unsigned char> packed = lz4Compress(item.blob.data(), item.blob.size());
+			if (packed.size() <= item.blob.size() - item.blob.size() / 8) {
+				item.blob = std::move(packed);
+				item.entry.compression = PACK_LZ4;
+			}
+		}
+		item.entry.stored_size = item.blob.size();
+		items.push_back(std::move(item));
+	}
+	std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.entry.hash < b.entry.hash; });
+
+	std::string name_table;
+	for (Item& item : items) {
+		item.entry.name_offset = (uint32_t)name_table.size();
+		item.entry.name_length = (uint32_t)item.name.size();
+		name_table += item.name;
+	}
+
+	auto align = [](uint64_t offset) { return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT; };
+	PackHeader header;
+	std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.entry_count = (uint32_t)items.size();
+	header.names_offset = sizeof(PackHeader) + items.size() * sizeof(PackEntry);
+	header.names_size = name_table.size();
+	uint64_t offset = align(header.names_offset + header.names_size);
+	for (Item& item : items) {
+		item.entry.offset = offset;
+		offset = align(offset + item.entry.stored_size);
+	}
+
+	std::ofstream output(output_path, std::ios::binary);
+	if (!output) {
+		std::cout << "ERROR::ASSET_PACK::FAILED_TO_WRITE: " << output_path << std::endl;
+		return false;
+	}
+	output.write((const char*)&header, sizeof(PackHeader));
+	for (const Item& item : items)
+		output.write((const char*)&item.entry, sizeof(PackEntry));
+	output.write(name_table.data(), name_table.size());
+
+	uint64_t written = header.names_offset + header.names_size;
+	const char padding[PACK_ALIGNMENT] = {};
+	uint64_t stored_bytes = 0, original_bytes = 0;
+	for (const Item& item : items) {
+		output.write(padding, (std::streamsize)(item.entry.offset - written));
+		output.write((const char*)item.blob.data(), (std::streamsize)item.blob.size());
+		written = item.entry.offset + item.blob.size();
+		stored_bytes += item.entry.stored_size;
+		original_bytes += item.entry.size;
+
+		std::cout << "\t" << item.name << " : " << item.entry.size << " bytes"
+			<< (item.entry.compression == PACK_LZ4 ? " -> " + std::to_string(item.entry.stored_size) + " (lz4)" : "") << std::endl;
+	}
+	if (!output) {
+		std::cout << "ERROR::ASSET_PACK::FAILED_TO_WRITE: " << output_path << std::endl;
+		return false;
+	}
+	std::cout << "Packed " << items.size() << " assets into " << output_path << ", "
+		<< original_bytes << " bytes -> " << stored_bytes << " bytes" << std::endl;
+	return true;
+}
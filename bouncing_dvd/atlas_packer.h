@@ -0,0 +1,145 @@
+#pragma once
+// rectangle packer class defined here
+// MaxRects with the best short side fit heuristic (Jukka Jylanki, "A Thousand Ways to Pack the Bin")
+//
+// the free space is kept as a list of maximal empty rectangles that may overlap each other, a new rectangle goes into the
+// free rectangle where it leaves the smallest leftover along its shorter side, then every free rectangle it touches is split
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+struct AtlasRect {
+	int x = 0, y = 0, width = 0, height = 0;
+};
+
+class MaxRectsPacker {
+public:
+	MaxRectsPacker(int width = 0, int height = 0) {
+		reset(width, height);
+	}
+
+	// forget every placed rectangle
+	void reset(int width, int height) {
+		bin_width = width;
+		bin_height = height;
+		used_area = 0;
+		free_rects.clear();
+		if (width > 0 && height > 0)
+			free_rects.push_back({ 0, 0, width, height });
+	}
+
+	// place a width x height rectangle, false when there is no room left for it
+	bool insert(int width, int height, AtlasRect& placed) {
+		int best_short = INT_MAX_SIDE, best_long = INT_MAX_SIDE;
+		for (const AtlasRect& free : free_rects) {
+			if (free.width < width || free.height < height)
+				continue;
+			int leftover_x = free.width - width, leftover_y = free.height - height;
+			int short_side = std::min(leftover_x, leftover_y), long_side = std::max(leftover_x, leftover_y);
+			if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+				placed = { free.x, free.y, width, height };
+				best_short = short_side;
+				best_long = long_side;
+			}
+		}
+		if (best_short == INT_MAX_SIDE)
+			return false;
+
+		// split every free rectangle the new one overlaps into the up to four pieces around it
+		std::vector<AtlasRect> pieces;
+		for (size_t i = 0; i < free_rects.size();) {
+			if (splitFreeRect(free_rects[i], placed, pieces)) {
+				free_rects[i] = free_rects.back();
+				free_rects.pop_back();
+			}
+			else
+				i++;
+		}
+		// the surviving rectangles are still maximal, only the new pieces can be redundant
+		size_t survivors = free_rects.size();
+		for (size_t i = 0; i < pieces.size(); i++) {
+			bool redundant = false;
+			for (size_t j = 0; j < survivors && !redundant; j++)
+				redundant = contains(free_rects[j], pieces[i]);
+			for (size_t j = 0; j < pieces.size() && !redundant; j++)
+				redundant = j != i && contains(pieces[j], pieces[i]) && (j < i || !contains(pieces[i], pieces[j]));
+			if (!redundant)
+				free_rects.push_back(pieces[i]);
+		}
+		used_area += (size_t)width * height;
+		return true;
+	}
+
+	// hand a placed rectangle back, the space is reused by later inserts that fit inside it
+	// neighbouring free space is not merged, rebuild the whole bin when fragmentation starts to hurt
+	void remove(const AtlasRect& rect) {
+		free_rects.push_back(rect);
+		pruneFreeList();
+		used_area -= std::min(used_area, (size_t)rect.width * rect.height);
+	}
+
+	int width() const {
+		return bin_width;
+	}
+
+	int height() const {
+		return bin_height;
+	}
+
+	size_t usedArea() const {
+		return used_area;
+	}
+
+	// fraction of the bin covered by placed rectangles
+	float occupancy() const {
+		size_t area = (size_t)bin_width * bin_height;
+		return area > 0 ? (float)used_area / area : 0.0f;
+	}
+
+private:
+	static const int INT_MAX_SIDE = 0x7FFFFFFF;
+
+	int bin_width = 0, bin_height = 0;
+	size_t used_area = 0;
+	std::vector<AtlasRect> free_rects;
+
+	// returns true when 'free' overlaps 'used', the parts of 'free' left uncovered are appended to 'pieces'
+	static bool splitFreeRect(const AtlasRect& free, const AtlasRect& used, std::vector<AtlasRect>& pieces) {
+		if (used.x >= free.x + free.width || used.x + used.width <= free.x ||
+			used.y >= free.y + free.height || used.y + used.height <= free.y)
+			return false;
+
+		if (used.x > free.x)
+			pieces.push_back({ free.x, free.y, used.x - free.x, free.height });
+		if (used.x + used.width < free.x + free.width)
+			pieces.push_back({ used.x + used.width, free.y, free.x + free.width - used.x - used.width, free.height });
+		if (used.y > free.y)
+			pieces.push_back({ free.x, free.y, free.width, used.y - free.y });
+		if (used.y + used.height < free.y + free.height)
+			pieces.push_back({ free.x, used.y + used.height, free.width, free.y + free.height - used.y - used.height });
+		return true;
+	}
+
+	static bool contains(const AtlasRect& outer, const AtlasRect& inner) {
+		return inner.x >= outer.x && inner.y >= outer.y &&
+			inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+	}
+
+	// drop free rectangles that lie inside another one, they can never be a better fit
+	void pruneFreeList() {
+		for (size_t i = 0; i < free_rects.size(); i++) {
+			for (size_t j = i + 1; j < free_rects.size();) {
+				if (contains(free_rects[j], free_rects[i])) {
+					free_rects.erase(free_rects.begin() + i);
+					i--;
+					break;
+				}
+				if (contains(free_rects[i], free_rects[j]))
+					free_rects.erase(free_rects.begin() + j);
+				else
+					j++;
+			}
+		}
+	}
+};
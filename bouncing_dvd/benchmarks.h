@@ -0,0 +1,741 @@
+#pragma once
+// benchmarks defined here
+// each one prints its results, most need a current opengl context, run them from the command line (see main.cpp)
+
+#include <glad/glad.h>
+
+#include <asset_pack.h>
+#include <block_encoder.h>
+#include <dynamic_texture.h>
+#include <ktx2.h>
+#include <pixel_convert.h>
+#include <png_decoder.h>
+#include <qoi.h>
+#include <sprite_batch.h>
+#include <stb_image.h>
+#include <virtual_texture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// read a whole file into memory, empty on failure
+inline std::vector<unsigned char> readFileBytes(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// stb_image decode + RGBA upload + runtime mips against reading a cooked ktx2 and uploading its levels as they are
+inline void benchmarkKtx2(const std::string& png_path, const std::string& ktx2_path, int iterations = 20) {
+	double png_cpu = 0.0, png_gpu = 0.0, ktx2_cpu = 0.0, ktx2_gpu = 0.0;
+	size_t png_vram = 0, ktx2_vram = 0;
+	size_t png_disk = readFileBytes(png_path).size(), ktx2_disk = readFileBytes(ktx2_path).size();
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (int i = 0; i < iterations; i++) {
+		// stb_image path, what bouncing_dvd used to do before the render loop
+		auto start = std::chrono::steady_clock::now();
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load_thread(true);
+		unsigned char* pixels = stbi_load(png_path.c_str(), &width, &height, &channels, 4);
+		png_cpu += elapsedMs(start);
+		if (pixels == NULL) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << png_path << std::endl;
+			return;
+		}
+
+		start = std::chrono::steady_clock::now();
+		int levels = 1;
+		while ((std::max(width, height) >> levels) > 0)
+			levels++;
+		unsigned int texture;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, levels, GL_RGBA8, width, height);
+		glTextureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glGenerateTextureMipmap(texture);
+		glFinish();
+		png_gpu += elapsedMs(start);
+		glDeleteTextures(1, &texture);
+		stbi_image_free(pixels);
+
+		png_vram = 0;
+		for (int level = 0; level < levels; level++)
+			png_vram += (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * 4;
+
+		// ktx2 path, no decode, no mip generation
+		start = std::chrono::steady_clock::now();
+		std::vector<unsigned char> file = readFileBytes(ktx2_path);
+		Ktx2Image image;
+		if (!parseKtx2(file.data(), file.size(), image) || !ktx2FormatSupported(image.vk_format)) {
+			std::cout << "ERROR::BENCHMARK::UNSUPPORTED_KTX2: " << ktx2_path << std::endl;
+			return;
+		}
+		ktx2_cpu += elapsedMs(start);
+
+		start = std::chrono::steady_clock::now();
+		GLenum format = ktx2GLFormat(image.vk_format);
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, (GLsizei)image.levels.size(), format, image.width, image.height);
+		ktx2_vram = 0;
+		for (size_t level = 0; level < image.levels.size(); level++) {
+			const Ktx2Level& view = image.levels[level];
+			glCompressedTextureSubImage2D(texture, (GLint)level, 0, 0, view.width, view.height, format, (GLsizei)view.size, view.data);
+			ktx2_vram += view.size;
+		}
+		glFinish();
+		ktx2_gpu += elapsedMs(start);
+		glDeleteTextures(1, &texture);
+	}
+
+	std::cout << "\nKTX2 benchmark, average of " << iterations << " loads:" << std::endl
+		<< "\t                 " << "stb_image      ktx2" << std::endl
+		<< "\tDecode/read ms : " << png_cpu / iterations << "\t" << ktx2_cpu / iterations << std::endl
+		<< "\tUpload ms      : " << png_gpu / iterations << "\t" << ktx2_gpu / iterations << std::endl
+		<< "\tTotal ms       : " << (png_cpu + png_gpu) / iterations << "\t" << (ktx2_cpu + ktx2_gpu) / iterations << std::endl
+		<< "\tDisk bytes     : " << png_disk << "\t" << ktx2_disk << std::endl
+		<< "\tVRAM bytes     : " << png_vram << "\t" << ktx2_vram
+		<< "  (" << (double)png_vram / std::max<size_t>(ktx2_vram, 1) << "x smaller)" << std::endl;
+}
+
+// 'count' small shader sized files read one by one against the same files served from one mapped pack
+// both runs hit the page cache, what is measured is the per file open/read/close overhead the pack removes
+inline void benchmarkAssetPack(int count = 2000, int iterations = 5) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "dvd_pack_benchmark";
+	std::filesystem::create_directories(directory);
+	std::vector<std::string> files;
+	for (int i = 0; i < count; i++) {
+		std::string path = (directory / ("asset_" + std::to_string(i) + ".glsl")).generic_string();
+		std::ofstream file(path, std::ios::binary);
+		for (int line = 0; line < 40; line++)
+			file << "uniform vec4 value_" << i << "_" << line << "; // padding to a typical shader size\n";
+		files.push_back(path);
+	}
+	std::string pack_path = (directory / "benchmark.pak").generic_string();
+	std::cout.setstate(std::ios::failbit); // the builder lists every file
+	bool built = buildAssetPack(pack_path, files, false);
+	std::cout.clear();
+	if (!built) {
+		std::cout << "ERROR::BENCHMARK::FAILED_TO_BUILD_PACK: " << pack_path << std::endl;
+		return;
+	}
+
+	double loose_ms = 0.0, pack_ms = 0.0;
+	size_t loose_bytes = 0, pack_bytes = 0;
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		loose_bytes = 0;
+		for (const std::string& path : files)
+			loose_bytes += readFileBytes(path).size();
+		loose_ms += elapsedMs(start);
+
+		// open included, every byte touched so the page faults are paid for as well
+		start = std::chrono::steady_clock::now();
+		AssetPack pack;
+		pack.open(pack_path);
+		pack_bytes = 0;
+		volatile unsigned int checksum = 0; // keeps the reads from being optimized away
+		for (const std::string& path : files) {
+			AssetView view = pack.find(path);
+			for (size_t b = 0; b < view.size; b += 64)
+				checksum += view.data[b];
+			pack_bytes += view.size;
+		}
+		pack_ms += elapsedMs(start);
+	}
+	std::filesystem::remove_all(directory);
+
+	std::cout << "\nAsset pack benchmark, " << count << " files, average of " << iterations << " runs:" << std::endl
+		<< "\t                 " << "loose files    pack" << std::endl
+		<< "\tLoad ms        : " << loose_ms / iterations << "\t" << pack_ms / iterations << std::endl
+		<< "\tBytes          : " << loose_bytes << "\t" << pack_bytes << std::endl
+		<< "\tSpeedup        : " << loose_ms / std::max(pack_ms, 1e-6) << "x" << std::endl;
+}
+
+// every pixel_convert.h operation on a 'megapixels' image at each kernel level the CPU runs, in GB/s of bytes read plus
+// written, the output of every level is checked against the scalar one
+inline void benchmarkPixelConvert(int megapixels = 16, int iterations = 10) {
+	size_t count = (size_t)megapixels << 20;
+	std::mt19937 random(7);
+	std::vector<unsigned char> rgb(count * 3), rgba(count * 4);
+	for (unsigned char& value : rgb)
+		value = (unsigned char)random();
+	for (unsigned char& value : rgba)
+		value = (unsigned char)random();
+	std::vector<float> linear(count * 4);
+	const unsigned char bgra[4] = { 2, 1, 0, 3 };
+
+	struct Operation {
+		const char* name;
+		size_t bytes; // read plus written per pixel
+		std::function<void(std::vector<unsigned char>&, std::vector<float>&)> run;
+	};
+	const std::vector<Operation> operations = {
+		{ "RGB -> RGBA", 7, [&](std::vector<unsigned char>& out, std::vector<float>&) { expandRGBToRGBA(rgb.data(), out.data(), count); } },
+		// in place, the source is copied first and those bytes count as well
+		{ "premultiply", 16, [&](std::vector<unsigned char>& out, std::vector<float>&) { out = rgba; premultiplyAlpha(out.data(), count); } },
+		{ "RGBA -> BGRA", 8, [&](std::vector<unsigned char>& out, std::vector<float>&) { swizzleRGBA(rgba.data(), out.data(), count, bgra); } },
+		{ "sRGB -> linear", 20, [&](std::vector<unsigned char>&, std::vector<float>& out) { srgbToLinear(rgba.data(), out.data(), count); } },
+		{ "linear -> sRGB", 20, [&](std::vector<unsigned char>& out, std::vector<float>&) { linearToSrgb(linear.data(), out.data(), count); } },
+	};
+	srgbToLinear(rgba.data(), linear.data(), count);
+
+	SimdLevel best = detectSimdLevel();
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "\nPixel conversion benchmark, " << megapixels << " megapixels, best of " << iterations << " runs, GB/s:" << std::endl
+		<< "\t" << std::left << std::setw(16) << "";
+	std::vector<SimdLevel> levels;
+	for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::NEON }) {
+		if (setSimdLevel(level)) {
+			levels.push_back(level);
+			std::cout << std::setw(10) << simdLevelName(level);
+		}
+	}
+	std::cout << std::endl;
+
+	for (const Operation& operation : operations) {
+		std::cout << "\t" << std::setw(16) << operation.name;
+		std::vector<unsigned char> reference_bytes(count * 4), bytes(count * 4);
+		std::vector<float> reference_floats(count * 4), floats(count * 4);
+		for (SimdLevel level : levels) {
+			setSimdLevel(level);
+			double best_ms = 1e30;
+			for (int i = 0; i < iterations; i++) {
+				auto start = std::chrono::steady_clock::now();
+				operation.run(bytes, floats);
+				best_ms = std::min(best_ms, elapsedMs(start));
+			}
+			if (level == SimdLevel::Scalar) {
+				reference_bytes = bytes;
+				reference_floats = floats;
+			}
+			std::cout << std::setw(10);
+			if (bytes == reference_bytes && floats == reference_floats)
+				std::cout << count * operation.bytes / (best_ms * 1e6);
+			else
+				std::cout << "MISMATCH";
+		}
+		std::cout << std::endl;
+	}
+
+	// not dispatched, row swaps are memcpy
+	double flip_ms = 1e30;
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		flipRows(rgba.data(), 4096, (int)(count / 4096), 4);
+		flip_ms = std::min(flip_ms, elapsedMs(start));
+	}
+	std::cout << "\t" << std::setw(16) << "vertical flip" << count * 8 / (flip_ms * 1e6) << std::endl;
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	setSimdLevel(best);
+}
+
+// decode every png with stb_image and with png_decoder.h (scalar unfilters, then the best simd level), in MB/s of decoded
+// pixels, and check that both decoders return the same bytes. a corpus of sizes from sprites to large sheets covers it
+inline void benchmarkPngDecode(const std::vector<std::string>& paths, int iterations = 10) {
+	SimdLevel best = detectSimdLevel();
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "\nPNG decode benchmark, best of " << iterations << " runs, MB/s of decoded pixels:" << std::endl
+		<< "\t" << std::left << std::setw(14) << "size" << std::setw(10) << "stb" << std::setw(10) << "scalar"
+		<< std::setw(10) << simdLevelName(best) << std::setw(10) << "speedup" << "result" << std::endl;
+	stbi_set_flip_vertically_on_load_thread(false);
+	int mismatches = 0;
+	for (const std::string& path : paths) {
+		std::vector<unsigned char> file = readFileBytes(path);
+		int width = 0, height = 0, channels = 0;
+		unsigned char* reference = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0);
+		if (reference == NULL) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+		size_t bytes = (size_t)width * height * channels;
+
+		auto best_of = [&](auto decode) {
+			double best_ms = 1e30;
+			for (int i = 0; i < iterations; i++) {
+				auto start = std::chrono::steady_clock::now();
+				decode();
+				best_ms = std::min(best_ms, elapsedMs(start));
+			}
+			return bytes / (best_ms * 1000.0);
+		};
+		double stb_rate = best_of([&] {
+			int w, h, c;
+			stbi_image_free(stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, 0));
+		});
+
+		// null when the decoder turns the file down, the loader would use stb_image for it
+		const char* result = "exact";
+		double rates[2] = {};
+		SimdLevel levels[2] = { SimdLevel::Scalar, best };
+		for (int l = 0; l < 2; l++) {
+			setSimdLevel(levels[l]);
+			int w = 0, h = 0, c = 0;
+			unsigned char* pixels = decodePng(file.data(), file.size(), w, h, c);
+			if (pixels == nullptr)
+				result = "stb fallback";
+			else if (w != width || h != height || c != channels || std::memcmp(pixels, reference, bytes) != 0)
+				result = "MISMATCH";
+			std::free(pixels);
+			if (pixels == nullptr)
+				break;
+			rates[l] = best_of([&] {
+				std::free(decodePng(file.data(), file.size(), w, h, c));
+			});
+		}
+		setSimdLevel(best);
+		stbi_image_free(reference);
+		if (std::strcmp(result, "MISMATCH") == 0)
+			mismatches++;
+
+		std::string size = std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(channels);
+		std::cout << "\t" << std::setw(14) << size << std::setw(10) << stb_rate << std::setw(10) << rates[0] << std::setw(10) << rates[1]
+			<< std::setw(10) << rates[1] / stb_rate << result << "  " << path << std::endl;
+	}
+
+	// a 2x1 image with a one entry palette and a second pixel indexing past it (the invalid-palette.png case of Go's
+	// image/png tests), the decoder has to turn it down rather than read a color the file never gave
+	static const unsigned char invalid_palette[] = {
+		0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x02,
+		0x00, 0x00, 0x00, 0x01, 0x08, 0x03, 0x00, 0x00, 0x00, 0xC3, 0xFC, 0x8F, 0xB8, 0x00, 0x00, 0x00, 0x03, 0x50, 0x4C, 0x54,
+		0x45, 0xFF, 0x00, 0x00, 0x19, 0xE2, 0x09, 0x37, 0x00, 0x00, 0x00, 0x0E, 0x49, 0x44, 0x41, 0x54, 0x78, 0x01, 0x01, 0x03,
+		0x00, 0xFC, 0xFF, 0x00, 0x00, 0x01, 0x00, 0x04, 0x00, 0x02, 0x0B, 0x21, 0x8B, 0x71, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+		0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+	};
+	int w = 0, h = 0, c = 0;
+	unsigned char* invalid = decodePng(invalid_palette, sizeof(invalid_palette), w, h, c);
+	std::cout << "\t" << std::setw(14) << "2x1x3" << (invalid == nullptr ? "stb fallback" : "MISMATCH") << "  palette index out of range" << std::endl;
+	if (invalid != nullptr)
+		mismatches++;
+	std::free(invalid);
+
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	std::cout << "\t" << paths.size() << " files, " << mismatches << " mismatches against stb_image" << std::endl;
+}
+
+// load time of every png against the same image converted to qoi, file read included, in ms per image: stb_image and
+// png_decoder.h on the png, qoi.h on the qoi (written to a temporary directory first). the qoi pixels are checked against
+// the png's and the total over all files shows what converting a whole corpus buys
+inline void benchmarkQoi(const std::vector<std::string>& paths, int iterations = 10) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "dvd_qoi_benchmark";
+	std::filesystem::create_directories(directory);
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "\nQOI benchmark, best of " << iterations << " runs, ms to read and decode:" << std::endl
+		<< "\t" << std::left << std::setw(14) << "size" << std::setw(10) << "png KB" << std::setw(10) << "qoi KB"
+		<< std::setw(10) << "stb" << std::setw(10) << "png" << std::setw(10) << "qoi" << std::setw(10) << "speedup" << "result" << std::endl;
+	stbi_set_flip_vertically_on_load_thread(false);
+	double totals[3] = {};
+	size_t png_total = 0, qoi_total = 0;
+	int mismatches = 0, loaded = 0;
+	for (const std::string& path : paths) {
+		std::string qoi_path = (directory / (std::to_string(loaded) + ".qoi")).generic_string();
+		std::cout.setstate(std::ios::failbit); // the converter reports every file
+		bool converted = convertToQoi(path, qoi_path);
+		std::cout.clear();
+		if (!converted) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+		loaded++;
+
+		// the qoi always decodes to RGBA, compare it with stb_image's RGBA
+		std::vector<unsigned char> png = readFileBytes(path), qoi = readFileBytes(qoi_path);
+		int width = 0, height = 0, channels = 0, w = 0, h = 0, c = 0;
+		unsigned char* reference = stbi_load_from_memory(png.data(), (int)png.size(), &width, &height, &channels, 4);
+		unsigned char* pixels = decodeQoi(qoi.data(), qoi.size(), w, h, c);
+		bool exact = reference != NULL && pixels != nullptr && w == width && h == height
+			&& std::memcmp(pixels, reference, (size_t)width * height * 4) == 0;
+		stbi_image_free(reference);
+		std::free(pixels);
+		if (!exact)
+			mismatches++;
+
+		auto best_of = [&](auto load) {
+			double best_ms = 1e30;
+			for (int i = 0; i < iterations; i++) {
+				auto start = std::chrono::steady_clock::now();
+				load();
+				best_ms = std::min(best_ms, elapsedMs(start));
+			}
+			return best_ms;
+		};
+		double ms[3];
+		ms[0] = best_of([&] {
+			std::vector<unsigned char> file = readFileBytes(path);
+			stbi_image_free(stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, 0));
+		});
+		ms[1] = best_of([&] {
+			std::vector<unsigned char> file = readFileBytes(path);
+			unsigned char* decoded = decodePng(file.data(), file.size(), w, h, c);
+			if (decoded == nullptr) // what the loader does with files the decoder turns down
+				decoded = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, 0);
+			std::free(decoded);
+		});
+		ms[2] = best_of([&] {
+			std::vector<unsigned char> file = readFileBytes(qoi_path);
+			std::free(decodeQoi(file.data(), file.size(), w, h, c));
+		});
+		for (int i = 0; i < 3; i++)
+			totals[i] += ms[i];
+		png_total += png.size();
+		qoi_total += qoi.size();
+
+		std::string size = std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(channels);
+		std::cout << "\t" << std::setw(14) << size << std::setw(10) << png.size() / 1024.0 << std::setw(10) << qoi.size() / 1024.0
+			<< std::setw(10) << ms[0] << std::setw(10) << ms[1] << std::setw(10) << ms[2] << std::setw(10) << ms[1] / ms[2]
+			<< (exact ? "exact" : "MISMATCH") << "  " << path << std::endl;
+	}
+	std::filesystem::remove_all(directory);
+	std::cout << "\t" << std::setw(14) << "total" << std::setw(10) << png_total / 1024.0 << std::setw(10) << qoi_total / 1024.0
+		<< std::setw(10) << totals[0] << std::setw(10) << totals[1] << std::setw(10) << totals[2]
+		<< std::setw(10) << totals[1] / std::max(totals[2], 1e-6) << std::endl;
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	std::cout << "\t" << loaded << " files, " << mismatches << " mismatches against the png" << std::endl;
+}
+
+// 'sprites' quads showing 'images' distinct small images, rendered into an offscreen 720x480 target in every mode:
+// one texture per image (a bind and draw whenever the texture changes), one atlas, a texture array and bindless handles
+inline void benchmarkSpriteBatch(int images = 2000, int sprites = 2000, int iterations = 50) {
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> side(8, 64);
+	std::vector<std::vector<unsigned char>> pixels(images);
+	std::vector<int> widths(images), heights(images);
+	for (int i = 0; i < images; i++) {
+		widths[i] = side(rng);
+		heights[i] = side(rng);
+		unsigned char r = (unsigned char)rng(), g = (unsigned char)rng(), b = (unsigned char)rng();
+		pixels[i].resize((size_t)widths[i] * heights[i] * 4);
+		for (int y = 0; y < heights[i]; y++)
+			for (int x = 0; x < widths[i]; x++) {
+				unsigned char* p = &pixels[i][((size_t)y * widths[i] + x) * 4];
+				p[0] = (unsigned char)(r * x / widths[i]);
+				p[1] = (unsigned char)(g * y / heights[i]);
+				p[2] = b;
+				p[3] = 255;
+			}
+	}
+
+	// separate textures, what drawing sprites looked like before batching
+	std::vector<unsigned int> textures(images);
+	glCreateTextures(GL_TEXTURE_2D, images, textures.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (int i = 0; i < images; i++) {
+		glTextureStorage2D(textures[i], 1, GL_RGBA8, widths[i], heights[i]);
+		glTextureSubImage2D(textures[i], 0, 0, 0, widths[i], heights[i], GL_RGBA, GL_UNSIGNED_BYTE, pixels[i].data());
+		glTextureParameteri(textures[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	}
+
+	// start small so the benchmark also exercises growing
+	auto start = std::chrono::steady_clock::now();
+	TextureAtlas atlas(256, 256);
+	std::vector<int> ids(images);
+	for (int i = 0; i < images; i++)
+		ids[i] = atlas.add("image_" + std::to_string(i), pixels[i].data(), widths[i], heights[i]);
+	double pack_ms = elapsedMs(start);
+	start = std::chrono::steady_clock::now();
+	atlas.update();
+	glFinish();
+	double atlas_upload_ms = elapsedMs(start);
+
+	SpriteTextureSet array(TextureSetMode::TextureArray, images, 64, 64);
+	for (int i = 0; i < images; i++)
+		array.add(textures[i], widths[i], heights[i]);
+	array.update();
+	bool bindless = bindlessTextureLoaded();
+	std::unique_ptr<SpriteTextureSet> handles;
+	if (bindless) {
+		handles = std::make_unique<SpriteTextureSet>(TextureSetMode::Bindless);
+		for (int i = 0; i < images; i++)
+			handles->add(textures[i], widths[i], heights[i]);
+		handles->update();
+	}
+
+	unsigned int framebuffer, color;
+	glCreateFramebuffers(1, &framebuffer);
+	glCreateRenderbuffers(1, &color);
+	glNamedRenderbufferStorage(color, GL_RGBA8, 720, 480);
+	glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, 720, 480);
+
+	// sprite positions and images shared by every mode, in random order so nothing comes presorted by texture
+	std::uniform_real_distribution<float> position(-1.0f, 0.9f);
+	std::uniform_int_distribution<int> pick(0, images - 1);
+	std::vector<float> xs(sprites), ys(sprites);
+	std::vector<int> image_of(sprites);
+	for (int i = 0; i < sprites; i++) {
+		xs[i] = position(rng);
+		ys[i] = position(rng);
+		image_of[i] = i < images ? i : pick(rng);
+	}
+	std::shuffle(image_of.begin(), image_of.end(), rng);
+
+	const char* names[] = { "textures", "atlas", "array", "bindless" };
+	double frame_ms[4] = {};
+	size_t draw_calls[4] = {};
+	SpriteBatch texture_batch(sprites);
+	SpriteBatch array_batch(sprites, SpriteTextureSet::fragmentShader(TextureSetMode::TextureArray));
+	std::unique_ptr<SpriteBatch> bindless_batch;
+	if (bindless)
+		bindless_batch = std::make_unique<SpriteBatch>(sprites, SpriteTextureSet::fragmentShader(TextureSetMode::Bindless));
+	const float full[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+	for (int frame = 0; frame < iterations; frame++) {
+		for (int mode = 0; mode < (bindless ? 4 : 3); mode++) {
+			SpriteBatch& batch = mode == 3 ? *bindless_batch : mode == 2 ? array_batch : texture_batch;
+			start = std::chrono::steady_clock::now();
+			glClear(GL_COLOR_BUFFER_BIT);
+			batch.begin();
+			for (int i = 0; i < sprites; i++) {
+				int image = image_of[i];
+				float width = widths[image] / 360.0f, height = heights[image] / 240.0f;
+				if (mode == 0)
+					batch.draw(textures[image], full, xs[i], ys[i], width, height);
+				else if (mode == 1)
+					batch.draw(atlas, ids[image], xs[i], ys[i], width, height);
+				else
+					batch.draw(mode == 2 ? array : *handles, image, xs[i], ys[i], width, height);
+			}
+			batch.end();
+			glFinish();
+			frame_ms[mode] += elapsedMs(start);
+			draw_calls[mode] = batch.drawCalls();
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color);
+	handles.reset(); // handles go non-resident before their textures are deleted
+	glDeleteTextures(images, textures.data());
+
+	atlas.printStats();
+	std::cout << "\nSprite batch benchmark, " << sprites << " sprites showing " << images << " distinct images, average of "
+		<< iterations << " frames:" << std::endl
+		<< "\tAtlas packing  : " << pack_ms << " ms, upload " << atlas_upload_ms << " ms" << std::endl;
+	for (int mode = 0; mode < 4; mode++) {
+		std::cout << "\t" << names[mode] << std::string(15 - std::strlen(names[mode]), ' ') << ": ";
+		if (mode == 3 && !bindless)
+			std::cout << "GL_ARB_bindless_texture not supported" << std::endl;
+		else
+			std::cout << draw_calls[mode] << " draw calls, " << frame_ms[mode] / iterations << " ms per frame" << std::endl;
+	}
+}
+
+// zoom from the whole image to 2 screen pixels per texel around one point, then pan across the image at that zoom,
+// rendered offscreen at 720x480. reports the render thread cost of streaming, how often the view still showed coarser
+// tiles than it asked for, and the GPU memory used against the whole pyramid
+inline void benchmarkVirtualTexture(const std::string& path, int frames = 600) {
+	JobSystem jobs;
+	VirtualTexture texture(jobs);
+	if (!texture.open(path))
+		return;
+	const int width = 720, height = 480;
+	unsigned int framebuffer, color;
+	glCreateFramebuffers(1, &framebuffer);
+	glCreateRenderbuffers(1, &color);
+	glNamedRenderbufferStorage(color, GL_RGBA8, width, height);
+	glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+
+	float image_width = (float)texture.width(), image_height = (float)texture.height();
+	float fit = std::min(width / image_width, height / image_height); // pixels per texel showing the whole image
+	float u = 0.37f, v = 0.61f;                                         // image point kept at the center, from the top left
+	int zoom_frames = frames / 2;
+	double cpu_ms = 0.0, worst_ms = 0.0, frame_ms = 0.0;
+	int incomplete = 0;
+	size_t missing = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		float scale = 2.0f;
+		if (frame < zoom_frames)
+			scale = fit * std::pow(2.0f / fit, (float)frame / zoom_frames);
+		else
+			u = std::min(0.37f + (frame - zoom_frames) * 4.0f / (image_width * scale), 1.0f); // 4 pixels a frame
+		float rect[4] = { 0.0f, 0.0f, 2.0f * image_width * scale / width, 2.0f * image_height * scale / height };
+		rect[0] = -u * rect[2];
+		rect[1] = -(1.0f - v) * rect[3];
+
+		auto start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		texture.update();
+		texture.renderFeedback(width, height, rect);
+		texture.draw(rect);
+		double ms = elapsedMs(start);
+		glFinish();
+		frame_ms += elapsedMs(start);
+		cpu_ms += ms;
+		if (frame > 0) // drivers compile shaders on their first use
+			worst_ms = std::max(worst_ms, ms);
+
+		VirtualTextureStats stats = texture.stats();
+		missing += stats.missing;
+		incomplete += stats.missing > 0;
+	}
+	VirtualTextureStats stats = texture.stats();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color);
+
+	std::cout << "\nVirtual texture benchmark, " << texture.width() << "x" << texture.height() << ", " << frames << " frames at "
+		<< width << "x" << height << ":" << std::endl
+		<< "\tRender thread ms : " << cpu_ms / frames << " average, " << worst_ms << " worst (update, feedback and draw)" << std::endl
+		<< "\tFrame ms         : " << frame_ms / frames << " including the GPU" << std::endl
+		<< "\tTiles            : " << stats.streamed << " streamed, " << stats.evicted << " evicted, " << stats.dropped << " dropped" << std::endl
+		<< "\tCoarser tiles    : " << incomplete << " of " << frames << " frames, " << (double)missing / frames << " tiles missing on average" << std::endl
+		<< "\tGPU memory       : " << stats.gpu_bytes / (1024.0 * 1024.0) << " MB against " << stats.virtual_bytes / (1024.0 * 1024.0)
+		<< " MB for the whole pyramid" << std::endl;
+}
+// block encoding of every image, in MPix/s on one thread at each SIMD level (the blocks of every level are checked
+// against the scalar ones) and spread over the job system, with the PSNR of what the GPU decodes. images with alpha are
+// compared premultiplied, BC1 drops the color of transparent pixels and nobody sees it. then the per frame cost of a
+// 1024x1024 dynamic texture in each format
+inline void benchmarkBlockEncoder(const std::vector<std::string>& paths, int iterations = 3) {
+	JobSystem jobs;
+	SimdLevel best = detectSimdLevel();
+	std::vector<SimdLevel> levels;
+	for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::NEON })
+		if (setBlockEncoderLevel(level))
+			levels.push_back(level);
+	setBlockEncoderLevel(best);
+	bool bc1 = ktx2FormatSupported(ktx2VkFormat(BlockFormat::BC1));
+
+	// what the GPU samples, decoded by the driver
+	auto decode = [](BlockFormat format, const std::vector<unsigned char>& blocks, int width, int height) {
+		GLenum gl_format = ktx2GLFormat(ktx2VkFormat(format));
+		unsigned int texture;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, 1, gl_format, width, height);
+		glCompressedTextureSubImage2D(texture, 0, 0, 0, width, height, gl_format, (GLsizei)blocks.size(), blocks.data());
+		std::vector<unsigned char> pixels((size_t)width * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)pixels.size(), pixels.data());
+		glDeleteTextures(1, &texture);
+		return pixels;
+	};
+
+	struct Encoder {
+		const char* name;
+		BlockFormat format;
+		EncodeQuality quality;
+	};
+	const Encoder encoders[] = {
+		{ "BC1", BlockFormat::BC1, EncodeQuality::Fast },
+		{ "BC7 fast", BlockFormat::BC7, EncodeQuality::Fast },
+		{ "BC7 normal", BlockFormat::BC7, EncodeQuality::Normal },
+		{ "BC7 high", BlockFormat::BC7, EncodeQuality::High },
+	};
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "\nBlock encoder benchmark, best of " << iterations << " runs, MPix/s and PSNR in dB, "
+		<< jobs.threadCount() + 1 << " threads:" << std::endl;
+	stbi_set_flip_vertically_on_load_thread(false);
+	int mismatches = 0;
+	for (const std::string& path : paths) {
+		int width, height, channels;
+		unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+		if (pixels == NULL) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+		double megapixels = (double)width * height / 1e6;
+		size_t count = (size_t)width * height;
+		std::vector<unsigned char> original(pixels, pixels + count * 4);
+		if (channels == 4)
+			premultiplyAlpha(original.data(), count);
+		auto quality = [&](BlockFormat format, const std::vector<unsigned char>& blocks) {
+			std::vector<unsigned char> decoded = decode(format, blocks, width, height);
+			if (channels == 4)
+				premultiplyAlpha(decoded.data(), count);
+			return psnr(original.data(), decoded.data(), count, channels == 4 ? 4 : 3);
+		};
+		std::cout << "\t" << path << ", " << width << "x" << height << std::endl
+			<< "\t\t" << std::left << std::setw(12) << "";
+		for (SimdLevel level : levels)
+			std::cout << std::setw(10) << simdLevelName(level);
+		std::cout << std::setw(10) << "threads" << "PSNR" << std::endl;
+
+		auto best_of = [&](auto encode) {
+			double best_ms = 1e30;
+			for (int i = 0; i < iterations; i++) {
+				auto start = std::chrono::steady_clock::now();
+				encode();
+				best_ms = std::min(best_ms, elapsedMs(start));
+			}
+			return megapixels * 1000.0 / best_ms;
+		};
+
+		for (const Encoder& encoder : encoders) {
+			if (encoder.format == BlockFormat::BC1 && !bc1)
+				continue;
+			std::cout << "\t\t" << std::setw(12) << encoder.name;
+			std::vector<unsigned char> reference(compressedSize(encoder.format, width, height)), blocks(reference.size());
+			int blocks_y = (height + 3) / 4;
+			for (SimdLevel level : levels) {
+				setBlockEncoderLevel(level);
+				double rate = best_of([&] { encodeBlockRows(encoder.format, encoder.quality, pixels, width, height, 0, blocks_y, blocks.data()); });
+				if (level == SimdLevel::Scalar)
+					reference = blocks;
+				std::cout << std::setw(10);
+				if (blocks == reference)
+					std::cout << rate;
+				else {
+					std::cout << "MISMATCH";
+					mismatches++;
+				}
+			}
+			setBlockEncoderLevel(best);
+			double threaded = best_of([&] { encodeImage(jobs, encoder.format, encoder.quality, pixels, width, height, blocks.data()); });
+			if (blocks != reference)
+				mismatches++;
+			std::cout << std::setprecision(2) << std::setw(10) << threaded
+				<< quality(encoder.format, blocks)
+				<< std::setprecision(1) << std::endl;
+		}
+		stbi_image_free(pixels);
+	}
+	std::cout << "\t" << mismatches << " mismatches against the scalar encoder" << std::endl;
+
+	// a plasma regenerated every frame and uploaded, the generator is not timed
+	const int size = 1024, frames = 120;
+	std::vector<unsigned char> plasma((size_t)size * size * 4);
+	std::cout << std::setprecision(2) << "\tDynamic " << size << "x" << size << " texture, " << frames << " frames, ms per frame:" << std::endl
+		<< "\t\t" << std::setw(12) << "" << std::setw(10) << "encode" << std::setw(10) << "worst" << std::setw(10) << "frame"
+		<< std::setw(12) << "upload KB" << "PSNR" << std::endl;
+	for (int mode = 0; mode < 4; mode++) {
+		if (mode == 1 && !bc1)
+			continue;
+		const char* names[] = { "RGBA8", "BC1", "BC7 fast", "BC7 normal" };
+		DynamicTexture texture(jobs, size, size, mode > 0, mode == 1 ? BlockFormat::BC1 : BlockFormat::BC7,
+			mode == 3 ? EncodeQuality::Normal : EncodeQuality::Fast);
+		double frame_ms = 0.0;
+		for (int frame = 0; frame < frames; frame++) {
+			generatePlasma(plasma.data(), size, size, frame / 60.0);
+			auto start = std::chrono::steady_clock::now();
+			texture.update(plasma.data());
+			glFinish();
+			frame_ms += elapsedMs(start);
+		}
+		std::vector<unsigned char> sampled(plasma.size());
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTextureImage(texture.texture(), 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)sampled.size(), sampled.data());
+		DynamicTextureStats stats = texture.stats();
+		std::cout << "\t\t" << std::setw(12) << names[mode] << std::setw(10) << stats.encode_ms / frames << std::setw(10) << stats.worst_encode_ms
+			<< std::setw(10) << frame_ms / frames << std::setw(12) << stats.uploaded_bytes / frames / 1024
+			<< psnr(plasma.data(), sampled.data(), (size_t)size * size, 3) << std::endl;
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+}
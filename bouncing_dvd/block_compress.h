@@ -0,0 +1,264 @@
+#pragma once
+// block compression helpers defined here
+// the fixed-rate block formats GPUs sample from directly, their sizes, the ETC2 encoder and the image helpers the
+// encoders share. BC1 and BC7 blocks come from block_encoder.h, compressImage() included
+//
+//   BC1  - 8 bytes per 4x4 block, two RGB565 endpoints + 2 bit indices, 1 bit alpha (4 bits per pixel)
+//   BC7  - 16 bytes per 4x4 block, RGBA endpoints with p-bits + 2 to 4 bit indices (8 bits per pixel)
+//   ETC2 - 16 bytes per 4x4 block, EAC alpha block followed by an ETC1 compatible color block (8 bits per pixel)
+//
+// the ETC2 encoder takes a 4x4 block as 64 bytes of RGBA, rows first
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+enum class BlockFormat {
+	BC1,
+	BC7,
+	ETC2
+};
+
+inline size_t blockBytes(BlockFormat format) {
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+// bytes needed for one mip level of the given size
+inline size_t compressedSize(BlockFormat format, int width, int height) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+// ---------------------------------------------------------------- ETC2 (RGBA8, EAC alpha + ETC1 color)
+
+const int ETC1_MODIFIERS[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+const int EAC_MODIFIERS[16][8] = {
+	{ -3, -6, -9, -15, 2, 5, 8, 14 },
+	{ -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5, -8, -13, 1, 4, 7, 12 },
+	{ -2, -4, -6, -13, 1, 3, 5, 12 },
+	{ -3, -6, -8, -12, 2, 5, 7, 11 },
+	{ -3, -7, -9, -11, 2, 6, 8, 10 },
+	{ -4, -7, -8, -11, 3, 6, 7, 10 },
+	{ -3, -5, -8, -11, 2, 4, 7, 10 },
+	{ -2, -6, -8, -10, 1, 5, 7, 9 },
+	{ -2, -5, -8, -10, 1, 4, 7, 9 },
+	{ -2, -4, -8, -10, 1, 3, 7, 9 },
+	{ -2, -5, -7, -10, 1, 4, 6, 9 },
+	{ -3, -4, -7, -10, 2, 3, 6, 9 },
+	{ -1, -2, -3, -10, 0, 1, 2, 9 },
+	{ -4, -6, -8, -9, 3, 5, 7, 8 },
+	{ -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+inline int clampByte(int value) {
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+inline void storeBigEndian64(uint64_t value, unsigned char* out) {
+	for (int i = 0; i < 8; i++)
+		out[i] = (unsigned char)(value >> (56 - 8 * i));
+}
+
+// best modifier table and per pixel selectors for one 2x4 / 4x2 sub-block around a base color
+inline int fitETC1Subblock(const unsigned char* block, const int* pixels, const int* base, int* table, int* selectors) {
+	int best_total = 1 << 30;
+	for (int t = 0; t < 8; t++) {
+		// selector value order is +a, +b, -a, -b
+		const int modifiers[4] = { ETC1_MODIFIERS[t][0], ETC1_MODIFIERS[t][1], -ETC1_MODIFIERS[t][0], -ETC1_MODIFIERS[t][1] };
+		int total = 0;
+		int chosen[8];
+		for (int i = 0; i < 8 && total < best_total; i++) {
+			const unsigned char* pixel = block + pixels[i] * 4;
+			int best_error = 1 << 30;
+			for (int s = 0; s < 4; s++) {
+				int error = 0;
+				for (int c = 0; c < 3; c++) {
+					int d = clampByte(base[c] + modifiers[s]) - pixel[c];
+					error += d * d;
+				}
+				if (error < best_error) {
+					best_error = error;
+					chosen[i] = s;
+				}
+			}
+			total += best_error;
+		}
+		if (total < best_total) {
+			best_total = total;
+			*table = t;
+			for (int i = 0; i < 8; i++)
+				selectors[i] = chosen[i];
+		}
+	}
+	return best_total;
+}
+
+inline uint64_t encodeETC1Color(const unsigned char* block) {
+	uint64_t best_bits = 0;
+	int best_error = 1 << 30;
+
+	for (int flip = 0; flip < 2; flip++) {
+		// pixel numbers (y * 4 + x) of both sub-blocks, left/right halves without flip, top/bottom halves with it
+		int pixels[2][8];
+		int counts[2] = { 0, 0 };
+		for (int y = 0; y < 4; y++)
+			for (int x = 0; x < 4; x++) {
+				int half = flip ? (y >= 2) : (x >= 2);
+				pixels[half][counts[half]++] = y * 4 + x;
+			}
+
+		float average[2][3] = {};
+		for (int half = 0; half < 2; half++) {
+			for (int i = 0; i < 8; i++)
+				for (int c = 0; c < 3; c++)
+					average[half][c] += block[pixels[half][i] * 4 + c];
+			for (int c = 0; c < 3; c++)
+				average[half][c] /= 8.0f;
+		}
+
+		for (int differential = 0; differential < 2; differential++) {
+			int quantized[2][3], base[2][3];
+			bool valid = true;
+			for (int half = 0; half < 2; half++)
+				for (int c = 0; c < 3; c++) {
+					if (differential) {
+						quantized[half][c] = std::min((int)(average[half][c] * 31.0f / 255.0f + 0.5f), 31);
+						base[half][c] = (quantized[half][c] << 3) | (quantized[half][c] >> 2);
+					}
+					else {
+						quantized[half][c] = std::min((int)(average[half][c] * 15.0f / 255.0f + 0.5f), 15);
+						base[half][c] = (quantized[half][c] << 4) | quantized[half][c];
+					}
+				}
+			// the second color is stored as a 3 bit signed delta, out of range deltas would select the ETC2 T/H/planar modes
+			if (differential)
+				for (int c = 0; c < 3; c++) {
+					int delta = quantized[1][c] - quantized[0][c];
+					valid &= delta >= -4 && delta <= 3;
+				}
+			if (!valid)
+				continue;
+
+			int tables[2] = { 0, 0 }, selectors[2][8];
+			int error = fitETC1Subblock(block, pixels[0], base[0], &tables[0], selectors[0])
+				+ fitETC1Subblock(block, pixels[1], base[1], &tables[1], selectors[1]);
+			if (error >= best_error)
+				continue;
+			best_error = error;
+
+			uint64_t bits = 0;
+			for (int c = 0; c < 3; c++) {
+				int shift = 56 - 8 * c;
+				if (differential)
+					bits |= (uint64_t)quantized[0][c] << (shift + 3) | (uint64_t)((quantized[1][c] - quantized[0][c]) & 7) << shift;
+				else
+					bits |= (uint64_t)quantized[0][c] << (shift + 4) | (uint64_t)quantized[1][c] << shift;
+			}
+			bits |= (uint64_t)tables[0] << 37 | (uint64_t)tables[1] << 34 | (uint64_t)differential << 33 | (uint64_t)flip << 32;
+
+			// selectors are stored column by column, msb plane in bits 16..31 and lsb plane in bits 0..15
+			for (int half = 0; half < 2; half++)
+				for (int i = 0; i < 8; i++) {
+					int pixel = pixels[half][i];
+					int k = (pixel % 4) * 4 + pixel / 4;
+					int s = selectors[half][i];
+					bits |= (uint64_t)(s >> 1) << (16 + k) | (uint64_t)(s & 1) << k;
+				}
+			best_bits = bits;
+		}
+	}
+	return best_bits;
+}
+
+inline uint64_t encodeEACAlpha(const unsigned char* block) {
+	int min_alpha = 255, max_alpha = 0;
+	for (int i = 0; i < 16; i++) {
+		min_alpha = std::min(min_alpha, (int)block[i * 4 + 3]);
+		max_alpha = std::max(max_alpha, (int)block[i * 4 + 3]);
+	}
+
+	// flat alpha, table 13 has a zero modifier at selector 4
+	if (min_alpha == max_alpha) {
+		uint64_t bits = (uint64_t)min_alpha << 56 | (uint64_t)1 << 52 | (uint64_t)13 << 48;
+		for (int k = 0; k < 16; k++)
+			bits |= (uint64_t)4 << (45 - 3 * k);
+		return bits;
+	}
+
+	uint64_t best_bits = 0;
+	int best_error = 1 << 30;
+	for (int t = 0; t < 16; t++) {
+		int t_min = EAC_MODIFIERS[t][3], t_max = EAC_MODIFIERS[t][7];
+		// the multiplier and base that stretch the table across the block's alpha range, searched in a small neighbourhood
+		int multiplier_guess = (int)std::lround((double)(max_alpha - min_alpha) / (t_max - t_min));
+		for (int multiplier = std::max(multiplier_guess - 1, 1); multiplier <= std::min(multiplier_guess + 1, 15); multiplier++) {
+			int base_guess = min_alpha - multiplier * t_min;
+			for (int base = std::max(base_guess - 1, 0); base <= std::min(base_guess + 1, 255); base++) {
+				int error = 0;
+				uint64_t selector_bits = 0;
+				for (int k = 0; k < 16 && error < best_error; k++) {
+					int alpha = block[((k % 4) * 4 + k / 4) * 4 + 3]; // k runs down the columns
+					int best_s = 0, best_d = 1 << 30;
+					for (int s = 0; s < 8; s++) {
+						int d = clampByte(base + EAC_MODIFIERS[t][s] * multiplier) - alpha;
+						d *= d;
+						if (d < best_d) {
+							best_d = d;
+							best_s = s;
+						}
+					}
+					error += best_d;
+					selector_bits |= (uint64_t)best_s << (45 - 3 * k);
+				}
+				if (error < best_error) {
+					best_error = error;
+					best_bits = (uint64_t)base << 56 | (uint64_t)multiplier << 52 | (uint64_t)t << 48 | selector_bits;
+				}
+			}
+		}
+	}
+	return best_bits;
+}
+
+inline void encodeBlockETC2(const unsigned char* block, unsigned char* out) {
+	storeBigEndian64(encodeEACAlpha(block), out);
+	storeBigEndian64(encodeETC1Color(block), out + 8);
+}
+
+// ---------------------------------------------------------------- images
+
+// copy the 4x4 block at (block_x, block_y) out of an RGBA8 image, pixels past the edge repeat the last row/column
+inline void extractBlock(const unsigned char* rgba, int width, int height, int block_x, int block_y, unsigned char* block) {
+	for (int y = 0; y < 4; y++) {
+		int sy = std::min(block_y * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++) {
+			int sx = std::min(block_x * 4 + x, width - 1);
+			std::memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+		}
+	}
+}
+
+// next mip level of an RGBA8 image with a 2x2 box filter
+inline std::vector<unsigned char> downsampleRGBA(const unsigned char* rgba, int width, int height, int* out_width, int* out_height) {
+	int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+	std::vector<unsigned char> result((size_t)w * h * 4);
+	for (int y = 0; y < h; y++) {
+		int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < w; x++) {
+			int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; c++) {
+				int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c]
+					+ rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+				result[((size_t)y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	*out_width = w;
+	*out_height = h;
+	return result;
+}
@@ -0,0 +1,1165 @@
+#pragma once
+// block encoder functions defined here
+// the BC1 and BC7 encoders, for textures made while the program runs (procedural content, captured frames reused as
+// textures) fast enough to redo every frame, and for the offline cookers through compressImage()
+//
+//   BC1         - principal axis endpoints, indices from projecting onto the endpoint line, one least squares refit.
+//                 blocks with pixels below half alpha use the 3 color mode and fit only their opaque pixels
+//   BC7 Fast    - mode 6 (one subset, RGBA), principal axis endpoints and projected indices
+//   BC7 Normal  - mode 6 plus a least squares refit of the endpoints, blocks with varying alpha also try mode 5 (color
+//                 and alpha on separate lines, what edges between transparent and opaque pixels need)
+//   BC7 High    - the same refit twice, opaque blocks also try mode 1 (two RGB subsets) on the partitions that suit them
+//
+// the per pixel work (splitting a block into channels, moments, projections, palette fitting) runs in SSE4.1 / AVX2 /
+// NEON kernels picked once at startup like the ones in pixel_convert.h. every kernel only sums whole numbers or works on
+// each pixel on its own, so all of them produce exactly the blocks the scalar code does
+//
+// encodeImage() spreads rows of blocks over the job system, compressImage() encodes on the calling thread
+
+#include <block_compress.h>
+#include <job_system.h>
+#include <pixel_convert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+enum class EncodeQuality {
+	Fast,
+	Normal,
+	High,
+};
+
+inline const char* encodeQualityName(EncodeQuality quality) {
+	switch (quality) {
+	case EncodeQuality::Normal: return "normal";
+	case EncodeQuality::High: return "high";
+	default: return "fast";
+	}
+}
+
+// one 4x4 block split into channels, rows first, the kernels read four or eight pixels at a time
+struct EncoderBlock {
+	alignas(32) float channel[4][16];
+	unsigned char rgba[64]; // the same pixels as bytes, for the ETC2 encoder
+	int min_alpha;
+};
+
+// palette between two endpoints: entry k is ((scale - w) * e0 + w * e1 + bias) / scale rounded down, with the weight
+// w = round(k * scale / (levels - 1)). BC7 interpolates in 64ths and rounds, BC1 in thirds (halves in 3 color mode) and
+// truncates
+struct PaletteShape {
+	int levels;
+	float scale;
+	float bias;
+};
+
+const PaletteShape BC1_PALETTE = { 4, 3.0f, 0.0f };
+const PaletteShape BC1_PALETTE_3COLOR = { 3, 2.0f, 0.0f };
+const PaletteShape BC7_PALETTE_2BIT = { 4, 64.0f, 32.0f };
+const PaletteShape BC7_PALETTE_3BIT = { 8, 64.0f, 32.0f };
+const PaletteShape BC7_PALETTE_4BIT = { 16, 64.0f, 32.0f };
+
+// moments of the pixels a weights array (0 or 1 per pixel) selects: count, sum of every channel, then the sums of
+// products r*r r*g r*b r*a g*g g*b g*a b*b b*a a*a. whole numbers below 2^24, so float sums them exactly in any order
+const int BLOCK_MOMENTS = 15;
+
+const float ALL_PIXELS[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+// scalar reference
+
+inline void loadBlockScalar(const unsigned char* const* rows, EncoderBlock& block) {
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 4; x++)
+			for (int c = 0; c < 4; c++)
+				block.channel[c][y * 4 + x] = rows[y][x * 4 + c];
+}
+
+inline void blockMomentsScalar(const EncoderBlock& block, const float* weights, float* moments) {
+	for (int m = 0; m < BLOCK_MOMENTS; m++)
+		moments[m] = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float w = weights[i];
+		moments[0] += w;
+		int m = 5;
+		for (int a = 0; a < 4; a++) {
+			float wa = w * block.channel[a][i];
+			moments[1 + a] += wa;
+			for (int b = a; b < 4; b++)
+				moments[m++] += wa * block.channel[b][i];
+		}
+	}
+}
+
+// lowest and highest position of the selected pixels along 'axis' through 'mean'
+inline void axisExtentScalar(const EncoderBlock& block, const float* weights, const float* mean, const float* axis, int channels,
+	float* low, float* high) {
+	*low = 1e30f;
+	*high = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (block.channel[c][i] - mean[c]) * axis[c];
+		if (weights[i] > 0.0f) {
+			*low = std::min(*low, t);
+			*high = std::max(*high, t);
+		}
+	}
+}
+
+// palette entries for every pixel by rounding its projection onto the endpoint line, returns the squared error of the
+// selected pixels. endpoints are whole numbers, which keeps the projection exact
+inline float fitPaletteScalar(const EncoderBlock& block, const float* weights, const float* e0, const float* e1, int channels,
+	const PaletteShape& shape, unsigned char* indices) {
+	float d[4] = {}, length = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		d[c] = e1[c] - e0[c];
+		length += d[c] * d[c];
+	}
+	float to_index = length > 0.0f ? (shape.levels - 1) / length : 0.0f;
+	float last = (float)(shape.levels - 1), to_weight = shape.scale / (shape.levels - 1);
+
+	float error = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (block.channel[c][i] - e0[c]) * d[c];
+		float k = std::floor(std::min(std::max(t * to_index, 0.0f), last) + 0.5f);
+		float w = std::floor(k * to_weight + 0.5f);
+		float pixel_error = 0.0f;
+		for (int c = 0; c < channels; c++) {
+			float value = std::floor(((shape.scale - w) * e0[c] + w * e1[c] + shape.bias) / shape.scale);
+			float difference = block.channel[c][i] - value;
+			pixel_error += difference * difference;
+		}
+		error += pixel_error * weights[i];
+		indices[i] = (unsigned char)k;
+	}
+	return error;
+}
+
+#if defined(PIXEL_X86)
+
+PIXEL_TARGET("sse4.1")
+inline float horizontalSumSSE41(__m128 v) {
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+// the sums of four vectors at once
+PIXEL_TARGET("sse4.1")
+inline __m128 horizontalSums4SSE41(__m128 a, __m128 b, __m128 c, __m128 d) {
+	return _mm_hadd_ps(_mm_hadd_ps(a, b), _mm_hadd_ps(c, d));
+}
+
+PIXEL_TARGET("sse4.1")
+inline float horizontalMinSSE41(__m128 v) {
+	v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_min_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+PIXEL_TARGET("sse4.1")
+inline float horizontalMaxSSE41(__m128 v) {
+	v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+// SSE4.1, a row of four pixels per step
+PIXEL_TARGET("sse4.1")
+inline void loadBlockSSE41(const unsigned char* const* rows, EncoderBlock& block) {
+	const __m128i planar = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+	for (int y = 0; y < 4; y++) {
+		__m128i bytes = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)rows[y]), planar);
+		_mm_store_ps(block.channel[0] + y * 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes)));
+		_mm_store_ps(block.channel[1] + y * 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4))));
+		_mm_store_ps(block.channel[2] + y * 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8))));
+		_mm_store_ps(block.channel[3] + y * 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12))));
+	}
+}
+
+PIXEL_TARGET("sse4.1")
+inline void blockMomentsSSE41(const EncoderBlock& block, const float* weights, float* moments) {
+	__m128 sums[BLOCK_MOMENTS];
+	for (int m = 0; m < BLOCK_MOMENTS; m++)
+		sums[m] = _mm_setzero_ps();
+	for (int i = 0; i < 16; i += 4) {
+		__m128 w = _mm_loadu_ps(weights + i);
+		__m128 p[4] = { _mm_load_ps(block.channel[0] + i), _mm_load_ps(block.channel[1] + i),
+			_mm_load_ps(block.channel[2] + i), _mm_load_ps(block.channel[3] + i) };
+		sums[0] = _mm_add_ps(sums[0], w);
+		int m = 5;
+		for (int a = 0; a < 4; a++) {
+			__m128 wa = _mm_mul_ps(w, p[a]);
+			sums[1 + a] = _mm_add_ps(sums[1 + a], wa);
+			for (int b = a; b < 4; b++, m++)
+				sums[m] = _mm_add_ps(sums[m], _mm_mul_ps(wa, p[b]));
+		}
+	}
+	alignas(16) float totals[16];
+	__m128 zero = _mm_setzero_ps();
+	for (int m = 0; m < 16; m += 4)
+		_mm_store_ps(totals + m, horizontalSums4SSE41(sums[m], sums[m + 1], sums[m + 2], m + 3 < BLOCK_MOMENTS ? sums[m + 3] : zero));
+	std::memcpy(moments, totals, BLOCK_MOMENTS * sizeof(float));
+}
+
+PIXEL_TARGET("sse4.1")
+inline void axisExtentSSE41(const EncoderBlock& block, const float* weights, const float* mean, const float* axis, int channels,
+	float* low, float* high) {
+	__m128 lowest = _mm_set1_ps(1e30f), highest = _mm_set1_ps(-1e30f);
+	for (int i = 0; i < 16; i += 4) {
+		__m128 t = _mm_setzero_ps();
+		for (int c = 0; c < channels; c++)
+			t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.channel[c] + i), _mm_set1_ps(mean[c])), _mm_set1_ps(axis[c])));
+		__m128 selected = _mm_cmpgt_ps(_mm_loadu_ps(weights + i), _mm_setzero_ps());
+		lowest = _mm_blendv_ps(lowest, _mm_min_ps(lowest, t), selected);
+		highest = _mm_blendv_ps(highest, _mm_max_ps(highest, t), selected);
+	}
+	*low = horizontalMinSSE41(lowest);
+	*high = horizontalMaxSSE41(highest);
+}
+
+PIXEL_TARGET("sse4.1")
+inline float fitPaletteSSE41(const EncoderBlock& block, const float* weights, const float* e0, const float* e1, int channels,
+	const PaletteShape& shape, unsigned char* indices) {
+	float d[4] = {}, length = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		d[c] = e1[c] - e0[c];
+		length += d[c] * d[c];
+	}
+	const __m128 to_index = _mm_set1_ps(length > 0.0f ? (shape.levels - 1) / length : 0.0f);
+	const __m128 last = _mm_set1_ps((float)(shape.levels - 1)), to_weight = _mm_set1_ps(shape.scale / (shape.levels - 1));
+	const __m128 scale = _mm_set1_ps(shape.scale), bias = _mm_set1_ps(shape.bias), half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+
+	__m128 error = zero;
+	alignas(16) int32_t chosen[16];
+	for (int i = 0; i < 16; i += 4) {
+		__m128 p[4];
+		__m128 t = zero;
+		for (int c = 0; c < channels; c++) {
+			p[c] = _mm_load_ps(block.channel[c] + i);
+			t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(p[c], _mm_set1_ps(e0[c])), _mm_set1_ps(d[c])));
+		}
+		__m128 k = _mm_floor_ps(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(t, to_index), zero), last), half));
+		__m128 w = _mm_floor_ps(_mm_add_ps(_mm_mul_ps(k, to_weight), half));
+		__m128 w0 = _mm_sub_ps(scale, w);
+		__m128 pixel_error = zero;
+		for (int c = 0; c < channels; c++) {
+			__m128 mixed = _mm_add_ps(_mm_mul_ps(w0, _mm_set1_ps(e0[c])), _mm_mul_ps(w, _mm_set1_ps(e1[c])));
+			__m128 value = _mm_floor_ps(_mm_div_ps(_mm_add_ps(mixed, bias), scale));
+			__m128 difference = _mm_sub_ps(p[c], value);
+			pixel_error = _mm_add_ps(pixel_error, _mm_mul_ps(difference, difference));
+		}
+		error = _mm_add_ps(error, _mm_mul_ps(pixel_error, _mm_loadu_ps(weights + i)));
+		_mm_store_si128((__m128i*)(chosen + i), _mm_cvttps_epi32(k));
+	}
+	for (int i = 0; i < 16; i++)
+		indices[i] = (unsigned char)chosen[i];
+	return horizontalSumSSE41(error);
+}
+
+// AVX2, two rows of the block (eight pixels) per step
+
+PIXEL_TARGET("avx2")
+inline float horizontalSumAVX2(__m256 v) {
+	return horizontalSumSSE41(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+PIXEL_TARGET("avx2")
+inline void loadBlockAVX2(const unsigned char* const* rows, EncoderBlock& block) {
+	const __m256i planar = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+		0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+	// r g b a of the first row then of the second, gathered into rr gg bb aa
+	const __m256i pairs = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	for (int y = 0; y < 4; y += 2) {
+		__m256i bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(loadLanes(rows[y], rows[y + 1]), planar), pairs);
+		__m128i low = _mm256_castsi256_si128(bytes), high = _mm256_extracti128_si256(bytes, 1);
+		_mm256_store_ps(block.channel[0] + y * 4, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(low)));
+		_mm256_store_ps(block.channel[1] + y * 4, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(low, 8))));
+		_mm256_store_ps(block.channel[2] + y * 4, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(high)));
+		_mm256_store_ps(block.channel[3] + y * 4, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(high, 8))));
+	}
+}
+
+PIXEL_TARGET("avx2")
+inline void blockMomentsAVX2(const EncoderBlock& block, const float* weights, float* moments) {
+	__m256 sums[BLOCK_MOMENTS];
+	for (int m = 0; m < BLOCK_MOMENTS; m++)
+		sums[m] = _mm256_setzero_ps();
+	for (int i = 0; i < 16; i += 8) {
+		__m256 w = _mm256_loadu_ps(weights + i);
+		__m256 p[4] = { _mm256_load_ps(block.channel[0] + i), _mm256_load_ps(block.channel[1] + i),
+			_mm256_load_ps(block.channel[2] + i), _mm256_load_ps(block.channel[3] + i) };
+		sums[0] = _mm256_add_ps(sums[0], w);
+		int m = 5;
+		for (int a = 0; a < 4; a++) {
+			__m256 wa = _mm256_mul_ps(w, p[a]);
+			sums[1 + a] = _mm256_add_ps(sums[1 + a], wa);
+			for (int b = a; b < 4; b++, m++)
+				sums[m] = _mm256_add_ps(sums[m], _mm256_mul_ps(wa, p[b]));
+		}
+	}
+	__m128 halves[16];
+	for (int m = 0; m < BLOCK_MOMENTS; m++)
+		halves[m] = _mm_add_ps(_mm256_castps256_ps128(sums[m]), _mm256_extractf128_ps(sums[m], 1));
+	halves[15] = _mm_setzero_ps();
+	alignas(16) float totals[16];
+	for (int m = 0; m < 16; m += 4)
+		_mm_store_ps(totals + m, horizontalSums4SSE41(halves[m], halves[m + 1], halves[m + 2], halves[m + 3]));
+	std::memcpy(moments, totals, BLOCK_MOMENTS * sizeof(float));
+}
+
+PIXEL_TARGET("avx2")
+inline void axisExtentAVX2(const EncoderBlock& block, const float* weights, const float* mean, const float* axis, int channels,
+	float* low, float* high) {
+	__m256 lowest = _mm256_set1_ps(1e30f), highest = _mm256_set1_ps(-1e30f);
+	for (int i = 0; i < 16; i += 8) {
+		__m256 t = _mm256_setzero_ps();
+		for (int c = 0; c < channels; c++)
+			t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.channel[c] + i), _mm256_set1_ps(mean[c])),
+				_mm256_set1_ps(axis[c])));
+		__m256 selected = _mm256_cmp_ps(_mm256_loadu_ps(weights + i), _mm256_setzero_ps(), _CMP_GT_OQ);
+		lowest = _mm256_blendv_ps(lowest, _mm256_min_ps(lowest, t), selected);
+		highest = _mm256_blendv_ps(highest, _mm256_max_ps(highest, t), selected);
+	}
+	*low = horizontalMinSSE41(_mm_min_ps(_mm256_castps256_ps128(lowest), _mm256_extractf128_ps(lowest, 1)));
+	*high = horizontalMaxSSE41(_mm_max_ps(_mm256_castps256_ps128(highest), _mm256_extractf128_ps(highest, 1)));
+}
+
+PIXEL_TARGET("avx2")
+inline float fitPaletteAVX2(const EncoderBlock& block, const float* weights, const float* e0, const float* e1, int channels,
+	const PaletteShape& shape, unsigned char* indices) {
+	float d[4] = {}, length = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		d[c] = e1[c] - e0[c];
+		length += d[c] * d[c];
+	}
+	const __m256 to_index = _mm256_set1_ps(length > 0.0f ? (shape.levels - 1) / length : 0.0f);
+	const __m256 last = _mm256_set1_ps((float)(shape.levels - 1)), to_weight = _mm256_set1_ps(shape.scale / (shape.levels - 1));
+	const __m256 scale = _mm256_set1_ps(shape.scale), bias = _mm256_set1_ps(shape.bias), half = _mm256_set1_ps(0.5f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256 error = zero;
+	alignas(32) int32_t chosen[16];
+	for (int i = 0; i < 16; i += 8) {
+		__m256 p[4];
+		__m256 t = zero;
+		for (int c = 0; c < channels; c++) {
+			p[c] = _mm256_load_ps(block.channel[c] + i);
+			t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_sub_ps(p[c], _mm256_set1_ps(e0[c])), _mm256_set1_ps(d[c])));
+		}
+		__m256 k = _mm256_floor_ps(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(t, to_index), zero), last), half));
+		__m256 w = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(k, to_weight), half));
+		__m256 w0 = _mm256_sub_ps(scale, w);
+		__m256 pixel_error = zero;
+		for (int c = 0; c < channels; c++) {
+			__m256 mixed = _mm256_add_ps(_mm256_mul_ps(w0, _mm256_set1_ps(e0[c])), _mm256_mul_ps(w, _mm256_set1_ps(e1[c])));
+			__m256 value = _mm256_floor_ps(_mm256_div_ps(_mm256_add_ps(mixed, bias), scale));
+			__m256 difference = _mm256_sub_ps(p[c], value);
+			pixel_error = _mm256_add_ps(pixel_error, _mm256_mul_ps(difference, difference));
+		}
+		error = _mm256_add_ps(error, _mm256_mul_ps(pixel_error, _mm256_loadu_ps(weights + i)));
+		_mm256_store_si256((__m256i*)(chosen + i), _mm256_cvttps_epi32(k));
+	}
+	for (int i = 0; i < 16; i++)
+		indices[i] = (unsigned char)chosen[i];
+	return horizontalSumAVX2(error);
+}
+
+#endif
+
+#if defined(PIXEL_NEON)
+
+// separate multiplies and adds rather than vmlaq / vfmaq, the same operations in the same order as the scalar code
+
+inline void loadBlockNEON(const unsigned char* const* rows, EncoderBlock& block) {
+	const unsigned char order[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+	const uint8x16_t planar = vld1q_u8(order);
+	for (int y = 0; y < 4; y++) {
+		uint8x16_t bytes = vqtbl1q_u8(vld1q_u8(rows[y]), planar);
+		uint16x8_t rg = vmovl_u8(vget_low_u8(bytes)), ba = vmovl_u8(vget_high_u8(bytes));
+		vst1q_f32(block.channel[0] + y * 4, vcvtq_f32_u32(vmovl_u16(vget_low_u16(rg))));
+		vst1q_f32(block.channel[1] + y * 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(rg))));
+		vst1q_f32(block.channel[2] + y * 4, vcvtq_f32_u32(vmovl_u16(vget_low_u16(ba))));
+		vst1q_f32(block.channel[3] + y * 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(ba))));
+	}
+}
+
+inline void blockMomentsNEON(const EncoderBlock& block, const float* weights, float* moments) {
+	float32x4_t sums[BLOCK_MOMENTS];
+	for (int m = 0; m < BLOCK_MOMENTS; m++)
+		sums[m] = vdupq_n_f32(0.0f);
+	for (int i = 0; i < 16; i += 4) {
+		float32x4_t w = vld1q_f32(weights + i);
+		float32x4_t p[4] = { vld1q_f32(block.channel[0] + i), vld1q_f32(block.channel[1] + i),
+			vld1q_f32(block.channel[2] + i), vld1q_f32(block.channel[3] + i) };
+		sums[0] = vaddq_f32(sums[0], w);
+		int m = 5;
+		for (int a = 0; a < 4; a++) {
+			float32x4_t wa = vmulq_f32(w, p[a]);
+			sums[1 + a] = vaddq_f32(sums[1 + a], wa);
+			for (int b = a; b < 4; b++, m++)
+				sums[m] = vaddq_f32(sums[m], vmulq_f32(wa, p[b]));
+		}
+	}
+	for (int m = 0; m < BLOCK_MOMENTS; m++)
+		moments[m] = vaddvq_f32(sums[m]);
+}
+
+inline void axisExtentNEON(const EncoderBlock& block, const float* weights, const float* mean, const float* axis, int channels,
+	float* low, float* high) {
+	float32x4_t lowest = vdupq_n_f32(1e30f), highest = vdupq_n_f32(-1e30f);
+	for (int i = 0; i < 16; i += 4) {
+		float32x4_t t = vdupq_n_f32(0.0f);
+		for (int c = 0; c < channels; c++)
+			t = vaddq_f32(t, vmulq_f32(vsubq_f32(vld1q_f32(block.channel[c] + i), vdupq_n_f32(mean[c])), vdupq_n_f32(axis[c])));
+		uint32x4_t selected = vcgtq_f32(vld1q_f32(weights + i), vdupq_n_f32(0.0f));
+		lowest = vbslq_f32(selected, vminq_f32(lowest, t), lowest);
+		highest = vbslq_f32(selected, vmaxq_f32(highest, t), highest);
+	}
+	*low = vminvq_f32(lowest);
+	*high = vmaxvq_f32(highest);
+}
+
+inline float fitPaletteNEON(const EncoderBlock& block, const float* weights, const float* e0, const float* e1, int channels,
+	const PaletteShape& shape, unsigned char* indices) {
+	float d[4] = {}, length = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		d[c] = e1[c] - e0[c];
+		length += d[c] * d[c];
+	}
+	const float32x4_t to_index = vdupq_n_f32(length > 0.0f ? (shape.levels - 1) / length : 0.0f);
+	const float32x4_t last = vdupq_n_f32((float)(shape.levels - 1)), to_weight = vdupq_n_f32(shape.scale / (shape.levels - 1));
+	const float32x4_t scale = vdupq_n_f32(shape.scale), bias = vdupq_n_f32(shape.bias), half = vdupq_n_f32(0.5f);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+
+	float32x4_t error = zero;
+	for (int i = 0; i < 16; i += 4) {
+		float32x4_t p[4];
+		float32x4_t t = zero;
+		for (int c = 0; c < channels; c++) {
+			p[c] = vld1q_f32(block.channel[c] + i);
+			t = vaddq_f32(t, vmulq_f32(vsubq_f32(p[c], vdupq_n_f32(e0[c])), vdupq_n_f32(d[c])));
+		}
+		float32x4_t k = vrndmq_f32(vaddq_f32(vminq_f32(vmaxq_f32(vmulq_f32(t, to_index), zero), last), half));
+		float32x4_t w = vrndmq_f32(vaddq_f32(vmulq_f32(k, to_weight), half));
+		float32x4_t w0 = vsubq_f32(scale, w);
+		float32x4_t pixel_error = zero;
+		for (int c = 0; c < channels; c++) {
+			float32x4_t mixed = vaddq_f32(vmulq_f32(w0, vdupq_n_f32(e0[c])), vmulq_f32(w, vdupq_n_f32(e1[c])));
+			float32x4_t value = vrndmq_f32(vdivq_f32(vaddq_f32(mixed, bias), scale));
+			float32x4_t difference = vsubq_f32(p[c], value);
+			pixel_error = vaddq_f32(pixel_error, vmulq_f32(difference, difference));
+		}
+		error = vaddq_f32(error, vmulq_f32(pixel_error, vld1q_f32(weights + i)));
+		uint16x4_t narrow = vmovn_u32(vcvtq_u32_f32(k));
+		uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(narrow, narrow))), 0);
+		std::memcpy(indices + i, &packed, 4);
+	}
+	return vaddvq_f32(error);
+}
+
+#endif
+
+// the kernel set in use, one function pointer per operation
+struct BlockEncoderKernels {
+	SimdLevel level = SimdLevel::Scalar;
+	void (*loadBlock)(const unsigned char* const*, EncoderBlock&) = loadBlockScalar;
+	void (*blockMoments)(const EncoderBlock&, const float*, float*) = blockMomentsScalar;
+	void (*axisExtent)(const EncoderBlock&, const float*, const float*, const float*, int, float*, float*) = axisExtentScalar;
+	float (*fitPalette)(const EncoderBlock&, const float*, const float*, const float*, int, const PaletteShape&, unsigned char*) = fitPaletteScalar;
+};
+
+inline BlockEncoderKernels makeBlockEncoderKernels(SimdLevel level) {
+	BlockEncoderKernels kernels;
+	kernels.level = level;
+#if defined(PIXEL_X86)
+	if (level == SimdLevel::SSE41) {
+		kernels.loadBlock = loadBlockSSE41;
+		kernels.blockMoments = blockMomentsSSE41;
+		kernels.axisExtent = axisExtentSSE41;
+		kernels.fitPalette = fitPaletteSSE41;
+	}
+	if (level == SimdLevel::AVX2) {
+		kernels.loadBlock = loadBlockAVX2;
+		kernels.blockMoments = blockMomentsAVX2;
+		kernels.axisExtent = axisExtentAVX2;
+		kernels.fitPalette = fitPaletteAVX2;
+	}
+#elif defined(PIXEL_NEON)
+	if (level == SimdLevel::NEON) {
+		kernels.loadBlock = loadBlockNEON;
+		kernels.blockMoments = blockMomentsNEON;
+		kernels.axisExtent = axisExtentNEON;
+		kernels.fitPalette = fitPaletteNEON;
+	}
+#endif
+	return kernels;
+}
+
+// kernels for the best level the CPU supports, picked on first use
+inline BlockEncoderKernels& blockEncoderKernels() {
+	static BlockEncoderKernels kernels = makeBlockEncoderKernels(detectSimdLevel());
+	return kernels;
+}
+
+// force a lower level, for benchmarks and for checking kernels against each other, false if the CPU cannot run 'level'
+inline bool setBlockEncoderLevel(SimdLevel level) {
+	SimdLevel best = detectSimdLevel();
+	bool supported = level == SimdLevel::Scalar || level == best || (level == SimdLevel::SSE41 && best == SimdLevel::AVX2);
+	if (supported)
+		blockEncoderKernels() = makeBlockEncoderKernels(level);
+	return supported;
+}
+
+// ---------------------------------------------------------------- shared steps
+
+// split the block whose rows start at 'rows' into channels
+inline void loadEncoderBlock(const unsigned char* const* rows, EncoderBlock& block) {
+	blockEncoderKernels().loadBlock(rows, block);
+	block.min_alpha = 255;
+	for (int y = 0; y < 4; y++) {
+		std::memcpy(block.rgba + y * 16, rows[y], 16);
+		for (int x = 0; x < 4; x++)
+			block.min_alpha = std::min(block.min_alpha, (int)rows[y][x * 4 + 3]);
+	}
+}
+
+// mean and principal axis from the moments, power iteration on the covariance matrix. returns the variance along the axis
+inline float momentsAxis(const float* moments, int channels, float* mean, float* axis, int iterations = 8) {
+	float count = std::max(moments[0], 1.0f);
+	for (int c = 0; c < 4; c++)
+		mean[c] = moments[1 + c] / count;
+
+	float covariance[4][4];
+	int m = 5;
+	for (int a = 0; a < 4; a++)
+		for (int b = a; b < 4; b++, m++)
+			covariance[a][b] = covariance[b][a] = moments[m] - moments[1 + a] * moments[1 + b] / count;
+
+	float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float variance = 0.0f;
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		float next[4] = {};
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * v[b];
+			length = std::max(length, std::fabs(next[a]));
+		}
+		if (length < 1e-6f)
+			break;
+		for (int a = 0; a < channels; a++)
+			v[a] = next[a] / length;
+		variance = length;
+	}
+
+	float length = 0.0f;
+	for (int c = 0; c < channels; c++)
+		length += v[c] * v[c];
+	length = std::sqrt(length);
+	for (int c = 0; c < 4; c++)
+		axis[c] = c < channels && length > 0.0f ? v[c] / length : 0.0f;
+	// with the largest component of v kept at 1, the largest component of C v converges to the largest eigenvalue
+	return variance;
+}
+
+// endpoints at the extremes of the selected pixels along their principal axis
+inline void momentsEndpoints(const EncoderBlock& block, const float* weights, const float* moments, int channels, float* low, float* high) {
+	const BlockEncoderKernels& kernels = blockEncoderKernels();
+	float mean[4], axis[4], t_low, t_high;
+	momentsAxis(moments, channels, mean, axis);
+	kernels.axisExtent(block, weights, mean, axis, channels, &t_low, &t_high);
+	for (int c = 0; c < 4; c++) {
+		low[c] = std::min(std::max(mean[c] + axis[c] * t_low, 0.0f), 255.0f);
+		high[c] = std::min(std::max(mean[c] + axis[c] * t_high, 0.0f), 255.0f);
+	}
+}
+
+// least squares endpoints for the palette entries the pixels already use, false when every pixel sits on one entry
+inline bool refitEndpoints(const EncoderBlock& block, const float* weights, const unsigned char* indices, int channels,
+	const PaletteShape& shape, float* low, float* high) {
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f, xa[4] = {}, xb[4] = {};
+	for (int i = 0; i < 16; i++) {
+		if (weights[i] == 0.0f)
+			continue;
+		float t = std::floor(indices[i] * shape.scale / (shape.levels - 1) + 0.5f) / shape.scale;
+		float s = 1.0f - t;
+		aa += s * s;
+		ab += s * t;
+		bb += t * t;
+		for (int c = 0; c < channels; c++) {
+			xa[c] += s * block.channel[c][i];
+			xb[c] += t * block.channel[c][i];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+		return false;
+	for (int c = 0; c < channels; c++) {
+		low[c] = std::min(std::max((bb * xa[c] - ab * xb[c]) / determinant, 0.0f), 255.0f);
+		high[c] = std::min(std::max((aa * xb[c] - ab * xa[c]) / determinant, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+// ---------------------------------------------------------------- BC1
+
+inline uint16_t packRGB565(const float* color) {
+	int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t packed, int* color) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+const unsigned char BC1_ORDER[4] = { 0, 2, 3, 1 }; // stored index of the palette entries from c0 to c1
+const unsigned char BC1_ORDER_3COLOR[3] = { 0, 2, 1 }; // the same in 3 color mode, 3 is transparent black
+
+// the two 565 endpoints for 'low'/'high' in 4 color order (c0 > c1) fitted against the block, false when they are equal
+inline float fitBC1(const EncoderBlock& block, const float* low, const float* high, uint16_t* c0, uint16_t* c1, unsigned char* indices) {
+	*c0 = packRGB565(high);
+	*c1 = packRGB565(low);
+	if (*c0 < *c1)
+		std::swap(*c0, *c1);
+	int expanded[2][3];
+	unpackRGB565(*c0, expanded[0]);
+	unpackRGB565(*c1, expanded[1]);
+	float e0[3] = { (float)expanded[0][0], (float)expanded[0][1], (float)expanded[0][2] };
+	float e1[3] = { (float)expanded[1][0], (float)expanded[1][1], (float)expanded[1][2] };
+	return blockEncoderKernels().fitPalette(block, ALL_PIXELS, e0, e1, 3, BC1_PALETTE, indices);
+}
+
+inline void storeBC1(uint16_t c0, uint16_t c1, uint32_t bits, unsigned char* out) {
+	out[0] = c0 & 0xFF;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xFF;
+	out[3] = c1 >> 8;
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (bits >> (8 * i)) & 0xFF;
+}
+
+// punch through alpha: 3 color mode (c0 <= c1), pixels below half alpha take the transparent index and the endpoints
+// are fitted to the others
+inline void encodeBC1Transparent(const EncoderBlock& block, unsigned char* out) {
+	float opaque[16];
+	bool any_opaque = false;
+	for (int i = 0; i < 16; i++) {
+		opaque[i] = block.rgba[i * 4 + 3] < 128 ? 0.0f : 1.0f;
+		any_opaque |= opaque[i] > 0.0f;
+	}
+	if (!any_opaque) {
+		storeBC1(0, 0, 0xFFFFFFFFu, out);
+		return;
+	}
+
+	const BlockEncoderKernels& kernels = blockEncoderKernels();
+	float moments[BLOCK_MOMENTS], low[4], high[4];
+	kernels.blockMoments(block, opaque, moments);
+	momentsEndpoints(block, opaque, moments, 3, low, high);
+
+	auto fit = [&](uint16_t* c0, uint16_t* c1, unsigned char* indices) {
+		*c0 = packRGB565(low);
+		*c1 = packRGB565(high);
+		if (*c0 > *c1)
+			std::swap(*c0, *c1);
+		int expanded[2][3];
+		unpackRGB565(*c0, expanded[0]);
+		unpackRGB565(*c1, expanded[1]);
+		float e0[3] = { (float)expanded[0][0], (float)expanded[0][1], (float)expanded[0][2] };
+		float e1[3] = { (float)expanded[1][0], (float)expanded[1][1], (float)expanded[1][2] };
+		return kernels.fitPalette(block, opaque, e0, e1, 3, BC1_PALETTE_3COLOR, indices);
+	};
+	uint16_t c0, c1;
+	unsigned char indices[16];
+	float error = fit(&c0, &c1, indices);
+	if (error > 0.0f && refitEndpoints(block, opaque, indices, 3, BC1_PALETTE_3COLOR, low, high)) {
+		uint16_t r0, r1;
+		unsigned char refit[16];
+		if (fit(&r0, &r1, refit) < error) {
+			c0 = r0;
+			c1 = r1;
+			std::memcpy(indices, refit, 16);
+		}
+	}
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint32_t)(opaque[i] > 0.0f ? BC1_ORDER_3COLOR[indices[i]] : 3) << (2 * i);
+	storeBC1(c0, c1, bits, out);
+}
+
+inline void encodeBC1(const EncoderBlock& block, unsigned char* out) {
+	if (block.min_alpha < 128) {
+		encodeBC1Transparent(block, out);
+		return;
+	}
+
+	const BlockEncoderKernels& kernels = blockEncoderKernels();
+	float moments[BLOCK_MOMENTS], low[4], high[4];
+	kernels.blockMoments(block, ALL_PIXELS, moments);
+	momentsEndpoints(block, ALL_PIXELS, moments, 3, low, high);
+
+	uint16_t c0, c1;
+	unsigned char indices[16];
+	float error = fitBC1(block, low, high, &c0, &c1, indices);
+	if (error > 0.0f && refitEndpoints(block, ALL_PIXELS, indices, 3, BC1_PALETTE, low, high)) {
+		uint16_t r0, r1;
+		unsigned char refit[16];
+		if (fitBC1(block, low, high, &r0, &r1, refit) < error) {
+			c0 = r0;
+			c1 = r1;
+			std::memcpy(indices, refit, 16);
+		}
+	}
+
+	// equal endpoints select the 3 color mode, where entry 0 is still c0
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint32_t)(c0 == c1 ? 0 : BC1_ORDER[indices[i]]) << (2 * i);
+	storeBC1(c0, c1, bits, out);
+}
+
+// ---------------------------------------------------------------- BC7
+
+// two subset partitions, bit i set puts pixel i in the second subset
+const uint16_t BC7_PARTITIONS2[64] = {
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+// pixel whose index of the second subset is stored without its top bit, the first subset's is always pixel 0
+const unsigned char BC7_ANCHORS2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+const int BC7_MODE1_CANDIDATES = 3;       // partitions fully encoded in High quality, the best estimates first
+const int BC7_PARTITION_ITERATIONS = 3;   // power iterations per subset when ranking partitions, a rough axis is enough
+
+// the partitions as weights arrays, [partition][subset][pixel]
+struct BC7PartitionWeights {
+	float weights[64][2][16];
+
+	BC7PartitionWeights() {
+		for (int p = 0; p < 64; p++)
+			for (int i = 0; i < 16; i++) {
+				float second = (float)((BC7_PARTITIONS2[p] >> i) & 1);
+				weights[p][0][i] = 1.0f - second;
+				weights[p][1][i] = second;
+			}
+	}
+};
+
+inline const BC7PartitionWeights& bc7PartitionWeights() {
+	static const BC7PartitionWeights tables;
+	return tables;
+}
+
+// appends bits to a 128 bit block, least significant bit first
+struct BlockBitWriter {
+	unsigned char* out;
+	int position = 0;
+
+	// a byte at a time, a field never touches more than three bytes
+	void write(uint32_t value, int bits) {
+		while (bits > 0) {
+			int shift = position & 7, count = std::min(8 - shift, bits);
+			out[position >> 3] |= (unsigned char)((value & ((1u << count) - 1)) << shift);
+			value >>= count;
+			bits -= count;
+			position += count;
+		}
+	}
+};
+
+// quantize an RGBA endpoint to 7 bits per channel plus a shared p-bit, picking the p-bit with the lower error
+inline void quantizeBC7Endpoint(const float* color, int* quantized, int* pbit) {
+	int best_error = 1 << 30;
+	for (int p = 0; p < 2; p++) {
+		int q[4];
+		int error = 0;
+		for (int c = 0; c < 4; c++) {
+			q[c] = std::min(std::max((int)((color[c] - p) / 2.0f + 0.5f), 0), 127);
+			int d = ((q[c] << 1) | p) - (int)(color[c] + 0.5f);
+			error += d * d;
+		}
+		if (error < best_error) {
+			best_error = error;
+			*pbit = p;
+			for (int c = 0; c < 4; c++)
+				quantized[c] = q[c];
+		}
+	}
+}
+
+inline void packBC7Mode6(const int* q0, int p0, const int* q1, int p1, int* indices, unsigned char* out) {
+	// the anchor (first) index is stored with 3 bits, its top bit must be zero, flip the endpoints if it is not
+	if (indices[0] & 8) {
+		std::swap(q0, q1);
+		std::swap(p0, p1);
+		for (int i = 0; i < 16; i++)
+			indices[i] = 15 - indices[i];
+	}
+
+	std::memset(out, 0, 16);
+	BlockBitWriter writer = { out };
+	writer.write(1 << 6, 7); // mode 6
+	for (int c = 0; c < 4; c++) {
+		writer.write(q0[c], 7);
+		writer.write(q1[c], 7);
+	}
+	writer.write(p0, 1);
+	writer.write(p1, 1);
+	writer.write(indices[0], 3);
+	for (int i = 1; i < 16; i++)
+		writer.write(indices[i], 4);
+}
+
+struct BC7Mode6 {
+	int q[2][4], p[2];
+	unsigned char indices[16];
+	float error;
+};
+
+// quantize both endpoints for mode 6 and fit the block against them
+inline void fitBC7Mode6(const EncoderBlock& block, const float* low, const float* high, BC7Mode6& mode) {
+	quantizeBC7Endpoint(low, mode.q[0], &mode.p[0]);
+	quantizeBC7Endpoint(high, mode.q[1], &mode.p[1]);
+	float e[2][4];
+	for (int end = 0; end < 2; end++)
+		for (int c = 0; c < 4; c++)
+			e[end][c] = (float)((mode.q[end][c] << 1) | mode.p[end]);
+	mode.error = blockEncoderKernels().fitPalette(block, ALL_PIXELS, e[0], e[1], 4, BC7_PALETTE_4BIT, mode.indices);
+}
+
+inline BC7Mode6 encodeBC7Mode6(const EncoderBlock& block, const float* moments, int refits) {
+	float low[4], high[4];
+	momentsEndpoints(block, ALL_PIXELS, moments, 4, low, high);
+	BC7Mode6 best;
+	fitBC7Mode6(block, low, high, best);
+	for (int i = 0; i < refits && best.error > 0.0f; i++) {
+		if (!refitEndpoints(block, ALL_PIXELS, best.indices, 4, BC7_PALETTE_4BIT, low, high))
+			break;
+		BC7Mode6 refit;
+		fitBC7Mode6(block, low, high, refit);
+		if (refit.error >= best.error)
+			break;
+		best = refit;
+	}
+	return best;
+}
+
+// mode 1 endpoints are 6 bits per channel plus a p-bit shared by both endpoints of a subset
+inline int expandBC7Mode1(int q, int p) {
+	int value = (q << 1) | p;
+	return (value << 1) | (value >> 6);
+}
+
+inline float quantizeBC7Mode1(const float* low, const float* high, int* q0, int* q1, int* pbit) {
+	float best_error = 1e30f;
+	for (int p = 0; p < 2; p++) {
+		int candidate[2][3];
+		float error = 0.0f;
+		for (int end = 0; end < 2; end++)
+			for (int c = 0; c < 3; c++) {
+				float target = end == 0 ? low[c] : high[c];
+				int q = std::min(std::max((int)((target * 127.0f / 255.0f - p) / 2.0f), 0), 63);
+				// the rounding above can be one step short, try the next value up as well
+				float below = std::fabs(expandBC7Mode1(q, p) - target);
+				float above = q < 63 ? std::fabs(expandBC7Mode1(q + 1, p) - target) : 1e30f;
+				candidate[end][c] = above < below ? q + 1 : q;
+				error += std::min(below, above) * std::min(below, above);
+			}
+		if (error < best_error) {
+			best_error = error;
+			*pbit = p;
+			std::memcpy(q0, candidate[0], sizeof(candidate[0]));
+			std::memcpy(q1, candidate[1], sizeof(candidate[1]));
+		}
+	}
+	return best_error;
+}
+
+struct BC7Mode1 {
+	int partition;
+	int q[2][2][3], p[2]; // [subset][endpoint][channel]
+	unsigned char indices[2][16];
+	float error;
+};
+
+inline float fitBC7Mode1Subset(const EncoderBlock& block, const float* weights, const float* low, const float* high, BC7Mode1& mode, int subset) {
+	quantizeBC7Mode1(low, high, mode.q[subset][0], mode.q[subset][1], &mode.p[subset]);
+	float e[2][3];
+	for (int end = 0; end < 2; end++)
+		for (int c = 0; c < 3; c++)
+			e[end][c] = (float)expandBC7Mode1(mode.q[subset][end][c], mode.p[subset]);
+	return blockEncoderKernels().fitPalette(block, weights, e[0], e[1], 3, BC7_PALETTE_3BIT, mode.indices[subset]);
+}
+
+inline void encodeBC7Mode1(const EncoderBlock& block, const float (*subset_moments)[BLOCK_MOMENTS], int partition, BC7Mode1& mode) {
+	const BC7PartitionWeights& partitions = bc7PartitionWeights();
+	mode.partition = partition;
+	mode.error = 0.0f;
+	for (int subset = 0; subset < 2; subset++) {
+		const float* weights = partitions.weights[partition][subset];
+		float low[4], high[4];
+		momentsEndpoints(block, weights, subset_moments[subset], 3, low, high);
+		float error = fitBC7Mode1Subset(block, weights, low, high, mode, subset);
+		if (error > 0.0f && refitEndpoints(block, weights, mode.indices[subset], 3, BC7_PALETTE_3BIT, low, high)) {
+			BC7Mode1 refit = mode;
+			float refit_error = fitBC7Mode1Subset(block, weights, low, high, refit, subset);
+			if (refit_error < error) {
+				mode = refit;
+				error = refit_error;
+			}
+		}
+		mode.error += error;
+	}
+}
+
+inline void packBC7Mode1(BC7Mode1& mode, unsigned char* out) {
+	// anchor indices are stored with 2 bits, flip a subset's endpoints when its anchor needs the top bit
+	const int anchors[2] = { 0, BC7_ANCHORS2[mode.partition] };
+	for (int subset = 0; subset < 2; subset++)
+		if (mode.indices[subset][anchors[subset]] & 4) {
+			for (int c = 0; c < 3; c++)
+				std::swap(mode.q[subset][0][c], mode.q[subset][1][c]);
+			for (int i = 0; i < 16; i++)
+				mode.indices[subset][i] = 7 - mode.indices[subset][i];
+		}
+
+	std::memset(out, 0, 16);
+	BlockBitWriter writer = { out };
+	writer.write(1 << 1, 2); // mode 1
+	writer.write(mode.partition, 6);
+	for (int c = 0; c < 3; c++)
+		for (int subset = 0; subset < 2; subset++)
+			for (int end = 0; end < 2; end++)
+				writer.write(mode.q[subset][end][c], 6);
+	writer.write(mode.p[0], 1);
+	writer.write(mode.p[1], 1);
+	for (int i = 0; i < 16; i++) {
+		int subset = (BC7_PARTITIONS2[mode.partition] >> i) & 1;
+		writer.write(mode.indices[subset][i], i == anchors[subset] ? 2 : 3);
+	}
+}
+
+// mode 5 color endpoints are 7 bits per channel, alpha endpoints 8 bits
+inline int expandBC7Mode5(int q) {
+	return (q << 1) | (q >> 6);
+}
+
+struct BC7Mode5 {
+	int q[2][3], alpha[2]; // [endpoint][channel]
+	unsigned char indices[16], alpha_indices[16];
+	float error;
+};
+
+inline float fitBC7Mode5Color(const EncoderBlock& block, const float* low, const float* high, BC7Mode5& mode) {
+	float e[2][3];
+	for (int end = 0; end < 2; end++)
+		for (int c = 0; c < 3; c++) {
+			float target = end == 0 ? low[c] : high[c];
+			int q = std::min(std::max((int)(target * 127.0f / 255.0f + 0.5f), 0), 127), best = q;
+			for (int step = q - 1; step <= q + 1; step += 2)
+				if (step >= 0 && step <= 127 && std::fabs(expandBC7Mode5(step) - target) < std::fabs(expandBC7Mode5(best) - target))
+					best = step;
+			mode.q[end][c] = best;
+			e[end][c] = (float)expandBC7Mode5(best);
+		}
+	return blockEncoderKernels().fitPalette(block, ALL_PIXELS, e[0], e[1], 3, BC7_PALETTE_2BIT, mode.indices);
+}
+
+// color along its principal axis with 2 bit indices, alpha between its extremes with its own 2 bit indices
+inline BC7Mode5 encodeBC7Mode5(const EncoderBlock& block, const float* moments, int refits) {
+	const BlockEncoderKernels& kernels = blockEncoderKernels();
+	BC7Mode5 mode;
+	float low[4], high[4];
+	momentsEndpoints(block, ALL_PIXELS, moments, 3, low, high);
+	float color_error = fitBC7Mode5Color(block, low, high, mode);
+	for (int i = 0; i < refits && color_error > 0.0f; i++) {
+		if (!refitEndpoints(block, ALL_PIXELS, mode.indices, 3, BC7_PALETTE_2BIT, low, high))
+			break;
+		BC7Mode5 refit = mode;
+		float refit_error = fitBC7Mode5Color(block, low, high, refit);
+		if (refit_error >= color_error)
+			break;
+		mode = refit;
+		color_error = refit_error;
+	}
+
+	// the kernels fit channel 0, give them the alpha there
+	EncoderBlock alpha;
+	std::memcpy(alpha.channel[0], block.channel[3], sizeof(alpha.channel[0]));
+	float extremes[2] = { 255.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		extremes[0] = std::min(extremes[0], block.channel[3][i]);
+		extremes[1] = std::max(extremes[1], block.channel[3][i]);
+	}
+	mode.alpha[0] = (int)extremes[0];
+	mode.alpha[1] = (int)extremes[1];
+	mode.error = color_error + kernels.fitPalette(alpha, ALL_PIXELS, &extremes[0], &extremes[1], 1, BC7_PALETTE_2BIT, mode.alpha_indices);
+	return mode;
+}
+
+inline void packBC7Mode5(BC7Mode5& mode, unsigned char* out) {
+	// pixel 0 is the anchor of both index sets, flip the endpoints of either when it needs the top bit
+	if (mode.indices[0] & 2) {
+		std::swap(mode.q[0], mode.q[1]);
+		for (int i = 0; i < 16; i++)
+			mode.indices[i] = 3 - mode.indices[i];
+	}
+	if (mode.alpha_indices[0] & 2) {
+		std::swap(mode.alpha[0], mode.alpha[1]);
+		for (int i = 0; i < 16; i++)
+			mode.alpha_indices[i] = 3 - mode.alpha_indices[i];
+	}
+
+	std::memset(out, 0, 16);
+	BlockBitWriter writer = { out };
+	writer.write(1 << 5, 6); // mode 5
+	writer.write(0, 2);      // no channel rotation
+	for (int c = 0; c < 3; c++)
+		for (int end = 0; end < 2; end++)
+			writer.write(mode.q[end][c], 7);
+	writer.write(mode.alpha[0], 8);
+	writer.write(mode.alpha[1], 8);
+	for (int i = 0; i < 16; i++)
+		writer.write(mode.indices[i], i == 0 ? 1 : 2);
+	for (int i = 0; i < 16; i++)
+		writer.write(mode.alpha_indices[i], i == 0 ? 1 : 2);
+}
+
+inline void encodeBC7(const EncoderBlock& block, EncodeQuality quality, unsigned char* out) {
+	const BlockEncoderKernels& kernels = blockEncoderKernels();
+	float moments[BLOCK_MOMENTS];
+	kernels.blockMoments(block, ALL_PIXELS, moments);
+	int refits = quality == EncodeQuality::Fast ? 0 : quality == EncodeQuality::Normal ? 1 : 2;
+	BC7Mode6 mode6 = encodeBC7Mode6(block, moments, refits);
+
+	if (quality != EncodeQuality::Fast && block.min_alpha < 255 && mode6.error > 0.0f) {
+		BC7Mode5 mode5 = encodeBC7Mode5(block, moments, refits);
+		if (mode5.error < mode6.error) {
+			packBC7Mode5(mode5, out);
+			return;
+		}
+	}
+
+	if (quality == EncodeQuality::High && block.min_alpha == 255 && mode6.error > 0.0f) {
+		// rank the partitions by how far their subsets stray from a line: variance left over after the principal axis
+		const BC7PartitionWeights& partitions = bc7PartitionWeights();
+		float subset_moments[64][2][BLOCK_MOMENTS];
+		float estimates[64];
+		int order[64];
+		for (int p = 0; p < 64; p++) {
+			kernels.blockMoments(block, partitions.weights[p][1], subset_moments[p][1]);
+			for (int m = 0; m < BLOCK_MOMENTS; m++)
+				subset_moments[p][0][m] = moments[m] - subset_moments[p][1][m];
+			estimates[p] = 0.0f;
+			for (int subset = 0; subset < 2; subset++) {
+				const float* sums = subset_moments[p][subset];
+				float count = std::max(sums[0], 1.0f), mean[4], axis[4];
+				float spread = sums[5] + sums[9] + sums[12] - (sums[1] * sums[1] + sums[2] * sums[2] + sums[3] * sums[3]) / count;
+				estimates[p] += spread - momentsAxis(sums, 3, mean, axis, BC7_PARTITION_ITERATIONS);
+			}
+			order[p] = p;
+		}
+		std::partial_sort(order, order + BC7_MODE1_CANDIDATES, order + 64, [&](int a, int b) { return estimates[a] < estimates[b]; });
+
+		BC7Mode1 best;
+		best.error = 1e30f;
+		for (int i = 0; i < BC7_MODE1_CANDIDATES; i++) {
+			BC7Mode1 candidate;
+			encodeBC7Mode1(block, subset_moments[order[i]], order[i], candidate);
+			if (candidate.error < best.error)
+				best = candidate;
+		}
+		if (best.error < mode6.error) {
+			packBC7Mode1(best, out);
+			return;
+		}
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; i++)
+		indices[i] = mode6.indices[i];
+	packBC7Mode6(mode6.q[0], mode6.p[0], mode6.q[1], mode6.p[1], indices, out);
+}
+
+// ---------------------------------------------------------------- images
+
+// encode the rows of blocks [first_row, last_row) of an RGBA8 image into 'out', which holds the whole image
+// (compressedSize() bytes). 'out' is only written, a block at a time, so write combined memory is fine
+// ETC2 has no runtime encoder, its blocks come from block_compress.h
+inline void encodeBlockRows(BlockFormat format, EncodeQuality quality, const unsigned char* rgba, int width, int height,
+	int first_row, int last_row, unsigned char* out) {
+	int blocks_x = (width + 3) / 4;
+	size_t row_bytes = (size_t)width * 4;
+	EncoderBlock block;
+	unsigned char edge[64], encoded[16];
+	for (int by = first_row; by < last_row; by++)
+		for (int bx = 0; bx < blocks_x; bx++) {
+			const unsigned char* rows[4];
+			if (bx * 4 + 4 <= width && by * 4 + 4 <= height) {
+				for (int y = 0; y < 4; y++)
+					rows[y] = rgba + (size_t)(by * 4 + y) * row_bytes + bx * 16;
+			}
+			else {
+				// blocks hanging over the edge repeat the last row and column
+				extractBlock(rgba, width, height, bx, by, edge);
+				for (int y = 0; y < 4; y++)
+					rows[y] = edge + y * 16;
+			}
+
+			loadEncoderBlock(rows, block);
+			if (format == BlockFormat::BC1)
+				encodeBC1(block, encoded);
+			else if (format == BlockFormat::BC7)
+				encodeBC7(block, quality, encoded);
+			else
+				encodeBlockETC2(block.rgba, encoded);
+			std::memcpy(out + ((size_t)by * blocks_x + bx) * blockBytes(format), encoded, blockBytes(format));
+		}
+}
+
+// encode a whole RGBA8 image spread over the job system, 'out' must hold compressedSize(format, width, height) bytes
+// runs on the calling thread plus every worker and returns when the image is done, do not call from inside a job
+inline void encodeImage(JobSystem& jobs, BlockFormat format, EncodeQuality quality, const unsigned char* rgba, int width, int height,
+	unsigned char* out) {
+	int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+	size_t rows_per_batch = std::max(1, 256 / blocks_x); // a few hundred blocks per batch
+	jobs.parallelFor(blocks_y, rows_per_batch, [&](size_t begin, size_t end) {
+		encodeBlockRows(format, quality, rgba, width, height, (int)begin, (int)end, out);
+	});
+}
+
+// compress a whole RGBA8 image on the calling thread, 'out' must hold compressedSize(format, width, height) bytes. the
+// offline cookers (ktx2.h, the virtual texture tiler) take the High tier by default
+inline void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* out,
+	EncodeQuality quality = EncodeQuality::High) {
+	encodeBlockRows(format, quality, rgba, width, height, 0, (height + 3) / 4, out);
+}
+
+// peak signal to noise ratio in dB of 'decoded' against 'original', over RGB or RGBA
+inline double psnr(const unsigned char* original, const unsigned char* decoded, size_t pixels, int channels) {
+	double squared = 0.0;
+	for (size_t i = 0; i < pixels; i++)
+		for (int c = 0; c < channels; c++) {
+			double difference = (double)original[i * 4 + c] - decoded[i * 4 + c];
+			squared += difference * difference;
+		}
+	double mean = squared / ((double)pixels * channels);
+	return mean > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mean) : 99.0;
+}
@@ -0,0 +1,176 @@
+#pragma once
+// dynamic texture class defined here
+// a texture whose pixels are made on the CPU while the program runs (procedural content, captured frames reused as
+// textures) and replaced every frame
+//
+// update() block compresses the new pixels with the runtime encoder (see block_encoder.h), spread over the job system
+// and written straight into a persistently mapped staging buffer, then uploads them from there. a BC7 dynamic texture
+// takes a quarter of the VRAM and upload bandwidth of an RGBA8 one, BC1 an eighth
+//
+// same staging scheme as the texture loader, one segment per frame in flight, each guarded by a fence
+
+#include <glad/glad.h>
+
+#include <block_encoder.h>
+#include <job_system.h>
+#include <ktx2.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+struct DynamicTextureStats {
+	size_t frames = 0;
+	double encode_ms = 0.0;       // summed over every frame, render thread waiting for the workers included
+	double worst_encode_ms = 0.0;
+	size_t uploaded_bytes = 0;
+	size_t gpu_bytes = 0;         // texture storage
+};
+
+class DynamicTexture {
+public:
+	int width, height;
+
+	// 'compressed' false uploads plain RGBA8, BC1 falls back to that without GL_EXT_texture_compression_s3tc
+	DynamicTexture(JobSystem& jobs, int width, int height, bool compressed = true, BlockFormat format = BlockFormat::BC7,
+		EncodeQuality quality = EncodeQuality::Fast)
+		: width(width), height(height), jobs(jobs), format(format), quality(quality), fences(STAGING_SEGMENTS, nullptr) {
+
+		if (compressed && !ktx2FormatSupported(ktx2VkFormat(format)))
+			std::cout << "ERROR::DYNAMIC_TEXTURE::FORMAT_NOT_SUPPORTED: falling back to RGBA8" << std::endl;
+		else if (compressed)
+			gl_format = ktx2GLFormat(ktx2VkFormat(format));
+		segment_bytes = gl_format != 0 ? compressedSize(format, width, height) : (size_t)width * height * 4;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+		glTextureStorage2D(handle, 1, gl_format != 0 ? gl_format : GL_RGBA8, width, height);
+		glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		statistics.gpu_bytes = segment_bytes;
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &staging);
+		glNamedBufferStorage(staging, segment_bytes * STAGING_SEGMENTS, NULL, flags);
+		staging_memory = (unsigned char*)glMapNamedBufferRange(staging, 0, segment_bytes * STAGING_SEGMENTS, flags);
+	}
+
+	~DynamicTexture() {
+		for (GLsync fence : fences)
+			if (fence != nullptr)
+				glDeleteSync(fence);
+		glUnmapNamedBuffer(staging);
+		glDeleteBuffers(1, &staging);
+		glDeleteTextures(1, &handle);
+	}
+
+	DynamicTexture(const DynamicTexture&) = delete;
+	DynamicTexture& operator=(const DynamicTexture&) = delete;
+
+	unsigned int texture() const {
+		return handle;
+	}
+
+	bool compressed() const {
+		return gl_format != 0;
+	}
+
+	// replace the pixels, 'rgba' is width * height RGBA8 pixels with the bottom row first like every texture upload
+	// call once per frame from the thread owning the GL context, returns once the pixels are encoded
+	void update(const unsigned char* rgba) {
+		// wait for the GPU to finish reading this segment, it was last used STAGING_SEGMENTS frames ago
+		size_t segment = frame++ % STAGING_SEGMENTS;
+		if (fences[segment] != nullptr) {
+			glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(fences[segment]);
+			fences[segment] = nullptr;
+		}
+		size_t offset = segment * segment_bytes;
+
+		auto start = std::chrono::steady_clock::now();
+		if (gl_format != 0)
+			encodeImage(jobs, format, quality, rgba, width, height, staging_memory + offset);
+		else
+			std::memcpy(staging_memory + offset, rgba, segment_bytes);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		statistics.frames++;
+		statistics.encode_ms += ms;
+		statistics.worst_encode_ms = std::max(statistics.worst_encode_ms, ms);
+		statistics.uploaded_bytes += segment_bytes;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+		if (gl_format != 0)
+			glCompressedTextureSubImage2D(handle, 0, 0, 0, width, height, gl_format, (GLsizei)segment_bytes, (void*)offset);
+		else {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTextureSubImage2D(handle, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)offset);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	DynamicTextureStats stats() const {
+		return statistics;
+	}
+
+	void printStats() const {
+		const char* name = gl_format == 0 ? "RGBA8" : format == BlockFormat::BC1 ? "BC1" : format == BlockFormat::BC7 ? "BC7" : "ETC2";
+		size_t frames = std::max<size_t>(statistics.frames, 1);
+		std::cout << "\nDynamic texture stats:" << std::endl
+			<< "\tTexture        : " << width << "x" << height << " " << name;
+		if (gl_format != 0 && format == BlockFormat::BC7)
+			std::cout << " (" << encodeQualityName(quality) << ")";
+		std::cout << ", " << statistics.gpu_bytes / 1024 << " KB" << std::endl
+			<< "\tFrames         : " << statistics.frames << std::endl
+			<< "\tEncode ms      : " << statistics.encode_ms / frames << " average, " << statistics.worst_encode_ms << " worst" << std::endl
+			<< "\tUploaded       : " << statistics.uploaded_bytes / frames / 1024 << " KB per frame" << std::endl;
+	}
+
+private:
+	static const size_t STAGING_SEGMENTS = 3;
+
+	unsigned int handle = 0;
+	JobSystem& jobs;
+	BlockFormat format;
+	EncodeQuality quality;
+	GLenum gl_format = 0; // 0 for plain RGBA8
+	size_t segment_bytes = 0;
+	unsigned int staging = 0;
+	unsigned char* staging_memory = nullptr;
+	std::vector<GLsync> fences;
+	size_t frame = 0;
+	DynamicTextureStats statistics;
+};
+
+// animated plasma, the procedural content the '--dynamic' demo and its benchmark compress every frame
+// smooth gradients with every hue in them, 'time' in seconds
+inline void generatePlasma(unsigned char* rgba, int width, int height, double time) {
+	int wave[256];
+	unsigned char palette[256][3];
+	for (int i = 0; i < 256; i++) {
+		double angle = i * 6.283185307179586 / 256.0;
+		wave[i] = (int)std::lround(63.0 * std::sin(angle));
+		for (int c = 0; c < 3; c++)
+			palette[i][c] = (unsigned char)std::lround(127.5 + 127.5 * std::sin(angle + c * 2.0943951023931953));
+	}
+
+	int t = (int)(time * 60.0); // one step a frame at 60 fps
+	for (int y = 0; y < height; y++) {
+		int v = y * 512 / height;
+		unsigned char* pixel = rgba + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++, pixel += 4) {
+			int u = x * 512 / width;
+			int sum = wave[(u + t) & 255] + wave[(v + 2 * t) & 255] + wave[((u + v) / 2 + 3 * t) & 255]
+				+ wave[((u - v) / 3 - t) & 255];
+			const unsigned char* color = palette[(sum + t) & 255];
+			pixel[0] = color[0];
+			pixel[1] = color[1];
+			pixel[2] = color[2];
+			pixel[3] = 255;
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+// frame capture class defined here
+// reads the framebuffer back through a ring of pixel buffer objects (PBO)
+// glReadPixels into a bound PBO returns immediately, the copy to CPU memory happens a few frames later
+// so the render loop never waits on the GPU to finish the current frame
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <vector>
+
+class FrameCapture {
+public:
+	unsigned int width, height; // size of the captured region, fixed for the lifetime of the object
+
+	FrameCapture(unsigned int width, unsigned int height, unsigned int ring_size = 3)
+		: width(width), height(height), pbos(ring_size, 0), fences(ring_size, nullptr) {
+
+		glGenBuffers((GLsizei)pbos.size(), pbos.data());
+		for (unsigned int pbo : pbos) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+			glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes(), NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	~FrameCapture() {
+		for (GLsync fence : fences)
+			if (fence != nullptr)
+				glDeleteSync(fence);
+		glDeleteBuffers((GLsizei)pbos.size(), pbos.data());
+	}
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// size in bytes of one RGBA8 frame
+	size_t frameBytes() const {
+		return (size_t)width * height * 4;
+	}
+
+	// number of readbacks issued but not yet retrieved
+	unsigned int pending() const {
+		return in_flight;
+	}
+
+	// queue an asynchronous read of the currently bound read framebuffer, call before glfwSwapBuffers
+	// returns false if every PBO is still waiting to be retrieved
+	bool capture() {
+		if (in_flight == pbos.size())
+			return false;
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[write_index]);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		fences[write_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		write_index = (write_index + 1) % pbos.size();
+		in_flight++;
+		return true;
+	}
+
+	// copy the oldest finished readback into dst (frameBytes() in size, rows bottom-up as opengl stores them)
+	// pass dst == nullptr to discard the frame without mapping it
+	// with wait == false this returns false instead of blocking when the GPU has not finished that frame yet
+	// a frame whose wait fails or whose PBO cannot be mapped is consumed and lost, that also returns false
+	bool retrieve(unsigned char* dst, bool wait = false) {
+		if (in_flight == 0)
+			return false;
+
+		GLsync& fence = fences[read_index];
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+		if (status == GL_TIMEOUT_EXPIRED && !wait)
+			return false;
+		glDeleteSync(fence);
+		fence = nullptr;
+
+		size_t index = read_index;
+		read_index = (read_index + 1) % pbos.size();
+		in_flight--;
+		if (status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED)
+			return false;
+		if (dst == nullptr)
+			return true;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[index]);
+		void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes(), GL_MAP_READ_BIT);
+		if (src != NULL) {
+			std::memcpy(dst, src, frameBytes());
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return src != NULL;
+	}
+
+private:
+	std::vector<unsigned int> pbos; // PBO handles
+	std::vector<GLsync> fences;     // signalled once the matching glReadPixels has landed in its PBO
+	size_t write_index = 0;
+	size_t read_index = 0;
+	unsigned int in_flight = 0;
+};
@@ -0,0 +1,15 @@
+// sprite batch fragment shader, one layer of a texture array per sprite
+
+#version 460 core
+out vec4 FragColor;
+
+in vec4 ourColor;
+in vec2 TexCoord;
+flat in uint Layer;
+
+// every sprite texture, one per layer
+uniform sampler2DArray texture1;
+
+void main() {
+	FragColor = texture(texture1, vec3(TexCoord, Layer)) * ourColor;
+}
@@ -0,0 +1,20 @@
+// sprite batch fragment shader, one bindless texture handle per sprite
+
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+out vec4 FragColor;
+
+in vec4 ourColor;
+in vec2 TexCoord;
+flat in uint Layer;
+
+// resident texture handles, filled by SpriteTextureSet
+layout (std430, binding = 0) readonly buffer TextureHandles {
+	sampler2D textures[];
+};
+
+// Layer differs between the instances of one draw, drivers exposing bindless textures handle the non-uniform index
+// (GL_NV_gpu_shader5 guarantees it)
+void main() {
+	FragColor = texture(textures[Layer], TexCoord) * ourColor;
+}
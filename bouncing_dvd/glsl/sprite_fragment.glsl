@@ -0,0 +1,14 @@
+// sprite batch fragment shader
+
+#version 460 core
+out vec4 FragColor;
+
+in vec4 ourColor;
+in vec2 TexCoord;
+
+// atlas (or single texture) sampler
+uniform sampler2D texture1;
+
+void main() {
+	FragColor = texture(texture1, TexCoord) * ourColor;
+}
@@ -0,0 +1,20 @@
+// sprite batch vertex shader
+
+#version 460 core
+// one instance per sprite, the four corners of its quad come from gl_VertexID (triangle strip)
+layout (location = 0) in vec4 aRect;  // x, y, width, height in normalized device coordinates
+layout (location = 1) in vec4 aUV;    // u0, v0, u1, v1
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in uint aLayer;  // texture index, only read by the bindless and array fragment shaders
+
+out vec4 ourColor;
+out vec2 TexCoord;
+flat out uint Layer;
+
+void main() {
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	gl_Position = vec4(aRect.xy + corner * aRect.zw, 0.0, 1.0);
+	ourColor = aColor;
+	TexCoord = mix(aUV.xy, aUV.zw, corner);
+	Layer = aLayer;
+}
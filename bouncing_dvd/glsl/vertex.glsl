@@ -3,7 +3,7 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
-layout (location = 2) in vec3 aTexCoord;
+layout (location = 2) in vec2 aTexCoord;
 
 out vec3 ourColor;
 out vec2 TexCoord;
@@ -15,5 +15,5 @@ uniform float y_offset;
 void main() {
 	gl_Position = vec4(aPos.x + x_offset, aPos.y + y_offset, aPos.z, 1.0);
 	ourColor = aColor;
-	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
+	TexCoord = aTexCoord;
 }
\ No newline at end of file
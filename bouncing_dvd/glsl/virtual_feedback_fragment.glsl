@@ -0,0 +1,18 @@
+// virtual texture feedback shader, writes the tile every pixel would like to sample
+
+#version 460 core
+layout (location = 0) out uvec4 Feedback; // tile x, tile y, level, 1 where the image covers the pixel
+
+in vec2 TexCoord;
+
+uniform vec2 image_size;
+uniform float tile_size;
+uniform int max_level;
+uniform float lod_bias; // includes the smaller size of the feedback buffer
+
+void main() {
+	vec2 texel = clamp(vec2(TexCoord.x, 1.0 - TexCoord.y) * image_size, vec2(0.5), image_size - 0.5);
+	float lod = log2(max(length(dFdx(texel)), length(dFdy(texel)))) + lod_bias;
+	int level = clamp(int(floor(lod + 0.5)), 0, max_level);
+	Feedback = uvec4(uvec2(texel / (tile_size * exp2(float(level)))), level, 1);
+}
@@ -0,0 +1,32 @@
+// virtual texture fragment shader, samples the tile cache through the indirection texture
+
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D cache;        // resident tiles, one page of page_size texels each
+uniform usampler2D indirection; // one texel per tile and level: page x, page y, level of the tile standing in for it
+
+uniform vec2 image_size; // level 0 in texels
+uniform float tile_size;
+uniform float border;
+uniform float page_size;
+uniform float cache_size;
+uniform int max_level;
+uniform float lod_bias;
+
+void main() {
+	// level 0 texels counted from the top left, the way tiles are numbered
+	vec2 texel = clamp(vec2(TexCoord.x, 1.0 - TexCoord.y) * image_size, vec2(0.5), image_size - 0.5);
+	// nearest level like GL_NEAREST_MIPMAP_*, must match the feedback shader
+	float lod = log2(max(length(dFdx(texel)), length(dFdy(texel)))) + lod_bias;
+	int level = clamp(int(floor(lod + 0.5)), 0, max_level);
+
+	// the tile itself or its closest resident ancestor, level 'entry.z'
+	uvec4 entry = texelFetch(indirection, ivec2(texel / (tile_size * exp2(float(level)))), level);
+	vec2 mapped = texel / exp2(float(entry.z));
+	vec2 in_tile = mapped - floor(mapped / tile_size) * tile_size;
+	vec2 cache_texel = vec2(entry.xy) * page_size + border + in_tile;
+	FragColor = textureLod(cache, cache_texel / cache_size, 0.0);
+}
@@ -0,0 +1,13 @@
+// virtual texture vertex shader, shared by the visible and the feedback pass
+
+#version 460 core
+// the four corners of the image quad come from gl_VertexID (triangle strip), no vertex buffer
+uniform vec4 rect; // x, y, width, height in normalized device coordinates
+
+out vec2 TexCoord;
+
+void main() {
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	gl_Position = vec4(rect.xy + corner * rect.zw, 0.0, 1.0);
+	TexCoord = corner;
+}
@@ -0,0 +1,124 @@
+#pragma once
+// job system class defined here
+// a fixed pool of worker threads pulling jobs off a shared queue
+// used for work that must stay off the render thread (image decoding, encoding, ...)
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem {
+public:
+	// thread_count == 0 uses every hardware thread except the one running the render loop
+	JobSystem(unsigned int thread_count = 0) {
+		if (thread_count == 0) {
+			unsigned int hardware = std::thread::hardware_concurrency();
+			thread_count = hardware > 1 ? hardware - 1 : 1;
+		}
+		for (unsigned int i = 0; i < thread_count; i++)
+			workers.emplace_back(&JobSystem::workerLoop, this);
+	}
+
+	~JobSystem() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		job_available.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int threadCount() const {
+		return (unsigned int)workers.size();
+	}
+
+	// queue a job, it runs on whichever worker is free first
+	void submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+			unfinished++;
+		}
+		job_available.notify_one();
+	}
+
+	// block until every submitted job has finished
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		all_done.wait(lock, [this] { return unfinished == 0; });
+	}
+
+	// run fn(begin, end) over [0, count) split into batches, the calling thread helps and returns once all batches are done
+	// do not call from inside a job, the helpers would wait on the worker that is running it
+	void parallelFor(size_t count, size_t batch_size, const std::function<void(size_t, size_t)>& fn) {
+		if (count == 0)
+			return;
+		batch_size = std::max<size_t>(batch_size, 1);
+		size_t batches = (count + batch_size - 1) / batch_size;
+
+		std::atomic<size_t> next(0);
+		auto run = [&]() {
+			size_t batch;
+			while ((batch = next.fetch_add(1)) < batches) {
+				size_t begin = batch * batch_size;
+				fn(begin, std::min(begin + batch_size, count));
+			}
+		};
+
+		size_t helpers = std::min<size_t>(workers.size(), batches - 1);
+		std::mutex finished_mutex;
+		std::condition_variable finished;
+		size_t helpers_left = helpers;
+		for (size_t i = 0; i < helpers; i++) {
+			submit([&]() {
+				run();
+				std::lock_guard<std::mutex> lock(finished_mutex);
+				if (--helpers_left == 0)
+					finished.notify_one();
+			});
+		}
+		run();
+
+		// the lambdas above reference this stack frame, wait for every helper to leave it
+		std::unique_lock<std::mutex> lock(finished_mutex);
+		finished.wait(lock, [&] { return helpers_left == 0; });
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable job_available;
+	std::condition_variable all_done;
+	size_t unfinished = 0;
+	bool stopping = false;
+
+	void workerLoop() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				job_available.wait(lock, [this] { return !jobs.empty() || stopping; });
+				if (jobs.empty())
+					return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			job();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--unfinished == 0)
+				all_done.notify_all();
+		}
+	}
+};
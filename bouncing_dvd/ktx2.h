@@ -0,0 +1,276 @@
+#pragma once
+// KTX2 container support defined here
+// cookKtx2() turns a source image into a .ktx2 file holding every mip level already block compressed
+// parseKtx2() reads such a file from memory without copying, the texture loader uploads the levels as they are
+//
+// only what the cooker writes is supported: 2D, one layer, one face, no supercompression
+// file layout: identifier, header, index, level index, data format descriptor, key/value data, then mip data smallest level first
+
+#include <glad/glad.h>
+
+#include <block_encoder.h>
+#include <stb_image.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// not part of core opengl, comes with GL_EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+
+const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// vulkan format numbers stored in the header
+const uint32_t VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133;
+const uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+const uint32_t VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK = 151;
+
+// one mip level, points into the parsed file
+struct Ktx2Level {
+	const unsigned char* data;
+	size_t size;
+	int width, height;
+};
+
+struct Ktx2Image {
+	uint32_t vk_format = 0;
+	int width = 0, height = 0;
+	std::vector<Ktx2Level> levels; // level 0 is the full size image
+};
+
+inline uint32_t ktx2VkFormat(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case BlockFormat::BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+	default: return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+	}
+}
+
+// opengl internal format for a vulkan format, 0 if the loader does not know it
+inline GLenum ktx2GLFormat(uint32_t vk_format) {
+	switch (vk_format) {
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case VK_FORMAT_BC7_UNORM_BLOCK: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+	default: return 0;
+	}
+}
+
+inline size_t ktx2BlockBytes(uint32_t vk_format) {
+	return vk_format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK ? 8 : 16;
+}
+
+inline bool hasGLExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+		if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+			return true;
+	return false;
+}
+
+// BC7 and ETC2 are core since opengl 4.2 / 4.3, BC1 needs the s3tc extension
+inline bool ktx2FormatSupported(uint32_t vk_format) {
+	if (vk_format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK) {
+		static const bool s3tc = hasGLExtension("GL_EXT_texture_compression_s3tc");
+		return s3tc;
+	}
+	return ktx2GLFormat(vk_format) != 0;
+}
+
+inline uint32_t readU32(const unsigned char* p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline uint64_t readU64(const unsigned char* p) {
+	return (uint64_t)readU32(p) | (uint64_t)readU32(p + 4) << 32;
+}
+
+inline void writeU32(std::vector<unsigned char>& out, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+inline void writeU64(std::vector<unsigned char>& out, uint64_t value) {
+	writeU32(out, (uint32_t)value);
+	writeU32(out, (uint32_t)(value >> 32));
+}
+
+// fill 'image' with views into 'data', which must outlive it
+inline bool parseKtx2(const unsigned char* data, size_t size, Ktx2Image& image) {
+	const size_t header_size = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+	if (size < header_size || std::memcmp(data, KTX2_IDENTIFIER, 12) != 0)
+		return false;
+
+	const unsigned char* header = data + 12;
+	image.vk_format = readU32(header);
+	image.width = (int)readU32(header + 8);
+	image.height = (int)readU32(header + 12);
+	uint32_t depth = readU32(header + 16);
+	uint32_t layers = readU32(header + 20);
+	uint32_t faces = readU32(header + 24);
+	uint32_t level_count = readU32(header + 28);
+	uint32_t supercompression = readU32(header + 32);
+	if (depth != 0 || layers > 1 || faces != 1 || supercompression != 0 || image.width == 0 || image.height == 0)
+		return false;
+	if (level_count == 0)
+		level_count = 1;
+	if (header_size + (size_t)level_count * 24 > size)
+		return false;
+
+	const unsigned char* level_index = data + header_size;
+	image.levels.clear();
+	for (uint32_t level = 0; level < level_count; level++) {
+		uint64_t offset = readU64(level_index + level * 24);
+		uint64_t length = readU64(level_index + level * 24 + 8);
+		if (offset > size || length > size - offset)
+			return false;
+		Ktx2Level view;
+		view.data = data + offset;
+		view.size = (size_t)length;
+		view.width = std::max(image.width >> level, 1);
+		view.height = std::max(image.height >> level, 1);
+		// the loader uploads a level in rows of blocks, a short or padded level would make it read past the data
+		if (view.size != (size_t)((view.width + 3) / 4) * ((view.height + 3) / 4) * ktx2BlockBytes(image.vk_format))
+			return false;
+		image.levels.push_back(view);
+	}
+	return true;
+}
+
+// basic data format descriptor for the three block formats the cooker writes, linear RGBA with straight alpha
+inline std::vector<unsigned char> ktx2DataFormatDescriptor(BlockFormat format) {
+	const uint32_t KHR_DF_MODEL_BC1A = 128, KHR_DF_MODEL_BC7 = 134, KHR_DF_MODEL_ETC2 = 161;
+	const uint32_t KHR_DF_PRIMARIES_BT709 = 1, KHR_DF_TRANSFER_LINEAR = 1;
+
+	struct Sample {
+		uint32_t bit_offset, bit_length, channel;
+	};
+	std::vector<Sample> samples;
+	uint32_t model;
+	switch (format) {
+	case BlockFormat::BC1:
+		model = KHR_DF_MODEL_BC1A;
+		samples.push_back({ 0, 64, 1 }); // KHR_DF_CHANNEL_BC1A_ALPHAPRESENT
+		break;
+	case BlockFormat::BC7:
+		model = KHR_DF_MODEL_BC7;
+		samples.push_back({ 0, 128, 0 }); // KHR_DF_CHANNEL_BC7_COLOR
+		break;
+	default:
+		model = KHR_DF_MODEL_ETC2;
+		samples.push_back({ 0, 64, 15 });  // KHR_DF_CHANNEL_ETC2_ALPHA
+		samples.push_back({ 64, 64, 2 });  // KHR_DF_CHANNEL_ETC2_COLOR
+		break;
+	}
+
+	uint32_t block_size = 24 + 16 * (uint32_t)samples.size();
+	std::vector<unsigned char> dfd;
+	writeU32(dfd, 4 + block_size);                      // dfdTotalSize
+	writeU32(dfd, 0);                                   // vendorId, descriptorType
+	writeU32(dfd, 2 | block_size << 16);                // versionNumber, descriptorBlockSize
+	writeU32(dfd, model | KHR_DF_PRIMARIES_BT709 << 8 | KHR_DF_TRANSFER_LINEAR << 16);
+	writeU32(dfd, 3 | 3 << 8);                          // texelBlockDimension, 4x4 stored minus one
+	writeU32(dfd, (uint32_t)blockBytes(format));        // bytesPlane0
+	writeU32(dfd, 0);                                   // bytesPlane4..7
+	for (const Sample& sample : samples) {
+		writeU32(dfd, sample.bit_offset | (sample.bit_length - 1) << 16 | sample.channel << 24);
+		writeU32(dfd, 0);                               // samplePosition
+		writeU32(dfd, 0);                               // sampleLower
+		writeU32(dfd, 0xFFFFFFFF);                      // sampleUpper
+	}
+	return dfd;
+}
+
+// encode an RGBA8 image and its mip chain into a ktx2 file in memory, 'max_levels' > 0 stops the chain early
+inline std::vector<unsigned char> encodeKtx2(const unsigned char* rgba, int width, int height, BlockFormat format, int max_levels = 0) {
+	// compress every level first, largest to smallest
+	std::vector<std::vector<unsigned char>> levels;
+	std::vector<unsigned char> current(rgba, rgba + (size_t)width * height * 4);
+	int w = width, h = height;
+	while (true) {
+		std::vector<unsigned char> compressed(compressedSize(format, w, h));
+		compressImage(format, current.data(), w, h, compressed.data());
+		levels.push_back(std::move(compressed));
+		if ((w == 1 && h == 1) || (int)levels.size() == max_levels)
+			break;
+		current = downsampleRGBA(current.data(), w, h, &w, &h);
+	}
+
+	std::vector<unsigned char> dfd = ktx2DataFormatDescriptor(format);
+
+	// key/value data, rows are stored bottom-up for opengl so record the orientation as right/up
+	const char orientation[] = "KTXorientation\0ru";
+	std::vector<unsigned char> kvd;
+	writeU32(kvd, sizeof(orientation));
+	kvd.insert(kvd.end(), orientation, orientation + sizeof(orientation));
+	kvd.resize((kvd.size() + 3) / 4 * 4, 0);
+	std::vector<unsigned char> file(KTX2_IDENTIFIER, KTX2_IDENTIFIER + 12);
+	writeU32(file, ktx2VkFormat(format));
+	writeU32(file, 1);                           // typeSize
+	writeU32(file, width);
+	writeU32(file, height);
+	writeU32(file, 0);                           // pixelDepth
+	writeU32(file, 0);                           // layerCount
+	writeU32(file, 1);                           // faceCount
+	writeU32(file, (uint32_t)levels.size());
+	writeU32(file, 0);                           // supercompressionScheme
+
+	size_t dfd_offset = file.size() + 4 * 4 + 2 * 8 + levels.size() * 24;
+	writeU32(file, (uint32_t)dfd_offset);
+	writeU32(file, (uint32_t)dfd.size());
+	writeU32(file, (uint32_t)(dfd_offset + dfd.size()));
+	writeU32(file, (uint32_t)kvd.size());
+	writeU64(file, 0);                           // sgdByteOffset
+	writeU64(file, 0);                           // sgdByteLength
+
+	// level data is stored smallest first, each level aligned to the block size
+	size_t alignment = blockBytes(format);
+	std::vector<size_t> offsets(levels.size());
+	size_t offset = dfd_offset + dfd.size() + kvd.size();
+	for (size_t i = levels.size(); i-- > 0;) {
+		offset = (offset + alignment - 1) / alignment * alignment;
+		offsets[i] = offset;
+		offset += levels[i].size();
+	}
+	for (size_t i = 0; i < levels.size(); i++) {
+		writeU64(file, offsets[i]);
+		writeU64(file, levels[i].size());
+		writeU64(file, levels[i].size());        // uncompressedByteLength, no supercompression
+	}
+	file.insert(file.end(), dfd.begin(), dfd.end());
+	file.insert(file.end(), kvd.begin(), kvd.end());
+	for (size_t i = levels.size(); i-- > 0;) {
+		file.resize(offsets[i], 0);
+		file.insert(file.end(), levels[i].begin(), levels[i].end());
+	}
+	return file;
+}
+
+// offline step: load any image stb_image understands and write it out as ktx2
+inline bool cookKtx2(const std::string& source_path, const std::string& output_path, BlockFormat format) {
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load_thread(true); // store rows the way opengl expects them, the loader never flips
+	unsigned char* rgba = stbi_load(source_path.c_str(), &width, &height, &channels, 4);
+	if (rgba == NULL) {
+		std::cout << "ERROR::KTX2::FAILED_TO_LOAD_SOURCE: " << source_path << std::endl;
+		return false;
+	}
+	std::vector<unsigned char> file = encodeKtx2(rgba, width, height, format);
+	stbi_image_free(rgba);
+
+	std::ofstream out(output_path, std::ios::binary);
+	out.write((const char*)file.data(), file.size());
+	if (!out) {
+		std::cout << "ERROR::KTX2::FAILED_TO_WRITE: " << output_path << std::endl;
+		return false;
+	}
+	std::cout << "Cooked " << source_path << " -> " << output_path << " (" << width << "x" << height << ", "
+		<< file.size() << " bytes)" << std::endl;
+	return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+// LZ4 block format compressor and decompressor defined here
+// output is compatible with LZ4_decompress_safe() from the reference library, only the raw block format is
+// implemented (no frame header, no checksums), the asset pack stores sizes itself
+//
+// the compressor is the simple greedy variant: one hash table of 4 byte sequences, no match chains
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+const size_t LZ4_MIN_MATCH = 4;
+const size_t LZ4_LAST_LITERALS = 5; // the last 5 bytes of a block are always literals
+const size_t LZ4_MATCH_LIMIT = 12;  // no match may start in the last 12 bytes
+const int LZ4_HASH_BITS = 16;
+
+inline uint32_t lz4Read32(const unsigned char* p) {
+	uint32_t value;
+	std::memcpy(&value, p, 4);
+	return value;
+}
+
+// lengths of 15 and more spill into extra bytes of 255
+inline void lz4WriteLength(std::vector<unsigned char>& out, size_t length) {
+	while (length >= 255) {
+		out.push_back(255);
+		length -= 255;
+	}
+	out.push_back((unsigned char)length);
+}
+
+inline void lz4WriteSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literal_length,
+	size_t offset, size_t match_length) {
+
+	size_t match_code = match_length - LZ4_MIN_MATCH;
+	unsigned char token = (unsigned char)((literal_length < 15 ? literal_length : 15) << 4);
+	if (match_length > 0)
+		token |= (unsigned char)(match_code < 15 ? match_code : 15);
+	out.push_back(token);
+	if (literal_length >= 15)
+		lz4WriteLength(out, literal_length - 15);
+	out.insert(out.end(), literals, literals + literal_length);
+
+	// the final sequence of a block carries literals only
+	if (match_length == 0)
+		return;
+	out.push_back((unsigned char)(offset & 0xFF));
+	out.push_back((unsigned char)(offset >> 8));
+	if (match_code >= 15)
+		lz4WriteLength(out, match_code - 15);
+}
+
+inline std::vector<unsigned char> lz4Compress(const unsigned char* source, size_t size) {
+	std::vector<unsigned char> out;
+	out.reserve(size + size / 255 + 16);
+	std::vector<uint32_t> table((size_t)1 << LZ4_HASH_BITS, 0); // position + 1 of the last sequence with this hash
+
+	size_t position = 0, anchor = 0;
+	if (size > LZ4_MATCH_LIMIT) {
+		while (position < size - LZ4_MATCH_LIMIT) {
+			uint32_t sequence = lz4Read32(source + position);
+			uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+			size_t candidate = table[hash];
+			table[hash] = (uint32_t)(position + 1);
+
+			if (candidate == 0 || position + 1 - candidate > 65535 || lz4Read32(source + candidate - 1) != sequence) {
+				position++;
+				continue;
+			}
+			size_t match = candidate - 1;
+			size_t length = LZ4_MIN_MATCH;
+			while (position + length < size - LZ4_LAST_LITERALS && source[match + length] == source[position + length])
+				length++;
+
+			lz4WriteSequence(out, source + anchor, position - anchor, position - match, length);
+			position += length;
+			anchor = position;
+		}
+	}
+	lz4WriteSequence(out, source + anchor, size - anchor, 0, 0);
+	return out;
+}
+
+// returns false on malformed input or when the output would not be exactly 'size' bytes
+inline bool lz4Decompress(const unsigned char* source, size_t source_size, unsigned char* destination, size_t size) {
+	const unsigned char* in = source;
+	const unsigned char* in_end = source + source_size;
+	unsigned char* out = destination;
+	unsigned char* out_end = destination + size;
+
+	auto readLength = [&](size_t& length) {
+		unsigned char extra;
+		do {
+			if (in == in_end)
+				return false;
+			extra = *in++;
+			length += extra;
+		} while (extra == 255);
+		return true;
+	};
+
+	while (in < in_end) {
+		unsigned char token = *in++;
+
+		size_t literal_length = token >> 4;
+		if (literal_length == 15 && !readLength(literal_length))
+			return false;
+		if (literal_length > (size_t)(in_end - in) || literal_length > (size_t)(out_end - out))
+			return false;
+		std::memcpy(out, in, literal_length);
+		in += literal_length;
+		out += literal_length;
+		if (in == in_end)
+			break; // last sequence
+
+		if (in_end - in < 2)
+			return false;
+		size_t offset = in[0] | (size_t)in[1] << 8;
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - destination))
+			return false;
+
+		size_t match_length = token & 15;
+		if (match_length == 15 && !readLength(match_length))
+			return false;
+		match_length += LZ4_MIN_MATCH;
+		if (match_length > (size_t)(out_end - out))
+			return false;
+
+		// byte by byte, the match may overlap the bytes it produces
+		const unsigned char* match = out - offset;
+		for (size_t i = 0; i < match_length; i++)
+			out[i] = match[i];
+		out += match_length;
+	}
+	return out == out_end;
+}
@@ -9,21 +9,87 @@
 	- Implemented some functions to move the dvd 
 	- Implemented a bounding box system to bounce the dvd logo around
 
+	- Run with '--record out.mp4' to stream every frame to ffmpeg while the dvd bounces
+		'--record-fps 60'                               frame rate written into the video
+		'--record-policy block|drop-newest|drop-oldest' what to do when the encoder falls behind
+
+	- Textures can be cooked offline into block compressed ktx2 files with every mip level precomputed
+		'--cook-ktx2 bc7|bc1|etc2 dvd.png dvd.ktx2'     writes the file and exits, dvd.ktx2 is used instead of dvd.png when present
+		'--bench-ktx2 dvd.png dvd.ktx2'                 compares load time and memory of both paths
+
+	- Assets can be baked into one memory mapped pack, assets.pak is used when present and loose files fill the gaps
+		'--build-pack assets.pak glsl/vertex.glsl glsl/fragment.glsl dvd.png'
+		                                                writes the pack (lz4 where it pays off) and exits
+		'--pack other.pak'                              use another pack
+		'--bench-pack 2000'                             loose file reads against pack lookups for that many files
+
+	- Many small images can share one texture atlas and be drawn as a sprite batch with a single draw call
+		'--build-atlas sprites a.png b.png ...'         packs the images into sprites.ktx2 (bc7) plus the uv table sprites.atlas
+		'--bench-atlas 2000'                            a bind and draw per sprite against one atlas draw for that many images
+		'--bench-sprites 10000 500'                     that many sprites showing that many textures, drawn with separate
+		                                                textures, an atlas, a texture array and bindless handles
+
+	- PNG files are decoded by a faster decoder (stb_image for anything it does not handle), then flipped and widened to
+	  RGBA by SIMD kernels picked for the CPU at startup
+		'--bench-convert 16'                            GB/s of every pixel conversion at each SIMD level on that many megapixels
+		'--bench-png a.png b.png ...'                   MB/s of stb_image against the fast png decoder on those files, and
+		                                                whether both decode them to the same bytes
+
+	- QOI images load without inflate and are decoded straight into the texture upload buffer, dvd.qoi is used instead
+	  of dvd.png when present (a ktx2 still wins)
+		'--convert-qoi dvd.png dvd.qoi'                 writes the qoi file and exits
+		'--bench-qoi a.png b.png ...'                   load time of those files as png and converted to qoi
+
+	- Images too large for the GPU are tiled offline into a virtual texture and streamed in as the view needs them
+		'--build-vt bc7|bc1|rgba scan.qoi scan.vtex'    writes the tile pyramid and exits, qoi sources are read a row at a time
+		'--view-vt scan.vtex'                           shows the image behind the dvd, scroll to zoom and drag to pan
+		'--bench-vt scan.vtex'                          zooms into the image and pans across it, tiles streamed and frame cost
+
+	- Textures made while the program runs are block compressed every frame by SIMD encoders spread over the job system
+		'--dynamic bc7|bc1|rgba'                        an animated plasma replaces the dvd logo, compressed before each upload
+		'--dynamic-quality fast|normal|high'            bc7 encoder tier, better blocks for more encode time
+		'--bench-encode a.png b.png ...'                MPix/s and PSNR of every encoder on those images, then the per frame
+		                                                cost of a dynamic texture in each format
+
 */
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <shader.h>
+#include <vertex_layout.h>
+#include <frame_capture.h>
+#include <video_recorder.h>
+#include <asset_pack.h>
+#include <job_system.h>
+#include <texture_manager.h>
+#include <texture_atlas.h>
+#include <texture_set.h>
+#include <ktx2.h>
+#include <qoi.h>
+#include <virtual_texture.h>
+#include <dynamic_texture.h>
+#include <benchmarks.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
+#include <vector>
 
 float generateRandomDirection();
 void frameBufferSizeCallback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
+void scrollCallback(GLFWwindow* window, double x_offset, double y_offset);
+void fitImageView(GLFWwindow* window, int image_width, int image_height);
+void recordFrame(FrameCapture& capture, VideoRecorder& recorder, bool flush);
 
 const unsigned int SCR_WIDTH = 720;
 const unsigned int SCR_HEIGHT = 480;
@@ -32,13 +98,154 @@ const unsigned int SCR_HEIGHT = 480;
 const float MAX_VELOCITY = 2.0f;
 const float MIN_VELOCITY = 1.4f;
 
-int main() {
+// recording, frames are read back this many frames late so glReadPixels never stalls
+const unsigned int CAPTURE_LATENCY = 2;
+const size_t RECORD_QUEUE_CAPACITY = 8;
+
+// '--dynamic' texture size, in pixels
+const int DYNAMIC_SIZE = 512;
+
+// where '--view-vt' draws the image, changed by scrolling and dragging
+struct ImageView {
+	float rect[4] = { -1.0f, -1.0f, 2.0f, 2.0f }; // x, y, width, height in normalized device coordinates
+	bool dragging = false;
+	double drag_x = 0.0, drag_y = 0.0;
+};
+ImageView image_view;
+
+int main(int argc, char** argv) {
+
+	// parse command line
+	std::string record_path;
+	int record_fps = 60;
+	QueuePolicy record_policy = QueuePolicy::Block;
+	std::string bench_png, bench_ktx2;
+	std::string pack_path = "assets.pak";
+	int bench_atlas = 0;
+	int bench_sprites = 0, bench_sprite_textures = 0;
+	std::string view_vt, bench_vt;
+	std::string dynamic_format;
+	EncodeQuality dynamic_quality = EncodeQuality::Fast;
+	std::vector<std::string> bench_encode;
+	for (int i = 1; i < argc; i++) {
+		int remaining = argc - i - 1; // values left after this option
+		if (std::strcmp(argv[i], "--record") == 0 && remaining >= 1)
+			record_path = argv[++i];
+		else if (std::strcmp(argv[i], "--record-fps") == 0 && remaining >= 1)
+			record_fps = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--record-policy") == 0 && remaining >= 1) {
+			i++;
+			if (std::strcmp(argv[i], "drop-newest") == 0)
+				record_policy = QueuePolicy::DropNewest;
+			else if (std::strcmp(argv[i], "drop-oldest") == 0)
+				record_policy = QueuePolicy::DropOldest;
+		}
+		else if (std::strcmp(argv[i], "--cook-ktx2") == 0 && remaining >= 3) {
+			// offline tool, runs without a window
+			BlockFormat format = BlockFormat::BC7;
+			if (std::strcmp(argv[i + 1], "bc1") == 0)
+				format = BlockFormat::BC1;
+			else if (std::strcmp(argv[i + 1], "etc2") == 0)
+				format = BlockFormat::ETC2;
+			return cookKtx2(argv[i + 2], argv[i + 3], format) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--bench-ktx2") == 0 && remaining >= 2) {
+			bench_png = argv[++i];
+			bench_ktx2 = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--build-pack") == 0 && remaining >= 2) {
+			// offline tool, every argument after the output path is a file to pack
+			std::vector<std::string> files(argv + i + 2, argv + argc);
+			return buildAssetPack(argv[i + 1], files) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--build-atlas") == 0 && remaining >= 2) {
+			// offline tool, every argument after the output name is an image to pack
+			TextureAtlas atlas;
+			stbi_set_flip_vertically_on_load(true);
+			for (int image = i + 2; image < argc; image++) {
+				int width, height, channels;
+				unsigned char* pixels = stbi_load(argv[image], &width, &height, &channels, 4);
+				if (pixels == NULL) {
+					std::cout << "Failed to load texture: " << argv[image] << std::endl;
+					return -1;
+				}
+				int sprite = atlas.add(argv[image], pixels, width, height);
+				stbi_image_free(pixels);
+				if (sprite < 0)
+					return -1;
+			}
+			atlas.printStats();
+			return atlas.save(argv[i + 1], BlockFormat::BC7) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--bench-atlas") == 0 && remaining >= 1)
+			bench_atlas = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--bench-sprites") == 0 && remaining >= 2) {
+			bench_sprites = std::atoi(argv[++i]);
+			bench_sprite_textures = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--pack") == 0 && remaining >= 1)
+			pack_path = argv[++i];
+		else if (std::strcmp(argv[i], "--bench-pack") == 0 && remaining >= 1) {
+			// no context needed
+			benchmarkAssetPack(std::atoi(argv[++i]));
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-convert") == 0 && remaining >= 1) {
+			// no context needed
+			benchmarkPixelConvert(std::atoi(argv[++i]));
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-png") == 0 && remaining >= 1) {
+			// no context needed, every argument after it is a file
+			benchmarkPngDecode(std::vector<std::string>(argv + i + 1, argv + argc));
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--convert-qoi") == 0 && remaining >= 2) {
+			// offline tool, runs without a window
+			return convertToQoi(argv[i + 1], argv[i + 2]) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--build-vt") == 0 && remaining >= 3) {
+			// offline tool, runs without a window
+			uint32_t format = VTEX_BC7;
+			if (std::strcmp(argv[i + 1], "bc1") == 0)
+				format = VTEX_BC1;
+			else if (std::strcmp(argv[i + 1], "rgba") == 0)
+				format = VTEX_RGBA8;
+			JobSystem jobs;
+			return buildVirtualTexture(argv[i + 2], argv[i + 3], jobs, format) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--view-vt") == 0 && remaining >= 1)
+			view_vt = argv[++i];
+		else if (std::strcmp(argv[i], "--bench-vt") == 0 && remaining >= 1)
+			bench_vt = argv[++i];
+		else if (std::strcmp(argv[i], "--bench-qoi") == 0 && remaining >= 1) {
+			// no context needed, every argument after it is a file
+			benchmarkQoi(std::vector<std::string>(argv + i + 1, argv + argc));
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--dynamic") == 0 && remaining >= 1)
+			dynamic_format = argv[++i];
+		else if (std::strcmp(argv[i], "--dynamic-quality") == 0 && remaining >= 1) {
+			i++;
+			if (std::strcmp(argv[i], "normal") == 0)
+				dynamic_quality = EncodeQuality::Normal;
+			else if (std::strcmp(argv[i], "high") == 0)
+				dynamic_quality = EncodeQuality::High;
+		}
+		else if (std::strcmp(argv[i], "--bench-encode") == 0 && remaining >= 1) {
+			// every argument after it is a file, the PSNR needs the context
+			bench_encode.assign(argv + i + 1, argv + argc);
+			break;
+		}
+	}
 
 	// initialize and configure glfw
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (!record_path.empty())
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // video size is fixed once the encoder starts
 
 	// glfw, create window
 	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "dvd_window", NULL, NULL);
@@ -49,6 +256,7 @@ int main() {
 	}
 	glfwMakeContextCurrent(window);
 	glfwSetFramebufferSizeCallback(window, frameBufferSizeCallback);
+	glfwSetScrollCallback(window, scrollCallback);
 
 	// load GLAD opengl function pointers
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -56,8 +264,35 @@ int main() {
 		return -1;
 	}
 
-	// shader object
-	Shader base_shader("glsl/vertex.glsl", "glsl/fragment.glsl");
+	// extension entry points glad was not generated with, the sprite code falls back to texture arrays without them
+	loadBindlessTexture((GLADloadproc)glfwGetProcAddress);
+
+	// benchmarks only need the context
+	if (!bench_png.empty() || bench_atlas > 0 || bench_sprites > 0 || !bench_vt.empty() || !bench_encode.empty()) {
+		if (!bench_png.empty())
+			benchmarkKtx2(bench_png, bench_ktx2);
+		if (!bench_vt.empty())
+			benchmarkVirtualTexture(bench_vt);
+		if (!bench_encode.empty())
+			benchmarkBlockEncoder(bench_encode);
+		if (bench_atlas > 0)
+			benchmarkSpriteBatch(bench_atlas, bench_atlas);
+		if (bench_sprites > 0)
+			benchmarkSpriteBatch(bench_sprite_textures, bench_sprites);
+		glfwTerminate();
+		return 0;
+	}
+
+	// one mapping for every packed asset, the views handed out below stay valid until the pack is closed at exit
+	AssetPack pack;
+	bool use_pack = std::filesystem::exists(pack_path) && pack.open(pack_path);
+
+	// shader object, compiled straight from the mapped pack when it has both stages
+	AssetView vertex_source = use_pack ? pack.find("glsl/vertex.glsl") : AssetView();
+	AssetView fragment_source = use_pack ? pack.find("glsl/fragment.glsl") : AssetView();
+	Shader base_shader = vertex_source && fragment_source
+		? Shader((const char*)vertex_source.data, vertex_source.size, (const char*)fragment_source.data, fragment_source.size)
+		: Shader("glsl/vertex.glsl", "glsl/fragment.glsl");
 
 	// in GPU buffer memory, simplified double triangle implementation using indices and EBO
 	float vertices[] = {
@@ -72,11 +307,15 @@ int main() {
 		1, 2, 3
 	};
 
+	// position at location 0, color at 1, texture coordinates at 2. stride and offsets follow from the layout
+	using QuadVertexLayout = VertexLayout<Position3f, Color3f, UV2f>;
+	static_assert(sizeof(vertices) == 4 * QuadVertexLayout::stride, "QuadVertexLayout must match vertices");
+	checkVertexLayout<QuadVertexLayout>(base_shader.program);
+
 	// setup GPU memory buffers
-	unsigned int VAO, VBO, EBO; // handles
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
+	unsigned int VBO, EBO; // handles
+	glCreateBuffers(1, &VBO);
+	glCreateBuffers(1, &EBO);
 
 	/*
 	VAO vs VBO vs EBO? What's the difference?
@@ -105,74 +344,45 @@ int main() {
 		EBO: Stores index data for efficient drawing of primitives.
 	*/
 
-	// vertex array objects (VAO)
-	glBindVertexArray(VAO);
-	// vertex buffer objects (VBO)
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	// element buffer objects (EBO)
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	// access and save buffer attributes
-	// position
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// color
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// texture coordinates
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+	// vertex buffer objects (VBO) and element buffer objects (EBO)
+	glNamedBufferStorage(VBO, sizeof(vertices), vertices, 0);
+	glNamedBufferStorage(EBO, sizeof(indices), indices, 0);
+
+	// vertex array objects (VAO), one per layout. the attribute format is set once when the cache creates it, the
+	// buffers are only attached to its binding
+	VertexArrayCache vertex_arrays;
+	unsigned int VAO = vertex_arrays.get<QuadVertexLayout>();
+	glVertexArrayVertexBuffer(VAO, 0, VBO, 0, QuadVertexLayout::stride);
+	glVertexArrayElementBuffer(VAO, EBO);
 
 	// set polygon mode
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-	// load image, create texture, and generate mipmaps
-	unsigned int texture;
-	int width, height, channels;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* data = stbi_load("dvd.png", &width, &height, &channels, 0);
-	if (data != NULL) {
-		// output debug
-		std::cout << "\nLoaded Image with attributes:" << std::endl
-			<< "\tWidth     : " << width << std::endl
-			<< "\tHeight    : " << width << std::endl
-			<< "\tChannels  : " << channels << std::endl;
-
-			// deprecated, flips alpha channel
-			//for (int i = 0; i < width * height * channels; i += channels) {
-			//	data[i + 3] = 255 - data[i + 3]; // Flip the alpha value
-			//}
-
-		// create texture
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture); // operations on GL_TEXTURE_2D now have effect on our texture object through handles
-		// set texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// determine image format
-		GLenum format;
-		if (channels == 4)
-			format = GL_RGBA;
-		else if (channels == 3)
-			format = GL_RGB;
+	// load image on a worker thread, the loader's placeholder is drawn until dvd.png reaches the GPU
+	// the manager shares one texture between every acquire() of the same file
+	JobSystem jobs;
+	std::unique_ptr<TextureManager> textures = std::make_unique<TextureManager>(jobs, 4 * 1024 * 1024, use_pack ? &pack : nullptr);
+	auto available = [&](const char* path) { return (use_pack && pack.contains(path)) || std::filesystem::exists(path); };
+	const char* dvd_path = available("dvd.ktx2") ? "dvd.ktx2" : available("dvd.qoi") ? "dvd.qoi" : "dvd.png";
+	unsigned int dvd_texture = textures->acquire(dvd_path);
+
+	// a virtual texture behind the dvd, only what the view shows is ever on the GPU
+	std::unique_ptr<VirtualTexture> virtual_texture;
+	if (!view_vt.empty()) {
+		virtual_texture = std::make_unique<VirtualTexture>(jobs);
+		if (virtual_texture->open(view_vt))
+			fitImageView(window, virtual_texture->width(), virtual_texture->height());
 		else
-			format = GL_RED;
-
-		// load texture data into opengl
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		stbi_image_free(data);
-		glBindTexture(GL_TEXTURE_2D, 0);
+			virtual_texture.reset();
 	}
-	else {
-		std::cout << "Failed to load texture" << std::endl;
+
+	// a plasma drawn instead of the dvd logo, regenerated and compressed every frame
+	std::unique_ptr<DynamicTexture> dynamic_texture;
+	std::vector<unsigned char> plasma;
+	if (!dynamic_format.empty()) {
+		BlockFormat format = dynamic_format == "bc1" ? BlockFormat::BC1 : BlockFormat::BC7;
+		dynamic_texture = std::make_unique<DynamicTexture>(jobs, DYNAMIC_SIZE, DYNAMIC_SIZE, dynamic_format != "rgba", format, dynamic_quality);
+		plasma.resize((size_t)DYNAMIC_SIZE * DYNAMIC_SIZE * 4);
 	}
 
 	// movement variables
@@ -183,13 +393,38 @@ int main() {
 	float object_size_x = 0.2f; // size of bounding box, used for collision
 	float object_size_y = 0.2f;
 
+	// video recording, only created when requested on the command line
+	std::unique_ptr<FrameCapture> capture;
+	std::unique_ptr<VideoRecorder> recorder;
+	if (!record_path.empty()) {
+		int fb_width, fb_height;
+		glfwGetFramebufferSize(window, &fb_width, &fb_height);
+		recorder = std::make_unique<VideoRecorder>(record_path, fb_width, fb_height, record_fps, RECORD_QUEUE_CAPACITY, record_policy);
+		if (recorder->isOpen())
+			capture = std::make_unique<FrameCapture>(fb_width, fb_height, CAPTURE_LATENCY + 1);
+		else
+			recorder.reset();
+	}
+
 	// render loop
 	while (!glfwWindowShouldClose(window)) {
 		processInput(window);
 
+		// upload whatever finished decoding, bounded per frame
+		textures->update();
+
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // white background
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		if (virtual_texture) {
+			// stream tiles the last feedback asked for, then ask again for this frame's view
+			virtual_texture->update();
+			int fb_width, fb_height;
+			glfwGetFramebufferSize(window, &fb_width, &fb_height);
+			virtual_texture->renderFeedback(fb_width, fb_height, image_view.rect);
+			virtual_texture->draw(image_view.rect);
+		}
+
 		// update position
 		x_pos += x_velocity;
 		y_pos += y_velocity;
@@ -201,8 +436,13 @@ int main() {
 			y_velocity *= -1;
 
 		// bind texture
-		// ignore warning here, texture is initialized by openGL indirectly
-		glBindTexture(GL_TEXTURE_2D, texture);
+		if (dynamic_texture) {
+			generatePlasma(plasma.data(), DYNAMIC_SIZE, DYNAMIC_SIZE, glfwGetTime());
+			dynamic_texture->update(plasma.data());
+			glBindTexture(GL_TEXTURE_2D, dynamic_texture->texture());
+		}
+		else
+			glBindTexture(GL_TEXTURE_2D, textures->texture(dvd_texture));
 
 		// render container
 		base_shader.use();
@@ -214,15 +454,37 @@ int main() {
 		glBindVertexArray(VAO);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+		if (recorder)
+			recordFrame(*capture, *recorder, false);
+
 		// swap buffers and poll IO events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
+	// finish the video before the context goes away
+	if (recorder) {
+		recordFrame(*capture, *recorder, true);
+		recorder->stop();
+		recorder->printStats();
+		capture.reset();
+	}
+
 	// cleaning
-	glDeleteVertexArrays(1, &VAO);
+	vertex_arrays.clear();
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
+	textures->release(dvd_texture);
+	textures->printStats();
+	textures.reset();
+	if (virtual_texture) {
+		virtual_texture->printStats();
+		virtual_texture.reset();
+	}
+	if (dynamic_texture) {
+		dynamic_texture->printStats();
+		dynamic_texture.reset();
+	}
 
 	glfwTerminate();
 	return 0;
@@ -241,15 +503,74 @@ float generateRandomDirection() {
 	return num;
 }
 
+// read back the current frame and pass frames that are CAPTURE_LATENCY old to the encoder
+// flush == true drains every pending readback, used when the window closes
+void recordFrame(FrameCapture& capture, VideoRecorder& recorder, bool flush) {
+	if (!flush)
+		capture.capture();
+
+	while (capture.pending() > (flush ? 0 : CAPTURE_LATENCY)) {
+		// a null frame means the queue policy dropped it, the readback still has to be released
+		unsigned char* frame = recorder.acquireFrame();
+		if (capture.retrieve(frame, true))
+			recorder.submitFrame(frame);
+		else
+			recorder.discardFrame(frame); // the readback was lost, the buffer holds no frame
+	}
+}
+
 // process window inputs
 void processInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
+	// drag the image view with the left mouse button
+	double cursor_x, cursor_y;
+	glfwGetCursorPos(window, &cursor_x, &cursor_y);
+	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+		if (image_view.dragging) {
+			int width, height;
+			glfwGetWindowSize(window, &width, &height);
+			image_view.rect[0] += (float)(2.0 * (cursor_x - image_view.drag_x) / width);
+			image_view.rect[1] -= (float)(2.0 * (cursor_y - image_view.drag_y) / height);
+		}
+		image_view.dragging = true;
+		image_view.drag_x = cursor_x;
+		image_view.drag_y = cursor_y;
+	}
+	else
+		image_view.dragging = false;
+
 	// additional inputs here
 }
 
 // handle window resizing
 void frameBufferSizeCallback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
+}
+
+// zoom the image view around the cursor
+void scrollCallback(GLFWwindow* window, double, double y_offset) {
+	double cursor_x, cursor_y;
+	int width, height;
+	glfwGetCursorPos(window, &cursor_x, &cursor_y);
+	glfwGetWindowSize(window, &width, &height);
+	float x = (float)(2.0 * cursor_x / width - 1.0), y = (float)(1.0 - 2.0 * cursor_y / height);
+	float factor = std::pow(1.25f, (float)y_offset);
+	float* rect = image_view.rect;
+	rect[0] = x - (x - rect[0]) * factor;
+	rect[1] = y - (y - rect[1]) * factor;
+	rect[2] *= factor;
+	rect[3] *= factor;
+}
+
+// show the whole image as large as the window allows, centered and with square texels
+void fitImageView(GLFWwindow* window, int image_width, int image_height) {
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	float scale = std::min((float)width / image_width, (float)height / image_height); // pixels per texel
+	image_view.rect[2] = 2.0f * image_width * scale / width;
+	image_view.rect[3] = 2.0f * image_height * scale / height;
+	image_view.rect[0] = -image_view.rect[2] / 2.0f;
+	image_view.rect[1] = -image_view.rect[3] / 2.0f;
 }
\ No newline at end of file
@@ -0,0 +1,451 @@
+#pragma once
+// pixel format conversion functions defined here
+// everything the load path does to decoded pixels before they reach the GPU: RGB -> RGBA expansion, vertical flip,
+// premultiplied alpha, sRGB <-> linear and channel swizzles
+//
+// every operation has a scalar reference and SSE4.1 / AVX2 (x86) or NEON (AArch64) kernels, the fastest set the CPU
+// supports is picked once at startup (see pixelKernels()). the kernels produce exactly the bytes the scalar code does
+//
+// sRGB conversions are table lookups, only AVX2 has a gather instruction so the SSE4.1 and NEON sets use the scalar loop
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PIXEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PIXEL_TARGET(isa) // msvc accepts every intrinsic without a flag
+#else
+#define PIXEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+enum class SimdLevel {
+	Scalar,
+	SSE41,
+	AVX2,
+	NEON,
+};
+
+inline const char* simdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::SSE41: return "SSE4.1";
+	case SimdLevel::AVX2: return "AVX2";
+	case SimdLevel::NEON: return "NEON";
+	default: return "scalar";
+	}
+}
+
+// best level this CPU and OS can run
+inline SimdLevel detectSimdLevel() {
+#if defined(PIXEL_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	bool avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+#else
+	bool sse41 = __builtin_cpu_supports("sse4.1");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+	if (avx2)
+		return SimdLevel::AVX2;
+	if (sse41)
+		return SimdLevel::SSE41;
+	return SimdLevel::Scalar;
+#elif defined(PIXEL_NEON)
+	return SimdLevel::NEON; // part of every AArch64 CPU
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+// lookup tables shared by every kernel so all of them round the same way
+
+const int LINEAR_TO_SRGB_STEPS = 4096; // quantization of linear values, fine enough to round trip every sRGB byte
+
+struct SrgbTables {
+	float to_linear[256];
+	int to_srgb[LINEAR_TO_SRGB_STEPS];
+
+	SrgbTables() {
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < LINEAR_TO_SRGB_STEPS; i++) {
+			float l = (float)i / (LINEAR_TO_SRGB_STEPS - 1);
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			to_srgb[i] = (int)(c * 255.0f + 0.5f);
+		}
+	}
+};
+
+inline const SrgbTables& srgbTables() {
+	static const SrgbTables tables;
+	return tables;
+}
+
+// c * a / 255 rounded to nearest, exact for every pair of bytes
+inline unsigned char mulDiv255(unsigned int c, unsigned int a) {
+	unsigned int t = c * a + 128;
+	return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+// scalar reference
+
+inline void expandRGBToRGBAScalar(const unsigned char* rgb, unsigned char* rgba, size_t count, unsigned char alpha) {
+	for (size_t i = 0; i < count; i++) {
+		rgba[i * 4 + 0] = rgb[i * 3 + 0];
+		rgba[i * 4 + 1] = rgb[i * 3 + 1];
+		rgba[i * 4 + 2] = rgb[i * 3 + 2];
+		rgba[i * 4 + 3] = alpha;
+	}
+}
+
+inline void premultiplyAlphaScalar(unsigned char* rgba, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		unsigned char* p = rgba + i * 4;
+		p[0] = mulDiv255(p[0], p[3]);
+		p[1] = mulDiv255(p[1], p[3]);
+		p[2] = mulDiv255(p[2], p[3]);
+	}
+}
+
+inline void swizzleRGBAScalar(const unsigned char* source, unsigned char* destination, size_t count, const unsigned char* order) {
+	for (size_t i = 0; i < count; i++) {
+		unsigned char pixel[4] = { source[i * 4 + order[0]], source[i * 4 + order[1]], source[i * 4 + order[2]], source[i * 4 + order[3]] };
+		std::memcpy(destination + i * 4, pixel, 4); // source and destination may be the same buffer
+	}
+}
+
+inline void srgbToLinearScalar(const unsigned char* rgba, float* linear, size_t count) {
+	const SrgbTables& tables = srgbTables();
+	for (size_t i = 0; i < count; i++) {
+		linear[i * 4 + 0] = tables.to_linear[rgba[i * 4 + 0]];
+		linear[i * 4 + 1] = tables.to_linear[rgba[i * 4 + 1]];
+		linear[i * 4 + 2] = tables.to_linear[rgba[i * 4 + 2]];
+		linear[i * 4 + 3] = rgba[i * 4 + 3] * (1.0f / 255.0f); // alpha is stored linearly
+	}
+}
+
+inline void linearToSrgbScalar(const float* linear, unsigned char* rgba, size_t count) {
+	const SrgbTables& tables = srgbTables();
+	for (size_t i = 0; i < count * 4; i++) {
+		// written so NaN fails the test and becomes 0, the same as the SIMD kernels' max
+		float value = linear[i] > 0.0f ? std::min(linear[i], 1.0f) : 0.0f;
+		if (i % 4 == 3)
+			rgba[i] = (unsigned char)(int)(value * 255.0f + 0.5f);
+		else
+			rgba[i] = (unsigned char)tables.to_srgb[(int)(value * (LINEAR_TO_SRGB_STEPS - 1) + 0.5f)];
+	}
+}
+
+#if defined(PIXEL_X86)
+
+// SSE4.1, 16 pixels (48 bytes in, 64 out) per iteration
+PIXEL_TARGET("sse4.1")
+inline void expandRGBToRGBASSE41(const unsigned char* rgb, unsigned char* rgba, size_t count, unsigned char alpha) {
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha_bytes = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(rgb + i * 3 + 16));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(rgb + i * 3 + 32));
+		__m128i p0 = _mm_shuffle_epi8(v0, shuffle);
+		__m128i p1 = _mm_shuffle_epi8(_mm_alignr_epi8(v1, v0, 12), shuffle);
+		__m128i p2 = _mm_shuffle_epi8(_mm_alignr_epi8(v2, v1, 8), shuffle);
+		__m128i p3 = _mm_shuffle_epi8(_mm_srli_si128(v2, 4), shuffle);
+		_mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(p0, alpha_bytes));
+		_mm_storeu_si128((__m128i*)(rgba + i * 4 + 16), _mm_or_si128(p1, alpha_bytes));
+		_mm_storeu_si128((__m128i*)(rgba + i * 4 + 32), _mm_or_si128(p2, alpha_bytes));
+		_mm_storeu_si128((__m128i*)(rgba + i * 4 + 48), _mm_or_si128(p3, alpha_bytes));
+	}
+	expandRGBToRGBAScalar(rgb + i * 3, rgba + i * 4, count - i, alpha);
+}
+
+// two pixels widened to 16 bits, multiplied by (a, a, a, 255) and divided by 255 with the same rounding as mulDiv255()
+PIXEL_TARGET("sse4.1")
+inline __m128i premultiplyHalfSSE41(__m128i pixels, __m128i alpha_shuffle) {
+	const __m128i keep_alpha = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+	__m128i factors = _mm_or_si128(_mm_shuffle_epi8(pixels, alpha_shuffle), keep_alpha);
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, factors), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+PIXEL_TARGET("sse4.1")
+inline void premultiplyAlphaSSE41(unsigned char* rgba, size_t count) {
+	// alpha of each widened pixel copied into its three color lanes, the alpha lane is zeroed and set to 255 afterwards
+	const __m128i alpha_shuffle = _mm_setr_epi8(6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+		__m128i low = premultiplyHalfSSE41(_mm_unpacklo_epi8(v, zero), alpha_shuffle);
+		__m128i high = premultiplyHalfSSE41(_mm_unpackhi_epi8(v, zero), alpha_shuffle);
+		_mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(low, high));
+	}
+	premultiplyAlphaScalar(rgba + i * 4, count - i);
+}
+
+PIXEL_TARGET("sse4.1")
+inline void swizzleRGBASSE41(const unsigned char* source, unsigned char* destination, size_t count, const unsigned char* order) {
+	const __m128i shuffle = _mm_setr_epi8(
+		order[0], order[1], order[2], order[3], 4 + order[0], 4 + order[1], 4 + order[2], 4 + order[3],
+		8 + order[0], 8 + order[1], 8 + order[2], 8 + order[3], 12 + order[0], 12 + order[1], 12 + order[2], 12 + order[3]);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(source + i * 4)), shuffle));
+	swizzleRGBAScalar(source + i * 4, destination + i * 4, count - i, order);
+}
+
+// AVX2, each 128 bit lane does what the SSE4.1 kernel does for four pixels
+
+PIXEL_TARGET("avx2")
+inline __m256i loadLanes(const unsigned char* low, const unsigned char* high) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)low)), _mm_loadu_si128((const __m128i*)high), 1);
+}
+
+PIXEL_TARGET("avx2")
+inline void expandRGBToRGBAAVX2(const unsigned char* rgb, unsigned char* rgba, size_t count, unsigned char alpha) {
+	const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m256i alpha_bytes = _mm256_set1_epi32((int)((unsigned int)alpha << 24));
+	size_t i = 0;
+	// every lane load reads 16 bytes for 12, stop while the last one still lies inside the source
+	for (; i + 16 <= count && (i + 16) * 3 + 4 <= count * 3; i += 16) {
+		const unsigned char* s = rgb + i * 3;
+		__m256i p0 = _mm256_shuffle_epi8(loadLanes(s, s + 12), shuffle);
+		__m256i p1 = _mm256_shuffle_epi8(loadLanes(s + 24, s + 36), shuffle);
+		_mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(p0, alpha_bytes));
+		_mm256_storeu_si256((__m256i*)(rgba + i * 4 + 32), _mm256_or_si256(p1, alpha_bytes));
+	}
+	expandRGBToRGBASSE41(rgb + i * 3, rgba + i * 4, count - i, alpha);
+}
+
+PIXEL_TARGET("avx2")
+inline __m256i premultiplyHalfAVX2(__m256i pixels, __m256i alpha_shuffle) {
+	const __m256i keep_alpha = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+	__m256i factors = _mm256_or_si256(_mm256_shuffle_epi8(pixels, alpha_shuffle), keep_alpha);
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(pixels, factors), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+PIXEL_TARGET("avx2")
+inline void premultiplyAlphaAVX2(unsigned char* rgba, size_t count) {
+	const __m256i alpha_shuffle = _mm256_setr_epi8(6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1,
+		6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1);
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// unpack and pack both work per lane, so the pixels come back in their original order
+		__m256i v = _mm256_loadu_si256((const __m256i*)(rgba + i * 4));
+		__m256i low = premultiplyHalfAVX2(_mm256_unpacklo_epi8(v, zero), alpha_shuffle);
+		__m256i high = premultiplyHalfAVX2(_mm256_unpackhi_epi8(v, zero), alpha_shuffle);
+		_mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_packus_epi16(low, high));
+	}
+	premultiplyAlphaSSE41(rgba + i * 4, count - i);
+}
+
+PIXEL_TARGET("avx2")
+inline void swizzleRGBAAVX2(const unsigned char* source, unsigned char* destination, size_t count, const unsigned char* order) {
+	const __m256i shuffle = _mm256_setr_epi8(
+		order[0], order[1], order[2], order[3], 4 + order[0], 4 + order[1], 4 + order[2], 4 + order[3],
+		8 + order[0], 8 + order[1], 8 + order[2], 8 + order[3], 12 + order[0], 12 + order[1], 12 + order[2], 12 + order[3],
+		order[0], order[1], order[2], order[3], 4 + order[0], 4 + order[1], 4 + order[2], 4 + order[3],
+		8 + order[0], 8 + order[1], 8 + order[2], 8 + order[3], 12 + order[0], 12 + order[1], 12 + order[2], 12 + order[3]);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(source + i * 4)), shuffle));
+	swizzleRGBASSE41(source + i * 4, destination + i * 4, count - i, order);
+}
+
+PIXEL_TARGET("avx2")
+inline void srgbToLinearAVX2(const unsigned char* rgba, float* linear, size_t count) {
+	const SrgbTables& tables = srgbTables();
+	const __m256 alpha_lanes = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(rgba + i * 4)));
+		__m256 color = _mm256_i32gather_ps(tables.to_linear, bytes, 4);
+		__m256 alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(bytes), _mm256_set1_ps(1.0f / 255.0f));
+		_mm256_storeu_ps(linear + i * 4, _mm256_blendv_ps(color, alpha, alpha_lanes));
+	}
+	srgbToLinearScalar(rgba + i * 4, linear + i * 4, count - i);
+}
+
+PIXEL_TARGET("avx2")
+inline void linearToSrgbAVX2(const float* linear, unsigned char* rgba, size_t count) {
+	const SrgbTables& tables = srgbTables();
+	const __m256 alpha_lanes = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+	// the same multiply then add as the scalar code, no fused multiply-add, so both round identically
+	const __m256 scale = _mm256_blendv_ps(_mm256_set1_ps((float)(LINEAR_TO_SRGB_STEPS - 1)), _mm256_set1_ps(255.0f), alpha_lanes);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(linear + i * 4), _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+		__m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, scale), _mm256_set1_ps(0.5f)));
+		__m256i color = _mm256_i32gather_epi32(tables.to_srgb, index, 4);
+		__m256i bytes = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(color), _mm256_castsi256_ps(index), alpha_lanes));
+		__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+		_mm_storel_epi64((__m128i*)(rgba + i * 4), _mm_packus_epi16(words, words));
+	}
+	linearToSrgbScalar(linear + i * 4, rgba + i * 4, count - i);
+}
+
+#endif
+
+#if defined(PIXEL_NEON)
+
+inline void expandRGBToRGBANEON(const unsigned char* rgb, unsigned char* rgba, size_t count, unsigned char alpha) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x3_t in = vld3q_u8(rgb + i * 3);
+		uint8x16x4_t out = { { in.val[0], in.val[1], in.val[2], vdupq_n_u8(alpha) } };
+		vst4q_u8(rgba + i * 4, out);
+	}
+	expandRGBToRGBAScalar(rgb + i * 3, rgba + i * 4, count - i, alpha);
+}
+
+// (c * a + ((c * a + 128) >> 8) + 128) >> 8, the same value mulDiv255() computes
+inline uint8x8_t mulDiv255NEON(uint8x8_t c, uint8x8_t a) {
+	uint16x8_t t = vmull_u8(c, a);
+	return vrshrn_n_u16(vrsraq_n_u16(t, t, 8), 8);
+}
+
+inline void premultiplyAlphaNEON(unsigned char* rgba, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t p = vld4q_u8(rgba + i * 4);
+		for (int c = 0; c < 3; c++)
+			p.val[c] = vcombine_u8(mulDiv255NEON(vget_low_u8(p.val[c]), vget_low_u8(p.val[3])),
+				mulDiv255NEON(vget_high_u8(p.val[c]), vget_high_u8(p.val[3])));
+		vst4q_u8(rgba + i * 4, p);
+	}
+	premultiplyAlphaScalar(rgba + i * 4, count - i);
+}
+
+inline void swizzleRGBANEON(const unsigned char* source, unsigned char* destination, size_t count, const unsigned char* order) {
+	unsigned char indices[16];
+	for (int b = 0; b < 16; b++)
+		indices[b] = (unsigned char)((b & ~3) + order[b & 3]);
+	uint8x16_t table = vld1q_u8(indices);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		vst1q_u8(destination + i * 4, vqtbl1q_u8(vld1q_u8(source + i * 4), table));
+	swizzleRGBAScalar(source + i * 4, destination + i * 4, count - i, order);
+}
+
+#endif
+
+// flip an image upside down in place, rows are swapped through a small stack buffer with memcpy (already vectorized)
+inline void flipRows(unsigned char* pixels, int width, int height, int channels) {
+	size_t row_bytes = (size_t)width * channels;
+	unsigned char buffer[4096];
+	for (int y = 0; y < height / 2; y++) {
+		unsigned char* top = pixels + (size_t)y * row_bytes;
+		unsigned char* bottom = pixels + (size_t)(height - 1 - y) * row_bytes;
+		for (size_t offset = 0; offset < row_bytes; offset += sizeof(buffer)) {
+			size_t bytes = std::min(sizeof(buffer), row_bytes - offset);
+			std::memcpy(buffer, top + offset, bytes);
+			std::memcpy(top + offset, bottom + offset, bytes);
+			std::memcpy(bottom + offset, buffer, bytes);
+		}
+	}
+}
+
+// the kernel set in use, one function pointer per operation
+struct PixelKernels {
+	SimdLevel level = SimdLevel::Scalar;
+	void (*expandRGBToRGBA)(const unsigned char*, unsigned char*, size_t, unsigned char) = expandRGBToRGBAScalar;
+	void (*premultiplyAlpha)(unsigned char*, size_t) = premultiplyAlphaScalar;
+	void (*swizzleRGBA)(const unsigned char*, unsigned char*, size_t, const unsigned char*) = swizzleRGBAScalar;
+	void (*srgbToLinear)(const unsigned char*, float*, size_t) = srgbToLinearScalar;
+	void (*linearToSrgb)(const float*, unsigned char*, size_t) = linearToSrgbScalar;
+};
+
+inline PixelKernels makePixelKernels(SimdLevel level) {
+	PixelKernels kernels;
+	kernels.level = level;
+#if defined(PIXEL_X86)
+	if (level == SimdLevel::SSE41 || level == SimdLevel::AVX2) {
+		kernels.expandRGBToRGBA = expandRGBToRGBASSE41;
+		kernels.premultiplyAlpha = premultiplyAlphaSSE41;
+		kernels.swizzleRGBA = swizzleRGBASSE41;
+	}
+	if (level == SimdLevel::AVX2) {
+		kernels.expandRGBToRGBA = expandRGBToRGBAAVX2;
+		kernels.premultiplyAlpha = premultiplyAlphaAVX2;
+		kernels.swizzleRGBA = swizzleRGBAAVX2;
+		kernels.srgbToLinear = srgbToLinearAVX2;
+		kernels.linearToSrgb = linearToSrgbAVX2;
+	}
+#elif defined(PIXEL_NEON)
+	if (level == SimdLevel::NEON) {
+		kernels.expandRGBToRGBA = expandRGBToRGBANEON;
+		kernels.premultiplyAlpha = premultiplyAlphaNEON;
+		kernels.swizzleRGBA = swizzleRGBANEON;
+	}
+#endif
+	return kernels;
+}
+
+// one table per level, built on first use and never written after that
+inline const PixelKernels& pixelKernelsFor(SimdLevel level) {
+	static const PixelKernels tables[4] = { makePixelKernels(SimdLevel::Scalar), makePixelKernels(SimdLevel::SSE41),
+		makePixelKernels(SimdLevel::AVX2), makePixelKernels(SimdLevel::NEON) };
+	return tables[(int)level];
+}
+
+// the table in use, the best level the CPU supports until setSimdLevel() points it at another one. decodes on worker
+// threads read it while a benchmark may switch it, every table gives the same bytes so either one will do
+inline std::atomic<const PixelKernels*>& activePixelKernels() {
+	static std::atomic<const PixelKernels*> active(&pixelKernelsFor(detectSimdLevel()));
+	return active;
+}
+
+inline const PixelKernels& pixelKernels() {
+	return *activePixelKernels().load(std::memory_order_acquire);
+}
+
+// force a lower level, for benchmarks and for checking kernels against each other, false if the CPU cannot run 'level'
+inline bool setSimdLevel(SimdLevel level) {
+	SimdLevel best = detectSimdLevel();
+	bool supported = level == SimdLevel::Scalar || level == best || (level == SimdLevel::SSE41 && best == SimdLevel::AVX2);
+	if (supported)
+		activePixelKernels().store(&pixelKernelsFor(level), std::memory_order_release);
+	return supported;
+}
+
+// public entry points, 'count' is always in pixels
+
+inline void expandRGBToRGBA(const unsigned char* rgb, unsigned char* rgba, size_t count, unsigned char alpha = 255) {
+	pixelKernels().expandRGBToRGBA(rgb, rgba, count, alpha);
+}
+
+inline void premultiplyAlpha(unsigned char* rgba, size_t count) {
+	pixelKernels().premultiplyAlpha(rgba, count);
+}
+
+// destination channel c takes source channel order[c], { 2, 1, 0, 3 } turns RGBA into BGRA, in place is fine
+inline void swizzleRGBA(const unsigned char* source, unsigned char* destination, size_t count, const unsigned char* order) {
+	pixelKernels().swizzleRGBA(source, destination, count, order);
+}
+
+inline void srgbToLinear(const unsigned char* rgba, float* linear, size_t count) {
+	pixelKernels().srgbToLinear(rgba, linear, count);
+}
+
+inline void linearToSrgb(const float* linear, unsigned char* rgba, size_t count) {
+	pixelKernels().linearToSrgb(linear, rgba, count);
+}
@@ -0,0 +1,869 @@
+#pragma once
+// png decoder functions defined here
+// a faster replacement for stb_image on the png files the texture loader sees, the result is byte for byte what
+// stbi_load_from_memory(..., 0) returns (top row first), decodePng() hands back null for anything it does not cover
+// (interlaced and apple CgBI files, corrupt data) and the caller falls back to stb_image
+//
+// inflate reads 64 bits at a time and decodes through an 11 bit lookup table whose entries may hold two literals, one
+// lookup then emits both, longer codes go through a second level table. matches are copied 8 bytes at a time
+//
+// rows are unfiltered in place, each row is moved up over its own filter byte so the inflate output becomes the image
+// without another buffer. Sub/Up/Avg/Paeth have SSE4.1 and NEON kernels for 3 and 4 byte pixels, picked with the
+// same level as the pixel_convert.h kernels (setSimdLevel() switches both)
+//
+// like stb_image, the zlib adler32 and the chunk crcs are not checked
+
+#include <pixel_convert.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// huffman table entries: value << 16 | kind << 12 | extra bits << 8 | code bits
+// literal values are the byte, a double literal holds the first byte in bits 16-23 and the second in 24-31,
+// length and distance values are the base, a subtable entry holds its offset and uses 'extra' for its index bits
+const uint32_t HUFF_INVALID = 0, HUFF_LITERAL = 1, HUFF_DOUBLE = 2, HUFF_LENGTH = 3, HUFF_END = 4, HUFF_SUBTABLE = 5;
+const int LITLEN_TABLE_BITS = 11, DISTANCE_TABLE_BITS = 8, CODELEN_TABLE_BITS = 7;
+const size_t INFLATE_SLACK = 64; // match copies may write up to 8 bytes past the end of the output
+
+inline uint32_t huffEntry(uint32_t kind, uint32_t value, uint32_t extra = 0, uint32_t bits = 0) {
+	return value << 16 | kind << 12 | extra << 8 | bits;
+}
+
+inline uint32_t huffBits(uint32_t entry) {
+	return entry & 0xFF;
+}
+
+inline uint32_t huffExtra(uint32_t entry) {
+	return (entry >> 8) & 0xF;
+}
+
+inline uint32_t huffKind(uint32_t entry) {
+	return (entry >> 12) & 0xF;
+}
+
+inline uint32_t huffValue(uint32_t entry) {
+	return entry >> 16;
+}
+
+// entries every symbol of the two alphabets decodes to, without their code length
+struct DeflateSymbols {
+	uint32_t litlen[288];
+	uint32_t distance[32];
+
+	DeflateSymbols() {
+		const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+			131, 163, 195, 227, 258 };
+		const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+			2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		for (uint32_t s = 0; s < 288; s++) {
+			if (s < 256)
+				litlen[s] = huffEntry(HUFF_LITERAL, s);
+			else if (s == 256)
+				litlen[s] = huffEntry(HUFF_END, 0);
+			else if (s < 286)
+				litlen[s] = huffEntry(HUFF_LENGTH, length_base[s - 257], length_extra[s - 257]);
+			else
+				litlen[s] = huffEntry(HUFF_INVALID, 0);
+		}
+		for (uint32_t s = 0; s < 32; s++)
+			distance[s] = s < 30 ? huffEntry(HUFF_LENGTH, distance_base[s], distance_extra[s]) : huffEntry(HUFF_INVALID, 0);
+	}
+};
+
+inline const DeflateSymbols& deflateSymbols() {
+	static const DeflateSymbols symbols;
+	return symbols;
+}
+
+// build a canonical huffman decoding table from code lengths, a primary table of 1 << primary_bits entries indexed by the
+// next input bits followed by the subtables for longer codes. false for an over-subscribed code, unused codes stay invalid
+inline bool buildHuffmanTable(const uint8_t* lengths, int count, int primary_bits, const uint32_t* symbols, std::vector<uint32_t>& table) {
+	int counts[16] = {};
+	for (int s = 0; s < count; s++)
+		counts[lengths[s]]++;
+	counts[0] = 0;
+	int left = 1;
+	for (int length = 1; length < 16; length++) {
+		left = (left << 1) - counts[length];
+		if (left < 0)
+			return false;
+	}
+
+	// canonical codes, reversed because deflate sends them most significant bit first into a little endian bit stream
+	int next_code[16] = {};
+	for (int length = 1, code = 0; length < 16; length++) {
+		code = (code + counts[length - 1]) << 1;
+		next_code[length] = code;
+	}
+	uint32_t primary_mask = (1u << primary_bits) - 1;
+	std::vector<uint32_t> reversed(count);
+	int sub_bits[1 << 11] = {}; // longest code below each primary index, as subtable index bits
+	for (int s = 0; s < count; s++) {
+		int length = lengths[s];
+		if (length == 0)
+			continue;
+		uint32_t code = (uint32_t)next_code[length]++, r = 0;
+		for (int b = 0; b < length; b++)
+			r |= ((code >> b) & 1) << (length - 1 - b);
+		reversed[s] = r;
+		if (length > primary_bits)
+			sub_bits[r & primary_mask] = std::max(sub_bits[r & primary_mask], length - primary_bits);
+	}
+
+	table.assign((size_t)1 << primary_bits, huffEntry(HUFF_INVALID, 0));
+	for (uint32_t prefix = 0; prefix <= primary_mask; prefix++) {
+		if (sub_bits[prefix] == 0)
+			continue;
+		table[prefix] = huffEntry(HUFF_SUBTABLE, (uint32_t)table.size(), sub_bits[prefix], primary_bits);
+		table.resize(table.size() + ((size_t)1 << sub_bits[prefix]), huffEntry(HUFF_INVALID, 0));
+	}
+	for (int s = 0; s < count; s++) {
+		int length = lengths[s];
+		if (length == 0)
+			continue;
+		uint32_t r = reversed[s];
+		if (length <= primary_bits) {
+			for (uint32_t i = r; i <= primary_mask; i += 1u << length)
+				table[i] = symbols[s] | length;
+		}
+		else {
+			uint32_t pointer = table[r & primary_mask];
+			uint32_t size = 1u << huffExtra(pointer), step = 1u << (length - primary_bits);
+			for (uint32_t i = r >> primary_bits; i < size; i += step)
+				table[huffValue(pointer) + i] = symbols[s] | (length - primary_bits);
+		}
+	}
+	return true;
+}
+
+// turn primary literal entries into double literals wherever the next code is a literal that fits the remaining index bits
+inline void pairLiterals(std::vector<uint32_t>& table, int primary_bits) {
+	// i >> bits is below i, walking down reads every second entry before it gets paired itself
+	for (int i = (1 << primary_bits) - 1; i >= 0; i--) {
+		uint32_t first = table[i];
+		uint32_t bits = huffBits(first);
+		if (huffKind(first) != HUFF_LITERAL || (int)bits >= primary_bits)
+			continue;
+		uint32_t second = table[i >> bits];
+		if (huffKind(second) == HUFF_LITERAL && (int)(bits + huffBits(second)) <= primary_bits)
+			table[i] = huffEntry(HUFF_DOUBLE, huffValue(first) | huffValue(second) << 8, 0, bits + huffBits(second));
+	}
+}
+
+// little endian bit reader, keeps 56 to 63 bits buffered after every refill
+struct InflateBits {
+	const uint8_t* in;
+	const uint8_t* end;
+	uint64_t bits = 0;
+	unsigned int count = 0;
+	size_t overrun = 0; // zero bytes shifted in past the end of the input
+
+	void refill() {
+		if (end - in >= 8) {
+			uint64_t word;
+			std::memcpy(&word, in, 8);
+			bits |= word << count;
+			in += (63 - count) >> 3;
+			count |= 56;
+			return;
+		}
+		while (count < 56) {
+			if (in < end)
+				bits |= (uint64_t)*in++ << count;
+			else
+				overrun++;
+			count += 8;
+		}
+	}
+
+	uint32_t take(unsigned int n) {
+		uint32_t value = (uint32_t)(bits & ((1ull << n) - 1));
+		bits >>= n;
+		count -= n;
+		return value;
+	}
+
+	uint32_t decode(const std::vector<uint32_t>& table, int primary_bits) {
+		uint32_t entry = table[bits & ((1u << primary_bits) - 1)];
+		if (huffKind(entry) == HUFF_SUBTABLE) {
+			take(primary_bits);
+			entry = table[huffValue(entry) + (bits & ((1u << huffExtra(entry)) - 1))];
+		}
+		take(huffBits(entry));
+		return entry;
+	}
+
+	// more than the up to 8 bytes of padding a refill may add were consumed, the stream ended early
+	bool exhausted() const {
+		return overrun > 8;
+	}
+};
+
+struct InflateTables {
+	std::vector<uint32_t> litlen, distance, codelen;
+};
+
+inline const InflateTables& fixedInflateTables() {
+	static const InflateTables tables = [] {
+		InflateTables fixed;
+		uint8_t lengths[288];
+		std::memset(lengths, 8, 144);
+		std::memset(lengths + 144, 9, 112);
+		std::memset(lengths + 256, 7, 24);
+		std::memset(lengths + 280, 8, 8);
+		buildHuffmanTable(lengths, 288, LITLEN_TABLE_BITS, deflateSymbols().litlen, fixed.litlen);
+		pairLiterals(fixed.litlen, LITLEN_TABLE_BITS);
+		std::memset(lengths, 5, 32);
+		buildHuffmanTable(lengths, 32, DISTANCE_TABLE_BITS, deflateSymbols().distance, fixed.distance);
+		return fixed;
+	}();
+	return tables;
+}
+
+// read the code lengths of a dynamic block and build its tables
+inline bool readDynamicTables(InflateBits& input, InflateTables& tables) {
+	static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+	static const uint32_t codelen_symbols[19] = { huffEntry(HUFF_LITERAL, 0), huffEntry(HUFF_LITERAL, 1), huffEntry(HUFF_LITERAL, 2),
+		huffEntry(HUFF_LITERAL, 3), huffEntry(HUFF_LITERAL, 4), huffEntry(HUFF_LITERAL, 5), huffEntry(HUFF_LITERAL, 6),
+		huffEntry(HUFF_LITERAL, 7), huffEntry(HUFF_LITERAL, 8), huffEntry(HUFF_LITERAL, 9), huffEntry(HUFF_LITERAL, 10),
+		huffEntry(HUFF_LITERAL, 11), huffEntry(HUFF_LITERAL, 12), huffEntry(HUFF_LITERAL, 13), huffEntry(HUFF_LITERAL, 14),
+		huffEntry(HUFF_LITERAL, 15), huffEntry(HUFF_LITERAL, 16), huffEntry(HUFF_LITERAL, 17), huffEntry(HUFF_LITERAL, 18) };
+
+	input.refill();
+	int litlen_count = (int)input.take(5) + 257, distance_count = (int)input.take(5) + 1, codelen_count = (int)input.take(4) + 4;
+	uint8_t codelen_lengths[19] = {};
+	for (int i = 0; i < codelen_count; i++) {
+		input.refill();
+		codelen_lengths[order[i]] = (uint8_t)input.take(3);
+	}
+	if (!buildHuffmanTable(codelen_lengths, 19, CODELEN_TABLE_BITS, codelen_symbols, tables.codelen))
+		return false;
+
+	uint8_t lengths[288 + 32];
+	int total = litlen_count + distance_count;
+	for (int i = 0; i < total;) {
+		input.refill();
+		uint32_t entry = input.decode(tables.codelen, CODELEN_TABLE_BITS);
+		if (huffKind(entry) != HUFF_LITERAL)
+			return false;
+		uint32_t symbol = huffValue(entry);
+		if (symbol < 16) {
+			lengths[i++] = (uint8_t)symbol;
+			continue;
+		}
+		uint8_t value = 0;
+		int repeat;
+		if (symbol == 16) {
+			if (i == 0)
+				return false;
+			value = lengths[i - 1];
+			repeat = 3 + (int)input.take(2);
+		}
+		else if (symbol == 17)
+			repeat = 3 + (int)input.take(3);
+		else
+			repeat = 11 + (int)input.take(7);
+		if (i + repeat > total)
+			return false;
+		std::memset(lengths + i, value, repeat);
+		i += repeat;
+	}
+	if (lengths[256] == 0 || input.exhausted())
+		return false;
+
+	if (!buildHuffmanTable(lengths, litlen_count, LITLEN_TABLE_BITS, deflateSymbols().litlen, tables.litlen) ||
+		!buildHuffmanTable(lengths + litlen_count, distance_count, DISTANCE_TABLE_BITS, deflateSymbols().distance, tables.distance))
+		return false;
+	pairLiterals(tables.litlen, LITLEN_TABLE_BITS);
+	return true;
+}
+
+// decode one huffman block into [out, end), false on corrupt data or when it would not fit
+inline bool inflateBlock(InflateBits& input, const InflateTables& tables, const uint8_t* begin, uint8_t*& out, const uint8_t* end) {
+	for (;;) {
+		// one refill covers the longest length code, its extra bits, distance code and extra bits (48 bits)
+		input.refill();
+		uint32_t entry = input.decode(tables.litlen, LITLEN_TABLE_BITS);
+		uint32_t kind = huffKind(entry);
+		if (kind == HUFF_LITERAL) {
+			if (out == end)
+				return false;
+			*out++ = (uint8_t)huffValue(entry);
+			continue;
+		}
+		if (kind == HUFF_DOUBLE) {
+			if (end - out < 2)
+				return false;
+			out[0] = (uint8_t)huffValue(entry);
+			out[1] = (uint8_t)(huffValue(entry) >> 8);
+			out += 2;
+			continue;
+		}
+		if (kind == HUFF_END)
+			return !input.exhausted();
+		if (kind != HUFF_LENGTH || input.exhausted())
+			return false;
+
+		size_t length = huffValue(entry) + input.take(huffExtra(entry));
+		entry = input.decode(tables.distance, DISTANCE_TABLE_BITS);
+		if (huffKind(entry) != HUFF_LENGTH)
+			return false;
+		size_t distance = huffValue(entry) + input.take(huffExtra(entry));
+		if (distance > (size_t)(out - begin) || length > (size_t)(end - out))
+			return false;
+
+		uint8_t* destination = out;
+		const uint8_t* source = out - distance;
+		out += length;
+		if (distance >= 8) {
+			do {
+				std::memcpy(destination, source, 8);
+				destination += 8;
+				source += 8;
+			} while (destination < out);
+		}
+		else if (distance == 1)
+			std::memset(destination, *source, length);
+		else {
+			// a short distance repeats a pattern, lay down its first 8 bytes one at a time and continue 8 bytes at a time from
+			// a whole number of periods back, which is at least 8 bytes behind
+			size_t period = distance;
+			while (period < 8)
+				period += distance;
+			for (int i = 0; i < 8; i++)
+				destination[i] = source[i];
+			destination += 8;
+			source = destination - period;
+			while (destination < out) {
+				std::memcpy(destination, source, 8);
+				destination += 8;
+				source += 8;
+			}
+		}
+	}
+}
+
+// zlib stream to exactly 'size' bytes at 'out' (which has INFLATE_SLACK bytes to spare), false when it is anything else
+inline bool inflateZlib(const uint8_t* data, size_t data_size, uint8_t* out, size_t size) {
+	if (data_size < 2 || (data[0] & 0x0F) != 8 || (data[0] * 256 + data[1]) % 31 != 0 || (data[1] & 0x20) != 0)
+		return false;
+	InflateBits input;
+	input.in = data + 2;
+	input.end = data + data_size;
+	InflateTables dynamic;
+	const uint8_t* begin = out;
+	const uint8_t* end = out + size;
+
+	bool final = false;
+	while (!final) {
+		input.refill();
+		final = input.take(1) != 0;
+		uint32_t type = input.take(2);
+		if (type == 0) {
+			// stored, give back the whole bytes still buffered and copy straight from the input
+			input.take(input.count & 7);
+			size_t buffered = input.count / 8;
+			if (buffered < input.overrun)
+				return false;
+			input.in -= buffered - input.overrun;
+			input.bits = 0;
+			input.count = 0;
+			input.overrun = 0;
+			if (input.end - input.in < 4)
+				return false;
+			size_t length = input.in[0] | input.in[1] << 8;
+			if ((length ^ (input.in[2] | input.in[3] << 8)) != 0xFFFF)
+				return false;
+			input.in += 4;
+			if ((size_t)(input.end - input.in) < length || (size_t)(end - out) < length)
+				return false;
+			std::memcpy(out, input.in, length);
+			input.in += length;
+			out += length;
+		}
+		else if (type == 1) {
+			if (!inflateBlock(input, fixedInflateTables(), begin, out, end))
+				return false;
+		}
+		else if (type == 2) {
+			if (!readDynamicTables(input, dynamic) || !inflateBlock(input, dynamic, begin, out, end))
+				return false;
+		}
+		else
+			return false;
+	}
+	return out == end;
+}
+
+// png unfilter kernels
+// 'row' is written over 'filtered' (the same bytes moved down by at least one, which every kernel tolerates as long as
+// it reads each filtered byte before writing the row byte behind it), 'prior' is the row above, all zero for the first row
+
+inline int paethPredictor(int a, int b, int c) {
+	// same formulation as stb_image, equivalent to the one in the specification
+	int threshold = c * 3 - (a + b);
+	int low = a < b ? a : b, high = a < b ? b : a;
+	int t = high <= threshold ? low : c;
+	return threshold <= low ? high : t;
+}
+
+inline void unfilterSubScalar(uint8_t* row, const uint8_t* filtered, const uint8_t*, size_t size, int bpp) {
+	for (size_t i = 0; i < size; i++)
+		row[i] = (uint8_t)(filtered[i] + (i >= (size_t)bpp ? row[i - bpp] : 0));
+}
+
+inline void unfilterUpScalar(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int) {
+	for (size_t i = 0; i < size; i++)
+		row[i] = (uint8_t)(filtered[i] + prior[i]);
+}
+
+inline void unfilterAvgScalar(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	for (size_t i = 0; i < size; i++)
+		row[i] = (uint8_t)(filtered[i] + (((i >= (size_t)bpp ? row[i - bpp] : 0) + prior[i]) >> 1));
+}
+
+inline void unfilterPaethScalar(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	for (size_t i = 0; i < size; i++) {
+		int a = i >= (size_t)bpp ? row[i - bpp] : 0, c = i >= (size_t)bpp ? prior[i - bpp] : 0;
+		row[i] = (uint8_t)(filtered[i] + paethPredictor(a, prior[i], c));
+	}
+}
+
+#if defined(PIXEL_X86)
+
+// a pixel of BPP (3 or 4) bytes in the low lane, 3 byte pixels are read with their neighbour's first byte, every row is
+// followed by at least one more byte (the next filter byte, or the padding of the zero row)
+template <int BPP>
+inline __m128i loadPixel(const uint8_t* p) {
+	int32_t value;
+	std::memcpy(&value, p, 4);
+	return _mm_cvtsi32_si128(value);
+}
+
+template <int BPP>
+inline void storePixel(uint8_t* p, __m128i x) {
+	int32_t value = _mm_cvtsi128_si32(x);
+	std::memcpy(p, &value, BPP);
+}
+
+template <int BPP>
+PIXEL_TARGET("sse4.1")
+inline void unfilterSubPixelsSSE41(uint8_t* row, const uint8_t* filtered, size_t size) {
+	// prefix sums of 16 bytes (4 pixels, or 5 of 3 bytes of which 15 bytes are kept) plus the last pixel of the chunk before
+	const size_t step = BPP == 4 ? 16 : 15;
+	__m128i last = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= size; i += step) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(filtered + i));
+		if (BPP == 4) {
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+			x = _mm_add_epi8(x, last);
+			last = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+		else {
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 12));
+			x = _mm_add_epi8(x, last);
+			// pixel 4 (bytes 12..14) repeated in every group of three
+			last = _mm_shuffle_epi8(x, _mm_setr_epi8(12, 13, 14, 12, 13, 14, 12, 13, 14, 12, 13, 14, 12, 13, 14, -1));
+		}
+		_mm_storeu_si128((__m128i*)(row + i), x);
+	}
+	for (; i < size; i += BPP) {
+		last = _mm_add_epi8(loadPixel<BPP>(filtered + i), last);
+		storePixel<BPP>(row + i, last);
+	}
+}
+
+template <int BPP>
+PIXEL_TARGET("sse4.1")
+inline void unfilterAvgPixelsSSE41(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size) {
+	// pixels depend on their left neighbour, one pixel per step. floor((a + b) / 2) is the rounding up average minus the odd bit
+	__m128i a = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+	for (size_t i = 0; i < size; i += BPP) {
+		__m128i b = loadPixel<BPP>(prior + i);
+		__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+		a = _mm_add_epi8(loadPixel<BPP>(filtered + i), average);
+		storePixel<BPP>(row + i, a);
+	}
+}
+
+template <int BPP>
+PIXEL_TARGET("sse4.1")
+inline void unfilterPaethPixelsSSE41(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size) {
+	// predictor in 16 bit lanes: pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|, pick a, b or c in that order of preference
+	__m128i a = _mm_setzero_si128(), c = _mm_setzero_si128();
+	for (size_t i = 0; i < size; i += BPP) {
+		__m128i b = _mm_cvtepu8_epi16(loadPixel<BPP>(prior + i));
+		__m128i pa = _mm_abs_epi16(_mm_sub_epi16(b, c));
+		__m128i pb = _mm_abs_epi16(_mm_sub_epi16(a, c));
+		__m128i pc = _mm_abs_epi16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+		__m128i smallest = _mm_min_epi16(_mm_min_epi16(pa, pb), pc);
+		__m128i predictor = _mm_blendv_epi8(_mm_blendv_epi8(c, b, _mm_cmpeq_epi16(pb, smallest)), a, _mm_cmpeq_epi16(pa, smallest));
+		__m128i x = _mm_add_epi8(loadPixel<BPP>(filtered + i), _mm_packus_epi16(predictor, predictor));
+		storePixel<BPP>(row + i, x);
+		a = _mm_cvtepu8_epi16(x);
+		c = b;
+	}
+}
+
+PIXEL_TARGET("sse4.1")
+inline void unfilterSubSSE41(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	if (bpp == 4)
+		unfilterSubPixelsSSE41<4>(row, filtered, size);
+	else if (bpp == 3)
+		unfilterSubPixelsSSE41<3>(row, filtered, size);
+	else
+		unfilterSubScalar(row, filtered, prior, size, bpp);
+}
+
+PIXEL_TARGET("sse4.1")
+inline void unfilterUpSSE41(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(filtered + i)), _mm_loadu_si128((const __m128i*)(prior + i)));
+		_mm_storeu_si128((__m128i*)(row + i), x);
+	}
+	unfilterUpScalar(row + i, filtered + i, prior + i, size - i, bpp);
+}
+
+PIXEL_TARGET("sse4.1")
+inline void unfilterAvgSSE41(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	if (bpp == 4)
+		unfilterAvgPixelsSSE41<4>(row, filtered, prior, size);
+	else if (bpp == 3)
+		unfilterAvgPixelsSSE41<3>(row, filtered, prior, size);
+	else
+		unfilterAvgScalar(row, filtered, prior, size, bpp);
+}
+
+PIXEL_TARGET("sse4.1")
+inline void unfilterPaethSSE41(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	if (bpp == 4)
+		unfilterPaethPixelsSSE41<4>(row, filtered, prior, size);
+	else if (bpp == 3)
+		unfilterPaethPixelsSSE41<3>(row, filtered, prior, size);
+	else
+		unfilterPaethScalar(row, filtered, prior, size, bpp);
+}
+
+#endif
+
+#if defined(PIXEL_NEON)
+
+template <int BPP>
+inline uint8x8_t loadPixelNEON(const uint8_t* p) {
+	uint32_t value;
+	std::memcpy(&value, p, 4);
+	return vreinterpret_u8_u32(vdup_n_u32(value));
+}
+
+template <int BPP>
+inline void storePixelNEON(uint8_t* p, uint8x8_t x) {
+	uint32_t value = vget_lane_u32(vreinterpret_u32_u8(x), 0);
+	std::memcpy(p, &value, BPP);
+}
+
+template <int BPP>
+inline void unfilterSubPixelsNEON(uint8_t* row, const uint8_t* filtered, size_t size) {
+	uint8x8_t a = vdup_n_u8(0);
+	for (size_t i = 0; i < size; i += BPP) {
+		a = vadd_u8(loadPixelNEON<BPP>(filtered + i), a);
+		storePixelNEON<BPP>(row + i, a);
+	}
+}
+
+template <int BPP>
+inline void unfilterAvgPixelsNEON(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size) {
+	uint8x8_t a = vdup_n_u8(0);
+	for (size_t i = 0; i < size; i += BPP) {
+		a = vadd_u8(loadPixelNEON<BPP>(filtered + i), vhadd_u8(a, loadPixelNEON<BPP>(prior + i)));
+		storePixelNEON<BPP>(row + i, a);
+	}
+}
+
+template <int BPP>
+inline void unfilterPaethPixelsNEON(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size) {
+	uint8x8_t a = vdup_n_u8(0), c = vdup_n_u8(0);
+	for (size_t i = 0; i < size; i += BPP) {
+		uint8x8_t b = loadPixelNEON<BPP>(prior + i);
+		uint16x8_t pa = vabdl_u8(b, c), pb = vabdl_u8(a, c);
+		uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vshll_n_u8(c, 1));
+		uint16x8_t smallest = vminq_u16(vminq_u16(pa, pb), pc);
+		uint8x8_t predictor = vbsl_u8(vmovn_u16(vceqq_u16(pa, smallest)), a, vbsl_u8(vmovn_u16(vceqq_u16(pb, smallest)), b, c));
+		a = vadd_u8(loadPixelNEON<BPP>(filtered + i), predictor);
+		storePixelNEON<BPP>(row + i, a);
+		c = b;
+	}
+}
+
+inline void unfilterSubNEON(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	if (bpp == 4)
+		unfilterSubPixelsNEON<4>(row, filtered, size);
+	else if (bpp == 3)
+		unfilterSubPixelsNEON<3>(row, filtered, size);
+	else
+		unfilterSubScalar(row, filtered, prior, size, bpp);
+}
+
+inline void unfilterUpNEON(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16)
+		vst1q_u8(row + i, vaddq_u8(vld1q_u8(filtered + i), vld1q_u8(prior + i)));
+	unfilterUpScalar(row + i, filtered + i, prior + i, size - i, bpp);
+}
+
+inline void unfilterAvgNEON(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	if (bpp == 4)
+		unfilterAvgPixelsNEON<4>(row, filtered, prior, size);
+	else if (bpp == 3)
+		unfilterAvgPixelsNEON<3>(row, filtered, prior, size);
+	else
+		unfilterAvgScalar(row, filtered, prior, size, bpp);
+}
+
+inline void unfilterPaethNEON(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp) {
+	if (bpp == 4)
+		unfilterPaethPixelsNEON<4>(row, filtered, prior, size);
+	else if (bpp == 3)
+		unfilterPaethPixelsNEON<3>(row, filtered, prior, size);
+	else
+		unfilterPaethScalar(row, filtered, prior, size, bpp);
+}
+
+#endif
+
+typedef void (*PngUnfilter)(uint8_t* row, const uint8_t* filtered, const uint8_t* prior, size_t size, int bpp);
+
+// kernels for filter types 1 to 4 at a simd level
+inline void pngUnfilterKernels(SimdLevel level, PngUnfilter kernels[4]) {
+	kernels[0] = unfilterSubScalar;
+	kernels[1] = unfilterUpScalar;
+	kernels[2] = unfilterAvgScalar;
+	kernels[3] = unfilterPaethScalar;
+#if defined(PIXEL_X86)
+	if (level == SimdLevel::SSE41 || level == SimdLevel::AVX2) {
+		kernels[0] = unfilterSubSSE41;
+		kernels[1] = unfilterUpSSE41;
+		kernels[2] = unfilterAvgSSE41;
+		kernels[3] = unfilterPaethSSE41;
+	}
+#elif defined(PIXEL_NEON)
+	if (level == SimdLevel::NEON) {
+		kernels[0] = unfilterSubNEON;
+		kernels[1] = unfilterUpNEON;
+		kernels[2] = unfilterAvgNEON;
+		kernels[3] = unfilterPaethNEON;
+	}
+#endif
+}
+
+// unfilter 'rows' rows of 'stride' bytes, each stored after its filter byte, compacting them to the start of 'data'
+inline bool unfilterPng(uint8_t* data, size_t stride, size_t rows, int bpp) {
+	PngUnfilter kernels[4];
+	pngUnfilterKernels(pixelKernels().level, kernels);
+	std::vector<uint8_t> zero_row(stride + 4, 0); // padded for the 4 byte loads of 3 byte pixels
+	const uint8_t* prior = zero_row.data();
+	for (size_t y = 0; y < rows; y++) {
+		const uint8_t* filtered = data + y * (stride + 1);
+		uint8_t* row = data + y * stride;
+		uint8_t filter = *filtered++;
+		if (filter > 4)
+			return false;
+		if (filter == 0)
+			std::memmove(row, filtered, stride);
+		else
+			kernels[filter - 1](row, filtered, prior, stride, bpp);
+		prior = row;
+	}
+	return true;
+}
+
+inline uint32_t readBigEndian32(const uint8_t* p) {
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// decode a png held in memory into 8 bit samples, the same pixels and channel count as stbi_load_from_memory(..., 0)
+// returns a malloc()ed image to std::free(), or null when the file is not a png this decoder handles
+inline unsigned char* decodePng(const unsigned char* data, size_t size, int& width, int& height, int& channels) {
+	if (size < 8 || std::memcmp(data, PNG_SIGNATURE, 8) != 0)
+		return nullptr;
+
+	uint32_t image_width = 0, image_height = 0;
+	int depth = 0, color = -1;
+	uint8_t palette[256 * 4];
+	for (int i = 0; i < 256; i++) {
+		palette[i * 4 + 0] = palette[i * 4 + 1] = palette[i * 4 + 2] = 0;
+		palette[i * 4 + 3] = 255;
+	}
+	size_t palette_size = 0;
+	bool palette_alpha = false, has_key = false;
+	uint16_t key[3] = {};
+	std::vector<std::pair<const uint8_t*, size_t>> idat;
+
+	bool ended = false;
+	for (size_t offset = 8; !ended;) {
+		if (size - offset < 12)
+			return nullptr;
+		uint32_t length = readBigEndian32(data + offset);
+		uint32_t type = readBigEndian32(data + offset + 4);
+		const uint8_t* chunk = data + offset + 8;
+		if (length > size - offset - 12)
+			return nullptr;
+		offset += 12 + (size_t)length;
+		bool first = color < 0;
+
+		if (type == 0x49484452) { // IHDR
+			if (!first || length != 13)
+				return nullptr;
+			image_width = readBigEndian32(chunk);
+			image_height = readBigEndian32(chunk + 4);
+			depth = chunk[8];
+			color = chunk[9];
+			// compression, filter method and interlacing, adam7 is left to stb_image
+			if (chunk[10] != 0 || chunk[11] != 0 || chunk[12] != 0)
+				return nullptr;
+			bool valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+			bool valid_color = color == 0 || color == 2 || color == 3 || color == 4 || color == 6;
+			if (!valid_depth || !valid_color || (color == 3 && depth == 16) || ((color == 2 || color == 4 || color == 6) && depth < 8))
+				return nullptr;
+			if (image_width == 0 || image_height == 0 || image_width > (1u << 24) || image_height > (1u << 24))
+				return nullptr;
+		}
+		else if (first)
+			return nullptr;
+		else if (type == 0x504C5445) { // PLTE
+			if (length > 256 * 3 || length % 3 != 0)
+				return nullptr;
+			palette_size = length / 3;
+			for (size_t i = 0; i < palette_size; i++)
+				std::memcpy(palette + i * 4, chunk + i * 3, 3);
+		}
+		else if (type == 0x74524E53) { // tRNS
+			if (!idat.empty())
+				return nullptr;
+			if (color == 3) {
+				if (palette_size == 0 || length > palette_size)
+					return nullptr;
+				palette_alpha = true;
+				for (size_t i = 0; i < length; i++)
+					palette[i * 4 + 3] = chunk[i];
+			}
+			else {
+				int samples = color == 2 ? 3 : 1;
+				if ((color != 0 && color != 2) || length != (uint32_t)samples * 2)
+					return nullptr;
+				has_key = true;
+				for (int k = 0; k < samples; k++)
+					key[k] = (uint16_t)(chunk[k * 2] << 8 | chunk[k * 2 + 1]);
+			}
+		}
+		else if (type == 0x49444154) { // IDAT
+			if (color == 3 && palette_size == 0)
+				return nullptr;
+			idat.push_back({ chunk, length });
+		}
+		else if (type == 0x49454E44) // IEND
+			ended = true;
+		else if ((type & (1u << 29)) == 0)
+			return nullptr; // unknown critical chunk, CgBI included
+	}
+	if (idat.empty())
+		return nullptr;
+
+	int samples = color == 2 ? 3 : color == 4 ? 2 : color == 6 ? 4 : 1;
+	if ((1u << 30) / image_width / (color == 3 ? 4 : samples) < image_height)
+		return nullptr;
+	size_t stride = ((size_t)samples * image_width * depth + 7) / 8;
+	size_t raw_size = (stride + 1) * image_height;
+	uint8_t* raw = (uint8_t*)std::malloc(raw_size + INFLATE_SLACK);
+	if (raw == nullptr)
+		return nullptr;
+
+	// a single IDAT is inflated straight from the file, several are joined first
+	bool inflated;
+	if (idat.size() == 1)
+		inflated = inflateZlib(idat[0].first, idat[0].second, raw, raw_size);
+	else {
+		std::vector<uint8_t> joined;
+		for (const auto& part : idat)
+			joined.insert(joined.end(), part.first, part.first + part.second);
+		inflated = inflateZlib(joined.data(), joined.size(), raw, raw_size);
+	}
+	int bpp = std::max(1, samples * depth / 8);
+	if (!inflated || !unfilterPng(raw, stride, image_height, bpp)) {
+		std::free(raw);
+		return nullptr;
+	}
+
+	width = (int)image_width;
+	height = (int)image_height;
+	if (depth == 8 && color != 3 && !has_key) {
+		channels = samples;
+		return raw; // the unfiltered rows already are the image
+	}
+
+	// everything else is expanded into a second buffer, the way stb_image does it
+	channels = color == 3 ? (palette_alpha ? 4 : 3) : samples + (has_key ? 1 : 0);
+	size_t pixel_count = (size_t)image_width * image_height;
+	uint8_t* image = (uint8_t*)std::malloc(pixel_count * channels);
+	if (image == nullptr) {
+		std::free(raw);
+		return nullptr;
+	}
+	static const uint8_t depth_scale[9] = { 0, 0xFF, 0x55, 0, 0x11, 0, 0, 0, 0x01 };
+	uint8_t scale = color == 0 ? depth_scale[std::min(depth, 8)] : 1;
+	uint8_t key8[3];
+	for (int k = 0; k < 3; k++)
+		key8[k] = (uint8_t)((key[k] & 255) * depth_scale[std::min(depth, 8)]);
+
+	uint8_t* out = image;
+	for (uint32_t y = 0; y < image_height; y++) {
+		const uint8_t* row = raw + y * stride;
+		for (uint32_t x = 0; x < image_width; x++) {
+			uint16_t sample[4];
+			for (int k = 0; k < samples; k++) {
+				size_t index = (size_t)x * samples + k;
+				if (depth == 16)
+					sample[k] = (uint16_t)(row[index * 2] << 8 | row[index * 2 + 1]);
+				else if (depth == 8)
+					sample[k] = row[index];
+				else {
+					int shift = 8 - depth - (int)(index * depth % 8);
+					sample[k] = (uint8_t)(((row[index * depth / 8] >> shift) & ((1 << depth) - 1)) * scale);
+				}
+			}
+			if (color == 3) {
+				if (sample[0] >= palette_size) { // an index past the palette, the file is left to stb_image
+					std::free(image);
+					std::free(raw);
+					return nullptr;
+				}
+				std::memcpy(out, palette + sample[0] * 4, channels);
+				out += channels;
+				continue;
+			}
+			bool keyed = has_key;
+			for (int k = 0; k < samples; k++) {
+				*out++ = (uint8_t)(depth == 16 ? sample[k] >> 8 : sample[k]);
+				keyed = keyed && (depth == 16 ? sample[k] == key[k] : sample[k] == key8[k]);
+			}
+			if (has_key)
+				*out++ = keyed ? 0 : 255;
+		}
+	}
+	std::free(raw);
+	return image;
+}
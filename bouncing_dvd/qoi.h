@@ -0,0 +1,267 @@
+#pragma once
+// qoi image functions defined here
+// "Quite OK Image" format (https://qoiformat.org), lossless like png but decoded in a single pass over the bytes with
+// no entropy coding, several times faster than inflate + unfiltering at a file size in the same range
+//
+// QoiDecoder is resumable, it decodes any number of rows at a time into any memory with any row stride. the texture loader
+// uses that to decode straight into its mapped staging buffer, bottom row first, so a qoi texture never exists in
+// client memory at all (see texture_loader.h)
+//
+// the decode loop keeps the pixel in a 32 bit register (r in the low byte), DIFF and LUMA chunks share one path:
+// their byte deltas come from two lookup tables and are added to all four channels at once without carries between them
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const unsigned char QOI_MAGIC[4] = { 'q', 'o', 'i', 'f' };
+const size_t QOI_HEADER_SIZE = 14;
+const size_t QOI_PADDING = 8; // seven zero bytes and a one end every file
+const uint8_t QOI_OP_INDEX = 0x00, QOI_OP_DIFF = 0x40, QOI_OP_LUMA = 0x80, QOI_OP_RUN = 0xC0, QOI_OP_RGB = 0xFE, QOI_OP_RGBA = 0xFF;
+const uint32_t QOI_MAX_PIXELS = 400000000; // same limit as the reference decoder
+
+// bytewise a + b of two packed pixels, carries do not cross from one channel into the next
+inline uint32_t qoiAdd(uint32_t a, uint32_t b) {
+	return ((a & 0x7F7F7F7F) + (b & 0x7F7F7F7F)) ^ ((a ^ b) & 0x80808080);
+}
+
+inline uint32_t qoiPack(int r, int g, int b, int a) {
+	return (uint32_t)(r & 0xFF) | (uint32_t)(g & 0xFF) << 8 | (uint32_t)(b & 0xFF) << 16 | (uint32_t)(a & 0xFF) << 24;
+}
+
+inline uint32_t qoiHash(uint32_t pixel) {
+	return ((pixel & 0xFF) * 3 + (pixel >> 8 & 0xFF) * 5 + (pixel >> 16 & 0xFF) * 7 + (pixel >> 24) * 11) % 64;
+}
+
+inline uint32_t qoiReadBigEndian32(const unsigned char* p) {
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// deltas of the first byte of DIFF and LUMA chunks and of the second byte of LUMA chunks
+struct QoiDeltaTables {
+	uint32_t first[256];
+	uint32_t second[256];
+
+	QoiDeltaTables() {
+		for (int b = 0; b < 256; b++) {
+			first[b] = 0;
+			if ((b & 0xC0) == QOI_OP_DIFF)
+				first[b] = qoiPack(((b >> 4) & 3) - 2, ((b >> 2) & 3) - 2, (b & 3) - 2, 0);
+			else if ((b & 0xC0) == QOI_OP_LUMA)
+				first[b] = qoiPack((b & 0x3F) - 32, (b & 0x3F) - 32, (b & 0x3F) - 32, 0);
+			// red and blue relative to green
+			second[b] = qoiPack((b >> 4) - 8, 0, (b & 0x0F) - 8, 0);
+		}
+	}
+};
+
+inline const QoiDeltaTables& qoiDeltaTables() {
+	static const QoiDeltaTables tables;
+	return tables;
+}
+
+class QoiDecoder {
+public:
+	int width = 0, height = 0;
+	int channels = 0;   // as written in the header, the decoder always produces RGBA
+	int colorspace = 0; // 0 sRGB with linear alpha, 1 all linear
+
+	// read the header, 'file' has to stay valid while rows are decoded
+	bool open(const unsigned char* file, size_t size) {
+		data = nullptr;
+		if (size < QOI_HEADER_SIZE + QOI_PADDING || std::memcmp(file, QOI_MAGIC, 4) != 0)
+			return false;
+		uint32_t w = qoiReadBigEndian32(file + 4), h = qoiReadBigEndian32(file + 8);
+		if (w == 0 || h == 0 || h >= QOI_MAX_PIXELS / w || (file[12] != 3 && file[12] != 4) || file[13] > 1)
+			return false;
+		width = (int)w;
+		height = (int)h;
+		channels = file[12];
+		colorspace = file[13];
+		data = file;
+		position = QOI_HEADER_SIZE;
+		chunks_end = size - QOI_PADDING;
+		pixel = qoiPack(0, 0, 0, 255);
+		std::memset(index, 0, sizeof(index));
+		run = 0;
+		row = 0;
+		return true;
+	}
+
+	bool isOpen() const {
+		return data != nullptr;
+	}
+
+	// rows decoded so far
+	int nextRow() const {
+		return row;
+	}
+
+	// decode the next 'rows' rows as RGBA, row r of them lands at destination + r * stride, a negative stride turns them
+	// upside down. the destination is only written, never read, so write combined memory is fine. false on corrupt data
+	bool decodeRows(unsigned char* destination, int rows, ptrdiff_t stride) {
+		const QoiDeltaTables& tables = qoiDeltaTables();
+		rows = std::min(rows, height - row);
+		for (int r = 0; r < rows; r++, row++) {
+			unsigned char* out = destination + r * stride;
+			for (int x = 0; x < width;) {
+				if (run > 0) {
+					// a run may carry over from the previous row
+					int count = std::min((int)run, width - x);
+					for (int i = 0; i < count; i++)
+						std::memcpy(out + (x + i) * 4, &pixel, 4);
+					x += count;
+					run -= count;
+					continue;
+				}
+				if (position >= chunks_end)
+					return false;
+				// every chunk is at most 5 bytes and the padding is 8, reads past the chunk start stay inside the file
+				uint32_t b1 = data[position++];
+				if (b1 < QOI_OP_DIFF)
+					pixel = index[b1];
+				else if (b1 < QOI_OP_RUN) {
+					// DIFF adds its own delta, LUMA also the one from its second byte, which DIFF masks to zero
+					uint32_t luma = b1 >> 7;
+					uint32_t delta = qoiAdd(tables.first[b1], tables.second[data[position]] & (0u - luma));
+					position += luma;
+					pixel = qoiAdd(pixel, delta);
+				}
+				else if (b1 < QOI_OP_RGB)
+					run = b1 & 0x3F; // this pixel and 'run' more
+				else if (b1 == QOI_OP_RGB) {
+					pixel = (pixel & 0xFF000000) | qoiPack(data[position], data[position + 1], data[position + 2], 0);
+					position += 3;
+				}
+				else {
+					std::memcpy(&pixel, data + position, 4);
+					position += 4;
+				}
+				index[qoiHash(pixel)] = pixel;
+				std::memcpy(out + x * 4, &pixel, 4);
+				x++;
+			}
+		}
+		return true;
+	}
+
+private:
+	const unsigned char* data = nullptr;
+	size_t position = 0, chunks_end = 0;
+	uint32_t pixel = 0;
+	uint32_t index[64] = {};
+	uint32_t run = 0;
+	int row = 0;
+};
+
+// whole image as RGBA (top row first) in malloc()ed memory to std::free(), null when it is not a valid qoi file
+inline unsigned char* decodeQoi(const unsigned char* file, size_t size, int& width, int& height, int& channels) {
+	QoiDecoder decoder;
+	if (!decoder.open(file, size))
+		return nullptr;
+	unsigned char* rgba = (unsigned char*)std::malloc((size_t)decoder.width * decoder.height * 4);
+	if (rgba == nullptr)
+		return nullptr;
+	if (!decoder.decodeRows(rgba, decoder.height, (ptrdiff_t)decoder.width * 4)) {
+		std::free(rgba);
+		return nullptr;
+	}
+	width = decoder.width;
+	height = decoder.height;
+	channels = 4;
+	return rgba;
+}
+
+// encode 3 or 4 channel pixels (top row first), the same bytes the reference encoder writes
+inline std::vector<unsigned char> encodeQoi(const unsigned char* pixels, int width, int height, int channels, int colorspace = 0) {
+	std::vector<unsigned char> file;
+	file.reserve(QOI_HEADER_SIZE + (size_t)width * height * (channels + 1) / 2 + QOI_PADDING);
+	file.insert(file.end(), QOI_MAGIC, QOI_MAGIC + 4);
+	for (uint32_t value : { (uint32_t)width, (uint32_t)height })
+		for (int shift = 24; shift >= 0; shift -= 8)
+			file.push_back((unsigned char)(value >> shift));
+	file.push_back((unsigned char)channels);
+	file.push_back((unsigned char)colorspace);
+
+	uint32_t index[64] = {};
+	uint32_t previous = qoiPack(0, 0, 0, 255);
+	int run = 0;
+	size_t count = (size_t)width * height;
+	for (size_t i = 0; i < count; i++) {
+		const unsigned char* p = pixels + i * channels;
+		uint32_t pixel = qoiPack(p[0], p[1], p[2], channels == 4 ? p[3] : 255);
+		if (pixel == previous) {
+			run++;
+			if (run == 62 || i + 1 == count) {
+				file.push_back((unsigned char)(QOI_OP_RUN | (run - 1)));
+				run = 0;
+			}
+			continue;
+		}
+		if (run > 0) {
+			file.push_back((unsigned char)(QOI_OP_RUN | (run - 1)));
+			run = 0;
+		}
+		uint32_t hash = qoiHash(pixel);
+		if (index[hash] == pixel)
+			file.push_back((unsigned char)(QOI_OP_INDEX | hash));
+		else {
+			index[hash] = pixel;
+			if ((pixel >> 24) == (previous >> 24)) {
+				signed char dr = (signed char)(p[0] - (previous & 0xFF));
+				signed char dg = (signed char)(p[1] - (previous >> 8 & 0xFF));
+				signed char db = (signed char)(p[2] - (previous >> 16 & 0xFF));
+				int dr_dg = dr - dg, db_dg = db - dg;
+				if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+					file.push_back((unsigned char)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+				else if (dr_dg > -9 && dr_dg < 8 && dg > -33 && dg < 32 && db_dg > -9 && db_dg < 8) {
+					file.push_back((unsigned char)(QOI_OP_LUMA | (dg + 32)));
+					file.push_back((unsigned char)((dr_dg + 8) << 4 | (db_dg + 8)));
+				}
+				else
+					file.insert(file.end(), { QOI_OP_RGB, p[0], p[1], p[2] });
+			}
+			else
+				file.insert(file.end(), { QOI_OP_RGBA, p[0], p[1], p[2], (unsigned char)(pixel >> 24) });
+		}
+		previous = pixel;
+	}
+	file.insert(file.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	return file;
+}
+
+// convert an image stb_image can read (png in particular) to qoi, RGB stays 3 channels and everything else becomes RGBA
+inline bool convertToQoi(const std::string& source_path, const std::string& output_path) {
+	int width, height, channels;
+	if (!stbi_info(source_path.c_str(), &width, &height, &channels)) {
+		std::cout << "ERROR::QOI::FAILED_TO_LOAD_SOURCE: " << source_path << std::endl;
+		return false;
+	}
+	int stored = channels == 3 ? 3 : 4;
+	stbi_set_flip_vertically_on_load_thread(false); // qoi is stored top row first like png
+	unsigned char* pixels = stbi_load(source_path.c_str(), &width, &height, &channels, stored);
+	if (pixels == NULL) {
+		std::cout << "ERROR::QOI::FAILED_TO_LOAD_SOURCE: " << source_path << std::endl;
+		return false;
+	}
+	std::vector<unsigned char> file = encodeQoi(pixels, width, height, stored);
+	stbi_image_free(pixels);
+
+	std::ofstream out(output_path, std::ios::binary);
+	out.write((const char*)file.data(), file.size());
+	if (!out) {
+		std::cout << "ERROR::QOI::FAILED_TO_WRITE: " << output_path << std::endl;
+		return false;
+	}
+	std::cout << "Converted " << source_path << " -> " << output_path << " (" << width << "x" << height << "x" << stored << ", "
+		<< file.size() << " bytes)" << std::endl;
+	return true;
+}
@@ -50,19 +50,55 @@ public:
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
 		}
 
-		const char* v_shader_code = vertex_code.c_str();
-		const char* f_shader_code = fragment_code.c_str();
+		build(vertex_code.c_str(), (int)vertex_code.size(), fragment_code.c_str(), (int)fragment_code.size());
+	}
+
+	// constructor to build shader program from sources already in memory, e.g. views into an asset pack
+	// the sources do not need to be null terminated, nothing is copied
+	Shader(const char* vertex_code, size_t vertex_length, const char* fragment_code, size_t fragment_length) {
+		build(vertex_code, (int)vertex_length, fragment_code, (int)fragment_length);
+	}
 
+	// activate shader
+	void use() {
+		glUseProgram(program);
+	}
+
+	// utility uniform functions, to change values within shader program
+	void setBool(const char* name, bool value) const
+	{
+		glUniform1i(glGetUniformLocation(program, name), (int)value);
+	}
+	void setInt(const char* name, int value) const
+	{
+		glUniform1i(glGetUniformLocation(program, name), value);
+	}
+	void setFloat(const char* name, float value) const
+	{
+		glUniform1f(glGetUniformLocation(program, name), value);
+	}
+	void setVec2(const char* name, float x, float y) const
+	{
+		glUniform2f(glGetUniformLocation(program, name), x, y);
+	}
+	void setVec4(const char* name, const float* value) const
+	{
+		glUniform4fv(glGetUniformLocation(program, name), 1, value);
+	}
+
+private:
+	// compile and link both stages into 'program'
+	void build(const char* v_shader_code, int v_length, const char* f_shader_code, int f_length) {
 		// compile shader
 		unsigned int vertex, fragment; // shader API handles
 
 		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &v_shader_code, NULL);
+		glShaderSource(vertex, 1, &v_shader_code, &v_length);
 		glCompileShader(vertex);
 		checkCompileErrors(vertex, "VERTEX");
 
 		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &f_shader_code, NULL);
+		glShaderSource(fragment, 1, &f_shader_code, &f_length);
 		glCompileShader(fragment);
 		checkCompileErrors(fragment, "FRAGMENT");
 
@@ -76,26 +112,6 @@ public:
 		glDeleteShader(fragment);
 	}
 
-	// activate shader
-	void use() {
-		glUseProgram(program);
-	}
-
-	// utility uniform functions, to change values within shader program
-	void setBool(const std::string& name, bool value) const
-	{
-		glUniform1i(glGetUniformLocation(program, name.c_str()), (int)value);
-	}
-	void setInt(const std::string& name, int value) const
-	{
-		glUniform1i(glGetUniformLocation(program, name.c_str()), value);
-	}
-	void setFloat(const std::string& name, float value) const
-	{
-		glUniform1f(glGetUniformLocation(program, name.c_str()), value);
-	}
-
-private:
 	// utility function to check for compile/linking errors
 	void checkCompileErrors(unsigned int shader, std::string type) {
 		// flags
@@ -0,0 +1,167 @@
+#pragma once
+// sprite batch class defined here
+// collects textured quads and draws every run of sprites sharing one texture with a single instanced draw call,
+// with a TextureAtlas or a SpriteTextureSet that is every sprite in the frame, however many different images they show
+//
+// instances are written into a persistently mapped buffer split into one segment per frame in flight, like the
+// texture loader's staging buffer, so filling it never waits on the GPU unless a frame overflows its segment
+
+#include <glad/glad.h>
+
+#include <shader.h>
+#include <texture_atlas.h>
+#include <texture_set.h>
+
+#include <cstddef>
+#include <vector>
+
+struct SpriteInstance {
+	float rect[4];  // x, y, width, height in normalized device coordinates
+	float uv[4];    // u0, v0, u1, v1
+	float color[4]; // multiplied with the texture
+	unsigned int layer; // texture index when drawing from a SpriteTextureSet
+};
+
+class SpriteBatch {
+public:
+	// the fragment shader decides where textures come from, see SpriteTextureSet::fragmentShader() for the other ones
+	SpriteBatch(size_t capacity = 16384, const char* fragment_path = "glsl/sprite_fragment.glsl")
+		: shader("glsl/sprite_vertex.glsl", fragment_path), capacity(capacity), fences(SEGMENTS, nullptr) {
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, capacity * SEGMENTS * sizeof(SpriteInstance), NULL, flags);
+		instances = (SpriteInstance*)glMapNamedBufferRange(buffer, 0, capacity * SEGMENTS * sizeof(SpriteInstance), flags);
+
+		// per instance attributes, the quad itself has no vertex buffer
+		glCreateVertexArrays(1, &VAO);
+		glVertexArrayVertexBuffer(VAO, 0, buffer, 0, sizeof(SpriteInstance));
+		glVertexArrayBindingDivisor(VAO, 0, 1);
+		const GLuint offsets[] = { offsetof(SpriteInstance, rect), offsetof(SpriteInstance, uv), offsetof(SpriteInstance, color) };
+		for (GLuint attribute = 0; attribute < 3; attribute++) {
+			glEnableVertexArrayAttrib(VAO, attribute);
+			glVertexArrayAttribFormat(VAO, attribute, 4, GL_FLOAT, GL_FALSE, offsets[attribute]);
+			glVertexArrayAttribBinding(VAO, attribute, 0);
+		}
+		glEnableVertexArrayAttrib(VAO, 3);
+		glVertexArrayAttribIFormat(VAO, 3, 1, GL_UNSIGNED_INT, offsetof(SpriteInstance, layer));
+		glVertexArrayAttribBinding(VAO, 3, 0);
+
+		shader.use();
+		shader.setInt("texture1", 0);
+	}
+
+	~SpriteBatch() {
+		for (GLsync fence : fences)
+			if (fence != nullptr)
+				glDeleteSync(fence);
+		glUnmapNamedBuffer(buffer);
+		glDeleteBuffers(1, &buffer);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteProgram(shader.program);
+	}
+
+	SpriteBatch(const SpriteBatch&) = delete;
+	SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+	// start a frame, waits until the GPU is done with the segment used SEGMENTS frames ago
+	void begin() {
+		segment = (segment + 1) % SEGMENTS;
+		waitSegment();
+		first = count = 0;
+		draw_calls = sprites = 0;
+	}
+
+	// queue a quad showing the 'uv' rectangle of 'texture', switching textures ends the current draw call
+	void draw(unsigned int texture, const float* uv, float x, float y, float width, float height, const float* color = nullptr) {
+		queue(texture, nullptr, uv, x, y, width, height, color, 0);
+	}
+
+	// queue a sprite from an atlas, the atlas has to be update()d before end()
+	void draw(const TextureAtlas& atlas, int sprite, float x, float y, float width, float height, const float* color = nullptr) {
+		queue(atlas.texture, nullptr, atlas.sprite(sprite).uv, x, y, width, height, color, 0);
+	}
+
+	// queue a sprite showing texture 'index' of a set, the batch must use the set's fragment shader
+	void draw(const SpriteTextureSet& set, int index, float x, float y, float width, float height, const float* color = nullptr) {
+		queue(0, &set, set.uv(index), x, y, width, height, color, (unsigned int)index);
+	}
+
+	// draw everything still queued and fence the frame's segment
+	void end() {
+		flush();
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// draw calls issued between the last begin() and end()
+	size_t drawCalls() const {
+		return draw_calls;
+	}
+
+	size_t spriteCount() const {
+		return sprites;
+	}
+
+private:
+	static const size_t SEGMENTS = 3;
+
+	Shader shader;
+	size_t capacity; // sprites per segment
+	unsigned int buffer, VAO;
+	SpriteInstance* instances;
+	std::vector<GLsync> fences;
+	size_t segment = 0;
+	size_t first = 0, count = 0; // queued instances of the current draw call inside the segment
+	unsigned int current_texture = 0;
+	const SpriteTextureSet* current_set = nullptr;
+	size_t draw_calls = 0, sprites = 0;
+
+	void waitSegment() {
+		if (fences[segment] == nullptr)
+			return;
+		glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fences[segment]);
+		fences[segment] = nullptr;
+	}
+
+	// append one instance, a change of texture or set ends the current draw call
+	void queue(unsigned int texture, const SpriteTextureSet* set, const float* uv, float x, float y, float width, float height,
+		const float* color, unsigned int layer) {
+
+		if ((texture != current_texture || set != current_set) && count > 0)
+			flush();
+		current_texture = texture;
+		current_set = set;
+		if (first + count == capacity) {
+			// the frame outgrew its segment, draw what is there and reuse the segment once the GPU has read it
+			flush();
+			fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			waitSegment();
+			first = 0;
+		}
+
+		const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		if (color == nullptr)
+			color = white;
+		SpriteInstance& instance = instances[segment * capacity + first + count];
+		instance = { { x, y, width, height }, { uv[0], uv[1], uv[2], uv[3] }, { color[0], color[1], color[2], color[3] }, layer };
+		count++;
+		sprites++;
+	}
+
+	void flush() {
+		if (count == 0)
+			return;
+		shader.use();
+		if (current_set != nullptr)
+			current_set->bind();
+		else
+			glBindTextureUnit(0, current_texture);
+		glBindVertexArray(VAO);
+		// the base instance points the attributes at this draw's instances, nothing is rebound
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count, (GLuint)(segment * capacity + first));
+		first += count;
+		count = 0;
+		draw_calls++;
+	}
+};
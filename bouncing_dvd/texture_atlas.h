@@ -0,0 +1,354 @@
+#pragma once
+// texture atlas class defined here
+// packs many small RGBA images into one texture so a sprite batch can draw all of them with a single bind and draw call
+//
+// every image gets a slot: the image, 'gutter' pixels of its own edge repeated around it so bilinear filtering never
+// reads a neighbour, and 'padding' pixels after that. slots are packed in cells of 'alignment' pixels, so each slot
+// covers whole texels down to mip level log2(alignment) and whole 4x4 blocks for block compression. the mip chain
+// stops at that level, below it sprites would start to blend into each other. the edge is repeated over the padding and
+// the alignment slack as well, so every mip texel of a slot is made of its own sprite and nothing a removed one left
+//
+// the atlas keeps a CPU copy of its pixels. new images can be added at any time, when one does not fit the atlas first
+// repacks to close the holes left by removed images, then doubles in size, sprite ids stay the same either way
+// update() pushes the changes to the GPU, the rest of the class does not need a context so it also works as an offline tool
+
+#include <glad/glad.h>
+
+#include <atlas_packer.h>
+#include <ktx2.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct AtlasSprite {
+	std::string name;
+	AtlasRect rect;                      // image pixels inside the atlas, gutter excluded
+	AtlasRect slot;                      // rect with its gutter and padding, aligned to the atlas alignment
+	float uv[4] = { 0.0f, 0.0f, 0.0f, 0.0f }; // u0, v0, u1, v1 of 'rect'
+	bool live = false;
+};
+
+class TextureAtlas {
+public:
+	unsigned int texture = 0; // created by the first update()
+
+	TextureAtlas(int width = 1024, int height = 1024, int gutter = 2, int padding = 0, int alignment = 4, int max_size = 8192)
+		: atlas_width(width), atlas_height(height), gutter(gutter), padding(padding), alignment(alignment), max_size(max_size),
+		packer(width / alignment, height / alignment), image((size_t)width * height * 4, 0) {
+	}
+
+	~TextureAtlas() {
+		if (texture != 0)
+			glDeleteTextures(1, &texture);
+	}
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// copy an RGBA8 image into the atlas, rows bottom-up like everything else uploaded to opengl
+	// returns the sprite id, or -1 when the atlas cannot grow large enough. adding a name twice returns the first sprite
+	int add(const std::string& name, const unsigned char* rgba, int width, int height) {
+		auto existing = names.find(name);
+		if (existing != names.end())
+			return existing->second;
+		if (width <= 0 || height <= 0) {
+			std::cout << "ERROR::TEXTURE_ATLAS::INVALID_SIZE: " << name << " (" << width << "x" << height << ")" << std::endl;
+			return -1;
+		}
+
+		int cells_x = (width + 2 * gutter + padding + alignment - 1) / alignment;
+		int cells_y = (height + 2 * gutter + padding + alignment - 1) / alignment;
+		AtlasRect cell;
+		while (!packer.insert(cells_x, cells_y, cell)) {
+			// close the holes left by removed sprites first, growing is the last resort
+			bool repacked = holes && rebuild();
+			if (!repacked && !grow()) {
+				std::cout << "ERROR::TEXTURE_ATLAS::OUT_OF_SPACE: " << name << " (" << width << "x" << height << ")" << std::endl;
+				return -1;
+			}
+		}
+
+		int id;
+		if (!free_ids.empty()) {
+			id = free_ids.back();
+			free_ids.pop_back();
+		}
+		else {
+			id = (int)sprites.size();
+			sprites.emplace_back();
+		}
+		AtlasSprite& sprite = sprites[id];
+		sprite.name = name;
+		sprite.live = true;
+		sprite.slot = { cell.x * alignment, cell.y * alignment, cell.width * alignment, cell.height * alignment };
+		sprite.rect = { sprite.slot.x + gutter, sprite.slot.y + gutter, width, height };
+		computeUV(sprite);
+		names[name] = id;
+
+		blit(sprite, rgba);
+		dirty.push_back(sprite.slot);
+		return id;
+	}
+
+	// free a sprite's slot, its id may be handed out again by a later add()
+	void remove(int id) {
+		AtlasSprite& sprite = sprites[id];
+		if (!sprite.live)
+			return;
+		packer.remove({ sprite.slot.x / alignment, sprite.slot.y / alignment, sprite.slot.width / alignment, sprite.slot.height / alignment });
+		names.erase(sprite.name);
+		sprite = AtlasSprite();
+		free_ids.push_back(id);
+		holes = true;
+	}
+
+	// repack every live sprite from scratch at the current size, largest first, false if they no longer fit
+	bool rebuild() {
+		if (!repack(atlas_width, atlas_height))
+			return false;
+		rebuilds++;
+		return true;
+	}
+
+	int find(const std::string& name) const {
+		auto it = names.find(name);
+		return it != names.end() ? it->second : -1;
+	}
+
+	const AtlasSprite& sprite(int id) const {
+		return sprites[id];
+	}
+
+	size_t spriteCount() const {
+		return sprites.size() - free_ids.size();
+	}
+
+	int width() const {
+		return atlas_width;
+	}
+
+	int height() const {
+		return atlas_height;
+	}
+
+	// levels that stay inside each slot, see the comment at the top
+	int mipLevels() const {
+		int levels = 1;
+		while ((alignment >> levels) > 0 && (std::min(atlas_width, atlas_height) >> levels) > 0)
+			levels++;
+		return levels;
+	}
+
+	// fraction of the atlas taken by slots, gutters and alignment included
+	float occupancy() const {
+		return packer.occupancy();
+	}
+
+	// fraction of the atlas covered by actual image pixels
+	float pixelOccupancy() const {
+		size_t pixels = 0;
+		for (const AtlasSprite& sprite : sprites)
+			if (sprite.live)
+				pixels += (size_t)sprite.rect.width * sprite.rect.height;
+		return (float)pixels / ((size_t)atlas_width * atlas_height);
+	}
+
+	const std::vector<unsigned char>& pixels() const {
+		return image;
+	}
+
+	// bring the texture up to date, call from the thread owning the GL context
+	// new sprites only upload their own slots, a grown or repacked atlas is uploaded whole
+	void update() {
+		if (!reallocate && dirty.empty())
+			return;
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (reallocate) {
+			if (texture != 0)
+				glDeleteTextures(1, &texture);
+			int levels = mipLevels();
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, levels, GL_RGBA8, atlas_width, atlas_height);
+			glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, levels - 1);
+			glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureSubImage2D(texture, 0, 0, 0, atlas_width, atlas_height, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+			reallocate = false;
+		}
+		else {
+			// the slots are sub rectangles of the CPU copy, let the driver step over the atlas rows
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas_width);
+			for (const AtlasRect& slot : dirty)
+				glTextureSubImage2D(texture, 0, slot.x, slot.y, slot.width, slot.height, GL_RGBA, GL_UNSIGNED_BYTE,
+					image.data() + ((size_t)slot.y * atlas_width + slot.x) * 4);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		}
+		dirty.clear();
+		if (mipLevels() > 1)
+			glGenerateTextureMipmap(texture);
+	}
+
+	// offline output: '<base>.ktx2' with the pixels and the mip-safe levels, '<base>.atlas' with one line per sprite: x y width height name
+	bool save(const std::string& base_path, BlockFormat format) const {
+		std::vector<unsigned char> file = encodeKtx2(image.data(), atlas_width, atlas_height, format, mipLevels());
+		std::ofstream ktx2(base_path + ".ktx2", std::ios::binary);
+		ktx2.write((const char*)file.data(), file.size());
+
+		std::ofstream table(base_path + ".atlas");
+		table << "atlas " << atlas_width << " " << atlas_height << " " << spriteCount() << "\n";
+		for (const AtlasSprite& sprite : sprites)
+			if (sprite.live)
+				table << sprite.rect.x << " " << sprite.rect.y << " " << sprite.rect.width << " " << sprite.rect.height << " " << sprite.name << "\n";
+
+		if (!ktx2 || !table) {
+			std::cout << "ERROR::TEXTURE_ATLAS::FAILED_TO_WRITE: " << base_path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void printStats() const {
+		std::cout << "\nTexture atlas statistics:" << std::endl
+			<< "\tSize           : " << atlas_width << "x" << atlas_height << " (" << mipLevels() << " mip levels)" << std::endl
+			<< "\tSprites        : " << spriteCount() << std::endl
+			<< "\tOccupancy      : " << occupancy() * 100.0f << "% slots, " << pixelOccupancy() * 100.0f << "% pixels" << std::endl
+			<< "\tGrown          : " << grows << " times" << std::endl
+			<< "\tRebuilt        : " << rebuilds << " times" << std::endl;
+	}
+
+private:
+	int atlas_width, atlas_height;
+	int gutter, padding, alignment, max_size;
+	MaxRectsPacker packer; // works in cells of 'alignment' pixels
+	std::vector<unsigned char> image;
+	std::vector<AtlasSprite> sprites; // indexed by id
+	std::vector<int> free_ids;
+	std::unordered_map<std::string, int> names;
+	std::vector<AtlasRect> dirty;     // slots changed since the last update()
+	bool reallocate = true;           // size or layout changed, update() uploads everything
+	bool holes = false;               // something was removed since the last repack
+	unsigned int grows = 0, rebuilds = 0;
+
+	void computeUV(AtlasSprite& sprite) const {
+		sprite.uv[0] = (float)sprite.rect.x / atlas_width;
+		sprite.uv[1] = (float)sprite.rect.y / atlas_height;
+		sprite.uv[2] = (float)(sprite.rect.x + sprite.rect.width) / atlas_width;
+		sprite.uv[3] = (float)(sprite.rect.y + sprite.rect.height) / atlas_height;
+	}
+
+	// write the image and extrude its edges out to the borders of its slot, covering the gutter, padding and slack
+	void blit(const AtlasSprite& sprite, const unsigned char* rgba) {
+		const AtlasRect& rect = sprite.rect;
+		const AtlasRect& slot = sprite.slot;
+		int left = slot.x - rect.x, right = slot.x + slot.width - rect.x;
+		for (int y = slot.y - rect.y; y < slot.y + slot.height - rect.y; y++) {
+			int source_y = std::clamp(y, 0, rect.height - 1);
+			const unsigned char* source = rgba + (size_t)source_y * rect.width * 4;
+			unsigned char* row = image.data() + ((size_t)(rect.y + y) * atlas_width + rect.x) * 4;
+			for (int x = left; x < 0; x++)
+				std::memcpy(row + x * 4, source, 4);
+			std::memcpy(row, source, (size_t)rect.width * 4);
+			for (int x = rect.width; x < right; x++)
+				std::memcpy(row + x * 4, source + (size_t)(rect.width - 1) * 4, 4);
+		}
+	}
+
+	// double the shorter side until every live sprite fits again
+	bool grow() {
+		int width = atlas_width, height = atlas_height;
+		while (width < max_size || height < max_size) {
+			if ((width <= height || height >= max_size) && width < max_size)
+				width *= 2;
+			else
+				height *= 2;
+			if (repack(width, height)) {
+				grows++;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// place the live sprites into a fresh packer of the given size and move their slots over, gutters included
+	bool repack(int width, int height) {
+		std::vector<int> order;
+		for (int id = 0; id < (int)sprites.size(); id++)
+			if (sprites[id].live)
+				order.push_back(id);
+		std::sort(order.begin(), order.end(), [this](int a, int b) {
+			const AtlasRect& sa = sprites[a].slot;
+			const AtlasRect& sb = sprites[b].slot;
+			return std::max(sa.width, sa.height) > std::max(sb.width, sb.height);
+		});
+
+		MaxRectsPacker fresh(width / alignment, height / alignment);
+		std::vector<AtlasRect> slots(sprites.size());
+		for (int id : order) {
+			AtlasRect cell;
+			if (!fresh.insert(sprites[id].slot.width / alignment, sprites[id].slot.height / alignment, cell))
+				return false;
+			slots[id] = { cell.x * alignment, cell.y * alignment, cell.width * alignment, cell.height * alignment };
+		}
+
+		std::vector<unsigned char> moved((size_t)width * height * 4, 0);
+		for (int id : order) {
+			AtlasSprite& sprite = sprites[id];
+			const AtlasRect& from = sprite.slot;
+			const AtlasRect& to = slots[id];
+			for (int y = 0; y < from.height; y++)
+				std::memcpy(moved.data() + ((size_t)(to.y + y) * width + to.x) * 4,
+					image.data() + ((size_t)(from.y + y) * atlas_width + from.x) * 4, (size_t)from.width * 4);
+		}
+
+		atlas_width = width;
+		atlas_height = height;
+		image.swap(moved);
+		packer = fresh;
+		for (int id : order) {
+			AtlasSprite& sprite = sprites[id];
+			sprite.rect.x += slots[id].x - sprite.slot.x;
+			sprite.rect.y += slots[id].y - sprite.slot.y;
+			sprite.slot = slots[id];
+			computeUV(sprite);
+		}
+		holes = false;
+		reallocate = true;
+		dirty.clear();
+		return true;
+	}
+};
+
+// read the sprite table written by TextureAtlas::save(), uv coordinates are filled in from the atlas size
+inline bool readAtlasTable(const std::string& path, int& width, int& height, std::vector<AtlasSprite>& sprites) {
+	std::ifstream table(path);
+	std::string tag;
+	size_t count = 0;
+	if (!(table >> tag >> width >> height >> count) || tag != "atlas" || width <= 0 || height <= 0) {
+		std::cout << "ERROR::TEXTURE_ATLAS::INVALID_TABLE: " << path << std::endl;
+		return false;
+	}
+	sprites.clear();
+	for (size_t i = 0; i < count; i++) {
+		AtlasSprite sprite;
+		// the name is the rest of the line, it may contain spaces
+		if (!(table >> sprite.rect.x >> sprite.rect.y >> sprite.rect.width >> sprite.rect.height) || !std::getline(table >> std::ws, sprite.name)) {
+			std::cout << "ERROR::TEXTURE_ATLAS::INVALID_TABLE: " << path << std::endl;
+			return false;
+		}
+		sprite.live = true;
+		sprite.uv[0] = (float)sprite.rect.x / width;
+		sprite.uv[1] = (float)sprite.rect.y / height;
+		sprite.uv[2] = (float)(sprite.rect.x + sprite.rect.width) / width;
+		sprite.uv[3] = (float)(sprite.rect.y + sprite.rect.height) / height;
+		sprites.push_back(sprite);
+	}
+	return true;
+}
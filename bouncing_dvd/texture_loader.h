@@ -0,0 +1,516 @@
+#pragma once
+// asynchronous texture loader class defined here
+// images are decoded on the job system, load() hands back a handle straight away
+// until the pixels reach the GPU the handle resolves to a small placeholder texture
+//
+// update() runs once per frame on the render thread and copies at most 'upload_budget' bytes into a persistently
+// mapped staging PBO, large images are uploaded a band of rows at a time over several frames so no frame ever hitches
+//
+// '.ktx2' files (see ktx2.h) skip decoding entirely, their block compressed mip levels are uploaded as stored
+//
+// with an asset pack (see asset_pack.h) every path is looked up in the pack first, images found there are decoded straight
+// from the mapping and ktx2 levels are uploaded from it without any copy, files missing from the pack come from disk
+//
+// png files are decoded by png_decoder.h, other formats and the png files it does not cover by stb_image
+//
+// '.qoi' files (see qoi.h) are not decoded on a worker at all, update() decodes each band of rows straight into the mapped
+// staging segment, bottom row first, so the only copy of the pixels is the one the GPU reads. decoding runs on the render
+// thread but never more than 'upload_budget' bytes of it per frame
+//
+// decoded images are turned upside down and RGB widened to RGBA by the SIMD kernels in pixel_convert.h, every texture
+// reaches the GPU with four byte aligned rows in a layout the driver copies without converting
+
+#include <glad/glad.h>
+
+#include <asset_pack.h>
+#include <job_system.h>
+#include <ktx2.h>
+#include <pixel_convert.h>
+#include <png_decoder.h>
+#include <qoi.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TextureInfo {
+	std::string path;
+	unsigned int texture = 0; // real texture, 0 until the upload finished
+	int width = 0, height = 0, channels = 0;
+	bool compressed = false;  // uploaded from a ktx2 file
+	size_t gpu_bytes = 0;     // texture storage including the mip chain
+	bool ready = false;
+	bool failed = false;
+};
+
+class TextureLoader {
+public:
+	unsigned int placeholder; // shown for every texture that is still loading (or failed to load)
+
+	// 'pack' may be null, otherwise it has to stay open for as long as the loader exists
+	TextureLoader(JobSystem& jobs, size_t upload_budget = 4 * 1024 * 1024, AssetPack* pack = nullptr)
+		: jobs(jobs), budget(upload_budget), pack(pack), fences(STAGING_SEGMENTS, nullptr) {
+
+		// 2x2 grey checker
+		const unsigned char checker[] = {
+			160, 160, 160, 255,   96,  96,  96, 255,
+			 96,  96,  96, 255,  160, 160, 160, 255,
+		};
+		glCreateTextures(GL_TEXTURE_2D, 1, &placeholder);
+		glTextureStorage2D(placeholder, 1, GL_RGBA8, 2, 2);
+		glTextureSubImage2D(placeholder, 0, 0, 0, 2, 2, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+		glTextureParameteri(placeholder, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(placeholder, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		// staging buffer split into one segment per frame in flight, each segment holds one frame's budget
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &staging);
+		glNamedBufferStorage(staging, budget * STAGING_SEGMENTS, NULL, flags);
+		staging_memory = (unsigned char*)glMapNamedBufferRange(staging, 0, budget * STAGING_SEGMENTS, flags);
+	}
+
+	~TextureLoader() {
+		// workers write into 'decoded', wait for them before it goes away
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			decode_finished.wait(lock, [this] { return decoding == 0; });
+		}
+		for (Upload& upload : decoded)
+			freeUpload(upload);
+		for (Upload& upload : uploads)
+			freeUpload(upload);
+
+		for (GLsync fence : fences)
+			if (fence != nullptr)
+				glDeleteSync(fence);
+		glUnmapNamedBuffer(staging);
+		glDeleteBuffers(1, &staging);
+
+		for (TextureInfo& info : textures)
+			if (info.texture != 0)
+				glDeleteTextures(1, &info.texture);
+		glDeleteTextures(1, &placeholder);
+	}
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// start loading an image, the returned handle is valid immediately
+	unsigned int load(const std::string& path) {
+		unsigned int handle;
+		if (!free_handles.empty()) {
+			handle = free_handles.back();
+			free_handles.pop_back();
+		}
+		else {
+			handle = (unsigned int)textures.size();
+			textures.emplace_back();
+			generations.push_back(0);
+		}
+		textures[handle] = TextureInfo();
+		textures[handle].path = path;
+		unsigned int generation = generations[handle];
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoding++;
+		}
+		jobs.submit([this, handle, generation, path]() {
+			Upload upload;
+			upload.handle = handle;
+			upload.generation = generation;
+			decodeFile(path, upload);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(upload);
+			if (--decoding == 0)
+				decode_finished.notify_all();
+		});
+		return handle;
+	}
+
+	// delete the texture behind a handle, an unfinished load is cancelled and the handle may be reused by a later load()
+	void unload(unsigned int handle) {
+		TextureInfo& info = textures[handle];
+		if (info.texture != 0)
+			glDeleteTextures(1, &info.texture);
+		for (auto it = uploads.begin(); it != uploads.end(); ++it) {
+			if (it->handle == handle) {
+				freeUpload(*it);
+				uploads.erase(it);
+				break;
+			}
+		}
+		// a decode still running on a worker is recognised by its stale generation and thrown away in update()
+		generations[handle]++;
+		info = TextureInfo();
+		free_handles.push_back(handle);
+	}
+
+	// texture to bind for a handle, the placeholder until the image is fully uploaded
+	unsigned int texture(unsigned int handle) const {
+		const TextureInfo& info = textures[handle];
+		return info.ready ? info.texture : placeholder;
+	}
+
+	const TextureInfo& info(unsigned int handle) const {
+		return textures[handle];
+	}
+
+	bool isReady(unsigned int handle) const {
+		return textures[handle].ready;
+	}
+
+	// number of textures still being decoded or uploaded
+	size_t pendingCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return decoding + decoded.size() + uploads.size();
+	}
+
+	// move finished decodes to the GPU, call once per frame from the thread owning the GL context
+	void update() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (Upload& upload : decoded) {
+				if (upload.generation == generations[upload.handle])
+					startUpload(upload);
+				else
+					freeUpload(upload); // unloaded while it was decoding
+			}
+			decoded.clear();
+		}
+		if (uploads.empty())
+			return;
+
+		// wait for the GPU to finish reading this segment, it was last used STAGING_SEGMENTS frames ago
+		size_t segment = frame++ % STAGING_SEGMENTS;
+		if (fences[segment] != nullptr) {
+			glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(fences[segment]);
+			fences[segment] = nullptr;
+		}
+		size_t segment_offset = segment * budget;
+		size_t used = 0;
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+		while (!uploads.empty() && used < budget) {
+			Upload& upload = uploads.front();
+			TextureInfo& info = textures[upload.handle];
+			const UploadLevel& level = upload.levels[upload.level];
+
+			// compressed data is uploaded in rows of 4x4 blocks, the y offset of every band stays block aligned
+			bool compressed = upload.compressed_format != 0;
+			int row_height = compressed ? 4 : 1;
+			int total_rows = (level.height + row_height - 1) / row_height;
+			size_t row_bytes = level.size / total_rows;
+			bool streamed = upload.qoi.isOpen();
+			if (row_bytes == 0) {
+				// a level shorter than one row has nothing to send
+				abandonUpload(upload);
+				uploads.pop_front();
+				continue;
+			}
+			const unsigned char* source = streamed ? nullptr : upload.data + level.offset + upload.next_row * row_bytes;
+
+			auto send = [&](int rows, const void* pixels) {
+				// streamed rows come out of the decoder top row first, they fill the texture from the top down
+				int y = streamed ? level.height - upload.next_row - rows : upload.next_row * row_height;
+				int height = std::min(rows * row_height, level.height - y);
+				if (compressed)
+					glCompressedTextureSubImage2D(info.texture, (GLint)upload.level, 0, y, level.width, height,
+						upload.compressed_format, (GLsizei)(rows * row_bytes), pixels);
+				else
+					glTextureSubImage2D(info.texture, (GLint)upload.level, 0, y, level.width, height,
+						pixelFormat(upload.channels), GL_UNSIGNED_BYTE, pixels);
+				upload.next_row += rows;
+			};
+
+			if (row_bytes > budget) {
+				// a single row does not fit the staging buffer, send it straight from client memory and spend the whole frame on it
+				if (used > 0)
+					break;
+				std::vector<unsigned char> row;
+				if (streamed) {
+					row.resize(row_bytes);
+					if (!upload.qoi.decodeRows(row.data(), 1, 0)) {
+						abandonUpload(upload);
+						uploads.pop_front();
+						continue;
+					}
+					source = row.data();
+				}
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				send(1, source);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+				used = budget;
+			}
+			else {
+				int rows = std::min(total_rows - upload.next_row, (int)((budget - used) / row_bytes));
+				if (rows == 0)
+					break;
+				unsigned char* destination = staging_memory + segment_offset + used;
+				if (!streamed)
+					std::memcpy(destination, source, rows * row_bytes);
+				// the first decoded row is the top of the band, it goes to the end of the band's staging memory
+				else if (!upload.qoi.decodeRows(destination + (rows - 1) * row_bytes, rows, -(ptrdiff_t)row_bytes)) {
+					abandonUpload(upload);
+					uploads.pop_front();
+					continue;
+				}
+				send(rows, (void*)(segment_offset + used));
+				used += rows * row_bytes;
+			}
+
+			if (upload.next_row == total_rows) {
+				upload.level++;
+				upload.next_row = 0;
+			}
+			if (upload.level == upload.levels.size()) {
+				// plain images arrive with a single level, the rest of the chain is built on the GPU
+				if (!compressed)
+					glGenerateTextureMipmap(info.texture);
+				freeUpload(upload);
+				info.ready = true;
+				uploads.pop_front();
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+private:
+	static const size_t STAGING_SEGMENTS = 3;
+
+	// where one mip level sits inside Upload::data
+	struct UploadLevel {
+		size_t offset, size;
+		int width, height;
+	};
+
+	// a decoded image on its way to the GPU
+	struct Upload {
+		unsigned int handle = 0;
+		unsigned int generation = 0;
+		const unsigned char* data = nullptr; // decoded pixels, or the whole file for ktx2 and qoi
+		void (*release)(void*) = nullptr;    // frees 'data', null when it points into the asset pack
+		int width = 0, height = 0, channels = 0;
+		GLenum compressed_format = 0;      // 0 for plain pixels
+		uint32_t vk_format = 0;            // format named in the ktx2 header
+		std::vector<UploadLevel> levels;
+		size_t level = 0;                  // level being uploaded
+		int next_row = 0;                  // next pixel row (block row when compressed) of that level
+		QoiDecoder qoi;                    // open while a qoi file is decoded into the staging buffer
+	};
+
+	JobSystem& jobs;
+	size_t budget; // bytes uploaded per frame
+	AssetPack* pack;
+
+	std::vector<TextureInfo> textures; // indexed by handle, only touched on the render thread
+	std::vector<unsigned int> generations; // bumped by unload() so late decodes of a reused handle are ignored
+	std::vector<unsigned int> free_handles;
+	std::deque<Upload> uploads;        // render thread only, front is uploading
+
+	std::mutex mutex;
+	std::condition_variable decode_finished;
+	std::vector<Upload> decoded; // filled by workers
+	size_t decoding = 0;
+
+	unsigned int staging;
+	unsigned char* staging_memory;
+	std::vector<GLsync> fences;
+	size_t frame = 0;
+
+	static void freeUpload(Upload& upload) {
+		if (upload.data != nullptr && upload.release != nullptr)
+			upload.release((void*)upload.data);
+		upload.data = nullptr;
+	}
+
+	// the texture could not be finished, drop its storage and show the placeholder for good
+	void abandonUpload(Upload& upload) {
+		TextureInfo& info = textures[upload.handle];
+		if (info.texture != 0)
+			glDeleteTextures(1, &info.texture);
+		info.texture = 0;
+		info.failed = true;
+		freeUpload(upload);
+		std::cout << "Failed to load texture: " << info.path << std::endl;
+	}
+
+	static bool hasExtension(const std::string& path, const char* extension) {
+		size_t length = std::strlen(extension);
+		return path.size() >= length && path.compare(path.size() - length, length, extension) == 0;
+	}
+
+	// runs on a worker, fills 'upload' with pixels or compressed levels, upload.data stays null on failure
+	void decodeFile(const std::string& path, Upload& upload) const {
+		bool is_ktx2 = hasExtension(path, ".ktx2");
+		bool is_qoi = hasExtension(path, ".qoi");
+		AssetView view = pack != nullptr ? pack->find(path) : AssetView();
+		if (!is_ktx2 && !is_qoi) {
+			std::vector<unsigned char> file;
+			if (!view) {
+				std::ifstream stream(path, std::ios::binary);
+				file.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+				if (file.empty())
+					return;
+				view = { file.data(), file.size() };
+			}
+			// png goes through the fast decoder, everything it turns down through stb_image
+			upload.data = decodePng(view.data, view.size, upload.width, upload.height, upload.channels);
+			upload.release = std::free;
+			if (upload.data == nullptr) {
+				// stb_image is told not to flip, its flip is a byte loop, the row order is fixed in convertDecoded()
+				stbi_set_flip_vertically_on_load_thread(false);
+				upload.data = stbi_load_from_memory(view.data, (int)view.size, &upload.width, &upload.height, &upload.channels, 0);
+				upload.release = stbi_image_free;
+			}
+			if (upload.data != nullptr && convertDecoded(upload))
+				upload.levels.push_back({ 0, (size_t)upload.width * upload.height * upload.channels, upload.width, upload.height });
+			return;
+		}
+
+		size_t size = view.size;
+		if (view)
+			upload.data = view.data; // levels are uploaded (or decoded) straight out of the pack, nothing to free
+		else {
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file)
+				return;
+			size = (size_t)file.tellg();
+			file.seekg(0);
+			unsigned char* bytes = (unsigned char*)std::malloc(size);
+			upload.data = bytes;
+			upload.release = std::free;
+			if (bytes == nullptr || !file.read((char*)bytes, size)) {
+				freeUpload(upload);
+				return;
+			}
+		}
+
+		if (is_qoi) {
+			// only the header is read here, the pixels are decoded by update()
+			if (!upload.qoi.open(upload.data, size)) {
+				freeUpload(upload);
+				return;
+			}
+			upload.width = upload.qoi.width;
+			upload.height = upload.qoi.height;
+			upload.channels = 4;
+			upload.levels.push_back({ 0, (size_t)upload.width * upload.height * 4, upload.width, upload.height });
+			return;
+		}
+
+		Ktx2Image image;
+		if (!parseKtx2(upload.data, size, image) || ktx2GLFormat(image.vk_format) == 0) {
+			freeUpload(upload);
+			return;
+		}
+
+		upload.width = image.width;
+		upload.height = image.height;
+		upload.channels = 4;
+		upload.vk_format = image.vk_format;
+		upload.compressed_format = ktx2GLFormat(image.vk_format);
+		for (const Ktx2Level& level : image.levels)
+			upload.levels.push_back({ (size_t)(level.data - upload.data), level.size, level.width, level.height });
+	}
+
+	// flip a decoded image so its first row is the bottom one, as GL expects, RGB is widened to RGBA on the way
+	static bool convertDecoded(Upload& upload) {
+		if (upload.channels != 3) {
+			flipRows((unsigned char*)upload.data, upload.width, upload.height, upload.channels);
+			return true;
+		}
+		unsigned char* rgba = (unsigned char*)std::malloc((size_t)upload.width * upload.height * 4);
+		if (rgba == nullptr) {
+			freeUpload(upload);
+			return false;
+		}
+		for (int y = 0; y < upload.height; y++)
+			expandRGBToRGBA(upload.data + (size_t)(upload.height - 1 - y) * upload.width * 3, rgba + (size_t)y * upload.width * 4, upload.width);
+		freeUpload(upload);
+		upload.data = rgba;
+		upload.release = std::free;
+		upload.channels = 4;
+		return true;
+	}
+
+	static GLenum pixelFormat(int channels) {
+		switch (channels) {
+		case 4: return GL_RGBA;
+		case 3: return GL_RGB;
+		case 2: return GL_RG;
+		default: return GL_RED;
+		}
+	}
+
+	static GLenum internalFormat(int channels) {
+		switch (channels) {
+		case 4: return GL_RGBA8;
+		case 3: return GL_RGB8;
+		case 2: return GL_RG8;
+		default: return GL_R8;
+		}
+	}
+
+	// allocate the texture storage for a decoded image and queue its rows for upload, called with the mutex held
+	void startUpload(Upload& upload) {
+		TextureInfo& info = textures[upload.handle];
+		bool compressed = upload.compressed_format != 0;
+		if (upload.data == nullptr || (compressed && !ktx2FormatSupported(upload.vk_format))) {
+			abandonUpload(upload);
+			return;
+		}
+		info.width = upload.width;
+		info.height = upload.height;
+		info.channels = upload.channels;
+		info.compressed = compressed;
+
+		// output debug
+		std::cout << "\nLoaded Image " << info.path << " with attributes:" << std::endl
+			<< "\tWidth     : " << upload.width << std::endl
+			<< "\tHeight    : " << upload.height << std::endl
+			<< "\tChannels  : " << upload.channels << std::endl
+			<< "\tFormat    : " << (compressed ? "block compressed" : "uncompressed") << std::endl;
+
+		int levels = (int)upload.levels.size();
+		info.gpu_bytes = 0;
+		if (compressed) {
+			for (const UploadLevel& level : upload.levels)
+				info.gpu_bytes += level.size;
+		}
+		else {
+			while ((std::max(upload.width, upload.height) >> levels) > 0)
+				levels++;
+			// drivers pad RGB8 to four bytes per texel
+			size_t texel_bytes = upload.channels == 3 ? 4 : upload.channels;
+			for (int level = 0; level < levels; level++)
+				info.gpu_bytes += (size_t)std::max(upload.width >> level, 1) * std::max(upload.height >> level, 1) * texel_bytes;
+		}
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &info.texture);
+		glTextureStorage2D(info.texture, levels, compressed ? upload.compressed_format : internalFormat(upload.channels),
+			upload.width, upload.height);
+		// set texture wrapping parameters
+		glTextureParameteri(info.texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(info.texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// set texture filtering parameters
+		glTextureParameteri(info.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(info.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		uploads.push_back(upload);
+	}
+};
@@ -0,0 +1,144 @@
+#pragma once
+// texture manager class defined here
+// sits on top of the texture loader and makes sure every image file is loaded at most once
+//
+// textures are keyed by their canonical path, so "dvd.png", "./dvd.png" and "glsl/../dvd.png" share one GL object
+// acquire() bumps a reference count, release() drops it, and a texture nobody references is only deleted a few frames
+// later, the GPU may still be drawing with it and a quick re-acquire brings it back without reloading
+// textures found in the asset pack are keyed by their name inside the pack instead
+
+#include <texture_loader.h>
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextureStats {
+	size_t resident = 0;          // textures fully uploaded and owned by the manager
+	size_t loading = 0;           // textures still decoding or uploading
+	size_t pending_delete = 0;    // unreferenced textures waiting out the deletion delay
+	size_t gpu_bytes = 0;         // storage of every resident texture, mips included
+	unsigned long long requests = 0;
+	unsigned long long cache_hits = 0;
+};
+
+class TextureManager {
+public:
+	// 'pack' may be null, otherwise it has to outlive the manager
+	TextureManager(JobSystem& jobs, size_t upload_budget = 4 * 1024 * 1024, AssetPack* pack = nullptr)
+		: loader(jobs, upload_budget, pack), pack(pack) {
+	}
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// get a handle for an image file, loading it only if no live handle for the same file exists
+	// every acquire() must be matched by one release()
+	unsigned int acquire(const std::string& path) {
+		stat.requests++;
+		std::string key = pack != nullptr && pack->contains(path) ? packName(path) : canonicalPath(path);
+		auto it = entries.find(key);
+		if (it != entries.end()) {
+			stat.cache_hits++;
+			Entry& entry = it->second;
+			entry.references++;
+			return entry.handle;
+		}
+
+		Entry entry;
+		entry.handle = loader.load(key);
+		entry.references = 1;
+		entries[key] = entry;
+		if (handle_keys.size() <= entry.handle)
+			handle_keys.resize(entry.handle + 1);
+		handle_keys[entry.handle] = key;
+		return entry.handle;
+	}
+
+	// give up one reference, the texture is queued for deletion once the count reaches zero
+	void release(unsigned int handle) {
+		Entry& entry = entries.at(handle_keys[handle]);
+		if (entry.references == 0)
+			return;
+		if (--entry.references == 0)
+			entry.released_frame = frame;
+	}
+
+	// texture to bind, the loader's placeholder while the image is still on its way
+	unsigned int texture(unsigned int handle) const {
+		return loader.texture(handle);
+	}
+
+	const TextureInfo& info(unsigned int handle) const {
+		return loader.info(handle);
+	}
+
+	// advance uploads and delete textures that have gone unreferenced for DELETE_DELAY frames
+	void update() {
+		loader.update();
+		frame++;
+
+		for (auto it = entries.begin(); it != entries.end();) {
+			Entry& entry = it->second;
+			if (entry.references == 0 && frame - entry.released_frame >= DELETE_DELAY) {
+				loader.unload(entry.handle);
+				it = entries.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	TextureStats stats() const {
+		TextureStats s = stat;
+		for (const auto& pair : entries) {
+			const Entry& entry = pair.second;
+			const TextureInfo& info = loader.info(entry.handle);
+			if (entry.references == 0)
+				s.pending_delete++;
+			if (info.ready) {
+				s.resident++;
+				s.gpu_bytes += info.gpu_bytes;
+			}
+			else if (!info.failed)
+				s.loading++;
+		}
+		return s;
+	}
+
+	void printStats() const {
+		TextureStats s = stats();
+		std::cout << "\nTexture manager statistics:" << std::endl
+			<< "\tResident       : " << s.resident << std::endl
+			<< "\tLoading        : " << s.loading << std::endl
+			<< "\tPending delete : " << s.pending_delete << std::endl
+			<< "\tGPU memory     : " << s.gpu_bytes / 1024.0 << " KiB" << std::endl
+			<< "\tRequests       : " << s.requests << " (" << s.cache_hits << " cache hits)" << std::endl;
+	}
+
+private:
+	static const unsigned long long DELETE_DELAY = 3; // frames, covers the frames the driver may still have in flight
+
+	struct Entry {
+		unsigned int handle = 0;
+		unsigned int references = 0;
+		unsigned long long released_frame = 0;
+	};
+
+	TextureLoader loader;
+	AssetPack* pack;
+	std::unordered_map<std::string, Entry> entries; // keyed by canonical path or pack name
+	std::vector<std::string> handle_keys;           // loader handle -> key in 'entries'
+	unsigned long long frame = 0;
+	TextureStats stat;
+
+	static std::string canonicalPath(const std::string& path) {
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		if (error)
+			canonical = std::filesystem::path(path).lexically_normal();
+		return canonical.generic_string();
+	}
+};
@@ -0,0 +1,180 @@
+#pragma once
+// sprite texture set class defined here
+// the second way (besides the texture atlas) to draw sprites showing many different textures in one draw call,
+// every sprite instance carries an index and the fragment shader picks its texture with it, nothing is rebound
+//
+// two modes:
+//   Bindless      GL_ARB_bindless_texture handles of the textures as they are, stored in an SSBO (glsl/sprite_bindless_fragment.glsl)
+//   TextureArray  the textures copied into the layers of one GL_TEXTURE_2D_ARRAY (glsl/sprite_array_fragment.glsl),
+//                 works everywhere but every layer has the same size, smaller textures use a corner of their layer and
+//                 their last row and column are repeated over the rest of it
+//
+// glad was generated without extensions, loadBindlessTexture() fetches the few entry points the bindless mode needs
+
+#include <glad/glad.h>
+
+#include <ktx2.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+inline PFNGLGETTEXTUREHANDLEARBPROC glad_glGetTextureHandleARB = nullptr;
+inline PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glad_glMakeTextureHandleResidentARB = nullptr;
+inline PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glad_glMakeTextureHandleNonResidentARB = nullptr;
+#define glGetTextureHandleARB glad_glGetTextureHandleARB
+#define glMakeTextureHandleResidentARB glad_glMakeTextureHandleResidentARB
+#define glMakeTextureHandleNonResidentARB glad_glMakeTextureHandleNonResidentARB
+
+inline bool bindlessTextureLoaded() {
+	return glad_glGetTextureHandleARB != nullptr && glad_glMakeTextureHandleResidentARB != nullptr
+		&& glad_glMakeTextureHandleNonResidentARB != nullptr;
+}
+
+// call once after gladLoadGLLoader() with the same loader, false when the driver has no bindless textures
+inline bool loadBindlessTexture(GLADloadproc load) {
+	if (!hasGLExtension("GL_ARB_bindless_texture"))
+		return false;
+	glad_glGetTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)load("glGetTextureHandleARB");
+	glad_glMakeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)load("glMakeTextureHandleResidentARB");
+	glad_glMakeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)load("glMakeTextureHandleNonResidentARB");
+	return bindlessTextureLoaded();
+}
+
+enum class TextureSetMode {
+	Bindless,
+	TextureArray,
+};
+
+class SpriteTextureSet {
+public:
+	// the array mode allocates 'capacity' layers of layer_width x layer_height up front, the bindless mode ignores all three
+	SpriteTextureSet(TextureSetMode mode, int capacity = 512, int layer_width = 256, int layer_height = 256)
+		: mode(mode), capacity(capacity), layer_width(layer_width), layer_height(layer_height) {
+
+		if (mode == TextureSetMode::Bindless) {
+			glCreateBuffers(1, &handle_buffer);
+			return;
+		}
+		levels = 1;
+		while ((std::max(layer_width, layer_height) >> levels) > 0)
+			levels++;
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array);
+		glTextureStorage3D(array, levels, GL_RGBA8, layer_width, layer_height, capacity);
+		glTextureParameteri(array, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(array, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(array, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	~SpriteTextureSet() {
+		for (GLuint64 handle : handles)
+			glMakeTextureHandleNonResidentARB(handle);
+		if (handle_buffer != 0)
+			glDeleteBuffers(1, &handle_buffer);
+		if (array != 0)
+			glDeleteTextures(1, &array);
+	}
+
+	SpriteTextureSet(const SpriteTextureSet&) = delete;
+	SpriteTextureSet& operator=(const SpriteTextureSet&) = delete;
+
+	// bindless when the driver has it, the texture array everywhere else
+	static TextureSetMode preferredMode() {
+		return bindlessTextureLoaded() ? TextureSetMode::Bindless : TextureSetMode::TextureArray;
+	}
+
+	// fragment shader that goes with a mode, pass it to the SpriteBatch constructor
+	static const char* fragmentShader(TextureSetMode mode) {
+		return mode == TextureSetMode::Bindless ? "glsl/sprite_bindless_fragment.glsl" : "glsl/sprite_array_fragment.glsl";
+	}
+
+	// add a GL_RGBA8 texture (e.g. from the texture manager) and return its index, -1 if the set is full or it does not fit
+	// bindless mode: the texture is used as it is and must outlive the set, its parameters can no longer change
+	// array mode: the base level is copied into the next layer, the texture can be deleted afterwards
+	int add(unsigned int texture, int width, int height) {
+		int index = (int)uvs.size();
+		if (mode == TextureSetMode::Bindless) {
+			GLuint64 handle = glGetTextureHandleARB(texture);
+			glMakeTextureHandleResidentARB(handle);
+			handles.push_back(handle);
+			uvs.push_back({ 0.0f, 0.0f, 1.0f, 1.0f });
+		}
+		else {
+			if (index == capacity || width <= 0 || height <= 0 || width > layer_width || height > layer_height) {
+				std::cout << "ERROR::TEXTURE_SET::DOES_NOT_FIT: " << width << "x" << height << " into layer " << index << std::endl;
+				return -1;
+			}
+			glCopyImageSubData(texture, GL_TEXTURE_2D, 0, 0, 0, 0, array, GL_TEXTURE_2D_ARRAY, 0, 0, 0, index, width, height, 1);
+			extrudeLayer(index, width, height);
+			uvs.push_back({ 0.0f, 0.0f, (float)width / layer_width, (float)height / layer_height });
+		}
+		dirty = true;
+		return index;
+	}
+
+	// push new handles or rebuild the layer mips, call once after adding and before drawing
+	void update() {
+		if (!dirty)
+			return;
+		if (mode == TextureSetMode::Bindless)
+			glNamedBufferData(handle_buffer, handles.size() * sizeof(GLuint64), handles.data(), GL_STATIC_DRAW);
+		else if (levels > 1)
+			glGenerateTextureMipmap(array);
+		dirty = false;
+	}
+
+	// make the set visible to the sprite shaders, the batch calls this before each of its draws
+	void bind() const {
+		if (mode == TextureSetMode::Bindless)
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, handle_buffer);
+		else
+			glBindTextureUnit(0, array);
+	}
+
+	// part of the index's layer covered by its texture, the whole texture in bindless mode
+	const float* uv(int index) const {
+		return uvs[index].uv;
+	}
+
+	size_t size() const {
+		return uvs.size();
+	}
+
+	TextureSetMode textureMode() const {
+		return mode;
+	}
+
+private:
+	struct LayerUV {
+		float uv[4];
+	};
+
+	// fill the layer outside the texture's corner with its last column and row, otherwise filtering at the uv limit and
+	// the mips read whatever the layer storage held. the filled part doubles with every copy, a copy never overlaps itself
+	void extrudeLayer(int index, int width, int height) {
+		for (int x = width; x < layer_width; ) {
+			int columns = std::min(x - (width - 1), layer_width - x);
+			glCopyImageSubData(array, GL_TEXTURE_2D_ARRAY, 0, width - 1, 0, index, array, GL_TEXTURE_2D_ARRAY, 0, x, 0, index, columns, height, 1);
+			x += columns;
+		}
+		for (int y = height; y < layer_height; ) {
+			int rows = std::min(y - (height - 1), layer_height - y);
+			glCopyImageSubData(array, GL_TEXTURE_2D_ARRAY, 0, 0, height - 1, index, array, GL_TEXTURE_2D_ARRAY, 0, 0, y, index, layer_width, rows, 1);
+			y += rows;
+		}
+	}
+
+	TextureSetMode mode;
+	int capacity, layer_width, layer_height;
+	int levels = 1;
+	unsigned int array = 0;         // array mode
+	unsigned int handle_buffer = 0; // bindless mode, SSBO of GLuint64 handles
+	std::vector<GLuint64> handles;
+	std::vector<LayerUV> uvs;
+	bool dirty = false;
+};
@@ -0,0 +1,244 @@
+#pragma once
+// video recorder class defined here
+// streams raw RGBA frames to an external encoder process (ffmpeg by default) over a pipe
+//
+// the render thread fills frame buffers taken from a fixed pool and hands them to a writer thread through a bounded queue,
+// so memory use stays constant no matter how long the recording runs
+// when the encoder falls behind the queue fills up and the policy decides what happens to new frames
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define RECORDER_POPEN _popen
+#define RECORDER_PCLOSE _pclose
+#define RECORDER_PIPE_MODE "wb"
+#else
+#include <csignal>
+#define RECORDER_POPEN popen
+#define RECORDER_PCLOSE pclose
+#define RECORDER_PIPE_MODE "w"
+#endif
+
+// what to do with a new frame when the queue is full
+enum class QueuePolicy {
+	Block,      // stall the render loop until the encoder catches up, no frame is ever lost
+	DropNewest, // discard the frame being submitted, keeps the render loop at full speed
+	DropOldest  // discard the oldest queued frame, keeps the recording closest to "now"
+};
+
+// backpressure metrics, read with VideoRecorder::stats()
+struct RecorderStats {
+	unsigned long long frames_submitted = 0; // frames the render loop tried to record
+	unsigned long long frames_written = 0;   // frames that reached the encoder pipe
+	unsigned long long frames_dropped = 0;   // frames discarded by the queue policy or lost to a failed readback
+	size_t max_queue_depth = 0;              // high water mark of the queue
+	double blocked_ms = 0.0;                 // total time the render loop spent waiting for a free buffer
+	double write_ms = 0.0;                   // total time the writer thread spent inside fwrite
+};
+
+class VideoRecorder {
+public:
+	unsigned int width, height;
+	QueuePolicy policy;
+
+	// encoder_command overrides the default ffmpeg invocation, raw frames are written to its stdin
+	VideoRecorder(const std::string& output_path, unsigned int width, unsigned int height, int fps,
+		size_t queue_capacity = 8, QueuePolicy policy = QueuePolicy::Block, const std::string& encoder_command = "")
+		: width(width), height(height), policy(policy), capacity(queue_capacity > 0 ? queue_capacity : 1) {
+
+		std::string command = encoder_command;
+		if (command.empty()) {
+			// frames come from glReadPixels bottom-up, let the encoder flip them instead of the render thread
+			std::ostringstream cmd;
+			cmd << "ffmpeg -y -loglevel error -f rawvideo -pixel_format rgba"
+				<< " -video_size " << width << "x" << height
+				<< " -framerate " << fps
+				<< " -i - -vf vflip -c:v libx264 -preset ultrafast -pix_fmt yuv420p \"" << output_path << "\"";
+			command = cmd.str();
+		}
+
+#ifndef _WIN32
+		// a dying encoder should surface as a failed write, not kill the whole program
+		std::signal(SIGPIPE, SIG_IGN);
+#endif
+		pipe = RECORDER_POPEN(command.c_str(), RECORDER_PIPE_MODE);
+		if (pipe == NULL) {
+			std::cout << "ERROR::RECORDER::FAILED_TO_START_ENCODER: " << command << std::endl;
+			return;
+		}
+
+		// one buffer for the render thread, one for the writer thread, the rest can sit in the queue
+		buffers.resize(capacity + 2);
+		for (std::vector<unsigned char>& buffer : buffers) {
+			buffer.resize(frameBytes());
+			free_list.push_back(buffer.data());
+		}
+
+		writer = std::thread(&VideoRecorder::writeLoop, this);
+	}
+
+	~VideoRecorder() {
+		stop();
+	}
+
+	VideoRecorder(const VideoRecorder&) = delete;
+	VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+	bool isOpen() const {
+		return pipe != NULL;
+	}
+
+	size_t frameBytes() const {
+		return (size_t)width * height * 4;
+	}
+
+	// get a buffer of frameBytes() to fill with the next frame
+	// returns nullptr when the policy decided to drop this frame, or the recorder is not running
+	unsigned char* acquireFrame() {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (pipe == NULL || stopping || failed)
+			return nullptr;
+		stat.frames_submitted++;
+
+		if (isFull()) {
+			if (policy == QueuePolicy::DropNewest) {
+				stat.frames_dropped++;
+				return nullptr;
+			}
+			if (policy == QueuePolicy::DropOldest && !queue.empty()) {
+				free_list.push_back(queue.front());
+				queue.pop_front();
+				stat.frames_dropped++;
+			}
+			else {
+				auto start = std::chrono::steady_clock::now();
+				space_available.wait(lock, [this] { return !isFull() || failed; });
+				stat.blocked_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if (failed)
+					return nullptr;
+			}
+		}
+
+		unsigned char* frame = free_list.back();
+		free_list.pop_back();
+		return frame;
+	}
+
+	// hand a buffer returned by acquireFrame() to the writer thread
+	void submitFrame(unsigned char* frame) {
+		if (frame == nullptr)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(frame);
+			if (queue.size() > stat.max_queue_depth)
+				stat.max_queue_depth = queue.size();
+		}
+		frame_available.notify_one();
+	}
+
+	// give back a buffer returned by acquireFrame() that never got a frame, counted as dropped
+	void discardFrame(unsigned char* frame) {
+		if (frame == nullptr)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free_list.push_back(frame);
+			stat.frames_dropped++;
+		}
+		space_available.notify_one();
+	}
+
+	// flush every queued frame into the encoder and wait for it to finish the file
+	void stop() {
+		if (pipe == NULL)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		frame_available.notify_one();
+		if (writer.joinable())
+			writer.join();
+
+		RECORDER_PCLOSE(pipe);
+		pipe = NULL;
+	}
+
+	RecorderStats stats() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stat;
+	}
+
+	void printStats() {
+		RecorderStats s = stats();
+		std::cout << "\nRecorder statistics:" << std::endl
+			<< "\tSubmitted : " << s.frames_submitted << std::endl
+			<< "\tWritten   : " << s.frames_written << std::endl
+			<< "\tDropped   : " << s.frames_dropped << std::endl
+			<< "\tMax queue : " << s.max_queue_depth << " / " << capacity << std::endl
+			<< "\tBlocked   : " << s.blocked_ms << " ms" << std::endl
+			<< "\tWriting   : " << s.write_ms << " ms" << std::endl;
+	}
+
+private:
+	FILE* pipe = NULL;
+	size_t capacity;
+
+	std::vector<std::vector<unsigned char>> buffers; // preallocated frame storage, never resized while recording
+	std::vector<unsigned char*> free_list;
+	std::deque<unsigned char*> queue;
+
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable frame_available;
+	std::condition_variable space_available;
+	bool stopping = false;
+	bool failed = false;
+	RecorderStats stat;
+
+	bool isFull() const {
+		return queue.size() >= capacity || free_list.empty();
+	}
+
+	// writer thread, drains the queue into the encoder pipe
+	void writeLoop() {
+		while (true) {
+			unsigned char* frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				frame_available.wait(lock, [this] { return !queue.empty() || stopping; });
+				if (queue.empty())
+					return; // stopping and fully drained
+				frame = queue.front();
+				queue.pop_front();
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			bool ok = !failed && fwrite(frame, 1, frameBytes(), pipe) == frameBytes();
+			double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stat.write_ms += elapsed;
+				if (ok)
+					stat.frames_written++;
+				else if (!failed) {
+					failed = true;
+					std::cout << "ERROR::RECORDER::ENCODER_PIPE_CLOSED" << std::endl;
+				}
+				free_list.push_back(frame);
+			}
+			space_available.notify_one();
+		}
+	}
+};
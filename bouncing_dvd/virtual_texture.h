@@ -0,0 +1,830 @@
+#pragma once
+// virtual texture classes defined here
+// images far larger than GPU memory (gigapixel scans, maps, ...) are cut offline into a mip pyramid of fixed size tiles,
+// at runtime only the tiles the current view needs are kept on the GPU, in a cache texture whose size never changes
+//
+//   tiler        - buildVirtualTexture() streams the source top to bottom, qoi sources a row at a time through QoiDecoder,
+//                  so tiling needs a few tile rows of memory per level however tall the image is
+//   feedback     - renderFeedback() draws the image into a small RGBA16UI target where every pixel holds the tile
+//                  (x, y, level) it would sample, read back through a ring of PBOs a few frames later like FrameCapture
+//   streaming    - missing tiles are faulted in from the memory mapped file on the job system, update() copies at most
+//                  'uploads_per_frame' of them through a persistently mapped staging buffer into free cache pages
+//   eviction     - pages no tile in the last feedback asked for are reused least recently used first, the coarsest tile
+//                  is pinned so every texel always has something to show
+//   indirection  - RGBA8UI texture with one mip level per pyramid level and one texel per tile, pointing at the page of
+//                  the tile or of its closest resident ancestor
+//
+// GPU memory is the cache (cache_pages^2 pages) plus an indirection texture of one texel per 128x128 tile, the file
+// itself is only ever touched through the OS page cache
+//
+// file layout, all integers little endian:
+//   VirtualTextureHeader
+//   VirtualTextureLevel[level_count]   finest first
+//   tiles                              from VTEX_ALIGNMENT on, level by level, rows top to bottom, tile_bytes each
+//
+// a tile is tile_size texels plus 'border' texels copied from its neighbours on every side (the image edge repeats),
+// so bilinear filtering never reads across into an unrelated page. rows are stored top to bottom, the shaders count
+// texels from the top left as well
+
+#include <glad/glad.h>
+
+#include <asset_pack.h>
+#include <block_encoder.h>
+#include <job_system.h>
+#include <ktx2.h>
+#include <qoi.h>
+#include <shader.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+const char VTEX_MAGIC[8] = { 'D', 'V', 'D', 'V', 'T', 'E', 'X', '\0' };
+const uint32_t VTEX_VERSION = 1;
+const size_t VTEX_ALIGNMENT = 4096; // tiles start on a page of the mapping
+
+// tile formats, the cache texture has the same one so tiles are copied without converting
+const uint32_t VTEX_RGBA8 = 0;
+const uint32_t VTEX_BC1 = 1;
+const uint32_t VTEX_BC7 = 2;
+
+struct VirtualTextureHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t format;      // VTEX_RGBA8, VTEX_BC1 or VTEX_BC7
+	uint32_t width;       // level 0 in texels
+	uint32_t height;
+	uint32_t tile_size;   // image texels per tile side
+	uint32_t border;      // extra texels on every side of a tile
+	uint32_t level_count;
+	uint32_t reserved;
+	uint64_t tile_bytes;  // every tile takes exactly this many bytes
+	uint64_t tiles_offset;
+};
+
+struct VirtualTextureLevel {
+	uint32_t width, height; // in texels, half the level below rounded up
+	uint32_t tiles_x, tiles_y;
+	uint64_t first_tile;    // index of the level's top left tile
+};
+
+static_assert(sizeof(VirtualTextureHeader) == 56, "VirtualTextureHeader must match the file layout");
+static_assert(sizeof(VirtualTextureLevel) == 24, "VirtualTextureLevel must match the file layout");
+
+inline BlockFormat vtexBlockFormat(uint32_t format) {
+	return format == VTEX_BC1 ? BlockFormat::BC1 : BlockFormat::BC7;
+}
+
+inline size_t vtexTileBytes(uint32_t format, int page_size) {
+	return format == VTEX_RGBA8 ? (size_t)page_size * page_size * 4 : compressedSize(vtexBlockFormat(format), page_size, page_size);
+}
+
+// levels down to the one that fits a single tile, each texel of level n + 1 covers 2x2 texels of level n
+inline std::vector<VirtualTextureLevel> vtexLevels(uint32_t width, uint32_t height, uint32_t tile_size) {
+	std::vector<VirtualTextureLevel> levels;
+	uint64_t first_tile = 0;
+	while (true) {
+		VirtualTextureLevel level = { width, height, (width + tile_size - 1) / tile_size, (height + tile_size - 1) / tile_size, first_tile };
+		levels.push_back(level);
+		first_tile += (uint64_t)level.tiles_x * level.tiles_y;
+		if (level.tiles_x == 1 && level.tiles_y == 1)
+			return levels;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+}
+
+// writes the tiles of every level as the rows of level 0 come in, each level keeps one tile row plus borders
+// and hands every pair of rows down to the next level as one 2x2 box filtered row
+class VirtualTextureTiler {
+public:
+	VirtualTextureTiler(std::ofstream& out, const VirtualTextureHeader& header, const std::vector<VirtualTextureLevel>& levels, JobSystem& jobs)
+		: out(out), header(header), levels(levels), jobs(jobs), states(levels.size()) {
+		page_size = (int)(header.tile_size + 2 * header.border);
+		for (size_t l = 0; l < levels.size(); l++) {
+			states[l].window.resize((size_t)page_size * levels[l].width * 4);
+			states[l].base = -(int)header.border;
+		}
+	}
+
+	// next row of level 0, top row first, RGBA
+	void pushRow(const unsigned char* row) {
+		push(0, row);
+	}
+
+	size_t tilesWritten() const {
+		return tiles_written;
+	}
+
+private:
+	struct LevelState {
+		std::vector<unsigned char> window;  // rows [base, base + page_size) of the level, the ones the current tile row reads
+		int base = 0;
+		int next_row = 0;
+		uint32_t tile_row = 0;
+		std::vector<unsigned char> pending; // even row waiting for the odd one below it
+		std::vector<unsigned char> half;    // the downsampled row handed to the next level
+	};
+
+	std::ofstream& out;
+	VirtualTextureHeader header;
+	std::vector<VirtualTextureLevel> levels;
+	JobSystem& jobs;
+	std::vector<LevelState> states;
+	int page_size;
+	size_t tiles_written = 0;
+
+	void push(size_t l, const unsigned char* row) {
+		LevelState& state = states[l];
+		const VirtualTextureLevel& level = levels[l];
+		size_t row_bytes = (size_t)level.width * 4;
+		int r = state.next_row++;
+		std::memcpy(state.window.data() + (size_t)(r - state.base) * row_bytes, row, row_bytes);
+
+		// a tile row is complete once its bottom border has arrived, or the image ended
+		int tile_size = (int)header.tile_size;
+		while (state.tile_row < level.tiles_y && r >= std::min((int)level.height - 1, state.base + page_size - 1)) {
+			writeTileRow(l);
+			state.tile_row++;
+			// the next tile row shares 2 * border rows with this one
+			std::memmove(state.window.data(), state.window.data() + (size_t)tile_size * row_bytes, (size_t)(page_size - tile_size) * row_bytes);
+			state.base += tile_size;
+		}
+
+		if (l + 1 == levels.size())
+			return;
+		if (r % 2 == 0 && r + 1 < (int)level.height) {
+			state.pending.assign(row, row + row_bytes);
+			return;
+		}
+		// an odd height pairs the last row with itself, like an odd width does with the last column
+		const unsigned char* above = r % 2 == 0 ? row : state.pending.data();
+		uint32_t half_width = levels[l + 1].width;
+		state.half.resize((size_t)half_width * 4);
+		for (uint32_t x = 0; x < half_width; x++) {
+			size_t x0 = (size_t)x * 2 * 4, x1 = (size_t)std::min(x * 2 + 1, level.width - 1) * 4;
+			for (int c = 0; c < 4; c++)
+				state.half[x * 4 + c] = (unsigned char)((above[x0 + c] + above[x1 + c] + row[x0 + c] + row[x1 + c] + 2) / 4);
+		}
+		push(l + 1, state.half.data());
+	}
+
+	// cut, encode and write every tile of the level's current tile row, tiles of a row are consecutive in the file
+	void writeTileRow(size_t l) {
+		const LevelState& state = states[l];
+		const VirtualTextureLevel& level = levels[l];
+		size_t row_bytes = (size_t)level.width * 4;
+		std::vector<unsigned char> encoded(level.tiles_x * header.tile_bytes);
+		jobs.parallelFor(level.tiles_x, 1, [&](size_t begin, size_t end) {
+			std::vector<unsigned char> pixels((size_t)page_size * page_size * 4);
+			for (size_t tile_x = begin; tile_x < end; tile_x++) {
+				int left = (int)(tile_x * header.tile_size) - (int)header.border;
+				for (int y = 0; y < page_size; y++) {
+					int source_row = std::clamp(state.base + y, 0, (int)level.height - 1);
+					const unsigned char* source = state.window.data() + (size_t)(source_row - state.base) * row_bytes;
+					unsigned char* destination = pixels.data() + (size_t)y * page_size * 4;
+					for (int x = 0; x < page_size; x++)
+						std::memcpy(destination + x * 4, source + (size_t)std::clamp(left + x, 0, (int)level.width - 1) * 4, 4);
+				}
+				unsigned char* tile = encoded.data() + tile_x * header.tile_bytes;
+				if (header.format == VTEX_RGBA8)
+					std::memcpy(tile, pixels.data(), pixels.size());
+				else
+					compressImage(vtexBlockFormat(header.format), pixels.data(), page_size, page_size, tile);
+			}
+		});
+		uint64_t first = level.first_tile + (uint64_t)state.tile_row * level.tiles_x;
+		out.seekp((std::streamoff)(header.tiles_offset + first * header.tile_bytes));
+		out.write((const char*)encoded.data(), encoded.size());
+		tiles_written += level.tiles_x;
+	}
+};
+
+// offline step: tile an image into a virtual texture file. qoi files are decoded a row at a time straight from a mapping,
+// anything else is loaded whole by stb_image first, convert very large images to qoi (see qoi.h) before tiling them
+inline bool buildVirtualTexture(const std::string& source_path, const std::string& output_path, JobSystem& jobs,
+	uint32_t format = VTEX_BC7, uint32_t tile_size = 128, uint32_t border = 4) {
+
+	MappedFile source;
+	QoiDecoder decoder;
+	unsigned char* pixels = nullptr;
+	int width = 0, height = 0, channels = 0;
+	if (source.open(source_path) && decoder.open(source.data(), source.size())) {
+		width = decoder.width;
+		height = decoder.height;
+	}
+	else {
+		stbi_set_flip_vertically_on_load_thread(false); // tiles are cut top row first
+		pixels = stbi_load(source_path.c_str(), &width, &height, &channels, 4);
+		if (pixels == NULL) {
+			std::cout << "ERROR::VTEX::FAILED_TO_LOAD_SOURCE: " << source_path << std::endl;
+			return false;
+		}
+	}
+
+	VirtualTextureHeader header = {};
+	std::memcpy(header.magic, VTEX_MAGIC, sizeof(VTEX_MAGIC));
+	header.version = VTEX_VERSION;
+	header.format = format;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.tile_size = tile_size;
+	header.border = border;
+	header.tile_bytes = vtexTileBytes(format, (int)(tile_size + 2 * border));
+	std::vector<VirtualTextureLevel> levels = vtexLevels(header.width, header.height, tile_size);
+	header.level_count = (uint32_t)levels.size();
+	size_t table_end = sizeof(header) + levels.size() * sizeof(VirtualTextureLevel);
+	header.tiles_offset = (table_end + VTEX_ALIGNMENT - 1) / VTEX_ALIGNMENT * VTEX_ALIGNMENT;
+
+	std::ofstream out(output_path, std::ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)levels.data(), levels.size() * sizeof(VirtualTextureLevel));
+
+	VirtualTextureTiler tiler(out, header, levels, jobs);
+	std::vector<unsigned char> row((size_t)width * 4);
+	bool decoded = true;
+	for (int y = 0; y < height && decoded; y++) {
+		if (pixels != nullptr)
+			tiler.pushRow(pixels + (size_t)y * width * 4);
+		else if ((decoded = decoder.decodeRows(row.data(), 1, 0)))
+			tiler.pushRow(row.data());
+	}
+	stbi_image_free(pixels);
+	if (!decoded) {
+		std::cout << "ERROR::VTEX::FAILED_TO_DECODE: " << source_path << std::endl;
+		return false;
+	}
+	if (!out) {
+		std::cout << "ERROR::VTEX::FAILED_TO_WRITE: " << output_path << std::endl;
+		return false;
+	}
+	std::cout << "Tiled " << source_path << " -> " << output_path << " (" << width << "x" << height << ", " << levels.size()
+		<< " levels, " << tiler.tilesWritten() << " tiles, " << header.tiles_offset + tiler.tilesWritten() * header.tile_bytes
+		<< " bytes)" << std::endl;
+	return true;
+}
+
+struct VirtualTextureStats {
+	size_t pages = 0, resident = 0;
+	size_t missing = 0;             // tiles the last feedback asked for that were not resident yet
+	size_t streamed = 0, evicted = 0, dropped = 0; // since open(), dropped tiles arrived when every page was in view
+	size_t gpu_bytes = 0;           // cache, indirection, staging and feedback buffers, fixed once open
+	size_t virtual_bytes = 0;       // every tile of the pyramid, what one texture holding the whole image would need
+};
+
+class VirtualTexture {
+public:
+	// the cache holds cache_pages x cache_pages tiles (at most 256 a side, the indirection stores page coordinates as bytes),
+	// feedback is rendered at 1 / feedback_divisor of the viewport size
+	VirtualTexture(JobSystem& jobs, int cache_pages = 16, int uploads_per_frame = 8, int feedback_divisor = 8)
+		: jobs(jobs), cache_pages(std::clamp(cache_pages, 2, 256)), uploads_per_frame(uploads_per_frame), feedback_divisor(feedback_divisor),
+		shader("glsl/virtual_vertex.glsl", "glsl/virtual_fragment.glsl"),
+		feedback_shader("glsl/virtual_vertex.glsl", "glsl/virtual_feedback_fragment.glsl"),
+		staging_fences(STAGING_SEGMENTS, nullptr), feedback_pbos(FEEDBACK_RING, 0), feedback_fences(FEEDBACK_RING, nullptr) {
+
+		glCreateVertexArrays(1, &VAO); // the quad is generated from gl_VertexID
+		shader.use();
+		shader.setInt("cache", 0);
+		shader.setInt("indirection", 1);
+	}
+
+	~VirtualTexture() {
+		close();
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteProgram(shader.program);
+		glDeleteProgram(feedback_shader.program);
+	}
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	// map a file written by buildVirtualTexture() and allocate the GPU side, the coarsest tile is uploaded right away
+	bool open(const std::string& path) {
+		close();
+		if (!file.open(path) || !readHeader()) {
+			std::cout << "ERROR::VTEX::INVALID_FILE: " << path << std::endl;
+			file.close();
+			return false;
+		}
+		GLenum compressed_format = header.format == VTEX_RGBA8 ? 0 : ktx2GLFormat(ktx2VkFormat(vtexBlockFormat(header.format)));
+		if (compressed_format != 0 && !ktx2FormatSupported(ktx2VkFormat(vtexBlockFormat(header.format)))) {
+			std::cout << "ERROR::VTEX::FORMAT_NOT_SUPPORTED: " << path << std::endl;
+			file.close();
+			return false;
+		}
+		upload_format = compressed_format;
+		page_size = (int)(header.tile_size + 2 * header.border);
+		cache_size = cache_pages * page_size;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &cache);
+		glTextureStorage2D(cache, 1, compressed_format != 0 ? compressed_format : GL_RGBA8, cache_size, cache_size);
+		glTextureParameteri(cache, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(cache, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(cache, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(cache, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		// a power of two side gives every level of the pyramid a mip level of at least its tile count
+		int side = 1 << (levels.size() - 1);
+		glCreateTextures(GL_TEXTURE_2D, 1, &indirection);
+		glTextureStorage2D(indirection, (GLsizei)levels.size(), GL_RGBA8UI, side, side);
+		glTextureParameteri(indirection, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(indirection, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		size_t staging_bytes = STAGING_SEGMENTS * uploads_per_frame * header.tile_bytes;
+		glCreateBuffers(1, &staging);
+		glNamedBufferStorage(staging, staging_bytes, NULL, flags);
+		staging_memory = (unsigned char*)glMapNamedBufferRange(staging, 0, staging_bytes, flags);
+
+		pages.assign((size_t)cache_pages * cache_pages, Page());
+		tile_pages.resize(levels.size());
+		entries.resize(levels.size());
+		for (size_t l = 0; l < levels.size(); l++) {
+			tile_pages[l].assign((size_t)levels[l].tiles_x * levels[l].tiles_y, -1);
+			entries[l].assign(tile_pages[l].size() * 4, 0);
+		}
+		statistics = VirtualTextureStats();
+		statistics.pages = pages.size();
+		statistics.virtual_bytes = (size_t)(levels.back().first_tile + 1) * header.tile_bytes;
+		statistics.gpu_bytes = (size_t)cache_pages * cache_pages * header.tile_bytes + (size_t)side * side * 4 * 4 / 3 + staging_bytes;
+
+		// the root tile never leaves, every texel falls back to it
+		pages[0].pinned = true;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		placeTile(0, tileKey((uint32_t)levels.size() - 1, 0, 0), tileData(tileKey((uint32_t)levels.size() - 1, 0, 0)));
+		updateIndirection(); // the root's rectangle covers every level
+		return true;
+	}
+
+	void close() {
+		if (!file.data())
+			return;
+		// prefetch jobs read the mapping, let them finish first
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			prefetch_finished.wait(lock, [this] { return prefetching == 0; });
+			ready.clear();
+		}
+		in_flight.clear();
+		changed_tiles.clear();
+		for (GLsync& fence : staging_fences)
+			if (fence != nullptr) {
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+		for (GLsync& fence : feedback_fences)
+			if (fence != nullptr) {
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+		feedback_pending = 0;
+		glUnmapNamedBuffer(staging);
+		glDeleteBuffers(1, &staging);
+		glDeleteBuffers((GLsizei)feedback_pbos.size(), feedback_pbos.data());
+		std::fill(feedback_pbos.begin(), feedback_pbos.end(), 0);
+		glDeleteFramebuffers(1, &feedback_framebuffer);
+		glDeleteRenderbuffers(1, &feedback_color);
+		feedback_framebuffer = feedback_color = 0;
+		feedback_width = feedback_height = 0;
+		glDeleteTextures(1, &cache);
+		glDeleteTextures(1, &indirection);
+		file.close();
+	}
+
+	bool isOpen() const {
+		return file.data() != nullptr;
+	}
+
+	int width() const {
+		return (int)header.width;
+	}
+
+	int height() const {
+		return (int)header.height;
+	}
+
+	// draw the image into a 1 / feedback_divisor sized target and queue its readback, 'rect' is the quad passed to draw()
+	// call once per frame, before or after draw(), with the size of the viewport draw() renders into
+	void renderFeedback(int viewport_width, int viewport_height, const float* rect) {
+		if (!isOpen())
+			return;
+		int width = std::max(1, (viewport_width + feedback_divisor - 1) / feedback_divisor);
+		int height = std::max(1, (viewport_height + feedback_divisor - 1) / feedback_divisor);
+		if (width != feedback_width || height != feedback_height)
+			resizeFeedback(width, height);
+		if (feedback_pending == FEEDBACK_RING)
+			return; // the GPU is more than a ring behind, skip this frame's feedback
+
+		GLint previous_framebuffer, previous_viewport[4];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+		glGetIntegerv(GL_VIEWPORT, previous_viewport);
+		glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer);
+		glViewport(0, 0, width, height);
+		const GLuint nothing[4] = { 0, 0, 0, 0 };
+		glClearNamedFramebufferuiv(feedback_framebuffer, GL_COLOR, 0, nothing);
+
+		// shift the quad by a different fraction of a feedback pixel every frame, tiles narrower than a feedback
+		// pixel on screen still get sampled within a few frames
+		int jitter = (int)(feedback_frames++ % (feedback_divisor * feedback_divisor));
+		float jittered[4] = {
+			rect[0] + ((jitter % feedback_divisor + 0.5f) / feedback_divisor - 0.5f) * 2.0f / width,
+			rect[1] + ((jitter / feedback_divisor + 0.5f) / feedback_divisor - 0.5f) * 2.0f / height,
+			rect[2], rect[3] };
+		feedback_shader.use();
+		setUniforms(feedback_shader, jittered, -std::log2((float)feedback_divisor));
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_pbos[feedback_write]);
+		glReadPixels(0, 0, width, height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		feedback_fences[feedback_write] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		feedback_write = (feedback_write + 1) % FEEDBACK_RING;
+		feedback_pending++;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+		glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+	}
+
+	// draw the image as a quad covering 'rect' (x, y, width, height in normalized device coordinates)
+	void draw(const float* rect) {
+		if (!isOpen())
+			return;
+		shader.use();
+		setUniforms(shader, rect, 0.0f);
+		shader.setFloat("border", (float)header.border);
+		shader.setFloat("page_size", (float)page_size);
+		shader.setFloat("cache_size", (float)cache_size);
+		glBindTextureUnit(0, cache);
+		glBindTextureUnit(1, indirection);
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	// read back finished feedback, request missing tiles and upload the ones that arrived, call once per frame
+	void update() {
+		if (!isOpen())
+			return;
+		frame++;
+		while (feedback_pending > 0) {
+			GLsync& fence = feedback_fences[feedback_read];
+			GLenum status = glClientWaitSync(fence, 0, 0);
+			if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+				break;
+			glDeleteSync(fence);
+			fence = nullptr;
+			size_t bytes = (size_t)feedback_width * feedback_height * 8;
+			const uint16_t* texels = (const uint16_t*)glMapNamedBufferRange(feedback_pbos[feedback_read], 0, bytes, GL_MAP_READ_BIT);
+			if (texels != NULL) {
+				readFeedback(texels, (size_t)feedback_width * feedback_height);
+				glUnmapNamedBuffer(feedback_pbos[feedback_read]);
+			}
+			feedback_read = (feedback_read + 1) % FEEDBACK_RING;
+			feedback_pending--;
+		}
+		uploadReady();
+	}
+
+	VirtualTextureStats stats() const {
+		VirtualTextureStats result = statistics;
+		result.resident = 0;
+		for (const Page& page : pages)
+			result.resident += page.key != NO_TILE;
+		return result;
+	}
+
+	void printStats() const {
+		VirtualTextureStats current = stats();
+		std::cout << "\nVirtual texture stats:" << std::endl
+			<< "\tImage          : " << header.width << "x" << header.height << ", " << levels.size() << " levels" << std::endl
+			<< "\tResident tiles : " << current.resident << " / " << current.pages << " pages" << std::endl
+			<< "\tStreamed       : " << current.streamed << " (" << current.evicted << " evicted, " << current.dropped << " dropped)" << std::endl
+			<< "\tGPU memory     : " << current.gpu_bytes / 1024 << " KB for a " << current.virtual_bytes / 1024 << " KB pyramid" << std::endl;
+	}
+
+private:
+	static const size_t STAGING_SEGMENTS = 3;
+	static const size_t FEEDBACK_RING = 3;
+	static const uint64_t NO_TILE = ~0ull;
+
+	struct Page {
+		uint64_t key = NO_TILE;
+		uint64_t last_used = 0; // frame of the last feedback that asked for the tile
+		bool pinned = false;
+	};
+
+	JobSystem& jobs;
+	int cache_pages, uploads_per_frame, feedback_divisor;
+	Shader shader, feedback_shader;
+	unsigned int VAO;
+
+	MappedFile file;
+	VirtualTextureHeader header = {};
+	std::vector<VirtualTextureLevel> levels;
+	int page_size = 0, cache_size = 0;
+	GLenum upload_format = 0; // 0 for RGBA8 tiles
+
+	unsigned int cache = 0, indirection = 0;
+	std::vector<Page> pages;
+	std::vector<std::vector<int>> tile_pages;         // per level, page of every tile or -1
+	std::vector<std::vector<unsigned char>> entries;  // per level, CPU copy of the indirection texels
+	std::vector<uint64_t> changed_tiles;              // placed or evicted since the last updateIndirection()
+	uint64_t frame = 0, feedback_frame = 0;
+
+	unsigned int staging = 0;
+	unsigned char* staging_memory = nullptr;
+	std::vector<GLsync> staging_fences;
+	size_t segment = 0;
+
+	unsigned int feedback_framebuffer = 0, feedback_color = 0;
+	int feedback_width = 0, feedback_height = 0;
+	std::vector<unsigned int> feedback_pbos;
+	std::vector<GLsync> feedback_fences;
+	size_t feedback_write = 0, feedback_read = 0, feedback_pending = 0;
+	uint64_t feedback_frames = 0;
+
+	std::unordered_set<uint64_t> in_flight; // requested tiles not uploaded yet, render thread only
+	std::mutex mutex;
+	std::condition_variable prefetch_finished;
+	std::vector<uint64_t> ready; // prefetched by workers
+	size_t prefetching = 0;
+
+	VirtualTextureStats statistics;
+
+	// coarser levels sort first
+	static uint64_t tileKey(uint32_t level, uint32_t x, uint32_t y) {
+		return (uint64_t)level << 48 | (uint64_t)y << 24 | x;
+	}
+
+	static uint32_t keyLevel(uint64_t key) {
+		return (uint32_t)(key >> 48);
+	}
+
+	static uint32_t keyX(uint64_t key) {
+		return (uint32_t)(key & 0xFFFFFF);
+	}
+
+	static uint32_t keyY(uint64_t key) {
+		return (uint32_t)(key >> 24 & 0xFFFFFF);
+	}
+
+	size_t tileIndex(uint64_t key) const {
+		return (size_t)keyY(key) * levels[keyLevel(key)].tiles_x + keyX(key);
+	}
+
+	const unsigned char* tileData(uint64_t key) const {
+		return file.data() + header.tiles_offset + (levels[keyLevel(key)].first_tile + tileIndex(key)) * header.tile_bytes;
+	}
+
+	bool readHeader() {
+		if (file.size() < sizeof(header))
+			return false;
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, VTEX_MAGIC, sizeof(VTEX_MAGIC)) != 0 || header.version != VTEX_VERSION || header.format > VTEX_BC7
+			|| header.width == 0 || header.height == 0 || header.tile_size == 0 || (header.tile_size + 2 * header.border) % 4 != 0 || header.level_count == 0 || header.level_count > 24
+			|| header.tile_bytes != vtexTileBytes(header.format, (int)(header.tile_size + 2 * header.border)))
+			return false;
+		// the table has to be the one the tiler writes for that size, which also bounds every tile index
+		levels = vtexLevels(header.width, header.height, header.tile_size);
+		if (levels.size() != header.level_count || file.size() < sizeof(header) + levels.size() * sizeof(VirtualTextureLevel)
+			|| std::memcmp(levels.data(), file.data() + sizeof(header), levels.size() * sizeof(VirtualTextureLevel)) != 0)
+			return false;
+		uint64_t tiles = levels.back().first_tile + 1;
+		return header.tiles_offset <= file.size() && tiles <= (file.size() - header.tiles_offset) / header.tile_bytes;
+	}
+
+	void resizeFeedback(int width, int height) {
+		for (GLsync& fence : feedback_fences)
+			if (fence != nullptr) {
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+		feedback_pending = feedback_write = feedback_read = 0;
+		glDeleteBuffers((GLsizei)feedback_pbos.size(), feedback_pbos.data());
+		glDeleteFramebuffers(1, &feedback_framebuffer);
+		glDeleteRenderbuffers(1, &feedback_color);
+
+		feedback_width = width;
+		feedback_height = height;
+		glCreateRenderbuffers(1, &feedback_color);
+		glNamedRenderbufferStorage(feedback_color, GL_RGBA16UI, width, height);
+		glCreateFramebuffers(1, &feedback_framebuffer);
+		glNamedFramebufferRenderbuffer(feedback_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedback_color);
+		glCreateBuffers((GLsizei)feedback_pbos.size(), feedback_pbos.data());
+		for (unsigned int pbo : feedback_pbos)
+			glNamedBufferStorage(pbo, (size_t)width * height * 8, NULL, GL_MAP_READ_BIT);
+		statistics.gpu_bytes += (size_t)width * height * 8 * (1 + FEEDBACK_RING);
+	}
+
+	void setUniforms(Shader& program, const float* rect, float lod_bias) const {
+		program.setVec4("rect", rect);
+		program.setVec2("image_size", (float)header.width, (float)header.height);
+		program.setFloat("tile_size", (float)header.tile_size);
+		program.setInt("max_level", (int)levels.size() - 1);
+		program.setFloat("lod_bias", lod_bias);
+	}
+
+	// mark what the view uses as recently used and request what it misses, coarse tiles first
+	void readFeedback(const uint16_t* texels, size_t count) {
+		feedback_frame = frame;
+		std::vector<uint64_t> wanted;
+		for (size_t i = 0; i < count; i++) {
+			const uint16_t* texel = texels + i * 4;
+			if (texel[3] != 0 && texel[2] < levels.size())
+				wanted.push_back(tileKey(texel[2], texel[0], texel[1]));
+		}
+		// every ancestor as well, they are what the view falls back to while finer tiles stream in
+		std::sort(wanted.begin(), wanted.end());
+		wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+		size_t visible = wanted.size();
+		for (size_t i = 0; i < visible; i++)
+			for (uint64_t key = wanted[i]; keyLevel(key) + 1 < levels.size();) {
+				key = tileKey(keyLevel(key) + 1, keyX(key) / 2, keyY(key) / 2);
+				wanted.push_back(key);
+			}
+		std::sort(wanted.begin(), wanted.end(), std::greater<uint64_t>());
+		wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+		statistics.missing = 0;
+		std::vector<uint64_t> missing;
+		for (uint64_t key : wanted) {
+			if (keyX(key) >= levels[keyLevel(key)].tiles_x || keyY(key) >= levels[keyLevel(key)].tiles_y)
+				continue;
+			int page = tile_pages[keyLevel(key)][tileIndex(key)];
+			if (page >= 0)
+				pages[page].last_used = frame;
+			else {
+				statistics.missing++;
+				if (in_flight.count(key) == 0)
+					missing.push_back(key);
+			}
+		}
+
+		// never fetch more than the pages the view can spare, a view that needs more than the cache holds stays at
+		// coarser levels instead of evicting its own tiles in a loop
+		size_t spare = 0;
+		for (const Page& page : pages)
+			spare += !page.pinned && (page.key == NO_TILE || page.last_used < frame);
+		spare = spare > in_flight.size() ? spare - in_flight.size() : 0;
+		size_t limit = std::min(spare, (size_t)uploads_per_frame * 4 - std::min(in_flight.size(), (size_t)uploads_per_frame * 4));
+		for (size_t i = 0; i < missing.size() && i < limit; i++)
+			prefetch(missing[i]);
+	}
+
+	// touch the tile's bytes on a worker, a tile that is not in the page cache yet is read from disk there and not
+	// in the middle of a frame
+	void prefetch(uint64_t key) {
+		in_flight.insert(key);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			prefetching++;
+		}
+		const unsigned char* data = tileData(key);
+		size_t bytes = header.tile_bytes;
+		jobs.submit([this, key, data, bytes]() {
+			volatile unsigned char sink = 0;
+			for (size_t offset = 0; offset < bytes; offset += 4096)
+				sink = sink + data[offset];
+			sink = sink + data[bytes - 1];
+
+			std::lock_guard<std::mutex> lock(mutex);
+			ready.push_back(key);
+			if (--prefetching == 0)
+				prefetch_finished.notify_all();
+		});
+	}
+
+	// page for a new tile, a free one or the least recently used tile the last feedback did not ask for, -1 when none
+	int findPage() const {
+		int best = -1;
+		for (int i = 0; i < (int)pages.size(); i++) {
+			const Page& page = pages[i];
+			if (page.pinned)
+				continue;
+			if (page.key == NO_TILE)
+				return i;
+			if (page.last_used < feedback_frame && (best < 0 || page.last_used < pages[best].last_used))
+				best = i;
+		}
+		return best;
+	}
+
+	void uploadReady() {
+		std::vector<uint64_t> arrived;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			size_t count = std::min(ready.size(), (size_t)uploads_per_frame);
+			arrived.assign(ready.begin(), ready.begin() + count);
+			ready.erase(ready.begin(), ready.begin() + count);
+		}
+		if (arrived.empty())
+			return;
+
+		// same staging scheme as the texture loader, one segment per frame in flight
+		segment = (segment + 1) % STAGING_SEGMENTS;
+		if (staging_fences[segment] != nullptr) {
+			glClientWaitSync(staging_fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(staging_fences[segment]);
+			staging_fences[segment] = nullptr;
+		}
+		size_t offset = segment * uploads_per_frame * header.tile_bytes;
+		bool placed = false;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+		for (uint64_t key : arrived) {
+			in_flight.erase(key);
+			if (tile_pages[keyLevel(key)][tileIndex(key)] >= 0)
+				continue;
+			int page = findPage();
+			if (page < 0) {
+				statistics.dropped++;
+				continue;
+			}
+			std::memcpy(staging_memory + offset, tileData(key), header.tile_bytes);
+			placeTile(page, key, (const void*)offset);
+			offset += header.tile_bytes;
+			placed = true;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		staging_fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		if (placed)
+			updateIndirection();
+	}
+
+	// upload a tile into a page, evicting whatever was there, 'pixels' follows the unpack buffer binding
+	void placeTile(int page, uint64_t key, const void* pixels) {
+		Page& slot = pages[page];
+		if (slot.key != NO_TILE) {
+			tile_pages[keyLevel(slot.key)][tileIndex(slot.key)] = -1;
+			changed_tiles.push_back(slot.key);
+			statistics.evicted++;
+		}
+		slot.key = key;
+		slot.last_used = frame;
+		tile_pages[keyLevel(key)][tileIndex(key)] = page;
+		changed_tiles.push_back(key);
+		statistics.streamed++;
+
+		int x = page % cache_pages * page_size, y = page / cache_pages * page_size;
+		if (upload_format != 0)
+			glCompressedTextureSubImage2D(cache, 0, x, y, page_size, page_size, upload_format, (GLsizei)header.tile_bytes, pixels);
+		else
+			glTextureSubImage2D(cache, 0, x, y, page_size, page_size, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	// the tiles placed or evicted since the last update point at their own page or inherit their parent's entry, and so
+	// does every finer tile under them without a page of its own. only those rectangles are written and uploaded, a finer
+	// level where every tile of the rectangle has its own page ends the walk down
+	void updateIndirection() {
+		std::sort(changed_tiles.begin(), changed_tiles.end(), std::greater<uint64_t>());
+		changed_tiles.erase(std::unique(changed_tiles.begin(), changed_tiles.end()), changed_tiles.end());
+		for (uint64_t key : changed_tiles) {
+			uint32_t x0 = keyX(key), y0 = keyY(key), x1 = x0 + 1, y1 = y0 + 1;
+			for (size_t l = keyLevel(key) + 1; l-- > 0;) {
+				const VirtualTextureLevel& level = levels[l];
+				x1 = std::min(x1, level.tiles_x);
+				y1 = std::min(y1, level.tiles_y);
+				bool inherited = l == keyLevel(key); // the children of the tile itself always follow it
+				for (uint32_t y = y0; y < y1; y++)
+					for (uint32_t x = x0; x < x1; x++) {
+						size_t index = (size_t)y * level.tiles_x + x;
+						unsigned char* entry = &entries[l][index * 4];
+						int page = tile_pages[l][index];
+						if (page >= 0) {
+							entry[0] = (unsigned char)(page % cache_pages);
+							entry[1] = (unsigned char)(page / cache_pages);
+							entry[2] = (unsigned char)l;
+							entry[3] = 1;
+						}
+						else {
+							std::memcpy(entry, &entries[l + 1][((size_t)(y / 2) * levels[l + 1].tiles_x + x / 2) * 4], 4);
+							inherited = true;
+						}
+					}
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)level.tiles_x);
+				glTextureSubImage2D(indirection, (GLint)l, x0, y0, x1 - x0, y1 - y0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+					&entries[l][((size_t)y0 * level.tiles_x + x0) * 4]);
+				if (!inherited)
+					break;
+				x0 *= 2;
+				y0 *= 2;
+				x1 *= 2;
+				y1 *= 2;
+			}
+		}
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		changed_tiles.clear();
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+// allocation counter defined here
+// counts what the calling thread allocates through the global operator new between startAllocationCount() and
+// stopAllocationCount(), so a loop can be shown to allocate nothing once it is warm (main.cpp, '--check-allocations').
+// std containers, std::string, std::function and make_unique all end up in operator new
+//
+// the replacement operators are compiled into the one translation unit that defines ALLOCATION_COUNTER_IMPLEMENTATION
+// before including this, the way stb_image is built. plain malloc() is not counted, it cannot be replaced portably and
+// what the GL driver and glfw malloc is not the render loop's to fix
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+struct AllocationCount {
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+};
+
+// per thread, so worker threads and the driver's own threads do not show up in the render thread's count
+inline thread_local bool allocation_counting = false;
+inline thread_local AllocationCount allocation_count;
+
+inline void startAllocationCount() {
+	allocation_count = AllocationCount();
+	allocation_counting = true;
+}
+
+inline AllocationCount stopAllocationCount() {
+	allocation_counting = false;
+	return allocation_count;
+}
+
+#ifdef ALLOCATION_COUNTER_IMPLEMENTATION
+
+inline void* countedAllocate(std::size_t size, std::size_t alignment) {
+	if (allocation_counting) {
+		allocation_count.allocations++;
+		allocation_count.bytes += size;
+	}
+	if (size == 0)
+		size = 1;
+	if (alignment <= alignof(std::max_align_t))
+		return std::malloc(size);
+#if defined(_MSC_VER)
+	return _aligned_malloc(size, alignment);
+#else
+	void* memory = nullptr;
+	return posix_memalign(&memory, alignment, size) == 0 ? memory : nullptr;
+#endif
+}
+
+// gcc sees std::free() inlined into the replacement operator delete and reports a mismatched new/delete pair, the
+// operators below allocate with malloc() themselves so the pairing is correct
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+inline void countedFree(void* memory, std::size_t alignment) {
+#if defined(_MSC_VER)
+	if (alignment > alignof(std::max_align_t)) {
+		_aligned_free(memory);
+		return;
+	}
+#endif
+	(void)alignment;
+	std::free(memory);
+}
+
+inline void* countedAllocateOrThrow(std::size_t size, std::size_t alignment) {
+	void* memory = countedAllocate(size, alignment);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(std::size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new[](std::size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocateOrThrow(size, (std::size_t)alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocateOrThrow(size, (std::size_t)alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, (std::size_t)alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, (std::size_t)alignment); }
+
+void operator delete(void* memory) noexcept { countedFree(memory, 0); }
+void operator delete[](void* memory) noexcept { countedFree(memory, 0); }
+void operator delete(void* memory, std::size_t) noexcept { countedFree(memory, 0); }
+void operator delete[](void* memory, std::size_t) noexcept { countedFree(memory, 0); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { countedFree(memory, 0); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { countedFree(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { countedFree(memory, (std::size_t)alignment); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { countedFree(memory, (std::size_t)alignment); }
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept { countedFree(memory, (std::size_t)alignment); }
+void operator delete[](void* memory, std::size_t, std::align_val_t alignment) noexcept { countedFree(memory, (std::size_t)alignment); }
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { countedFree(memory, (std::size_t)alignment); }
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { countedFree(memory, (std::size_t)alignment); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,516 @@
+#pragma once
+// batch math kernels defined here
+// the per object math of a frame over whole arrays instead of one glm call at a time: a shared matrix times many
+// matrices (view projection times every model), many vec4 and points through one matrix, the world bounds of many boxes
+// under their own model matrices, and the bounds of a point cloud
+//
+// every kernel has a scalar reference written with glm and an AVX2 version, the fastest exact set the CPU supports is
+// picked once at startup (see mathKernels()). the AVX2 kernels multiply and add in the order glm does, a matrix times a
+// vector as (c0 x + c1 y) + (c2 z + c3 w) and each column of a matrix product as ((a0 b0 + a1 b1) + a2 b2) + a3 b3, so
+// they return glm's results bit for bit as long as glm itself is not compiled with fused multiply adds (the default for
+// x86-64 builds of GCC, clang and MSVC). the FMA level fuses every multiply add, faster and no less accurate, but a few
+// ulp away from glm, so it is only used when setMathLevel() asks for it
+//
+// points go eight to a register in SoA form, the x of eight points in one register and y, z in two more.
+// transformPointsSoA() takes separate x, y and z arrays as they are, transformPoints() transposes PackedVec3 arrays on
+// the way in and out. points and boxes are PackedVec3, three floats, in every build: the GLM SIMD configuration
+// (GLM_FORCE_DEFAULT_ALIGNED_GENTYPES) pads glm::vec3 to four
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define MATH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MATH_TARGET(isa) // msvc accepts every intrinsic without a flag
+#else
+#define MATH_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+enum class MathLevel {
+	Scalar,
+	AVX2,
+	FMA, // AVX2 with fused multiply adds, not bit exact against glm
+};
+
+inline const char* mathLevelName(MathLevel level) {
+	switch (level) {
+	case MathLevel::AVX2: return "AVX2";
+	case MathLevel::FMA: return "AVX2+FMA";
+	default: return "scalar";
+	}
+}
+
+inline bool mathLevelSupported(MathLevel level) {
+	if (level == MathLevel::Scalar)
+		return true;
+#if defined(MATH_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 1);
+	bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	__cpuidex(info, 7, 0);
+	bool avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+#else
+	bool avx2 = __builtin_cpu_supports("avx2");
+	bool fma = __builtin_cpu_supports("fma");
+#endif
+	return level == MathLevel::AVX2 ? avx2 : avx2 && fma;
+#else
+	return false;
+#endif
+}
+
+// best level that still agrees with glm exactly
+inline MathLevel detectMathLevel() {
+	return mathLevelSupported(MathLevel::AVX2) ? MathLevel::AVX2 : MathLevel::Scalar;
+}
+
+typedef glm::vec<3, float, glm::packed_highp> PackedVec3;
+
+struct Aabb {
+	PackedVec3 min;
+	PackedVec3 max;
+};
+
+static_assert(sizeof(PackedVec3) == 12 && sizeof(Aabb) == 24, "points and boxes are tightly packed");
+
+// scalar reference, glm one element at a time
+
+inline void multiplyMatricesScalar(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		out[i] = left * right[i];
+}
+
+inline void transformVectorsScalar(const glm::mat4& matrix, const glm::vec4* in, glm::vec4* out, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		out[i] = matrix * in[i];
+}
+
+inline void transformPointsScalar(const glm::mat4& matrix, const PackedVec3* in, PackedVec3* out, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		out[i] = PackedVec3(matrix * glm::vec4(in[i], 1.0f));
+}
+
+inline void transformPointsSoAScalar(const glm::mat4& matrix, const float* x, const float* y, const float* z,
+	float* out_x, float* out_y, float* out_z, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		glm::vec4 point = matrix * glm::vec4(x[i], y[i], z[i], 1.0f);
+		out_x[i] = point.x;
+		out_y[i] = point.y;
+		out_z[i] = point.z;
+	}
+}
+
+// the box around 'box' once 'matrix' has moved it, from its center and half extent
+inline Aabb transformAabb(const glm::mat4& matrix, const Aabb& box) {
+	PackedVec3 center = (box.min + box.max) * 0.5f;
+	PackedVec3 extent = (box.max - box.min) * 0.5f;
+	glm::vec3 world_center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+	glm::mat3 absolute(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+	glm::vec3 world_extent = absolute * glm::vec3(extent);
+	return { PackedVec3(world_center - world_extent), PackedVec3(world_center + world_extent) };
+}
+
+inline void transformAabbsScalar(const glm::mat4* matrices, const Aabb* in, Aabb* out, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		out[i] = transformAabb(matrices[i], in[i]);
+}
+
+inline Aabb computeBoundsScalar(const PackedVec3* points, size_t count) {
+	Aabb bounds = { PackedVec3(0.0f), PackedVec3(0.0f) };
+	if (count > 0)
+		bounds = { points[0], points[0] };
+	for (size_t i = 1; i < count; i++) {
+		bounds.min = glm::min(bounds.min, points[i]);
+		bounds.max = glm::max(bounds.max, points[i]);
+	}
+	return bounds;
+}
+
+// AVX2, the exact kernels are built without FMA so the compiler cannot fuse their multiplies and adds either
+
+#if defined(MATH_X86)
+
+// eight interleaved points to x, y and z registers and back, three loads or stores, blends and lane permutes each way
+MATH_TARGET("avx2")
+inline void loadPoints8(const float* points, __m256& x, __m256& y, __m256& z) {
+	__m256 a = _mm256_loadu_ps(points);
+	__m256 b = _mm256_loadu_ps(points + 8);
+	__m256 c = _mm256_loadu_ps(points + 16);
+	__m256 tx = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x92), c, 0x24); // x0 x3 x6 x1 x4 x7 x2 x5
+	__m256 ty = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x24), c, 0x49); // y5 y0 y3 y6 y1 y4 y7 y2
+	__m256 tz = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x49), c, 0x92); // z2 z5 z0 z3 z6 z1 z4 z7
+	x = _mm256_permutevar8x32_ps(tx, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+	y = _mm256_permutevar8x32_ps(ty, _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+	z = _mm256_permutevar8x32_ps(tz, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+}
+
+MATH_TARGET("avx2")
+inline void storePoints8(float* points, __m256 x, __m256 y, __m256 z) {
+	__m256 tx = _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+	__m256 ty = _mm256_permutevar8x32_ps(y, _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2));
+	__m256 tz = _mm256_permutevar8x32_ps(z, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+	_mm256_storeu_ps(points, _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x92), tz, 0x24));
+	_mm256_storeu_ps(points + 8, _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x24), tz, 0x49));
+	_mm256_storeu_ps(points + 16, _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x49), tz, 0x92));
+}
+
+// one glm::vec4 column in both halves of a register
+MATH_TARGET("avx2")
+inline __m256 broadcastColumn(const glm::vec4& column) {
+	return _mm256_broadcast_ps((const __m128*)&column[0]);
+}
+
+// two glm::vec4 columns, one per half
+MATH_TARGET("avx2")
+inline __m256 loadColumns(const glm::vec4& low, const glm::vec4& high) {
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&low[0])), _mm_loadu_ps(&high[0]), 1);
+}
+
+// glm::abs(), which keeps the sign of -0 and flips NaN, where clearing the sign bit would not
+MATH_TARGET("avx2")
+inline __m256 glmAbs(__m256 value) {
+	__m256 negated = _mm256_xor_ps(value, _mm256_set1_ps(-0.0f));
+	return _mm256_blendv_ps(negated, value, _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+
+// x, y and z lanes of a box corner, the fourth is never touched
+MATH_TARGET("avx2")
+inline __m256 loadVec3Pair(const PackedVec3& low, const PackedVec3& high) {
+	__m128i mask = _mm_setr_epi32(-1, -1, -1, 0);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_maskload_ps(&low[0], mask)), _mm_maskload_ps(&high[0], mask), 1);
+}
+
+MATH_TARGET("avx2")
+inline void storeVec3Pair(PackedVec3& low, PackedVec3& high, __m256 value) {
+	__m128i mask = _mm_setr_epi32(-1, -1, -1, 0);
+	_mm_maskstore_ps(&low[0], mask, _mm256_castps256_ps128(value));
+	_mm_maskstore_ps(&high[0], mask, _mm256_extractf128_ps(value, 1));
+}
+
+MATH_TARGET("avx2")
+inline void multiplyMatricesAVX2(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+	__m256 a0 = broadcastColumn(left[0]), a1 = broadcastColumn(left[1]), a2 = broadcastColumn(left[2]), a3 = broadcastColumn(left[3]);
+	for (size_t i = 0; i < count; i++) {
+		const float* b = &right[i][0][0];
+		float* result = &out[i][0][0];
+		for (int half = 0; half < 2; half++) {
+			__m256 columns = _mm256_loadu_ps(b + half * 8); // two columns of the right matrix
+			__m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(columns, 0x00));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(a1, _mm256_permute_ps(columns, 0x55)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(a2, _mm256_permute_ps(columns, 0xAA)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(a3, _mm256_permute_ps(columns, 0xFF)));
+			_mm256_storeu_ps(result + half * 8, sum);
+		}
+	}
+}
+
+MATH_TARGET("avx2")
+inline void transformVectorsAVX2(const glm::mat4& matrix, const glm::vec4* in, glm::vec4* out, size_t count) {
+	__m256 c0 = broadcastColumn(matrix[0]), c1 = broadcastColumn(matrix[1]), c2 = broadcastColumn(matrix[2]), c3 = broadcastColumn(matrix[3]);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m256 v = _mm256_loadu_ps(&in[i][0]);
+		__m256 low = _mm256_add_ps(_mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00)), _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55)));
+		__m256 high = _mm256_add_ps(_mm256_mul_ps(c2, _mm256_permute_ps(v, 0xAA)), _mm256_mul_ps(c3, _mm256_permute_ps(v, 0xFF)));
+		_mm256_storeu_ps(&out[i][0], _mm256_add_ps(low, high));
+	}
+	transformVectorsScalar(matrix, in + i, out + i, count - i);
+}
+
+MATH_TARGET("avx2")
+inline void transformPointsSoAAVX2(const glm::mat4& matrix, const float* x, const float* y, const float* z,
+	float* out_x, float* out_y, float* out_z, size_t count) {
+	__m256 m[4][3];
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 3; r++)
+			m[c][r] = _mm256_set1_ps(matrix[c][r]);
+	float* out[3] = { out_x, out_y, out_z };
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+		for (int r = 0; r < 3; r++) {
+			__m256 low = _mm256_add_ps(_mm256_mul_ps(m[0][r], px), _mm256_mul_ps(m[1][r], py));
+			__m256 high = _mm256_add_ps(_mm256_mul_ps(m[2][r], pz), m[3][r]); // w is 1
+			_mm256_storeu_ps(out[r] + i, _mm256_add_ps(low, high));
+		}
+	}
+	transformPointsSoAScalar(matrix, x + i, y + i, z + i, out_x + i, out_y + i, out_z + i, count - i);
+}
+
+MATH_TARGET("avx2")
+inline void transformPointsAVX2(const glm::mat4& matrix, const PackedVec3* in, PackedVec3* out, size_t count) {
+	__m256 m[4][3];
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 3; r++)
+			m[c][r] = _mm256_set1_ps(matrix[c][r]);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 p[3], result[3];
+		loadPoints8(&in[i][0], p[0], p[1], p[2]);
+		for (int r = 0; r < 3; r++) {
+			__m256 low = _mm256_add_ps(_mm256_mul_ps(m[0][r], p[0]), _mm256_mul_ps(m[1][r], p[1]));
+			__m256 high = _mm256_add_ps(_mm256_mul_ps(m[2][r], p[2]), m[3][r]);
+			result[r] = _mm256_add_ps(low, high);
+		}
+		storePoints8(&out[i][0], result[0], result[1], result[2]);
+	}
+	transformPointsScalar(matrix, in + i, out + i, count - i);
+}
+
+// two boxes at a time, one per half with its own matrix
+MATH_TARGET("avx2")
+inline void transformAabbsAVX2(const glm::mat4* matrices, const Aabb* in, Aabb* out, size_t count) {
+	__m256 half = _mm256_set1_ps(0.5f);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		const glm::mat4& m0 = matrices[i];
+		const glm::mat4& m1 = matrices[i + 1];
+		__m256 c0 = loadColumns(m0[0], m1[0]), c1 = loadColumns(m0[1], m1[1]), c2 = loadColumns(m0[2], m1[2]), c3 = loadColumns(m0[3], m1[3]);
+		__m256 low = loadVec3Pair(in[i].min, in[i + 1].min);
+		__m256 high = loadVec3Pair(in[i].max, in[i + 1].max);
+		__m256 center = _mm256_mul_ps(_mm256_add_ps(low, high), half);
+		__m256 extent = _mm256_mul_ps(_mm256_sub_ps(high, low), half);
+
+		__m256 world_center = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(c0, _mm256_permute_ps(center, 0x00)), _mm256_mul_ps(c1, _mm256_permute_ps(center, 0x55))),
+			_mm256_add_ps(_mm256_mul_ps(c2, _mm256_permute_ps(center, 0xAA)), c3));
+		__m256 world_extent = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(glmAbs(c0), _mm256_permute_ps(extent, 0x00)), _mm256_mul_ps(glmAbs(c1), _mm256_permute_ps(extent, 0x55))),
+			_mm256_mul_ps(glmAbs(c2), _mm256_permute_ps(extent, 0xAA)));
+		storeVec3Pair(out[i].min, out[i + 1].min, _mm256_sub_ps(world_center, world_extent));
+		storeVec3Pair(out[i].max, out[i + 1].max, _mm256_add_ps(world_center, world_extent));
+	}
+	transformAabbsScalar(matrices + i, in + i, out + i, count - i);
+}
+
+// component 'c' of the first point where it is zero, either sign. the caller knows there is one
+inline float firstZero(const PackedVec3* points, size_t count, int c) {
+	for (size_t i = 0; i < count; i++)
+		if (points[i][c] == 0.0f)
+			return points[i][c];
+	return 0.0f;
+}
+
+MATH_TARGET("avx2")
+inline Aabb computeBoundsAVX2(const PackedVec3* points, size_t count) {
+	if (count < 16)
+		return computeBoundsScalar(points, count);
+	__m256 low[3], high[3];
+	loadPoints8(&points[0][0], low[0], low[1], low[2]);
+	for (int c = 0; c < 3; c++)
+		high[c] = low[c];
+	size_t i = 8;
+	for (; i + 8 <= count; i += 8) {
+		__m256 p[3];
+		loadPoints8(&points[i][0], p[0], p[1], p[2]);
+		for (int c = 0; c < 3; c++) {
+			low[c] = _mm256_min_ps(p[c], low[c]);
+			high[c] = _mm256_max_ps(p[c], high[c]);
+		}
+	}
+	Aabb bounds = computeBoundsScalar(points + i, count - i);
+	if (i == count)
+		bounds = { points[0], points[0] };
+	float lanes[2][3][8];
+	for (int c = 0; c < 3; c++) {
+		_mm256_storeu_ps(lanes[0][c], low[c]);
+		_mm256_storeu_ps(lanes[1][c], high[c]);
+	}
+	for (int c = 0; c < 3; c++)
+		for (int l = 0; l < 8; l++) {
+			bounds.min[c] = std::min(bounds.min[c], lanes[0][c][l]);
+			bounds.max[c] = std::max(bounds.max[c], lanes[1][c][l]);
+		}
+	// the lanes meet the points in another order than one running minimum does, which only shows when -0 and 0 tie.
+	// the scalar kernel keeps the zero that comes first, so a zero bound takes its sign from the first zero point
+	for (int c = 0; c < 3; c++) {
+		if (bounds.min[c] == 0.0f)
+			bounds.min[c] = firstZero(points, count, c);
+		if (bounds.max[c] == 0.0f)
+			bounds.max[c] = firstZero(points, count, c);
+	}
+	return bounds;
+}
+
+// FMA, the same loops with every multiply add fused
+
+MATH_TARGET("avx2,fma")
+inline void multiplyMatricesFMA(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+	__m256 a0 = broadcastColumn(left[0]), a1 = broadcastColumn(left[1]), a2 = broadcastColumn(left[2]), a3 = broadcastColumn(left[3]);
+	for (size_t i = 0; i < count; i++) {
+		const float* b = &right[i][0][0];
+		float* result = &out[i][0][0];
+		for (int half = 0; half < 2; half++) {
+			__m256 columns = _mm256_loadu_ps(b + half * 8);
+			__m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(columns, 0x00));
+			sum = _mm256_fmadd_ps(a1, _mm256_permute_ps(columns, 0x55), sum);
+			sum = _mm256_fmadd_ps(a2, _mm256_permute_ps(columns, 0xAA), sum);
+			sum = _mm256_fmadd_ps(a3, _mm256_permute_ps(columns, 0xFF), sum);
+			_mm256_storeu_ps(result + half * 8, sum);
+		}
+	}
+}
+
+MATH_TARGET("avx2,fma")
+inline void transformVectorsFMA(const glm::mat4& matrix, const glm::vec4* in, glm::vec4* out, size_t count) {
+	__m256 c0 = broadcastColumn(matrix[0]), c1 = broadcastColumn(matrix[1]), c2 = broadcastColumn(matrix[2]), c3 = broadcastColumn(matrix[3]);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m256 v = _mm256_loadu_ps(&in[i][0]);
+		__m256 sum = _mm256_mul_ps(c3, _mm256_permute_ps(v, 0xFF));
+		sum = _mm256_fmadd_ps(c2, _mm256_permute_ps(v, 0xAA), sum);
+		sum = _mm256_fmadd_ps(c1, _mm256_permute_ps(v, 0x55), sum);
+		_mm256_storeu_ps(&out[i][0], _mm256_fmadd_ps(c0, _mm256_permute_ps(v, 0x00), sum));
+	}
+	transformVectorsScalar(matrix, in + i, out + i, count - i);
+}
+
+MATH_TARGET("avx2,fma")
+inline void transformPointsSoAFMA(const glm::mat4& matrix, const float* x, const float* y, const float* z,
+	float* out_x, float* out_y, float* out_z, size_t count) {
+	__m256 m[4][3];
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 3; r++)
+			m[c][r] = _mm256_set1_ps(matrix[c][r]);
+	float* out[3] = { out_x, out_y, out_z };
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+		for (int r = 0; r < 3; r++)
+			_mm256_storeu_ps(out[r] + i, _mm256_fmadd_ps(m[0][r], px, _mm256_fmadd_ps(m[1][r], py, _mm256_fmadd_ps(m[2][r], pz, m[3][r]))));
+	}
+	transformPointsSoAScalar(matrix, x + i, y + i, z + i, out_x + i, out_y + i, out_z + i, count - i);
+}
+
+MATH_TARGET("avx2,fma")
+inline void transformPointsFMA(const glm::mat4& matrix, const PackedVec3* in, PackedVec3* out, size_t count) {
+	__m256 m[4][3];
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 3; r++)
+			m[c][r] = _mm256_set1_ps(matrix[c][r]);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 p[3], result[3];
+		loadPoints8(&in[i][0], p[0], p[1], p[2]);
+		for (int r = 0; r < 3; r++)
+			result[r] = _mm256_fmadd_ps(m[0][r], p[0], _mm256_fmadd_ps(m[1][r], p[1], _mm256_fmadd_ps(m[2][r], p[2], m[3][r])));
+		storePoints8(&out[i][0], result[0], result[1], result[2]);
+	}
+	transformPointsScalar(matrix, in + i, out + i, count - i);
+}
+
+MATH_TARGET("avx2,fma")
+inline void transformAabbsFMA(const glm::mat4* matrices, const Aabb* in, Aabb* out, size_t count) {
+	__m256 half = _mm256_set1_ps(0.5f);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		const glm::mat4& m0 = matrices[i];
+		const glm::mat4& m1 = matrices[i + 1];
+		__m256 c0 = loadColumns(m0[0], m1[0]), c1 = loadColumns(m0[1], m1[1]), c2 = loadColumns(m0[2], m1[2]), c3 = loadColumns(m0[3], m1[3]);
+		__m256 low = loadVec3Pair(in[i].min, in[i + 1].min);
+		__m256 high = loadVec3Pair(in[i].max, in[i + 1].max);
+		__m256 center = _mm256_mul_ps(_mm256_add_ps(low, high), half);
+		__m256 extent = _mm256_mul_ps(_mm256_sub_ps(high, low), half);
+
+		__m256 world_center = _mm256_fmadd_ps(c0, _mm256_permute_ps(center, 0x00),
+			_mm256_fmadd_ps(c1, _mm256_permute_ps(center, 0x55), _mm256_fmadd_ps(c2, _mm256_permute_ps(center, 0xAA), c3)));
+		__m256 world_extent = _mm256_fmadd_ps(glmAbs(c0), _mm256_permute_ps(extent, 0x00),
+			_mm256_fmadd_ps(glmAbs(c1), _mm256_permute_ps(extent, 0x55), _mm256_mul_ps(glmAbs(c2), _mm256_permute_ps(extent, 0xAA))));
+		storeVec3Pair(out[i].min, out[i + 1].min, _mm256_sub_ps(world_center, world_extent));
+		storeVec3Pair(out[i].max, out[i + 1].max, _mm256_add_ps(world_center, world_extent));
+	}
+	transformAabbsScalar(matrices + i, in + i, out + i, count - i);
+}
+
+#endif
+
+// the kernel set in use, one function pointer per operation
+struct MathKernels {
+	MathLevel level = MathLevel::Scalar;
+	void (*multiplyMatrices)(const glm::mat4&, const glm::mat4*, glm::mat4*, size_t) = multiplyMatricesScalar;
+	void (*transformVectors)(const glm::mat4&, const glm::vec4*, glm::vec4*, size_t) = transformVectorsScalar;
+	void (*transformPoints)(const glm::mat4&, const PackedVec3*, PackedVec3*, size_t) = transformPointsScalar;
+	void (*transformPointsSoA)(const glm::mat4&, const float*, const float*, const float*, float*, float*, float*, size_t) = transformPointsSoAScalar;
+	void (*transformAabbs)(const glm::mat4*, const Aabb*, Aabb*, size_t) = transformAabbsScalar;
+	Aabb (*computeBounds)(const PackedVec3*, size_t) = computeBoundsScalar;
+};
+
+inline MathKernels makeMathKernels(MathLevel level) {
+	MathKernels kernels;
+	kernels.level = level;
+#if defined(MATH_X86)
+	if (level == MathLevel::AVX2) {
+		kernels.multiplyMatrices = multiplyMatricesAVX2;
+		kernels.transformVectors = transformVectorsAVX2;
+		kernels.transformPoints = transformPointsAVX2;
+		kernels.transformPointsSoA = transformPointsSoAAVX2;
+		kernels.transformAabbs = transformAabbsAVX2;
+		kernels.computeBounds = computeBoundsAVX2;
+	}
+	if (level == MathLevel::FMA) {
+		kernels.multiplyMatrices = multiplyMatricesFMA;
+		kernels.transformVectors = transformVectorsFMA;
+		kernels.transformPoints = transformPointsFMA;
+		kernels.transformPointsSoA = transformPointsSoAFMA;
+		kernels.transformAabbs = transformAabbsFMA;
+		kernels.computeBounds = computeBoundsAVX2; // min and max have nothing to fuse
+	}
+#endif
+	return kernels;
+}
+
+// kernels for the best exact level the CPU supports, picked on first use
+inline MathKernels& mathKernels() {
+	static MathKernels kernels = makeMathKernels(detectMathLevel());
+	return kernels;
+}
+
+// switch level, for benchmarks and to opt into FMA, false if the CPU cannot run 'level'
+inline bool setMathLevel(MathLevel level) {
+	if (!mathLevelSupported(level))
+		return false;
+	mathKernels() = makeMathKernels(level);
+	return true;
+}
+
+// public entry points, 'count' is always in elements and 'out' may not overlap the inputs
+
+// out[i] = left * right[i], a view projection times every model matrix say
+inline void multiplyMatrices(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+	mathKernels().multiplyMatrices(left, right, out, count);
+}
+
+// out[i] = matrix * in[i]
+inline void transformVectors(const glm::mat4& matrix, const glm::vec4* in, glm::vec4* out, size_t count) {
+	mathKernels().transformVectors(matrix, in, out, count);
+}
+
+// out[i] = PackedVec3(matrix * glm::vec4(in[i], 1.0f)), no perspective divide
+inline void transformPoints(const glm::mat4& matrix, const PackedVec3* in, PackedVec3* out, size_t count) {
+	mathKernels().transformPoints(matrix, in, out, count);
+}
+
+// transformPoints() on points kept as three arrays
+inline void transformPointsSoA(const glm::mat4& matrix, const float* x, const float* y, const float* z,
+	float* out_x, float* out_y, float* out_z, size_t count) {
+	mathKernels().transformPointsSoA(matrix, x, y, z, out_x, out_y, out_z, count);
+}
+
+// out[i] = transformAabb(matrices[i], in[i]), every box under its own matrix
+inline void transformAabbs(const glm::mat4* matrices, const Aabb* in, Aabb* out, size_t count) {
+	mathKernels().transformAabbs(matrices, in, out, count);
+}
+
+// the box around every point, all zero for none. equal to computeBoundsScalar() bit for bit, a bound of zero included
+inline Aabb computeBounds(const PackedVec3* points, size_t count) {
+	return mathKernels().computeBounds(points, count);
+}
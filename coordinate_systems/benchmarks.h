@@ -0,0 +1,1342 @@
+#pragma once
+// benchmarks defined here
+// each one prints its results, run them from the command line (see main.cpp)
+
+#include <allocation_counter.h>
+#include <batch_math.h>
+#include <camera.h>
+#include <cooked_mesh.h>
+#include <frame_arena.h>
+#include <frustum_culling.h>
+#include <gpu_culling.h>
+#include <gpu_heap.h>
+#include <job_system.h>
+#include <mesh.h>
+#include <mesh_pool.h>
+#include <mesh_optimizer.h>
+#include <shader.h>
+#include <tlsf_allocator.h>
+#include <transform_hierarchy.h>
+#include <vertex_format.h>
+#include <vertex_layout.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// a torus of rings * sides quads with positions, normals and uvs, the model the import benchmark writes when it is given
+// no files. 'emit' receives every vertex as position, normal and uv
+template <typename Emit>
+inline void generateTorus(int rings, int sides, Emit emit) {
+	const float TAU = 6.2831853f, major = 1.0f, minor = 0.35f;
+	for (int r = 0; r <= rings; r++)
+		for (int s = 0; s <= sides; s++) {
+			float u = (float)r / rings, v = (float)s / sides;
+			float cu = std::cos(u * TAU), su = std::sin(u * TAU), cv = std::cos(v * TAU), sv = std::sin(v * TAU);
+			float position[3] = { (major + minor * cv) * cu, minor * sv, (major + minor * cv) * su };
+			float normal[3] = { cv * cu, sv, cv * su };
+			float uv[2] = { u, v };
+			emit(position, normal, uv);
+		}
+}
+
+// the torus as MeshData, two triangles per quad
+inline MeshData generateTorusMesh(int rings, int sides) {
+	MeshData mesh;
+	generateTorus(rings, sides, [&](const float* p, const float* n, const float* uv) {
+		MeshVertex vertex;
+		std::memcpy(vertex.position, p, sizeof(vertex.position));
+		std::memcpy(vertex.normal, n, sizeof(vertex.normal));
+		std::memcpy(vertex.uv, uv, sizeof(vertex.uv));
+		mesh.vertices.push_back(vertex);
+	});
+	for (int r = 0; r < rings; r++)
+		for (int s = 0; s < sides; s++) {
+			uint32_t a = r * (sides + 1) + s, b = (r + 1) * (sides + 1) + s;
+			mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	mesh.has_normals = mesh.has_uvs = true;
+	computeBounds(mesh);
+	return mesh;
+}
+
+// a cube from -1 to 1 with four vertices a face, so every face has its own normal
+inline MeshData generateBoxMesh() {
+	MeshData mesh;
+	for (int axis = 0; axis < 3; axis++)
+		for (int sign = -1; sign <= 1; sign += 2) {
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			uint32_t first = (uint32_t)mesh.vertices.size();
+			for (int corner = 0; corner < 4; corner++) {
+				MeshVertex vertex = {};
+				vertex.position[axis] = (float)sign;
+				vertex.position[u] = (corner & 1) ? 1.0f : -1.0f;
+				vertex.position[v] = (corner & 2) ? 1.0f : -1.0f;
+				vertex.normal[axis] = (float)sign;
+				vertex.uv[0] = (float)(corner & 1);
+				vertex.uv[1] = (float)(corner >> 1);
+				mesh.vertices.push_back(vertex);
+			}
+			// counter clockwise seen from outside
+			if (sign > 0)
+				mesh.indices.insert(mesh.indices.end(), { first, first + 1, first + 3, first, first + 3, first + 2 });
+			else
+				mesh.indices.insert(mesh.indices.end(), { first, first + 3, first + 1, first, first + 2, first + 3 });
+		}
+	mesh.has_normals = mesh.has_uvs = true;
+	computeBounds(mesh);
+	return mesh;
+}
+
+// the torus as an obj with one quad per face, vertices shared between faces like exporters write them
+inline bool writeTorusObj(const std::string& path, int rings, int sides) {
+	std::ofstream file(path, std::ios::binary);
+	char line[128];
+	std::string text;
+	generateTorus(rings, sides, [&](const float* p, const float* n, const float* uv) {
+		text.append(line, std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", p[0], p[1], p[2]));
+		text.append(line, std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", uv[0], uv[1]));
+		text.append(line, std::snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", n[0], n[1], n[2]));
+	});
+	for (int r = 0; r < rings; r++)
+		for (int s = 0; s < sides; s++) {
+			int a = r * (sides + 1) + s + 1, b = a + sides + 1; // 1 based
+			text.append(line, std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+				a, a, a, a + 1, a + 1, a + 1, b + 1, b + 1, b + 1, b, b, b));
+		}
+	file.write(text.data(), text.size());
+	return (bool)file;
+}
+
+// the torus as a glb, one primitive with 32 bit indices
+inline bool writeTorusGlb(const std::string& path, int rings, int sides) {
+	std::vector<float> attributes[3];
+	generateTorus(rings, sides, [&](const float* p, const float* n, const float* uv) {
+		attributes[0].insert(attributes[0].end(), p, p + 3);
+		attributes[1].insert(attributes[1].end(), n, n + 3);
+		attributes[2].insert(attributes[2].end(), uv, uv + 2);
+	});
+	std::vector<uint32_t> indices;
+	for (int r = 0; r < rings; r++)
+		for (int s = 0; s < sides; s++) {
+			uint32_t a = r * (sides + 1) + s, b = a + sides + 1;
+			uint32_t quad[6] = { a, a + 1, b + 1, a, b + 1, b };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+
+	std::vector<unsigned char> binary;
+	size_t offsets[4];
+	for (int i = 0; i < 3; i++) {
+		offsets[i] = binary.size();
+		binary.insert(binary.end(), (unsigned char*)attributes[i].data(), (unsigned char*)(attributes[i].data() + attributes[i].size()));
+	}
+	offsets[3] = binary.size();
+	binary.insert(binary.end(), (unsigned char*)indices.data(), (unsigned char*)(indices.data() + indices.size()));
+	size_t vertex_count = attributes[0].size() / 3;
+	const char* types[4] = { "VEC3", "VEC3", "VEC2", "SCALAR" };
+	size_t counts[4] = { vertex_count, vertex_count, vertex_count, indices.size() };
+	size_t lengths[4] = { offsets[1] - offsets[0], offsets[2] - offsets[1], offsets[3] - offsets[2], binary.size() - offsets[3] };
+
+	std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+		"\"buffers\":[{\"byteLength\":" + std::to_string(binary.size()) + "}],\"bufferViews\":[";
+	for (int i = 0; i < 4; i++)
+		json += std::string(i ? "," : "") + "{\"buffer\":0,\"byteOffset\":" + std::to_string(offsets[i]) + ",\"byteLength\":" + std::to_string(lengths[i]) + "}";
+	json += "],\"accessors\":[";
+	for (int i = 0; i < 4; i++)
+		json += std::string(i ? "," : "") + "{\"bufferView\":" + std::to_string(i) + ",\"componentType\":" + (i < 3 ? "5126" : "5125")
+			+ ",\"count\":" + std::to_string(counts[i]) + ",\"type\":\"" + types[i] + "\"}";
+	json += "]}";
+	while (json.size() % 4 != 0)
+		json += ' ';
+	while (binary.size() % 4 != 0)
+		binary.push_back(0);
+
+	std::ofstream file(path, std::ios::binary);
+	auto write32 = [&](uint32_t value) { file.write((const char*)&value, 4); };
+	write32(GLB_MAGIC);
+	write32(2);
+	write32((uint32_t)(12 + 8 + json.size() + 8 + binary.size()));
+	write32((uint32_t)json.size());
+	write32(GLB_CHUNK_JSON);
+	file.write(json.data(), json.size());
+	write32((uint32_t)binary.size());
+	write32(GLB_CHUNK_BIN);
+	file.write((const char*)binary.data(), binary.size());
+	return (bool)file;
+}
+
+// the files a mesh benchmark runs on: 'paths' when given, otherwise a 1M triangle torus written as obj (and glb with
+// 'both_formats') into 'directory'. empty when the torus cannot be written
+inline std::vector<std::string> benchmarkMeshFiles(const std::vector<std::string>& paths, const std::filesystem::path& directory,
+	bool both_formats = true) {
+	if (!paths.empty())
+		return paths;
+	std::filesystem::create_directories(directory);
+	std::string obj = (directory / "torus.obj").string(), glb = (directory / "torus.glb").string();
+	if (!writeTorusObj(obj, 1000, 500) || (both_formats && !writeTorusGlb(glb, 1000, 500))) {
+		std::cout << "ERROR::BENCHMARK::FAILED_TO_WRITE: " << directory << std::endl;
+		return {};
+	}
+	if (!both_formats)
+		return { obj };
+	return { obj, glb };
+}
+
+// import every file with the job system's caller plus one worker and then with every worker, in MB/s of file read and
+// millions of triangles per second, file read included and the optimizer (see benchmarkMeshOptimize()) left out. without files a 1M triangle torus is written as obj and glb
+// to a temporary directory and imported instead
+inline void benchmarkMeshImport(std::vector<std::string> paths, int iterations = 3) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "mesh_import_benchmark";
+	paths = benchmarkMeshFiles(paths, directory);
+
+	JobSystem pair(1), all;
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "\nMesh import benchmark, best of " << iterations << " runs:" << std::endl
+		<< "\t" << std::left << std::setw(10) << "MB" << std::setw(12) << "triangles" << std::setw(12) << "vertices"
+		<< std::setw(10) << "corners" << std::setw(8) << "index"
+		<< std::setw(20) << "2 threads MB/s" << std::setw(12) << "Mtri/s"
+		<< std::setw(20) << std::to_string(all.threadCount() + 1) + " threads MB/s" << std::setw(12) << "Mtri/s" << "file" << std::endl;
+	for (const std::string& path : paths) {
+		std::error_code error;
+		double megabytes = std::filesystem::file_size(path, error) / (1024.0 * 1024.0);
+		MeshData mesh;
+		if (error || !importMesh(all, path, mesh, false)) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+
+		double best_ms[2] = { 1e30, 1e30 };
+		JobSystem* systems[2] = { &pair, &all };
+		for (int s = 0; s < 2; s++)
+			for (int i = 0; i < iterations; i++) {
+				MeshData imported;
+				auto start = std::chrono::steady_clock::now();
+				importMesh(*systems[s], path, imported, false);
+				best_ms[s] = std::min(best_ms[s], elapsedMs(start));
+			}
+
+		// corners per unique vertex, how much the deduplication folded
+		double triangles = (double)mesh.triangleCount();
+		std::cout << "\t" << std::setw(10) << megabytes << std::setw(12) << mesh.triangleCount() << std::setw(12) << mesh.vertices.size()
+			<< std::setw(10) << mesh.indices.size() / std::max<double>((double)mesh.vertices.size(), 1.0)
+			<< std::setw(8) << (mesh.wideIndices() ? "32 bit" : "16 bit");
+		for (int s = 0; s < 2; s++)
+			std::cout << std::setw(20) << megabytes * 1000.0 / best_ms[s] << std::setw(12) << triangles / (best_ms[s] * 1000.0);
+		std::cout << path << std::endl;
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	std::filesystem::remove_all(directory);
+}
+
+// time from file to drawable buffers, importing (and optimizing) the source file against mapping its cooked version (cooked_mesh.h).
+// upload is measured to glFinish(), the cooked file is written next to the others in a temporary directory. needs the
+// context, the page cache is warm for both paths
+inline void benchmarkCookedMesh(std::vector<std::string> paths, int iterations = 5) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "cooked_mesh_benchmark";
+	paths = benchmarkMeshFiles(paths, directory);
+	std::filesystem::create_directories(directory);
+	JobSystem jobs;
+	VertexArrayCache vertex_arrays;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "\nCooked mesh benchmark, best of " << iterations << " runs, " << jobs.threadCount() + 1 << " import threads:" << std::endl
+		<< "\t" << std::left << std::setw(12) << "source MB" << std::setw(12) << "cooked MB" << std::setw(14) << "import ms"
+		<< std::setw(14) << "upload ms" << std::setw(14) << "map ms" << std::setw(14) << "upload ms" << std::setw(10) << "speedup" << "file" << std::endl;
+	for (const std::string& path : paths) {
+		MeshData mesh;
+		std::string cooked_path = (directory / (std::filesystem::path(path).stem().string() + ".mesh")).string();
+		if (!importMesh(jobs, path, mesh) || !cookMesh(mesh, cooked_path)) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+
+		double import_ms = 1e30, import_upload_ms = 1e30, map_ms = 1e30, map_upload_ms = 1e30;
+		for (int i = 0; i < iterations; i++) {
+			auto start = std::chrono::steady_clock::now();
+			MeshData imported;
+			importMesh(jobs, path, imported);
+			import_ms = std::min(import_ms, elapsedMs(start));
+			start = std::chrono::steady_clock::now();
+			{
+				Mesh uploaded(vertex_arrays, imported);
+				glFinish();
+				import_upload_ms = std::min(import_upload_ms, elapsedMs(start));
+			}
+
+			start = std::chrono::steady_clock::now();
+			CookedMesh cooked;
+			cooked.open(cooked_path);
+			map_ms = std::min(map_ms, elapsedMs(start));
+			start = std::chrono::steady_clock::now();
+			{
+				Mesh uploaded(vertex_arrays, cooked);
+				glFinish();
+				map_upload_ms = std::min(map_upload_ms, elapsedMs(start));
+			}
+		}
+
+		std::error_code error;
+		double source_mb = std::filesystem::file_size(path, error) / (1024.0 * 1024.0);
+		double cooked_mb = std::filesystem::file_size(cooked_path, error) / (1024.0 * 1024.0);
+		std::cout << "\t" << std::setw(12) << source_mb << std::setw(12) << cooked_mb << std::setw(14) << import_ms
+			<< std::setw(14) << import_upload_ms << std::setw(14) << map_ms << std::setw(14) << map_upload_ms
+			<< std::setw(10) << (import_ms + import_upload_ms) / (map_ms + map_upload_ms) << path << std::endl;
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	std::filesystem::remove_all(directory);
+}
+
+// the optimizer passes on every file as imported, and again with its triangles shuffled the way a careless exporter
+// might write them. vertex cache figures are for a VERTEX_CACHE_SIZE entry FIFO, overfetch for 64 byte lines
+inline void benchmarkMeshOptimize(std::vector<std::string> paths) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "mesh_optimize_benchmark";
+	paths = benchmarkMeshFiles(paths, directory, false);
+
+	JobSystem jobs;
+	std::mt19937 random(1);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nMesh optimizer benchmark, " << VERTEX_CACHE_SIZE << " entry vertex cache:" << std::endl
+		<< "\t" << std::left << std::setw(10) << "order" << std::setw(12) << "triangles" << std::setw(18) << "ACMR before/after"
+		<< std::setw(18) << "ATVR before/after" << std::setw(24) << "overfetch before/after" << std::setw(10) << "clusters" << std::setw(10) << "ms" << "file" << std::endl;
+	for (const std::string& path : paths) {
+		MeshData imported;
+		if (!importMesh(jobs, path, imported, false)) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+		for (int shuffled = 0; shuffled < 2; shuffled++) {
+			MeshData mesh = imported;
+			if (shuffled) {
+				std::vector<uint32_t> order(mesh.triangleCount());
+				std::iota(order.begin(), order.end(), 0);
+				std::shuffle(order.begin(), order.end(), random);
+				for (size_t t = 0; t < order.size(); t++)
+					std::copy_n(&imported.indices[order[t] * 3], 3, &mesh.indices[t * 3]);
+			}
+			MeshOptimizeStats stats = optimizeMesh(mesh);
+			std::cout << "\t" << std::setw(10) << (shuffled ? "shuffled" : "imported") << std::setw(12) << mesh.triangleCount()
+				<< std::setw(9) << stats.before.acmr << std::setw(9) << stats.after.acmr << std::setw(9) << stats.before.atvr << std::setw(9) << stats.after.atvr
+				<< std::setw(12) << stats.before.overfetch << std::setw(12) << stats.after.overfetch << std::setw(10) << stats.clusters
+				<< std::setw(10) << stats.cache_ms + stats.overdraw_ms + stats.fetch_ms << path << std::endl;
+		}
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	std::filesystem::remove_all(directory);
+}
+
+// every vertex format and stream layout: bytes per vertex, the worst error packing introduced, and millions of triangles
+// per second through the vertex shader with rasterization discarded, for the full shader and a position only pass.
+// needs the context and the glsl folder
+inline void benchmarkVertexFormats(std::vector<std::string> paths, int draws = 20) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "vertex_format_benchmark";
+	paths = benchmarkMeshFiles(paths, directory, false);
+
+	JobSystem jobs;
+	VertexArrayCache vertex_arrays;
+	Shader float_shader("glsl/mesh_vertex.glsl", "glsl/mesh_fragment.glsl");
+	Shader packed_shader("glsl/mesh_packed_vertex.glsl", "glsl/mesh_fragment.glsl");
+	Shader depth_shader("glsl/mesh_depth_vertex.glsl", "glsl/mesh_depth_fragment.glsl");
+	const char* encodings[3] = { "float", "half", "snorm16" };
+
+	for (const std::string& path : paths) {
+		MeshData mesh;
+		if (!importMesh(jobs, path, mesh)) {
+			std::cout << "ERROR::BENCHMARK::FAILED_TO_LOAD: " << path << std::endl;
+			continue;
+		}
+		glm::vec3 extent = glm::make_vec3(mesh.bounds_max) - glm::make_vec3(mesh.bounds_min);
+		float diagonal = std::max(glm::length(extent), 1e-30f);
+
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << "\nVertex format benchmark, " << mesh.triangleCount() << " triangles and " << mesh.vertices.size()
+			<< " vertices drawn " << draws << " times, " << path << ":" << std::endl
+			<< "\t" << std::left << std::setw(10) << "position" << std::setw(13) << "streams" << std::setw(8) << "bytes"
+			<< std::setw(10) << "MB" << std::setw(20) << "position error" << std::setw(16) << "normal error"
+			<< std::setw(14) << "full Mtri/s" << "position only Mtri/s" << std::endl;
+		glEnable(GL_RASTERIZER_DISCARD);
+		for (int encoding = 0; encoding < 3; encoding++) {
+			PackedMeshData packed;
+			double position_error = 0.0, normal_error = 0.0;
+			if (encoding > 0) {
+				packed = packMesh(mesh, encoding == 1 ? PositionEncoding::Half : PositionEncoding::Snorm16);
+				for (size_t i = 0; i < mesh.vertices.size(); i++) {
+					MeshVertex unpacked = unpackVertex(packed, packed.vertices[i]);
+					const MeshVertex& source = mesh.vertices[i];
+					glm::vec3 normal = glm::make_vec3(source.normal);
+					double cosine = glm::dot(glm::make_vec3(unpacked.normal), glm::length(normal) > 0.0f ? glm::normalize(normal) : normal);
+					position_error = std::max(position_error, (double)glm::length(glm::make_vec3(unpacked.position) - glm::make_vec3(source.position)));
+					normal_error = std::max(normal_error, std::acos(std::min(std::max(cosine, -1.0), 1.0)) * 57.29577951308232);
+				}
+			}
+
+			for (int split = 0; split < 2; split++) {
+				VertexStreams streams = split ? VertexStreams::Split : VertexStreams::Interleaved;
+				std::unique_ptr<Mesh> gpu = encoding > 0 ? std::make_unique<Mesh>(vertex_arrays, packed, streams)
+					: std::make_unique<Mesh>(vertex_arrays, mesh, streams);
+				double mtri_per_s[2];
+				for (int pass = 0; pass < 2; pass++) {
+					Shader& shader = pass == 1 ? depth_shader : encoding > 0 ? packed_shader : float_shader;
+					shader.use();
+					shader.setMat4("model", pass == 1 ? gpu->dequantize : glm::mat4(1.0f)); // depth only folds it in
+					shader.setMat4("view", glm::mat4(1.0f));
+					shader.setMat4("projection", glm::mat4(1.0f));
+					if (pass == 0 && encoding > 0) {
+						shader.setMat4("dequantize", gpu->dequantize);
+						shader.setVec4("uv_transform", glm::make_vec4(gpu->uv_transform));
+					}
+					gpu->draw(); // warm up
+					glFinish();
+					auto start = std::chrono::steady_clock::now();
+					for (int i = 0; i < draws; i++)
+						gpu->draw();
+					glFinish();
+					mtri_per_s[pass] = (double)mesh.triangleCount() * draws / (elapsedMs(start) * 1000.0);
+				}
+
+				std::cout << "\t" << std::setw(10) << encodings[encoding] << std::setw(13) << (split ? "split" : "interleaved")
+					<< std::setw(8) << gpu->vertex_bytes / std::max<size_t>(mesh.vertices.size(), 1)
+					<< std::setw(10) << gpu->vertex_bytes / (1024.0 * 1024.0);
+				if (encoding > 0)
+					std::cout << std::setprecision(4) << std::setw(20) << position_error / diagonal * 100.0 << std::setw(16) << normal_error;
+				else
+					std::cout << std::setw(20) << "-" << std::setw(16) << "-";
+				std::cout << std::setprecision(2) << std::setw(14) << mtri_per_s[0] << mtri_per_s[1] << std::endl;
+			}
+		}
+		glDisable(GL_RASTERIZER_DISCARD);
+		glBindVertexArray(0);
+		std::cout << "\tposition error is in percent of the bounds diagonal, normal error in degrees" << std::endl;
+		std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	}
+	std::filesystem::remove_all(directory);
+}
+
+// 'objects' small tori spread over 'mesh_count' different meshes, drawn in an order that changes mesh on every draw. the
+// traditional paths (a VAO per mesh, or a VAO per layout with the mesh's buffers attached each draw) set the model
+// matrix as a uniform per draw, the pulled paths read it from the transform buffer (mesh_pool.h). rasterization is
+// discarded, so the figures are submission and vertex work. needs the context and the glsl folder
+inline void benchmarkVertexPulling(int objects, int mesh_count, int frames = 20) {
+	mesh_count = std::max(mesh_count, 1);
+	int per_mesh = std::max(objects / mesh_count, 1);
+	objects = per_mesh * mesh_count;
+
+	// meshes of 96 to 616 triangles
+	std::vector<MeshData> meshes;
+	size_t triangles = 0;
+	for (int m = 0; m < mesh_count; m++) {
+		meshes.push_back(generateTorusMesh(8 + m % 8 * 2, 6 + m % 5 * 2));
+		triangles += meshes.back().triangleCount() * per_mesh;
+	}
+	// object o is instance o % per_mesh of mesh o / per_mesh, so each mesh's transforms are contiguous for instancing.
+	// draw k takes the next mesh round robin
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> spread(-0.9f, 0.9f);
+	std::vector<glm::mat4> transforms(objects);
+	for (glm::mat4& transform : transforms)
+		transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(spread(random), spread(random), spread(random) * 0.1f)), glm::vec3(0.04f));
+	std::vector<int> order(objects);
+	for (int k = 0; k < objects; k++)
+		order[k] = (k % mesh_count) * per_mesh + k / mesh_count;
+
+	Shader float_shader("glsl/mesh_vertex.glsl", "glsl/mesh_fragment.glsl");
+	Shader pulled_shader("glsl/mesh_pulled_vertex.glsl", "glsl/mesh_fragment.glsl");
+	GLint model_location = glGetUniformLocation(float_shader.program, "model");
+
+	// traditional, every mesh in its own buffers, with its own VAO as the demos used to set up
+	VertexArrayCache vertex_arrays;
+	std::vector<std::unique_ptr<Mesh>> gpu;
+	std::vector<unsigned int> mesh_vaos(mesh_count);
+	glCreateVertexArrays(mesh_count, mesh_vaos.data());
+	for (int m = 0; m < mesh_count; m++) {
+		gpu.push_back(std::make_unique<Mesh>(vertex_arrays, meshes[m]));
+		formatVertexAttributes(mesh_vaos[m], MeshVertexLayout::attributes.data(), MeshVertexLayout::count);
+		glVertexArrayVertexBuffer(mesh_vaos[m], 0, gpu[m]->VBO, 0, MeshVertexLayout::stride);
+		glVertexArrayElementBuffer(mesh_vaos[m], gpu[m]->EBO);
+	}
+
+	// pulled, every mesh in the pool
+	MeshPool pool;
+	for (const MeshData& mesh : meshes)
+		pool.add(mesh);
+	pool.upload();
+	pool.setTransforms(transforms.data(), transforms.size());
+	std::vector<DrawElementsIndirectCommand> per_object, per_mesh_commands;
+	for (int k = 0; k < objects; k++)
+		per_object.push_back(pool.command(order[k] / per_mesh, order[k]));
+	for (int m = 0; m < mesh_count; m++)
+		per_mesh_commands.push_back(pool.command(m, m * per_mesh, per_mesh));
+
+	const char* names[5] = { "VAO per mesh", "VAO per layout", "pulled, draw per object", "pulled, multi-draw", "pulled, instanced multi-draw" };
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nVertex pulling benchmark, " << objects << " objects of " << mesh_count << " meshes, " << triangles
+		<< " triangles a frame, mean of " << frames << " frames:" << std::endl
+		<< "\t" << std::left << std::setw(30) << "path" << std::setw(12) << "GL draws" << std::setw(14) << "submit ms"
+		<< std::setw(14) << "frame ms" << "Mtri/s" << std::endl;
+	glEnable(GL_RASTERIZER_DISCARD);
+	for (int path = 0; path < 5; path++) {
+		Shader& shader = path < 2 ? float_shader : pulled_shader;
+		shader.use();
+		shader.setMat4("view", glm::mat4(1.0f));
+		shader.setMat4("projection", glm::mat4(1.0f));
+		auto frame = [&]() {
+			if (path == 0)
+				for (int k = 0; k < objects; k++) {
+					const Mesh& mesh = *gpu[order[k] / per_mesh];
+					glBindVertexArray(mesh_vaos[order[k] / per_mesh]);
+					glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transforms[order[k]]));
+					glDrawElements(GL_TRIANGLES, mesh.index_count, mesh.index_type, 0);
+				}
+			else if (path == 1)
+				for (int k = 0; k < objects; k++) {
+					glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transforms[order[k]]));
+					gpu[order[k] / per_mesh]->draw();
+				}
+			else {
+				pool.bind();
+				if (path == 2)
+					for (const DrawElementsIndirectCommand& command : per_object)
+						pool.draw(command);
+				else
+					pool.drawMulti(path == 3 ? per_object : per_mesh_commands);
+			}
+		};
+		frame(); // warm up
+		glFinish();
+		double submit_ms = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) {
+			auto submit = std::chrono::steady_clock::now();
+			frame();
+			submit_ms += elapsedMs(submit);
+		}
+		glFinish();
+		double frame_ms = elapsedMs(start) / frames;
+		int draws = path < 3 ? objects : 1;
+		std::cout << "\t" << std::setw(30) << names[path] << std::setw(12) << draws << std::setw(14) << submit_ms / frames
+			<< std::setw(14) << frame_ms << (double)triangles / (frame_ms * 1000.0) << std::endl;
+	}
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(0);
+	std::cout << "\tsubmit is the CPU time to issue a frame, frame is to glFinish() with frames overlapping" << std::endl;
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	glDeleteVertexArrays(mesh_count, mesh_vaos.data());
+}
+
+// 'mesh_count' small tori uploaded into buffers of their own and into a GpuBufferHeap (gpu_heap.h): time to create them,
+// GL buffer objects used and time to draw them all. then every other mesh is freed and the heap compacted a 'budget'
+// of bytes at a time, printing the fragmentation after each step. the allocator alone is timed on a random
+// allocate / free mix first. needs the context and the glsl folder
+inline void benchmarkGpuHeap(int mesh_count, uint64_t budget = 1024 * 1024, int frames = 20) {
+	std::cout << std::fixed << std::setprecision(3);
+	{
+		std::mt19937 random(42);
+		TlsfAllocator allocator(1ull << 32);
+		std::vector<uint32_t> live;
+		const int OPERATIONS = 1000000;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < OPERATIONS; i++)
+			if (live.size() < 10000 && (live.empty() || random() % 2)) {
+				uint32_t allocation = allocator.allocate(16 + random() % 65536, 16ull << (random() % 5));
+				if (allocation != TlsfAllocator::NONE)
+					live.push_back(allocation);
+			}
+			else {
+				size_t k = random() % live.size();
+				allocator.free(live[k]);
+				live[k] = live.back();
+				live.pop_back();
+			}
+		std::cout << "\nTLSF allocator, random allocate and free with up to 10000 live: " << elapsedMs(start) * 1e6 / OPERATIONS
+			<< " ns per operation" << std::endl;
+	}
+
+	std::vector<MeshData> meshes;
+	size_t triangles = 0;
+	for (int m = 0; m < mesh_count; m++) {
+		meshes.push_back(generateTorusMesh(8 + m % 8 * 4, 6 + m % 5 * 2));
+		triangles += meshes.back().triangleCount();
+	}
+	Shader shader("glsl/mesh_vertex.glsl", "glsl/mesh_fragment.glsl");
+	shader.use();
+	shader.setMat4("view", glm::mat4(1.0f));
+	shader.setMat4("projection", glm::mat4(1.0f));
+	shader.setMat4("model", glm::mat4(0.001f));
+	VertexArrayCache vertex_arrays;
+	GpuBufferHeap heap;
+
+	std::cout << "\nGPU heap benchmark, " << mesh_count << " meshes of " << triangles << " triangles, draws are the mean of " << frames << " frames:" << std::endl
+		<< "\t" << std::left << std::setw(16) << "buffers" << std::setw(14) << "GL buffers" << std::setw(14) << "create ms" << "draw ms" << std::endl;
+	glEnable(GL_RASTERIZER_DISCARD);
+	std::vector<std::unique_ptr<Mesh>> gpu;
+	for (int path = 0; path < 2; path++) {
+		gpu.clear();
+		glFinish();
+		auto start = std::chrono::steady_clock::now();
+		for (const MeshData& mesh : meshes)
+			gpu.push_back(std::make_unique<Mesh>(vertex_arrays, mesh, VertexStreams::Interleaved, path == 1 ? &heap : nullptr));
+		glFinish();
+		double create_ms = elapsedMs(start);
+		start = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++)
+			for (const std::unique_ptr<Mesh>& mesh : gpu)
+				mesh->draw();
+		glFinish();
+		std::cout << "\t" << std::setw(16) << (path == 1 ? "heap ranges" : "one per mesh") << std::setw(14)
+			<< (path == 1 ? heap.stats().buffers : gpu.size() * 2) << std::setw(14) << create_ms << elapsedMs(start) / frames << std::endl;
+	}
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	// free every other mesh, the holes left are the size of one mesh each
+	for (size_t m = 0; m < gpu.size(); m += 2)
+		gpu[m].reset();
+	GpuHeapStats stats = heap.stats();
+	std::cout << "\tevery other mesh freed: " << stats.memory.free_blocks << " free ranges, fragmentation "
+		<< stats.fragmentation() * 100.0 << "%" << std::endl;
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	int steps = 0;
+	for (uint64_t copied = heap.compact(budget); copied > 0; copied = heap.compact(budget)) {
+		steps++;
+		if ((steps & (steps - 1)) == 0)
+			std::cout << "\tcompaction step " << steps << ": " << copied / 1024.0 << " KiB moved, fragmentation "
+				<< heap.stats().fragmentation() * 100.0 << "%" << std::endl;
+	}
+	glFinish();
+	std::cout << "\tcompacted in " << steps << " steps of up to " << budget / 1024 << " KiB, " << elapsedMs(start) << " ms with the copies" << std::endl;
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	heap.printStats();
+	gpu.clear();
+}
+
+// 'objects' instances of 16 pooled tori given new transforms and commands every frame, built three ways: std::vectors
+// made each frame and uploaded with glNamedBufferSubData(), the same arrays in the scratch arena, and written straight
+// into a double buffered GpuFrameArena the draw reads from. per frame CPU time, time to glFinish() and the operator new
+// calls per frame are printed, the latter only count when main.cpp compiles the allocation counter in
+inline void benchmarkFrameArena(int objects, int frames = 100) {
+	const int MESH_COUNT = 16;
+	objects = std::max(objects, MESH_COUNT);
+	MeshPool pool;
+	for (int m = 0; m < MESH_COUNT; m++)
+		pool.add(generateTorusMesh(8 + m % 4 * 2, 6 + m % 3 * 2));
+	pool.upload();
+	GpuFrameArena arena(objects * (sizeof(glm::mat4) + sizeof(DrawElementsIndirectCommand)) + 1024);
+	Shader shader("glsl/mesh_pulled_vertex.glsl", "glsl/mesh_fragment.glsl");
+	shader.use();
+	shader.setMat4("view", glm::mat4(1.0f));
+	shader.setMat4("projection", glm::mat4(1.0f));
+
+	// what a frame fills in, the same whichever memory it goes to
+	auto build = [&](int frame, glm::mat4* transforms, DrawElementsIndirectCommand* commands) {
+		float angle = frame * 0.01f;
+		for (int o = 0; o < objects; o++) {
+			transforms[o] = glm::rotate(glm::mat4(0.04f), angle + o, glm::vec3(0.0f, 1.0f, 0.0f));
+			commands[o] = pool.command(o % MESH_COUNT, o);
+		}
+	};
+
+	const char* names[3] = { "std::vector per frame", "scratch arena", "GPU frame arena" };
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nFrame arena benchmark, " << objects << " objects with new transforms and commands every frame, mean of "
+		<< frames << " frames:" << std::endl
+		<< "\t" << std::left << std::setw(26) << "memory" << std::setw(14) << "CPU ms" << std::setw(14) << "frame ms"
+		<< "allocations per frame" << std::endl;
+	glEnable(GL_RASTERIZER_DISCARD);
+	for (int path = 0; path < 3; path++) {
+		auto frame = [&](int f) {
+			pool.bind();
+			if (path == 0) {
+				std::vector<glm::mat4> transforms(objects);
+				std::vector<DrawElementsIndirectCommand> commands(objects);
+				build(f, transforms.data(), commands.data());
+				pool.setTransforms(transforms.data(), transforms.size());
+				pool.drawMulti(commands);
+			}
+			else if (path == 1) {
+				ScratchScope scratch;
+				glm::mat4* transforms = scratch.allocate<glm::mat4>(objects);
+				DrawElementsIndirectCommand* commands = scratch.allocate<DrawElementsIndirectCommand>(objects);
+				build(f, transforms, commands);
+				pool.setTransforms(transforms, objects);
+				pool.drawMulti(commands, objects);
+			}
+			else {
+				arena.beginFrame();
+				GpuFrameAllocation transforms = arena.allocate(objects * sizeof(glm::mat4));
+				GpuFrameAllocation commands = arena.allocate(objects * sizeof(DrawElementsIndirectCommand), 4);
+				build(f, (glm::mat4*)transforms.data, (DrawElementsIndirectCommand*)commands.data);
+				pool.bindTransforms(arena.buffer, transforms.offset, objects * sizeof(glm::mat4));
+				pool.drawIndirect(arena.buffer, commands.offset, objects);
+				arena.endFrame();
+			}
+		};
+		frame(0); // warm up, the pool's buffers grow to size here
+		glFinish();
+		double cpu_ms = 0.0;
+		startAllocationCount();
+		auto start = std::chrono::steady_clock::now();
+		for (int f = 1; f <= frames; f++) {
+			auto cpu = std::chrono::steady_clock::now();
+			frame(f);
+			cpu_ms += elapsedMs(cpu);
+		}
+		glFinish();
+		double frame_ms = elapsedMs(start) / frames;
+		AllocationCount allocations = stopAllocationCount();
+		std::cout << "\t" << std::setw(26) << names[path] << std::setw(14) << cpu_ms / frames << std::setw(14) << frame_ms
+			<< (double)allocations.allocations / frames << std::endl;
+	}
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(0);
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	arena.printStats();
+}
+
+// every batch math kernel (batch_math.h) at 1k, 10k, ... elements up to 'max_count': ns per element for glm one call at a
+// time and for the AVX2 and FMA kernels, whether AVX2 returned glm's bits and how far FMA strayed, in float epsilons of
+// the largest component of the element (an ulp count blows up wherever glm's result cancels to near zero). each size
+// runs at least 20M elements in total. no context needed
+inline void benchmarkBatchMath(size_t max_count = 10000000) {
+	max_count = std::max(max_count, (size_t)1000);
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	auto randomMatrix = [&]() {
+		glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random)) * 50.0f);
+		matrix = glm::rotate(matrix, unit(random) * 3.2f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f)));
+		return glm::scale(matrix, glm::vec3(0.5f + unit(random) * 0.4f));
+	};
+	std::vector<glm::mat4> matrices(max_count);
+	std::vector<PackedVec3> points(max_count);
+	std::vector<glm::vec4> vectors(max_count);
+	std::vector<float> soa(max_count * 3);
+	std::vector<Aabb> boxes(max_count);
+	for (size_t i = 0; i < max_count; i++) {
+		matrices[i] = randomMatrix();
+		points[i] = PackedVec3(unit(random), unit(random), unit(random)) * 100.0f;
+		if (i % 97 == 0)
+			points[i].y = -0.0f; // signed zeros have to come out the same too
+		vectors[i] = glm::vec4(points[i], i % 2 ? 1.0f : unit(random));
+		soa[i] = points[i].x;
+		soa[max_count + i] = points[i].y;
+		soa[max_count * 2 + i] = points[i].z;
+		PackedVec3 half = glm::abs(PackedVec3(unit(random), unit(random), unit(random))) * 2.0f;
+		boxes[i] = { points[i] - half, points[i] + half };
+	}
+	glm::mat4 view_projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f)
+		* glm::lookAt(glm::vec3(10.0f, 20.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// one kernel, writing its results for the first 'count' elements to 'out'. 'bitwise' results have to match glm's
+	// bits, otherwise only their values
+	struct Kernel {
+		const char* name;
+		size_t floats; // per element, or in all when not 'per_element'
+		bool per_element;
+		bool bitwise;
+		std::function<void(const MathKernels&, size_t, float*)> run;
+	};
+	Kernel kernels[6] = {
+		{ "multiplyMatrices", 16, true, true, [&](const MathKernels& k, size_t count, float* out) {
+			k.multiplyMatrices(view_projection, matrices.data(), (glm::mat4*)out, count); } },
+		{ "transformVectors", 4, true, true, [&](const MathKernels& k, size_t count, float* out) {
+			k.transformVectors(view_projection, vectors.data(), (glm::vec4*)out, count); } },
+		{ "transformPoints", 3, true, true, [&](const MathKernels& k, size_t count, float* out) {
+			k.transformPoints(matrices[0], points.data(), (PackedVec3*)out, count); } },
+		{ "transformPointsSoA", 3, true, true, [&](const MathKernels& k, size_t count, float* out) {
+			k.transformPointsSoA(matrices[0], soa.data(), soa.data() + max_count, soa.data() + max_count * 2, out, out + count, out + count * 2, count); } },
+		{ "transformAabbs", 6, true, true, [&](const MathKernels& k, size_t count, float* out) {
+			k.transformAabbs(matrices.data(), boxes.data(), (Aabb*)out, count); } },
+		{ "computeBounds", 6, false, true, [&](const MathKernels& k, size_t count, float* out) {
+			Aabb bounds = k.computeBounds(points.data(), count);
+			std::memcpy(out, &bounds, sizeof(bounds)); } },
+	};
+	const MathLevel levels[3] = { MathLevel::Scalar, MathLevel::AVX2, MathLevel::FMA };
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nBatch math benchmark, ns per element, glm is one call per element:" << std::endl
+		<< "\t" << std::left << std::setw(22) << "kernel" << std::setw(12) << "elements" << std::setw(10) << "glm"
+		<< std::setw(10) << "AVX2" << std::setw(10) << "speedup" << std::setw(10) << "FMA" << std::setw(10) << "speedup"
+		<< std::setw(12) << "AVX2 = glm" << "FMA error" << std::endl;
+	for (const Kernel& kernel : kernels) {
+		size_t out_floats = kernel.per_element ? max_count * kernel.floats : kernel.floats;
+		std::vector<float> reference(out_floats), result(out_floats);
+		for (size_t count = 1000; count <= max_count; count *= 10) {
+			size_t floats = kernel.per_element ? count * kernel.floats : kernel.floats;
+			size_t repeats = std::max((size_t)1, (size_t)20000000 / count);
+			double ns[3] = { 0.0, 0.0, 0.0 };
+			bool exact = true;
+			double fused_error = 0.0;
+			for (int l = 0; l < 3; l++) {
+				if (!mathLevelSupported(levels[l]))
+					continue;
+				MathKernels set = makeMathKernels(levels[l]);
+				float* out = l == 0 ? reference.data() : result.data();
+				kernel.run(set, count, out); // warm up
+				auto start = std::chrono::steady_clock::now();
+				for (size_t r = 0; r < repeats; r++)
+					kernel.run(set, count, out);
+				ns[l] = elapsedMs(start) * 1e6 / ((double)repeats * count);
+				for (size_t e = 0; l > 0 && e < floats; e += kernel.floats) {
+					float scale = 0.0f;
+					for (size_t f = e; f < e + kernel.floats; f++)
+						scale = std::max(scale, std::abs(reference[f]));
+					for (size_t f = e; f < e + kernel.floats; f++)
+						if (l == 1)
+							exact = exact && (kernel.bitwise ? std::memcmp(&reference[f], &result[f], 4) == 0 : reference[f] == result[f]);
+						else if (scale > 0.0f)
+							fused_error = std::max(fused_error, std::abs((double)result[f] - reference[f]) / (scale * FLT_EPSILON));
+				}
+			}
+			std::cout << "\t" << std::setw(22) << kernel.name << std::setw(12) << count << std::setw(10) << ns[0];
+			for (int l = 1; l < 3; l++)
+				if (ns[l] > 0.0)
+					std::cout << std::setw(10) << ns[l] << std::setw(10) << ns[0] / ns[l];
+				else
+					std::cout << std::setw(10) << "-" << std::setw(10) << "-";
+			std::cout << std::setw(12) << (ns[1] > 0.0 ? (exact ? "yes" : "NO") : "-");
+			if (ns[2] > 0.0)
+				std::cout << fused_error;
+			else
+				std::cout << "-";
+			std::cout << std::endl;
+		}
+	}
+
+	// bounds that are zero with -0 and 0 in different lanes and the tail, the scalar kernel keeps whichever comes first
+	std::vector<PackedVec3> zeros(37);
+	for (size_t i = 0; i < zeros.size(); i++) {
+		PackedVec3 away = glm::abs(PackedVec3(unit(random), unit(random), unit(random))) + 1.0f;
+		zeros[i] = PackedVec3(away.x, away.y, -away.z); // the lowest x and y and the highest z are the zeros below
+	}
+	zeros[5] = PackedVec3(-0.0f, 0.0f, 0.0f);
+	zeros[10] = PackedVec3(0.0f, -0.0f, -0.0f);
+	zeros[35] = PackedVec3(0.0f, -0.0f, -0.0f);
+	Aabb zero_reference = computeBoundsScalar(zeros.data(), zeros.size());
+	bool zeros_exact = true;
+	for (MathLevel level : { MathLevel::AVX2, MathLevel::FMA })
+		if (mathLevelSupported(level)) {
+			Aabb bounds = makeMathKernels(level).computeBounds(zeros.data(), zeros.size());
+			zeros_exact = zeros_exact && std::memcmp(&bounds, &zero_reference, sizeof(Aabb)) == 0;
+		}
+	std::cout << "\tcomputeBounds with signed zero bounds: " << (zeros_exact ? "exact" : "MISMATCH") << std::endl;
+	std::cout << "\tkernels in use: " << mathLevelName(mathKernels().level) << std::endl;
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+}
+
+// how the build configured GLM, plain C++ or its intrinsics for an instruction set
+inline const char* glmFlavorName() {
+#if GLM_CONFIG_SIMD == GLM_ENABLE
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	return "SIMD, AVX2";
+#elif GLM_ARCH & GLM_ARCH_AVX_BIT
+	return "SIMD, AVX";
+#elif GLM_ARCH & GLM_ARCH_SSE41_BIT
+	return "SIMD, SSE4.1";
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+	return "SIMD, SSE2";
+#else
+	return "SIMD, NEON";
+#endif
+#else
+	return "scalar";
+#endif
+}
+
+// inputs of benchmarkGlm() in one GLM flavor. the qualifier picks GLM's code path, packed_highp is its plain C++ and
+// aligned_highp its intrinsics, which only exist when the build enables them (the ReleaseSIMD configuration). both
+// flavors draw the same values from the same seed
+template <glm::qualifier Q>
+struct GlmFlavorInputs {
+	std::vector<glm::mat<4, 4, float, Q>> left, right;
+	std::vector<glm::vec<4, float, Q>> vectors;
+	std::vector<glm::vec<3, float, Q>> eyes, targets;
+	std::vector<float> fovs, aspects;
+	std::vector<glm::qua<float, Q>> rotations, turns, unnormalized;
+
+	explicit GlmFlavorInputs(size_t count)
+		: left(count), right(count), vectors(count), eyes(count), targets(count), fovs(count), aspects(count),
+		rotations(count), turns(count), unnormalized(count) {
+		typedef glm::vec<3, float, glm::packed_highp> Vec3;
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		auto randomAxis = [&]() {
+			return glm::normalize(Vec3(unit(random), unit(random), unit(random)) + Vec3(0.0f, 0.0f, 1e-3f));
+		};
+		// rotated, scaled and moved, the well conditioned kind of matrix a scene is made of
+		auto randomMatrix = [&]() {
+			glm::mat<4, 4, float, glm::packed_highp> matrix(1.0f);
+			matrix = glm::translate(matrix, Vec3(unit(random), unit(random), unit(random)) * 50.0f);
+			matrix = glm::rotate(matrix, unit(random) * 3.2f, randomAxis());
+			return glm::mat<4, 4, float, Q>(glm::scale(matrix, Vec3(0.5f + unit(random) * 0.4f)));
+		};
+		auto randomRotation = [&]() {
+			return glm::qua<float, Q>(glm::angleAxis(unit(random) * 3.2f, randomAxis()));
+		};
+		for (size_t i = 0; i < count; i++) {
+			left[i] = randomMatrix();
+			right[i] = randomMatrix();
+			vectors[i] = glm::vec<4, float, Q>(unit(random), unit(random), unit(random), 1.0f) * 20.0f;
+			eyes[i] = glm::vec<3, float, Q>(unit(random), unit(random), unit(random)) * 30.0f;
+			targets[i] = glm::vec<3, float, Q>(unit(random), unit(random), unit(random)) * 5.0f;
+			fovs[i] = glm::radians(30.0f + (unit(random) + 1.0f) * 30.0f);
+			aspects[i] = 1.0f + (unit(random) + 1.0f) * 0.5f;
+			rotations[i] = randomRotation();
+			turns[i] = randomRotation();
+			unnormalized[i] = rotations[i] * (1.5f + unit(random));
+		}
+	}
+};
+
+const int GLM_OPERATIONS = 10;
+
+// GLM operation 'operation' of benchmarkGlm() on the first 'count' inputs in flavor 'Q', results to 'out' as floats,
+// returns its name and how many floats each result has
+template <glm::qualifier Q>
+inline const char* runGlmOperation(int operation, const GlmFlavorInputs<Q>& in, size_t count, float* out, size_t& floats) {
+	auto store = [&](size_t i, const auto& value) {
+		std::memcpy(out + i * floats, glm::value_ptr(value), floats * sizeof(float));
+	};
+	const glm::vec<3, float, Q> up(0.0f, 1.0f, 0.0f);
+	floats = operation == 1 || (operation >= 5 && operation <= 8) ? 4 : 16;
+	switch (operation) {
+	case 0:
+		for (size_t i = 0; i < count; i++)
+			store(i, in.left[i] * in.right[i]);
+		return "mat4 * mat4";
+	case 1:
+		for (size_t i = 0; i < count; i++)
+			store(i, in.left[i] * in.vectors[i]);
+		return "mat4 * vec4";
+	case 2:
+		for (size_t i = 0; i < count; i++)
+			store(i, glm::inverse(in.left[i]));
+		return "inverse";
+	case 3:
+		for (size_t i = 0; i < count; i++)
+			store(i, glm::lookAt(in.eyes[i], in.targets[i], up));
+		return "lookAt";
+	case 4:
+		// not templated on the qualifier, both flavors run the same code into their own matrix type
+		for (size_t i = 0; i < count; i++)
+			store(i, glm::mat<4, 4, float, Q>(glm::perspective(in.fovs[i], in.aspects[i], 0.1f, 500.0f)));
+		return "perspective";
+	case 5:
+		for (size_t i = 0; i < count; i++)
+			store(i, in.rotations[i] * in.turns[i]);
+		return "quat * quat";
+	case 6:
+		for (size_t i = 0; i < count; i++)
+			store(i, in.rotations[i] * in.vectors[i]);
+		return "quat * vec4";
+	case 7:
+		for (size_t i = 0; i < count; i++)
+			store(i, glm::normalize(in.unnormalized[i]));
+		return "normalize(quat)";
+	case 8:
+		for (size_t i = 0; i < count; i++)
+			store(i, glm::slerp(in.rotations[i], in.turns[i], 0.3f));
+		return "slerp";
+	default:
+		for (size_t i = 0; i < count; i++)
+			store(i, glm::mat4_cast(in.rotations[i]));
+		return "mat4_cast";
+	}
+}
+
+// GLM's scalar code against its intrinsics for the math a frame does, each operation called once per input over
+// 'count' inputs: ns per call in both flavors and how far the SIMD results stray from the scalar ones, in float epsilons
+// of the largest component of each result. the SIMD flavor needs a build with GLM_FORCE_<ISA> and
+// GLM_FORCE_DEFAULT_ALIGNED_GENTYPES (the ReleaseSIMD configuration), otherwise only the scalar one is timed. false
+// when an operation strays past 'tolerance' epsilons. no context needed
+inline bool benchmarkGlm(size_t count = 100000, double tolerance = 16.0) {
+	count = std::max(count, (size_t)1);
+	size_t repeats = std::max((size_t)1, (size_t)10000000 / count);
+	GlmFlavorInputs<glm::packed_highp> scalar_inputs(count);
+#if GLM_CONFIG_SIMD == GLM_ENABLE && GLM_CONFIG_ALIGNED_GENTYPES == GLM_ENABLE
+	GlmFlavorInputs<glm::aligned_highp> simd_inputs(count);
+#endif
+	std::vector<float> reference(count * 16), result(count * 16);
+	bool passed = true;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nGLM benchmark, " << glmFlavorName() << " build, ns per call over " << count << " inputs:" << std::endl
+		<< "\t" << std::left << std::setw(18) << "operation" << std::setw(10) << "scalar" << std::setw(10) << "SIMD"
+		<< std::setw(10) << "speedup" << "SIMD error" << std::endl;
+	for (int operation = 0; operation < GLM_OPERATIONS; operation++) {
+		size_t floats = 0;
+		const char* name = runGlmOperation(operation, scalar_inputs, count, reference.data(), floats); // warm up
+		auto start = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < repeats; r++)
+			runGlmOperation(operation, scalar_inputs, count, reference.data(), floats);
+		double scalar_ns = elapsedMs(start) * 1e6 / ((double)repeats * count);
+		std::cout << "\t" << std::setw(18) << name << std::setw(10) << scalar_ns;
+#if GLM_CONFIG_SIMD == GLM_ENABLE && GLM_CONFIG_ALIGNED_GENTYPES == GLM_ENABLE
+		runGlmOperation(operation, simd_inputs, count, result.data(), floats);
+		start = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < repeats; r++)
+			runGlmOperation(operation, simd_inputs, count, result.data(), floats);
+		double simd_ns = elapsedMs(start) * 1e6 / ((double)repeats * count);
+
+		bool exact = std::memcmp(reference.data(), result.data(), count * floats * sizeof(float)) == 0;
+		double error = 0.0;
+		for (size_t e = 0; e < count * floats; e += floats) {
+			float scale = 0.0f;
+			for (size_t f = e; f < e + floats; f++)
+				scale = std::max(scale, std::abs(reference[f]));
+			for (size_t f = e; f < e + floats; f++)
+				if (std::isnan(result[f]) != std::isnan(reference[f]))
+					error = INFINITY;
+				else if (scale > 0.0f)
+					error = std::max(error, std::abs((double)result[f] - reference[f]) / (scale * FLT_EPSILON));
+		}
+		std::cout << std::setw(10) << simd_ns << std::setw(10) << scalar_ns / simd_ns;
+		if (exact)
+			std::cout << "exact" << std::endl;
+		else
+			std::cout << error << (error > tolerance ? " FAILED" : "") << std::endl;
+		passed = passed && error <= tolerance;
+#else
+		std::cout << std::setw(10) << "-" << std::setw(10) << "-" << "-" << std::endl;
+#endif
+	}
+#if GLM_CONFIG_SIMD == GLM_ENABLE && GLM_CONFIG_ALIGNED_GENTYPES == GLM_ENABLE
+	std::cout << "\tSIMD results " << (passed ? "within " : "NOT within ") << tolerance << " epsilons of scalar" << std::endl;
+#else
+	(void)tolerance; // nothing to compare against in this build
+	std::cout << "\tGLM intrinsics are off in this build, build the ReleaseSIMD configuration to compare" << std::endl;
+#endif
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+	return passed;
+}
+
+// a forest of 'nodes' transforms, trees of a thousand nodes and random depth, updated with 1%, 10% and 100% of the nodes
+// set before each update: ms per update on one thread, on every core, and on every core writing a WorldMatrixBuffer
+// too, checked against a recompute of every node and the buffer read back. needs a context for the buffer
+inline void benchmarkTransformHierarchy(size_t nodes = 1000000, int updates = 5) {
+	nodes = std::max(nodes, (size_t)1000);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	TransformHierarchy hierarchy;
+	std::vector<uint32_t> chain; // the last node added and its ancestors, what the next node may hang from
+	size_t deepest = 0;
+	for (size_t i = 0; i < nodes; i++) {
+		if (i % 1000 == 0)
+			chain.clear();
+		else
+			chain.resize(1 + random() % chain.size()); // back up a random number of levels
+		chain.push_back(hierarchy.add(chain.empty() ? TransformHierarchy::NONE : chain.back(),
+			PackedVec3(unit(random), unit(random), unit(random)) * 2.0f, glm::angleAxis(unit(random) * 3.2f, glm::vec3(0.0f, 1.0f, 0.0f)),
+			PackedVec3(0.95f)));
+		deepest = std::max(deepest, chain.size());
+	}
+	JobSystem jobs;
+	WorldMatrixBuffer gpu(nodes);
+	hierarchy.update(&jobs);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nTransform hierarchy benchmark, " << nodes << " nodes in trees of 1000, up to " << deepest << " deep, "
+		<< jobs.threadCount() + 1 << " threads, ms per update:" << std::endl
+		<< "\t" << std::left << std::setw(10) << "set" << std::setw(14) << "recomputed" << std::setw(12) << "1 thread"
+		<< std::setw(12) << "all threads" << std::setw(14) << "+ GPU buffer" << "matches" << std::endl;
+	std::vector<glm::mat4> expected(nodes), readback(nodes);
+	const double fractions[3] = { 0.01, 0.1, 1.0 };
+	for (double fraction : fractions) {
+		size_t set = (size_t)(nodes * fraction);
+		double ms[3] = { 0.0, 0.0, 0.0 };
+		size_t recomputed = 0;
+		for (int mode = 0; mode < 3; mode++) {
+			// regions last written before the updates made without the buffer catch up untimed
+			for (size_t r = 0; mode == 2 && r < gpu.regions(); r++) {
+				gpu.beginFrame();
+				hierarchy.update(&jobs, &gpu);
+				gpu.endFrame();
+			}
+			for (int u = 0; u < updates; u++) {
+				for (size_t s = 0; s < set; s++) {
+					uint32_t node = set == nodes ? (uint32_t)s : (uint32_t)(random() % nodes);
+					hierarchy.setPosition(node, PackedVec3(unit(random), unit(random), unit(random)) * 2.0f);
+				}
+				if (mode == 2)
+					gpu.beginFrame();
+				auto start = std::chrono::steady_clock::now();
+				recomputed += hierarchy.update(mode > 0 ? &jobs : nullptr, mode == 2 ? &gpu : nullptr);
+				ms[mode] += elapsedMs(start) / updates;
+				if (mode == 2)
+					gpu.endFrame();
+			}
+		}
+
+		// every node from scratch, and the region the last update wrote, which had to catch up on the other's updates
+		for (size_t n = 0; n < nodes; n++) {
+			uint32_t parent = hierarchy.parent((uint32_t)n);
+			expected[n] = parent == TransformHierarchy::NONE ? hierarchy.local((uint32_t)n) : expected[parent] * hierarchy.local((uint32_t)n);
+		}
+		glGetNamedBufferSubData(gpu.buffer, gpu.offset(), (GLsizeiptr)(nodes * sizeof(glm::mat4)), readback.data());
+		bool matches = std::memcmp(expected.data(), hierarchy.worldMatrices(), nodes * sizeof(glm::mat4)) == 0
+			&& std::memcmp(expected.data(), readback.data(), nodes * sizeof(glm::mat4)) == 0;
+
+		std::cout << "\t" << std::setw(10) << (std::to_string((int)(fraction * 100)) + "%") << std::setw(14) << recomputed / (3 * updates)
+			<< std::setw(12) << ms[0] << std::setw(12) << ms[1] << std::setw(14) << ms[2] << (matches ? "yes" : "NO") << std::endl;
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+}
+
+// 'objects' random boxes and spheres around a camera turning on the spot, ms per cull with the scalar kernel, the AVX2
+// kernel and the AVX2 kernel on every thread, and whether they all see the same objects
+inline void benchmarkFrustumCulling(size_t objects = 1000000) {
+	objects = std::max(objects, (size_t)1000);
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<Aabb> boxes(objects);
+	std::vector<glm::vec4> spheres(objects);
+	for (size_t i = 0; i < objects; i++) {
+		PackedVec3 center = PackedVec3(unit(random), unit(random), unit(random)) * 100.0f;
+		PackedVec3 half = glm::abs(PackedVec3(unit(random), unit(random), unit(random))) * 2.0f + 0.1f;
+		boxes[i] = { center - half, center + half };
+		spheres[i] = glm::vec4(center, glm::length(glm::vec3(half)));
+	}
+	CullBoxes cull_boxes;
+	cull_boxes.assign(boxes.data(), objects);
+	CullSpheres cull_spheres;
+	cull_spheres.assign(spheres.data(), objects);
+
+	JobSystem jobs;
+	Camera camera(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 60.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+	size_t repeats = std::max((size_t)3, (size_t)20000000 / objects);
+
+	// the camera's matrices and planes when nothing changed, and after each move
+	const int CAMERA_CALLS = 100000;
+	auto start = std::chrono::steady_clock::now();
+	volatile float sink = 0.0f; // keeps the calls
+	for (int c = 0; c < CAMERA_CALLS; c++) {
+		camera.setAspect(1920, 1080);
+		sink = camera.frustum().planes[FRUSTUM_NEAR].w;
+	}
+	double cached_ns = elapsedMs(start) * 1e6 / CAMERA_CALLS;
+	start = std::chrono::steady_clock::now();
+	for (int c = 0; c < CAMERA_CALLS; c++) {
+		camera.setYawPitch((float)c, 0.0f);
+		sink = camera.frustum().planes[FRUSTUM_NEAR].w;
+	}
+	double moved_ns = elapsedMs(start) * 1e6 / CAMERA_CALLS;
+	(void)sink;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nFrustum culling benchmark, " << objects << " objects, " << jobs.threadCount() + 1 << " threads:" << std::endl
+		<< "\tcamera frustum(), unchanged " << cached_ns << " ns, after a move " << moved_ns << " ns" << std::endl
+		<< "\t" << std::left << std::setw(10) << "bounds" << std::setw(12) << "visible" << std::setw(12) << "scalar ms"
+		<< std::setw(12) << "AVX2 ms" << std::setw(16) << "all threads ms" << "matches" << std::endl;
+
+	std::vector<uint32_t> reference(objects), visible(objects);
+	for (int kind = 0; kind < 2; kind++) {
+		auto cull = [&](int mode, uint32_t* out) {
+			const Frustum& frustum = camera.frustum();
+			if (mode == 0)
+				return kind == 0 ? cullBoxesScalar(frustum, cull_boxes, 0, objects, out) : cullSpheresScalar(frustum, cull_spheres, 0, objects, out);
+			JobSystem* threads = mode == 2 ? &jobs : nullptr;
+			return kind == 0 ? cullBoxes(frustum, cull_boxes, out, threads) : cullSpheres(frustum, cull_spheres, out, threads);
+		};
+		double ms[3] = { 0.0, 0.0, 0.0 };
+		size_t visible_total = 0;
+		bool matches = true;
+		for (size_t r = 0; r < repeats; r++) {
+			camera.setYawPitch(360.0f * r / repeats, 10.0f * unit(random));
+			size_t expected = 0;
+			for (int mode = 0; mode < 3; mode++) {
+				if (mode > 0 && !mathLevelSupported(MathLevel::AVX2))
+					continue;
+				start = std::chrono::steady_clock::now();
+				size_t found = cull(mode, mode == 0 ? reference.data() : visible.data());
+				ms[mode] += elapsedMs(start) / repeats;
+				if (mode == 0)
+					expected = found;
+				else
+					matches = matches && found == expected && std::memcmp(reference.data(), visible.data(), found * sizeof(uint32_t)) == 0;
+			}
+			visible_total += expected;
+		}
+		std::cout << "\t" << std::setw(10) << (kind == 0 ? "boxes" : "spheres") << std::setw(12) << visible_total / repeats
+			<< std::setw(12) << ms[0] << std::setw(12) << ms[1] << std::setw(16) << ms[2] << (matches ? "yes" : "NO") << std::endl;
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+}
+
+// 'objects' tori scattered around and behind a wall of boxes, culled on the GPU against the frustum and last frame's
+// depth and drawn from the commands the cull wrote, at a hundredth, a tenth and all of the objects. prints the time to
+// issue a frame's culling, drawing and pyramid calls, the cull and the pyramid alone waited on, how many objects the
+// frustum and then the pyramid left, and whether the shader drew exactly what the CPU reference would have, decisions
+// within rounding aside. false when it did not. a software driver runs the passes inside the calls, so there the
+// submit time is the work itself
+inline bool benchmarkGpuCulling(size_t objects = 100000, int frames = 10, int width = 1280, int height = 720) {
+	objects = std::max(objects, (size_t)1000);
+	frames = std::max(frames, 2);
+
+	// mesh 0 is the box the wall is built from, the rest are tori
+	MeshPool pool;
+	std::vector<Aabb> mesh_bounds;
+	for (int m = 0; m < 5; m++) {
+		MeshData mesh = m == 0 ? generateBoxMesh() : generateTorusMesh(8 + m * 4, 6 + m * 2);
+		pool.add(mesh);
+		mesh_bounds.push_back({ PackedVec3(glm::make_vec3(mesh.bounds_min)), PackedVec3(glm::make_vec3(mesh.bounds_max)) });
+	}
+	pool.upload();
+
+	// the wall first, so every prefix of the objects has it. its panels are a unit apart, the gaps are seen through
+	const int WALL_PANELS = 12;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::mat4> transforms(objects);
+	std::vector<Aabb> local_bounds(objects), world_bounds(objects);
+	std::vector<uint32_t> object_meshes(objects);
+	for (size_t i = 0; i < objects; i++) {
+		if (i < WALL_PANELS) {
+			transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3((i - (WALL_PANELS - 1) * 0.5f) * 7.0f, 2.0f, -20.0f)), glm::vec3(3.0f, 12.0f, 0.5f));
+			object_meshes[i] = 0;
+		}
+		else {
+			glm::vec3 position(unit(random) * 250.0f, unit(random) * 100.0f, -165.0f + unit(random) * 135.0f);
+			transforms[i] = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), position), unit(random) * 3.2f, glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(1.5f));
+			object_meshes[i] = 1 + (uint32_t)(i % 4);
+		}
+		local_bounds[i] = mesh_bounds[object_meshes[i]];
+	}
+	transformAabbs(transforms.data(), local_bounds.data(), world_bounds.data(), objects);
+	std::vector<GpuCullObject> cull_objects(objects);
+	for (size_t i = 0; i < objects; i++)
+		cull_objects[i] = { (world_bounds[i].min + world_bounds[i].max) * 0.5f, object_meshes[i],
+			(world_bounds[i].max - world_bounds[i].min) * 0.5f, (uint32_t)i };
+	pool.setTransforms(transforms.data(), objects);
+
+	// the frame is drawn offscreen, the pyramid needs a depth texture
+	unsigned int framebuffer, color_texture, depth_texture;
+	glCreateTextures(GL_TEXTURE_2D, 1, &color_texture);
+	glTextureStorage2D(color_texture, 1, GL_RGBA8, width, height);
+	glCreateTextures(GL_TEXTURE_2D, 1, &depth_texture);
+	glTextureStorage2D(depth_texture, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, color_texture, 0);
+	glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depth_texture, 0);
+
+	Shader shader("glsl/mesh_pulled_vertex.glsl", "glsl/mesh_fragment.glsl");
+	GpuCuller culler(pool);
+	DepthPyramid pyramid(width, height);
+	Camera camera(glm::vec3(0.0f, 2.0f, 10.0f), glm::vec3(0.0f, 2.0f, 0.0f), 60.0f, (float)width / (float)height, 0.5f, 400.0f);
+	glEnable(GL_DEPTH_TEST);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "\nGPU culling benchmark, " << width << "x" << height << ", mean of " << frames - 1 << " frames, "
+		<< (culler.drawCountSupported() ? "draw count read by glMultiDrawElementsIndirectCount" : "commands cleared for glMultiDrawElementsIndirect")
+		<< ":" << std::endl
+		<< "\t" << std::left << std::setw(10) << "objects" << std::setw(12) << "in frustum" << std::setw(10) << "drawn"
+		<< std::setw(12) << "submit ms" << std::setw(10) << "cull ms" << std::setw(12) << "pyramid ms" << std::setw(12) << "frame ms"
+		<< "matches CPU reference" << std::endl;
+	bool all_match = true;
+	for (size_t count = objects / 100; count <= objects; count *= 10) {
+		culler.setObjects(cull_objects.data(), count);
+		pyramid.resize(width, height); // no occlusion on the first frame
+		double submit_ms = 0.0, frame_ms = 0.0;
+		size_t in_frustum = 0, drawn = 0, mismatches = 0, within_rounding = 0;
+		// frame 0 has no pyramid yet, the frames after it are timed and one more is checked
+		for (int f = 0; f <= frames; f++) {
+			camera.setYawPitch(std::sin(f * 0.5f) * 2.0f, 0.0f); // sway, so the pyramid is always another frame's
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			culler.cull(camera.frustum(), &pyramid);
+
+			// the checked frame's draws against the reference, before its pyramid is replaced
+			bool timed = f > 0 && f < frames;
+			if (f == frames) {
+				drawn = culler.readDrawCount();
+				std::vector<DrawElementsIndirectCommand> commands(drawn);
+				glGetNamedBufferSubData(culler.command_buffer, 0, (GLsizeiptr)(drawn * sizeof(DrawElementsIndirectCommand)), commands.data());
+				std::vector<uint8_t> gpu_visible(count, 0);
+				for (const DrawElementsIndirectCommand& command : commands) {
+					DrawElementsIndirectCommand expected = pool.command(command.base_instance < count ? object_meshes[command.base_instance] : 0, command.base_instance);
+					bool valid = command.base_instance < count && !gpu_visible[command.base_instance]
+						&& std::memcmp(&command, &expected, sizeof(command)) == 0;
+					mismatches += !valid; // out of range, drawn twice or the wrong mesh
+					if (command.base_instance < count)
+						gpu_visible[command.base_instance] = 1;
+				}
+				std::vector<DepthLevel> levels = pyramid.readBack();
+				std::vector<DepthLevel> no_levels;
+				for (size_t i = 0; i < count; i++) {
+					bool borderline = false, ignored = false;
+					in_frustum += cullObjectReference(cull_objects[i], camera.frustum(), pyramid.viewProjection(), no_levels, ignored);
+					bool expected = cullObjectReference(cull_objects[i], camera.frustum(), pyramid.viewProjection(), levels, borderline);
+					if (expected != (gpu_visible[i] != 0)) {
+						within_rounding += borderline;
+						mismatches += !borderline;
+					}
+				}
+			}
+
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glViewport(0, 0, width, height);
+			glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			shader.use();
+			shader.setMat4("view", camera.view());
+			shader.setMat4("projection", camera.projection());
+			shader.setVec3("light_direction", glm::vec3(0.4f, 0.8f, 0.6f));
+			shader.setVec3("color", glm::vec3(0.8f, 0.75f, 0.7f));
+			pool.bind();
+			culler.draw(pool);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			pyramid.build(depth_texture, camera.viewProjection());
+			if (timed)
+				submit_ms += elapsedMs(start) / (frames - 1);
+			glFinish();
+			if (timed)
+				frame_ms += elapsedMs(start) / (frames - 1);
+		}
+
+		// each pass alone, waited on
+		const int PASSES = 5;
+		glFinish();
+		auto start = std::chrono::steady_clock::now();
+		for (int p = 0; p < PASSES; p++)
+			culler.cull(camera.frustum(), &pyramid);
+		glFinish();
+		double cull_ms = elapsedMs(start) / PASSES;
+		start = std::chrono::steady_clock::now();
+		for (int p = 0; p < PASSES; p++)
+			pyramid.build(depth_texture, camera.viewProjection());
+		glFinish();
+		double pyramid_ms = elapsedMs(start) / PASSES;
+
+		all_match = all_match && mismatches == 0;
+		std::cout << "\t" << std::setw(10) << count << std::setw(12) << in_frustum << std::setw(10) << drawn << std::setw(12) << submit_ms
+			<< std::setw(10) << cull_ms << std::setw(12) << pyramid_ms << std::setw(12) << frame_ms
+			<< (mismatches == 0 ? "yes" : "NO, " + std::to_string(mismatches) + " differ")
+			<< (within_rounding > 0 ? ", " + std::to_string(within_rounding) + " within rounding" : "") << std::endl;
+	}
+	std::cout << std::right << std::defaultfloat << std::setprecision(6);
+
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &color_texture);
+	glDeleteTextures(1, &depth_texture);
+	glDeleteProgram(shader.program);
+	return all_match;
+}
@@ -0,0 +1,168 @@
+#pragma once
+// camera class defined here
+// a perspective camera that keeps its view, projection and view projection matrices and the frustum planes of the
+// latter, and only rebuilds what depends on an input that actually changed. setting the same aspect ratio every frame
+// costs a compare, a resize rebuilds the projection and the product, moving rebuilds the view and the product
+//
+// the frustum is six planes in world space, normal pointing inside and normalized so the plane equation is a signed
+// distance. it is extracted from the rows of the view projection (Gribb and Hartmann) for GL's -w..w clip depth, which
+// is what glm::perspective() builds without GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+enum FrustumPlane {
+	FRUSTUM_LEFT,
+	FRUSTUM_RIGHT,
+	FRUSTUM_BOTTOM,
+	FRUSTUM_TOP,
+	FRUSTUM_NEAR,
+	FRUSTUM_FAR,
+	FRUSTUM_PLANES,
+};
+
+// xyz the inward normal, w the distance term: dot(xyz, point) + w is the signed distance of 'point'
+struct Frustum {
+	glm::vec4 planes[FRUSTUM_PLANES];
+};
+
+inline Frustum extractFrustum(const glm::mat4& view_projection) {
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+	Frustum frustum;
+	frustum.planes[FRUSTUM_LEFT] = rows[3] + rows[0];
+	frustum.planes[FRUSTUM_RIGHT] = rows[3] - rows[0];
+	frustum.planes[FRUSTUM_BOTTOM] = rows[3] + rows[1];
+	frustum.planes[FRUSTUM_TOP] = rows[3] - rows[1];
+	frustum.planes[FRUSTUM_NEAR] = rows[3] + rows[2];
+	frustum.planes[FRUSTUM_FAR] = rows[3] - rows[2];
+	for (glm::vec4& plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+			plane /= length;
+	}
+	return frustum;
+}
+
+class Camera {
+public:
+	// at 'position' looking at 'target', a vertical field of view of 'fov' degrees
+	Camera(const glm::vec3& position = glm::vec3(0.0f, 0.0f, 5.0f), const glm::vec3& target = glm::vec3(0.0f),
+		float fov = 45.0f, float aspect = 16.0f / 9.0f, float near_plane = 0.1f, float far_plane = 100.0f)
+		: eye(position), front(glm::normalize(target - position)), fov(fov), aspect(aspect), near_plane(near_plane), far_plane(far_plane) {}
+
+	void setPosition(const glm::vec3& position) {
+		if (position != eye) {
+			eye = position;
+			view_dirty = true;
+		}
+	}
+
+	// look along 'direction', which does not have to be normalized
+	void setDirection(const glm::vec3& direction) {
+		glm::vec3 normalized = glm::normalize(direction);
+		if (normalized != front) {
+			front = normalized;
+			view_dirty = true;
+		}
+	}
+
+	void lookAt(const glm::vec3& target) {
+		setDirection(target - eye);
+	}
+
+	// yaw around the world up axis from -z, pitch up from the horizon, in degrees
+	void setYawPitch(float yaw, float pitch) {
+		float y = glm::radians(yaw), p = glm::radians(pitch);
+		setDirection(glm::vec3(std::sin(y) * std::cos(p), std::sin(p), -std::cos(y) * std::cos(p)));
+	}
+
+	void setPerspective(float fov_degrees, float aspect_ratio, float near_distance, float far_distance) {
+		if (fov_degrees != fov || aspect_ratio != aspect || near_distance != near_plane || far_distance != far_plane) {
+			fov = fov_degrees;
+			aspect = aspect_ratio;
+			near_plane = near_distance;
+			far_plane = far_distance;
+			projection_dirty = true;
+		}
+	}
+
+	// the framebuffer's width over height, a zero height (minimized window) keeps the last ratio
+	void setAspect(int width, int height) {
+		if (height > 0)
+			setPerspective(fov, (float)width / (float)height, near_plane, far_plane);
+	}
+
+	const glm::vec3& position() const {
+		return eye;
+	}
+
+	const glm::vec3& direction() const {
+		return front;
+	}
+
+	const glm::mat4& view() {
+		if (view_dirty) {
+			view_matrix = glm::lookAt(eye, eye + front, up());
+			view_dirty = false;
+			product_dirty = true;
+		}
+		return view_matrix;
+	}
+
+	const glm::mat4& projection() {
+		if (projection_dirty) {
+			projection_matrix = glm::perspective(glm::radians(fov), aspect, near_plane, far_plane);
+			projection_dirty = false;
+			product_dirty = true;
+		}
+		return projection_matrix;
+	}
+
+	const glm::mat4& viewProjection() {
+		view();
+		projection();
+		if (product_dirty) {
+			view_projection = projection_matrix * view_matrix;
+			frustum_planes = extractFrustum(view_projection);
+			product_dirty = false;
+			revision++;
+		}
+		return view_projection;
+	}
+
+	// in world space, as of the current view projection
+	const Frustum& frustum() {
+		viewProjection();
+		return frustum_planes;
+	}
+
+	// counts view projection rebuilds, so whatever was derived from an older one can tell it is stale
+	uint64_t version() {
+		viewProjection();
+		return revision;
+	}
+
+private:
+	glm::vec3 eye;
+	glm::vec3 front;
+	float fov, aspect, near_plane, far_plane;
+
+	glm::mat4 view_matrix = glm::mat4(1.0f);
+	glm::mat4 projection_matrix = glm::mat4(1.0f);
+	glm::mat4 view_projection = glm::mat4(1.0f);
+	Frustum frustum_planes = {};
+	bool view_dirty = true;
+	bool projection_dirty = true;
+	bool product_dirty = true;
+	uint64_t revision = 0;
+
+	// world up, or world z when looking straight up or down
+	glm::vec3 up() const {
+		return std::abs(front.y) > 0.9999f ? glm::vec3(0.0f, 0.0f, front.y > 0.0f ? 1.0f : -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+};
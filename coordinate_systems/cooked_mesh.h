@@ -0,0 +1,189 @@
+#pragma once
+// cooked mesh format defined here
+// an imported mesh written out exactly as the GPU buffers hold it, so loading is a memory mapping and two buffer uploads
+// straight from the mapped pages, with nothing parsed or copied on the CPU. every process opening the same file shares
+// its pages through the OS page cache
+//
+// layout, all integers little endian:
+//   CookedMeshHeader
+//   vertices    MeshVertex[vertex_count], interleaved as mesh.h sets up the VAO
+//   indices     uint16_t or uint32_t[index_count], a triangle list
+// both blobs start on a COOKED_MESH_ALIGNMENT boundary, page aligned so a driver can pin or DMA them in place
+
+#include <mapped_file.h>
+#include <mesh_data.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char COOKED_MESH_MAGIC[8] = { 'C', 'O', 'O', 'K', 'M', 'E', 'S', 'H' };
+const uint32_t COOKED_MESH_VERSION = 1;
+const uint64_t COOKED_MESH_ALIGNMENT = 4096;
+
+// flags
+const uint32_t COOKED_MESH_NORMALS = 1; // normals came from the source file, not computeNormals()
+const uint32_t COOKED_MESH_UVS = 2;
+
+struct CookedMeshHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t vertex_stride; // sizeof(MeshVertex) when written
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t index_size;    // 2 or 4 bytes
+	uint32_t flags;
+	float bounds_min[3];
+	float bounds_max[3];
+	uint64_t vertex_offset; // from the start of the file
+	uint64_t vertex_bytes;
+	uint64_t index_offset;
+	uint64_t index_bytes;
+};
+
+static_assert(sizeof(CookedMeshHeader) == 88, "CookedMeshHeader must match the file layout");
+
+// write 'mesh' as a cooked file, false when it cannot be written or has nothing to draw
+inline bool cookMesh(const MeshData& mesh, const std::string& path) {
+	if (mesh.vertices.empty() || mesh.indices.empty() || mesh.vertices.size() > UINT32_MAX || mesh.indices.size() > UINT32_MAX) {
+		std::cout << "ERROR::COOKED_MESH::NOTHING_TO_COOK: " << path << std::endl;
+		return false;
+	}
+	std::vector<unsigned char> indices = packIndices(mesh);
+
+	auto align = [](uint64_t offset) { return (offset + COOKED_MESH_ALIGNMENT - 1) / COOKED_MESH_ALIGNMENT * COOKED_MESH_ALIGNMENT; };
+	CookedMeshHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, COOKED_MESH_MAGIC, sizeof(COOKED_MESH_MAGIC));
+	header.version = COOKED_MESH_VERSION;
+	header.vertex_stride = sizeof(MeshVertex);
+	header.vertex_count = (uint32_t)mesh.vertices.size();
+	header.index_count = (uint32_t)mesh.indices.size();
+	header.index_size = (uint32_t)mesh.indexSize();
+	header.flags = (mesh.has_normals ? COOKED_MESH_NORMALS : 0) | (mesh.has_uvs ? COOKED_MESH_UVS : 0);
+	std::memcpy(header.bounds_min, mesh.bounds_min, sizeof(header.bounds_min));
+	std::memcpy(header.bounds_max, mesh.bounds_max, sizeof(header.bounds_max));
+	header.vertex_offset = align(sizeof(CookedMeshHeader));
+	header.vertex_bytes = mesh.vertices.size() * sizeof(MeshVertex);
+	header.index_offset = align(header.vertex_offset + header.vertex_bytes);
+	header.index_bytes = indices.size();
+
+	std::ofstream output(path, std::ios::binary);
+	if (!output) {
+		std::cout << "ERROR::COOKED_MESH::FAILED_TO_WRITE: " << path << std::endl;
+		return false;
+	}
+	const std::vector<char> padding(COOKED_MESH_ALIGNMENT, 0);
+	output.write((const char*)&header, sizeof(header));
+	output.write(padding.data(), header.vertex_offset - sizeof(header));
+	output.write((const char*)mesh.vertices.data(), header.vertex_bytes);
+	output.write(padding.data(), header.index_offset - (header.vertex_offset + header.vertex_bytes));
+	output.write((const char*)indices.data(), header.index_bytes);
+	if (!output) {
+		std::cout << "ERROR::COOKED_MESH::FAILED_TO_WRITE: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// a mapped cooked file, the blob pointers stay valid until close() or destruction
+class CookedMesh {
+public:
+	CookedMeshHeader header;
+
+	CookedMesh() {
+		std::memset(&header, 0, sizeof(header));
+	}
+
+	CookedMesh(const CookedMesh&) = delete;
+	CookedMesh& operator=(const CookedMesh&) = delete;
+
+	// map the file and check the header against its size. nothing past the header is touched, so index values are
+	// trusted as cookMesh() wrote them
+	bool open(const std::string& path) {
+		close();
+		if (!file.open(path)) {
+			std::cout << "ERROR::COOKED_MESH::FILE_NOT_FOUND: " << path << std::endl;
+			return false;
+		}
+		if (file.size() >= sizeof(CookedMeshHeader))
+			std::memcpy(&header, file.data(), sizeof(CookedMeshHeader));
+		if (file.size() < sizeof(CookedMeshHeader) || std::memcmp(header.magic, COOKED_MESH_MAGIC, sizeof(COOKED_MESH_MAGIC)) != 0
+			|| header.version != COOKED_MESH_VERSION || header.vertex_stride != sizeof(MeshVertex)) {
+			std::cout << "ERROR::COOKED_MESH::UNSUPPORTED_FILE: " << path << std::endl;
+			close();
+			return false;
+		}
+		uint64_t size = file.size();
+		bool fits = header.vertex_offset <= size && header.vertex_bytes <= size - header.vertex_offset
+			&& header.index_offset <= size && header.index_bytes <= size - header.index_offset;
+		bool consistent = (header.index_size == 2 || header.index_size == 4)
+			&& header.vertex_count > 0 && header.index_count > 0
+			&& header.vertex_bytes == (uint64_t)header.vertex_count * sizeof(MeshVertex)
+			&& header.index_bytes == (uint64_t)header.index_count * header.index_size
+			&& header.vertex_offset % alignof(MeshVertex) == 0 && header.index_offset % header.index_size == 0;
+		if (!fits || !consistent) {
+			std::cout << "ERROR::COOKED_MESH::CORRUPT_FILE: " << path << std::endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+		file.close();
+		std::memset(&header, 0, sizeof(header));
+	}
+
+	bool isOpen() const {
+		return file.data() != nullptr;
+	}
+
+	const unsigned char* vertices() const {
+		return file.data() + header.vertex_offset;
+	}
+
+	const unsigned char* indices() const {
+		return file.data() + header.index_offset;
+	}
+
+private:
+	MappedFile file;
+};
+
+// read a cooked file back into 'mesh', for tools that want to edit or re-cook it. drawing should upload a CookedMesh
+// directly instead (see Mesh in mesh.h)
+inline bool loadCookedMesh(const std::string& path, MeshData& mesh) {
+	CookedMesh cooked;
+	if (!cooked.open(path))
+		return false;
+	const CookedMeshHeader& header = cooked.header;
+	mesh = MeshData();
+	mesh.vertices.resize(header.vertex_count);
+	std::memcpy(mesh.vertices.data(), cooked.vertices(), header.vertex_bytes);
+	mesh.indices.resize(header.index_count);
+	for (size_t i = 0; i < mesh.indices.size(); i++) {
+		uint32_t index;
+		if (header.index_size == 2) {
+			uint16_t narrow;
+			std::memcpy(&narrow, cooked.indices() + i * 2, 2);
+			index = narrow;
+		}
+		else
+			std::memcpy(&index, cooked.indices() + i * 4, 4);
+		if (index >= header.vertex_count) {
+			std::cout << "ERROR::COOKED_MESH::INDEX_OUT_OF_RANGE: " << path << std::endl;
+			mesh = MeshData();
+			return false;
+		}
+		mesh.indices[i] = index;
+	}
+	std::memcpy(mesh.bounds_min, header.bounds_min, sizeof(mesh.bounds_min));
+	std::memcpy(mesh.bounds_max, header.bounds_max, sizeof(mesh.bounds_max));
+	mesh.has_normals = (header.flags & COOKED_MESH_NORMALS) != 0;
+	mesh.has_uvs = (header.flags & COOKED_MESH_UVS) != 0;
+	return true;
+}
@@ -0,0 +1,270 @@
+#pragma once
+// frame arenas defined here
+// bump allocators for data that only lives for a frame or less. allocating is moving an offset forward and freeing is
+// moving it back, nothing is handed back one allocation at a time, so nothing stored in them may need a destructor
+//
+// LinearArena is CPU memory. when a frame asks for more than it holds, another block is chained on instead of failing,
+// and the next rewind to the start folds every block into one as large as the frame needed. the first frames grow it,
+// after that it settles and never allocates again. scratchArena() is one per thread for transient work inside a
+// function, taken with a ScratchScope that rewinds whatever was allocated under it
+//
+// GpuFrameArena is a persistently mapped GL buffer cut into one region per frame in flight (two, double buffered). the
+// CPU writes a frame's transforms and commands straight into its region and binds ranges of the buffer, while the GPU
+// may still be reading the previous frame's region. beginFrame() waits on the fence of the region it is about to reuse,
+// which with two regions only stalls when the GPU is more than a frame behind
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+class LinearArena {
+public:
+	// where the arena was, for rewind()
+	struct Marker {
+		size_t block = 0;
+		size_t offset = 0;
+	};
+
+	explicit LinearArena(size_t capacity = 64 * 1024) {
+		addBlock(std::max(capacity, (size_t)256));
+	}
+
+	~LinearArena() {
+		for (Block& block : blocks)
+			std::free(block.data);
+	}
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// 'bytes' at an 'alignment' multiple (a power of two), never null
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+		for (;;) {
+			Block& block = blocks[current];
+			uintptr_t address = ((uintptr_t)block.data + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			size_t end = (size_t)(address - (uintptr_t)block.data) + bytes;
+			if (end <= block.size) {
+				offset = end;
+				high_water = std::max(high_water, used());
+				return (void*)address;
+			}
+			// the rest of this block is skipped, the next one that fits takes the allocation
+			used_before += block.size;
+			offset = 0;
+			if (++current == blocks.size())
+				addBlock(std::max(block.size * 2, bytes + alignment));
+		}
+	}
+
+	// 'count' uninitialized elements
+	template <typename T>
+	T* allocate(size_t count = 1) {
+		static_assert(std::is_trivially_destructible<T>::value, "arena memory is dropped, not destroyed");
+		return (T*)allocate(count * sizeof(T), alignof(T));
+	}
+
+	Marker mark() const {
+		return { current, offset };
+	}
+
+	// drop everything allocated since 'marker'. back at the start, extra blocks are replaced by a single one
+	void rewind(const Marker& marker) {
+		current = marker.block;
+		offset = marker.offset;
+		used_before = 0;
+		for (size_t b = 0; b < current; b++)
+			used_before += blocks[b].size;
+		if (current == 0 && offset == 0 && blocks.size() > 1) {
+			for (Block& block : blocks)
+				std::free(block.data);
+			blocks.clear();
+			addBlock(high_water);
+		}
+	}
+
+	// start of a frame, everything from the last one is dropped
+	void reset() {
+		rewind(Marker());
+	}
+
+	size_t used() const {
+		return used_before + offset;
+	}
+
+	size_t capacity() const {
+		size_t total = 0;
+		for (const Block& block : blocks)
+			total += block.size;
+		return total;
+	}
+
+	// the most that was ever in use at once
+	size_t highWater() const {
+		return high_water;
+	}
+
+	// blocks that had to be allocated, 1 when the arena never outgrew its first block
+	uint64_t blockAllocations() const {
+		return block_allocations;
+	}
+
+private:
+	struct Block {
+		char* data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t current = 0;     // block being bumped
+	size_t offset = 0;      // into the current block
+	size_t used_before = 0; // bytes of the blocks before the current one
+	size_t high_water = 0;
+	uint64_t block_allocations = 0;
+
+	void addBlock(size_t size) {
+		// malloc is aligned for any fundamental type, larger alignments are padded inside the block
+		char* data = (char*)std::malloc(size);
+		if (data == nullptr)
+			throw std::bad_alloc();
+		blocks.push_back({ data, size });
+		block_allocations++;
+	}
+};
+
+// the calling thread's arena for transient data
+inline LinearArena& scratchArena() {
+	thread_local LinearArena arena(256 * 1024);
+	return arena;
+}
+
+// everything allocated from the arena while this is alive goes when it does, scopes nest
+class ScratchScope {
+public:
+	explicit ScratchScope(LinearArena& arena = scratchArena()) : arena(arena), marker(arena.mark()) {}
+
+	~ScratchScope() {
+		arena.rewind(marker);
+	}
+
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	template <typename T>
+	T* allocate(size_t count = 1) {
+		return arena.allocate<T>(count);
+	}
+
+private:
+	LinearArena& arena;
+	LinearArena::Marker marker;
+};
+
+// a range of the arena's buffer, written through 'data' and bound at 'offset'
+struct GpuFrameAllocation {
+	void* data = nullptr;
+	GLintptr offset = 0;
+
+	explicit operator bool() const {
+		return data != nullptr;
+	}
+};
+
+class GpuFrameArena {
+public:
+	static const int DEFAULT_FRAMES = 2;
+
+	unsigned int buffer = 0;
+
+	// 'bytes' for each of 'frames' regions, rounded up so every region starts bindable
+	explicit GpuFrameArena(size_t bytes, int frames = DEFAULT_FRAMES)
+		: fences(std::max(frames, 1), nullptr), frame(std::max(frames, 1) - 1) {
+		GLint uniform_alignment = 256, storage_alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+		bind_alignment = (size_t)std::max({ uniform_alignment, storage_alignment, 16 });
+		frame_bytes = (bytes + bind_alignment - 1) & ~(bind_alignment - 1);
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, (GLsizeiptr)(frame_bytes * fences.size()), nullptr, flags);
+		mapped = (char*)glMapNamedBufferRange(buffer, 0, (GLsizeiptr)(frame_bytes * fences.size()), flags);
+		if (mapped == nullptr)
+			std::cout << "ERROR::FRAME_ARENA::MAP_FAILED" << std::endl;
+	}
+
+	~GpuFrameArena() {
+		for (GLsync fence : fences)
+			glDeleteSync(fence); // null is ignored
+		glDeleteBuffers(1, &buffer); // unmaps it
+	}
+
+	GpuFrameArena(const GpuFrameArena&) = delete;
+	GpuFrameArena& operator=(const GpuFrameArena&) = delete;
+
+	// move on to the next region, once the GPU is done with what was written to it frames ago
+	void beginFrame() {
+		frame = (frame + 1) % fences.size();
+		offset = 0;
+		GLsync& fence = fences[frame];
+		if (fence == nullptr)
+			return;
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			stalls++;
+			while (status == GL_TIMEOUT_EXPIRED)
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// 'bytes' of this frame's region, empty when it is full. 'alignment' 0 is what any buffer range binding needs
+	GpuFrameAllocation allocate(size_t bytes, size_t alignment = 0) {
+		if (alignment == 0)
+			alignment = bind_alignment;
+		size_t start = (offset + alignment - 1) & ~(alignment - 1);
+		if (mapped == nullptr || start + bytes > frame_bytes) {
+			overflows++;
+			return GpuFrameAllocation();
+		}
+		offset = start + bytes;
+		high_water = std::max(high_water, offset);
+		GLintptr base = (GLintptr)(frame * frame_bytes + start);
+		return { mapped + base, base };
+	}
+
+	// after the frame's last draw reading the region
+	void endFrame() {
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	size_t frameBytes() const {
+		return frame_bytes;
+	}
+
+	void printStats() const {
+		std::cout << "\nFrame arena statistics:" << std::endl
+			<< "\tRegions        : " << fences.size() << " of " << frame_bytes / 1024.0 << " KiB" << std::endl
+			<< "\tMost in a frame: " << high_water / 1024.0 << " KiB" << std::endl
+			<< "\tStalls         : " << stalls << std::endl
+			<< "\tOverflows      : " << overflows << std::endl;
+	}
+
+private:
+	size_t frame_bytes = 0;
+	std::vector<GLsync> fences; // one per region, set at the end of the frame that wrote it
+	size_t frame;
+	size_t offset = 0;
+	size_t bind_alignment = 16;
+	char* mapped = nullptr;
+	size_t high_water = 0;
+	uint64_t stalls = 0;    // frames that had to wait for the GPU
+	uint64_t overflows = 0; // allocations refused for want of room
+};
@@ -0,0 +1,244 @@
+#pragma once
+// frustum culling defined here
+// which of many boxes or spheres a frustum can see, written out as a compact ascending list of their indices. bounds
+// are kept SoA, one array per component (CullBoxes, CullSpheres), so the AVX2 kernel tests eight objects against a
+// plane with a handful of instructions and no shuffles. a box is out when its center is further behind a plane than its
+// extent projected on the plane's normal reaches, a sphere when its center is more than its radius behind one. objects
+// the planes only straddle outside a corner of the frustum are kept, as every plane test culling does
+//
+// the AVX2 kernel adds in the order the scalar one does and the scalar one is built without fused multiply adds, so both
+// see the same objects (the FMA math level culls with the AVX2 kernel too). visible indices are packed by a permute
+// from a table of 256 lane orders, one store per eight objects. with a JobSystem the objects are cut into batches that
+// each fill their own part of the output, the parts are then moved together front to back
+
+#include <batch_math.h>
+#include <camera.h>
+#include <frame_arena.h>
+#include <job_system.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// box centers and half extents, one array each
+struct CullBoxes {
+	std::vector<float> center_x, center_y, center_z;
+	std::vector<float> extent_x, extent_y, extent_z;
+
+	void assign(const Aabb* boxes, size_t count) {
+		for (std::vector<float>* component : { &center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z })
+			component->resize(count);
+		for (size_t i = 0; i < count; i++) {
+			PackedVec3 center = (boxes[i].min + boxes[i].max) * 0.5f;
+			PackedVec3 extent = (boxes[i].max - boxes[i].min) * 0.5f;
+			center_x[i] = center.x;
+			center_y[i] = center.y;
+			center_z[i] = center.z;
+			extent_x[i] = extent.x;
+			extent_y[i] = extent.y;
+			extent_z[i] = extent.z;
+		}
+	}
+
+	size_t size() const {
+		return center_x.size();
+	}
+};
+
+// sphere centers and radii, one array each
+struct CullSpheres {
+	std::vector<float> center_x, center_y, center_z, radius;
+
+	// xyz the center, w the radius
+	void assign(const glm::vec4* spheres, size_t count) {
+		for (std::vector<float>* component : { &center_x, &center_y, &center_z, &radius })
+			component->resize(count);
+		for (size_t i = 0; i < count; i++) {
+			center_x[i] = spheres[i].x;
+			center_y[i] = spheres[i].y;
+			center_z[i] = spheres[i].z;
+			radius[i] = spheres[i].w;
+		}
+	}
+
+	size_t size() const {
+		return center_x.size();
+	}
+};
+
+// objects per job, a multiple of eight
+const size_t CULL_BATCH = 16384;
+
+// scalar reference, indices of the visible objects in [begin, end) to 'visible', returns how many
+
+inline size_t cullBoxesScalar(const Frustum& frustum, const CullBoxes& boxes, size_t begin, size_t end, uint32_t* visible) {
+	size_t written = 0;
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes) {
+			float distance = (plane.x * boxes.center_x[i] + plane.y * boxes.center_y[i]) + (plane.z * boxes.center_z[i] + plane.w);
+			float reach = (std::abs(plane.x) * boxes.extent_x[i] + std::abs(plane.y) * boxes.extent_y[i]) + std::abs(plane.z) * boxes.extent_z[i];
+			inside &= !(distance + reach < 0.0f);
+		}
+		visible[written] = (uint32_t)i;
+		written += inside;
+	}
+	return written;
+}
+
+inline size_t cullSpheresScalar(const Frustum& frustum, const CullSpheres& spheres, size_t begin, size_t end, uint32_t* visible) {
+	size_t written = 0;
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes) {
+			float distance = (plane.x * spheres.center_x[i] + plane.y * spheres.center_y[i]) + (plane.z * spheres.center_z[i] + plane.w);
+			inside &= !(distance + spheres.radius[i] < 0.0f);
+		}
+		visible[written] = (uint32_t)i;
+		written += inside;
+	}
+	return written;
+}
+
+#if defined(MATH_X86)
+
+// for every 8 bit mask of visible lanes, the lanes to keep moved to the front, and how many there are
+struct CompactTable {
+	uint32_t lanes[256][8];
+	uint8_t counts[256];
+
+	CompactTable() {
+		for (int mask = 0; mask < 256; mask++) {
+			int count = 0;
+			for (int lane = 0; lane < 8; lane++)
+				if (mask & (1 << lane))
+					lanes[mask][count++] = (uint32_t)lane;
+			for (int lane = count; lane < 8; lane++)
+				lanes[mask][lane] = 0;
+			counts[mask] = (uint8_t)count;
+		}
+	}
+};
+
+inline const CompactTable& compactTable() {
+	static const CompactTable table;
+	return table;
+}
+
+// the indices of the lanes set in 'visible_lanes' from eight starting at 'first', to 'visible'. all eight lanes are
+// stored, the caller's output has room for them
+MATH_TARGET("avx2")
+inline size_t storeVisible8(int visible_lanes, size_t first, uint32_t* visible) {
+	const CompactTable& table = compactTable();
+	__m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	__m256i order = _mm256_loadu_si256((const __m256i*)table.lanes[visible_lanes]);
+	_mm256_storeu_si256((__m256i*)visible, _mm256_permutevar8x32_epi32(indices, order));
+	return table.counts[visible_lanes];
+}
+
+MATH_TARGET("avx2")
+inline size_t cullBoxesAVX2(const Frustum& frustum, const CullBoxes& boxes, size_t begin, size_t end, uint32_t* visible) {
+	__m256 plane[FRUSTUM_PLANES][4], absolute[FRUSTUM_PLANES][3];
+	for (int p = 0; p < FRUSTUM_PLANES; p++)
+		for (int c = 0; c < 4; c++) {
+			plane[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+			if (c < 3)
+				absolute[p][c] = _mm256_set1_ps(std::abs(frustum.planes[p][c]));
+		}
+	__m256 zero = _mm256_setzero_ps();
+	size_t written = 0, i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 cx = _mm256_loadu_ps(&boxes.center_x[i]), cy = _mm256_loadu_ps(&boxes.center_y[i]), cz = _mm256_loadu_ps(&boxes.center_z[i]);
+		__m256 ex = _mm256_loadu_ps(&boxes.extent_x[i]), ey = _mm256_loadu_ps(&boxes.extent_y[i]), ez = _mm256_loadu_ps(&boxes.extent_z[i]);
+		__m256 outside = zero;
+		for (int p = 0; p < FRUSTUM_PLANES; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[p][0], cx), _mm256_mul_ps(plane[p][1], cy)),
+				_mm256_add_ps(_mm256_mul_ps(plane[p][2], cz), plane[p][3]));
+			__m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absolute[p][0], ex), _mm256_mul_ps(absolute[p][1], ey)),
+				_mm256_mul_ps(absolute[p][2], ez));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_LT_OQ));
+		}
+		written += storeVisible8(~_mm256_movemask_ps(outside) & 0xFF, i, visible + written);
+	}
+	return written + cullBoxesScalar(frustum, boxes, i, end, visible + written);
+}
+
+MATH_TARGET("avx2")
+inline size_t cullSpheresAVX2(const Frustum& frustum, const CullSpheres& spheres, size_t begin, size_t end, uint32_t* visible) {
+	__m256 plane[FRUSTUM_PLANES][4];
+	for (int p = 0; p < FRUSTUM_PLANES; p++)
+		for (int c = 0; c < 4; c++)
+			plane[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+	__m256 zero = _mm256_setzero_ps();
+	size_t written = 0, i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 cx = _mm256_loadu_ps(&spheres.center_x[i]), cy = _mm256_loadu_ps(&spheres.center_y[i]), cz = _mm256_loadu_ps(&spheres.center_z[i]);
+		__m256 radius = _mm256_loadu_ps(&spheres.radius[i]);
+		__m256 outside = zero;
+		for (int p = 0; p < FRUSTUM_PLANES; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[p][0], cx), _mm256_mul_ps(plane[p][1], cy)),
+				_mm256_add_ps(_mm256_mul_ps(plane[p][2], cz), plane[p][3]));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+		}
+		written += storeVisible8(~_mm256_movemask_ps(outside) & 0xFF, i, visible + written);
+	}
+	return written + cullSpheresScalar(frustum, spheres, i, end, visible + written);
+}
+
+#endif
+
+// the kernel of a range for the math level in use (see mathKernels())
+template <typename Bounds>
+using CullKernel = size_t (*)(const Frustum&, const Bounds&, size_t, size_t, uint32_t*);
+
+inline CullKernel<CullBoxes> boxCullKernel() {
+#if defined(MATH_X86)
+	if (mathKernels().level != MathLevel::Scalar)
+		return cullBoxesAVX2;
+#endif
+	return cullBoxesScalar;
+}
+
+inline CullKernel<CullSpheres> sphereCullKernel() {
+#if defined(MATH_X86)
+	if (mathKernels().level != MathLevel::Scalar)
+		return cullSpheresAVX2;
+#endif
+	return cullSpheresScalar;
+}
+
+// every batch culled into its own stretch of 'visible', on 'jobs' when given, then the stretches moved together
+template <typename Bounds>
+inline size_t cullBatches(CullKernel<Bounds> kernel, const Frustum& frustum, const Bounds& bounds, uint32_t* visible, JobSystem* jobs) {
+	size_t count = bounds.size();
+	size_t batches = (count + CULL_BATCH - 1) / CULL_BATCH;
+	if (jobs == nullptr || batches < 2)
+		return kernel(frustum, bounds, 0, count, visible);
+
+	ScratchScope scratch;
+	size_t* found = scratch.allocate<size_t>(batches);
+	jobs->parallelFor(batches, 1, [&](size_t first, size_t last) {
+		for (size_t b = first; b < last; b++) {
+			size_t begin = b * CULL_BATCH;
+			found[b] = kernel(frustum, bounds, begin, std::min(begin + CULL_BATCH, count), visible + begin);
+		}
+	});
+	size_t written = found[0];
+	for (size_t b = 1; b < batches; b++) {
+		std::memmove(visible + written, visible + b * CULL_BATCH, found[b] * sizeof(uint32_t));
+		written += found[b];
+	}
+	return written;
+}
+
+// indices of the boxes 'frustum' can see, ascending, to 'visible', which has room for one per box. returns how many
+inline size_t cullBoxes(const Frustum& frustum, const CullBoxes& boxes, uint32_t* visible, JobSystem* jobs = nullptr) {
+	return cullBatches(boxCullKernel(), frustum, boxes, visible, jobs);
+}
+
+inline size_t cullSpheres(const Frustum& frustum, const CullSpheres& spheres, uint32_t* visible, JobSystem* jobs = nullptr) {
+	return cullBatches(sphereCullKernel(), frustum, spheres, visible, jobs);
+}
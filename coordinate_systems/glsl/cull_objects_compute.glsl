@@ -0,0 +1,113 @@
+// object culling compute shader (gpu_culling.h): tests every object's world box against the frustum and then against
+// last frame's depth pyramid, and appends a draw command for each one that survives. the commands are compacted with
+// one atomic add per work group on the draw count, which glMultiDrawElementsIndirectCount() reads as its count
+
+#version 460 core
+layout (local_size_x = 64) in;
+
+struct CullObject {
+	vec3 center;
+	uint mesh;
+	vec3 extent;
+	uint transform;
+};
+
+struct PooledMesh {
+	uint first_index;
+	uint index_count;
+	uint base_vertex;
+	uint vertex_count;
+};
+
+struct DrawCommand {
+	uint count;
+	uint instance_count;
+	uint first_index;
+	int base_vertex;
+	uint base_instance;
+};
+
+layout (std430, binding = 2) readonly buffer Objects { CullObject objects[]; };
+layout (std430, binding = 3) readonly buffer Meshes { PooledMesh meshes[]; };
+layout (std430, binding = 4) writeonly buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 5) buffer DrawCount { uint draw_count; };
+
+uniform uint object_count;
+uniform vec4 planes[6];     // world space, normals inward
+uniform bool occlusion;     // false until a pyramid has been built
+uniform mat4 pyramid_view_projection;
+uniform ivec2 pyramid_size;
+uniform int pyramid_levels;
+uniform sampler2D pyramid;
+
+shared uint group_count;
+shared uint group_base;
+
+// the same sums in the same order as cullBoxesScalar() (frustum_culling.h)
+bool insideFrustum(vec3 center, vec3 extent) {
+	for (int p = 0; p < 6; p++) {
+		vec4 plane = planes[p];
+		float distance = (plane.x * center.x + plane.y * center.y) + (plane.z * center.z + plane.w);
+		float reach = (abs(plane.x) * extent.x + abs(plane.y) * extent.y) + abs(plane.z) * extent.z;
+		if (distance + reach < 0.0)
+			return false;
+	}
+	return true;
+}
+
+// whether the box is behind everything last frame drew over its screen rectangle. the rectangle is read at the level
+// where it spans at most two texels each way, so four fetches cover it
+bool occluded(vec3 center, vec3 extent) {
+	vec3 ndc_min = vec3(3.4e38), ndc_max = vec3(-3.4e38);
+	for (int corner = 0; corner < 8; corner++) {
+		vec3 side = vec3((corner & 1) != 0 ? 1.0 : -1.0, (corner & 2) != 0 ? 1.0 : -1.0, (corner & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = pyramid_view_projection * vec4(center + extent * side, 1.0);
+		if (clip.w <= 1e-5)
+			return false; // reaches behind last frame's eye, no rectangle to test
+		vec3 ndc = clip.xyz / clip.w;
+		ndc_min = min(ndc_min, ndc);
+		ndc_max = max(ndc_max, ndc);
+	}
+	if (any(lessThan(ndc_max.xy, vec2(-1.0))) || any(greaterThan(ndc_min.xy, vec2(1.0))))
+		return false; // off screen last frame, nothing there to hide it
+
+	float nearest = ndc_min.z * 0.5 + 0.5;
+	ivec2 low = min(ivec2(clamp(ndc_min.xy * 0.5 + 0.5, 0.0, 1.0) * vec2(pyramid_size)), pyramid_size - 1);
+	ivec2 high = min(ivec2(clamp(ndc_max.xy * 0.5 + 0.5, 0.0, 1.0) * vec2(pyramid_size)), pyramid_size - 1);
+	int level = 0;
+	while (level < pyramid_levels - 1 && any(greaterThan((high >> level) - (low >> level), ivec2(1))))
+		level++;
+	ivec2 size = max(pyramid_size >> level, ivec2(1));
+	ivec2 first = min(low >> level, size - 1), last = min(high >> level, size - 1);
+	float farthest = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			farthest = max(farthest, texelFetch(pyramid, ivec2(x, y), level).r);
+	return nearest > farthest;
+}
+
+void main() {
+	if (gl_LocalInvocationIndex == 0)
+		group_count = 0;
+	barrier();
+
+	uint index = gl_GlobalInvocationID.x;
+	bool visible = false;
+	CullObject object;
+	if (index < object_count) {
+		object = objects[index];
+		visible = insideFrustum(object.center, object.extent) && !(occlusion && occluded(object.center, object.extent));
+	}
+
+	// a slot in the group's run of commands, then one atomic on the buffer for the whole group
+	uint slot = visible ? atomicAdd(group_count, 1u) : 0u;
+	barrier();
+	if (gl_LocalInvocationIndex == 0)
+		group_base = atomicAdd(draw_count, group_count);
+	barrier();
+
+	if (visible) {
+		PooledMesh mesh = meshes[object.mesh];
+		commands[group_base + slot] = DrawCommand(mesh.index_count, 1u, mesh.first_index, int(mesh.base_vertex), object.transform);
+	}
+}
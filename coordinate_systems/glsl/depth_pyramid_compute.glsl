@@ -0,0 +1,31 @@
+// depth pyramid compute shader (gpu_culling.h), one mip level per dispatch: level 0 copies the depth buffer, every level
+// after it keeps the farthest depth of the texels of the level below it covers
+
+#version 460 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (r32f, binding = 0) uniform writeonly image2D destination;
+
+uniform sampler2D source;  // the depth buffer for level 0, the pyramid itself after that
+uniform int source_level;  // -1 copies level 0 of 'source'
+uniform ivec2 source_size;
+
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(destination);
+	if (any(greaterThanEqual(texel, size)))
+		return;
+	if (source_level < 0) {
+		imageStore(destination, texel, vec4(texelFetch(source, texel, 0).r));
+		return;
+	}
+
+	// an odd row or column of the level below has no pair, the last texel of this level folds it in as well
+	ivec2 first = texel * 2;
+	ivec2 last = min(first + 1 + ivec2(equal(texel, size - 1)) * (source_size & 1), source_size - 1);
+	float farthest = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			farthest = max(farthest, texelFetch(source, ivec2(x, y), source_level).r);
+	imageStore(destination, texel, vec4(farthest));
+}
@@ -0,0 +1,6 @@
+// mesh depth only fragment shader
+
+#version 460 core
+
+void main() {
+}
@@ -0,0 +1,12 @@
+// mesh depth only vertex shader, positions are all a depth prepass or shadow map reads
+
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
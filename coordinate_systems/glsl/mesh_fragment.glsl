@@ -0,0 +1,15 @@
+// mesh fragment shader, one directional light
+
+#version 460 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec2 TexCoord;
+
+uniform vec3 light_direction; // towards the light, world space
+uniform vec3 color;
+
+void main() {
+	float diffuse = max(dot(normalize(Normal), normalize(light_direction)), 0.0);
+	FragColor = vec4(color * (0.2 + 0.8 * diffuse), 1.0);
+}
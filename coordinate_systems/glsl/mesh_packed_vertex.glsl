@@ -0,0 +1,28 @@
+// mesh vertex shader for PackedVertex (vertex_format.h)
+
+#version 460 core
+layout (location = 0) in vec3 aPos;      // half or snorm16
+layout (location = 1) in vec2 aNormal;   // octahedral
+layout (location = 2) in vec2 aTexCoord; // unorm16 over the mesh's uv range
+
+out vec3 Normal;
+out vec2 TexCoord;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 dequantize;   // packed position to model space, kept out of 'model' so normals do not see its scale
+uniform vec4 uv_transform; // offset and scale
+
+vec3 decodeOctahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+void main() {
+	gl_Position = projection * view * model * dequantize * vec4(aPos, 1.0);
+	Normal = mat3(transpose(inverse(model))) * decodeOctahedral(aNormal);
+	TexCoord = uv_transform.xy + uv_transform.zw * aTexCoord;
+}
@@ -0,0 +1,25 @@
+// mesh vertex shader pulling its vertex from a storage buffer (mesh_pool.h), drawn with a VAO that has no attributes
+
+#version 460 core
+
+// MeshVertex is 32 bytes, two vec4 loads: position.xyz normal.x, then normal.yz uv.xy
+layout (std430, binding = 0) readonly buffer Vertices { vec4 vertices[]; };
+layout (std430, binding = 1) readonly buffer Transforms { mat4 transforms[]; };
+
+out vec3 Normal;
+out vec2 TexCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+	// the index buffer's value plus the draw's base vertex
+	uint index = uint(gl_VertexID);
+	vec4 first = vertices[index * 2];
+	vec4 second = vertices[index * 2 + 1];
+	mat4 model = transforms[gl_BaseInstance + gl_InstanceID];
+
+	gl_Position = projection * view * model * vec4(first.xyz, 1.0);
+	Normal = mat3(transpose(inverse(model))) * vec3(first.w, second.xy);
+	TexCoord = second.zw;
+}
@@ -0,0 +1,409 @@
+#pragma once
+// gltf loader functions defined here
+// glTF 2.0, both .gltf (buffers in separate files or base64 data uris) and binary .glb. every triangle primitive that a
+// node of the scene instances is placed with the node's world transform and merged into one MeshData, the way a static
+// model is drawn. POSITION, NORMAL and TEXCOORD_0 are read from float or normalized integer accessors, indices from
+// unsigned byte, short or int ones. sparse accessors, morph targets and skins are not supported
+//
+// primitives are decoded in parallel on the job system, each into its own vertex list, then deduplicated in order
+
+#include <job_system.h>
+#include <json.h>
+#include <mesh_data.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+const int GLTF_MAX_NODE_DEPTH = 256; // node trees are never this deep, stops cycles in broken files
+
+struct GltfDocument {
+	JsonValue json;
+	std::vector<std::vector<unsigned char>> buffers;
+};
+
+// bytes of the base64 text starting at 'start', false on characters outside the alphabet
+inline bool decodeBase64(const std::string& text, size_t start, std::vector<unsigned char>& out) {
+	out.clear();
+	out.reserve((text.size() - start) / 4 * 3);
+	uint32_t bits = 0;
+	int count = 0;
+	for (size_t i = start; i < text.size() && text[i] != '='; i++) {
+		char c = text[i];
+		int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 : c >= '0' && c <= '9' ? c - '0' + 52
+			: c == '+' ? 62 : c == '/' ? 63 : -1;
+		if (value < 0)
+			return false;
+		bits = (bits << 6) | value;
+		if (++count == 4) {
+			out.push_back((unsigned char)(bits >> 16));
+			out.push_back((unsigned char)(bits >> 8));
+			out.push_back((unsigned char)bits);
+			bits = 0;
+			count = 0;
+		}
+	}
+	if (count == 2)
+		out.push_back((unsigned char)(bits >> 4));
+	else if (count == 3) {
+		out.push_back((unsigned char)(bits >> 10));
+		out.push_back((unsigned char)(bits >> 2));
+	}
+	return count != 1;
+}
+
+inline uint32_t readLittleEndian32(const unsigned char* p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// parse the json and load every buffer it lists
+inline bool loadGltfDocument(const std::string& path, GltfDocument& document) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::GLTF::FILE_NOT_FOUND: " << path << std::endl;
+		return false;
+	}
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// a glb is a 12 byte header, then a JSON chunk and an optional BIN chunk, each with a length and type up front
+	const char* json = (const char*)data.data();
+	size_t json_length = data.size();
+	std::vector<unsigned char> binary;
+	if (data.size() >= 12 && readLittleEndian32(data.data()) == GLB_MAGIC) {
+		json = nullptr;
+		for (size_t offset = 12; offset + 8 <= data.size();) {
+			uint32_t length = readLittleEndian32(&data[offset]), type = readLittleEndian32(&data[offset + 4]);
+			if (length > data.size() - offset - 8)
+				break;
+			if (type == GLB_CHUNK_JSON && json == nullptr) {
+				json = (const char*)&data[offset + 8];
+				json_length = length;
+			}
+			else if (type == GLB_CHUNK_BIN && binary.empty())
+				binary.assign(data.begin() + offset + 8, data.begin() + offset + 8 + length);
+			offset += 8 + ((length + 3) & ~3u);
+		}
+		if (json == nullptr) {
+			std::cout << "ERROR::GLTF::NO_JSON_CHUNK: " << path << std::endl;
+			return false;
+		}
+	}
+	if (!JsonParser::parse(json, json_length, document.json))
+		return false;
+
+	const JsonValue& buffers = document.json["buffers"];
+	document.buffers.resize(buffers.size());
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	for (size_t i = 0; i < buffers.size(); i++) {
+		const std::string& uri = buffers[i]["uri"].asString();
+		std::vector<unsigned char>& buffer = document.buffers[i];
+		if (uri.empty() && i == 0)
+			buffer = std::move(binary); // the glb's own chunk
+		else if (uri.compare(0, 5, "data:") == 0) {
+			size_t comma = uri.find(',');
+			if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos || !decodeBase64(uri, comma + 1, buffer)) {
+				std::cout << "ERROR::GLTF::BAD_DATA_URI: buffer " << i << std::endl;
+				return false;
+			}
+		}
+		else {
+			// relative to the gltf, spaces and other reserved characters are percent encoded
+			std::string decoded;
+			for (size_t c = 0; c < uri.size(); c++) {
+				if (uri[c] == '%' && c + 2 < uri.size() && std::isxdigit((unsigned char)uri[c + 1]) && std::isxdigit((unsigned char)uri[c + 2])) {
+					decoded += (char)std::strtol(uri.substr(c + 1, 2).c_str(), nullptr, 16);
+					c += 2;
+				}
+				else
+					decoded += uri[c];
+			}
+			std::ifstream buffer_file(directory / std::filesystem::u8path(decoded), std::ios::binary);
+			if (!buffer_file) {
+				std::cout << "ERROR::GLTF::BUFFER_NOT_FOUND: " << decoded << std::endl;
+				return false;
+			}
+			buffer.assign(std::istreambuf_iterator<char>(buffer_file), std::istreambuf_iterator<char>());
+		}
+		if (buffer.size() < buffers[i]["byteLength"].asSize()) {
+			std::cout << "ERROR::GLTF::BUFFER_TOO_SHORT: buffer " << i << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// where one accessor's elements are, checked against the buffer
+struct GltfAccessor {
+	const unsigned char* data = nullptr; // null for accessors without a buffer view, every element is zero then
+	size_t count = 0;
+	size_t stride = 0;
+	int component_type = 0;
+	int components = 0;
+	bool normalized = false;
+};
+
+inline int gltfComponentSize(int component_type) {
+	switch (component_type) {
+	case 5120: case 5121: return 1; // byte, unsigned byte
+	case 5122: case 5123: return 2; // short, unsigned short
+	case 5125: case 5126: return 4; // unsigned int, float
+	default: return 0;
+	}
+}
+
+inline bool gltfAccessor(const GltfDocument& document, int index, GltfAccessor& accessor) {
+	const JsonValue& json = document.json["accessors"][index];
+	const std::string& type = json["type"].asString();
+	accessor.count = json["count"].asSize();
+	accessor.component_type = json["componentType"].asInt();
+	accessor.normalized = json["normalized"].boolean;
+	accessor.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+	size_t element = (size_t)gltfComponentSize(accessor.component_type) * accessor.components;
+	if (json.isNull() || element == 0 || json.contains("sparse")) {
+		std::cout << "ERROR::GLTF::UNSUPPORTED_ACCESSOR: " << index << std::endl;
+		return false;
+	}
+	if (!json.contains("bufferView"))
+		return true;
+
+	const JsonValue& view = document.json["bufferViews"][json["bufferView"].asInt()];
+	int buffer = view["buffer"].asInt();
+	size_t offset = view["byteOffset"].asSize() + json["byteOffset"].asSize();
+	accessor.stride = std::max(view["byteStride"].asSize(), element); // the spec caps strides at 252 bytes
+	size_t size = buffer >= 0 && (size_t)buffer < document.buffers.size() ? document.buffers[buffer].size() : 0;
+	bool inside = accessor.stride <= 252 && accessor.count <= size && view["byteOffset"].asSize() + view["byteLength"].asSize() <= size
+		&& (accessor.count == 0 || offset + accessor.stride * (accessor.count - 1) + element <= size);
+	if (!inside) {
+		std::cout << "ERROR::GLTF::ACCESSOR_OUT_OF_RANGE: " << index << std::endl;
+		return false;
+	}
+	accessor.data = document.buffers[buffer].data() + offset;
+	return true;
+}
+
+// component 'c' of element 'i' as a float, normalized integers map to [0, 1] or [-1, 1]
+inline float gltfComponent(const GltfAccessor& accessor, size_t i, int c) {
+	if (accessor.data == nullptr)
+		return 0.0f;
+	const unsigned char* p = accessor.data + i * accessor.stride + (size_t)c * gltfComponentSize(accessor.component_type);
+	switch (accessor.component_type) {
+	case 5126: { float value; std::memcpy(&value, p, 4); return value; }
+	case 5121: return accessor.normalized ? *p / 255.0f : (float)*p;
+	case 5120: return accessor.normalized ? std::max((int8_t)*p / 127.0f, -1.0f) : (float)(int8_t)*p;
+	case 5123: { uint16_t value; std::memcpy(&value, p, 2); return accessor.normalized ? value / 65535.0f : (float)value; }
+	case 5122: { int16_t value; std::memcpy(&value, p, 2); return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : (float)value; }
+	default: { uint32_t value; std::memcpy(&value, p, 4); return (float)value; }
+	}
+}
+
+inline uint32_t gltfIndex(const GltfAccessor& accessor, size_t i) {
+	if (accessor.data == nullptr)
+		return 0;
+	const unsigned char* p = accessor.data + i * accessor.stride;
+	switch (accessor.component_type) {
+	case 5121: return *p;
+	case 5123: { uint16_t value; std::memcpy(&value, p, 2); return value; }
+	default: { uint32_t value; std::memcpy(&value, p, 4); return value; }
+	}
+}
+
+// node transforms are a matrix or translation, rotation and scale
+inline glm::mat4 gltfNodeTransform(const JsonValue& node) {
+	glm::mat4 transform(1.0f);
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.size() == 16) {
+		for (int i = 0; i < 16; i++)
+			glm::value_ptr(transform)[i] = (float)matrix[i].asNumber(); // column major in both
+		return transform;
+	}
+	const JsonValue& t = node["translation"];
+	const JsonValue& r = node["rotation"];
+	const JsonValue& s = node["scale"];
+	if (t.size() == 3)
+		transform[3] = glm::vec4((float)t[0].asNumber(), (float)t[1].asNumber(), (float)t[2].asNumber(), 1.0f);
+	if (r.size() == 4)
+		transform = transform * glm::mat4_cast(glm::quat((float)r[3].asNumber(), (float)r[0].asNumber(), (float)r[1].asNumber(), (float)r[2].asNumber()));
+	if (s.size() == 3)
+		transform = transform * glm::mat4(glm::vec4((float)s[0].asNumber(), 0, 0, 0), glm::vec4(0, (float)s[1].asNumber(), 0, 0),
+			glm::vec4(0, 0, (float)s[2].asNumber(), 0), glm::vec4(0, 0, 0, 1));
+	return transform;
+}
+
+// one mesh primitive placed by one node
+struct GltfPrimitive {
+	const JsonValue* json;
+	glm::mat4 transform = glm::mat4(1.0f);
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	bool has_normals = false, has_uvs = false, ok = false;
+};
+
+inline void collectGltfPrimitives(const GltfDocument& document, int node_index, const glm::mat4& parent, int depth,
+	std::vector<GltfPrimitive>& out) {
+	const JsonValue& node = document.json["nodes"][node_index];
+	if (node.isNull() || depth > GLTF_MAX_NODE_DEPTH)
+		return;
+	glm::mat4 transform = parent * gltfNodeTransform(node);
+	const JsonValue& primitives = document.json["meshes"][node["mesh"].asInt()]["primitives"];
+	for (size_t i = 0; i < primitives.size(); i++) {
+		out.emplace_back();
+		out.back().json = &primitives[i];
+		out.back().transform = transform;
+	}
+	const JsonValue& children = node["children"];
+	for (size_t i = 0; i < children.size(); i++)
+		collectGltfPrimitives(document, children[i].asInt(), transform, depth + 1, out);
+}
+
+// vertices in world space and a triangle list, strips and fans become lists, points and lines are skipped
+inline void decodeGltfPrimitive(const GltfDocument& document, GltfPrimitive& primitive) {
+	const JsonValue& json = *primitive.json;
+	int mode = json["mode"].asInt(4);
+	const JsonValue& attributes = json["attributes"];
+	GltfAccessor positions, normals, uvs, indices;
+	if (mode < 4 || mode > 6 || !attributes.contains("POSITION")) {
+		primitive.ok = true; // nothing to draw, not an error
+		return;
+	}
+	if (!gltfAccessor(document, attributes["POSITION"].asInt(), positions) || positions.components != 3)
+		return;
+	primitive.has_normals = attributes.contains("NORMAL");
+	primitive.has_uvs = attributes.contains("TEXCOORD_0");
+	if ((primitive.has_normals && (!gltfAccessor(document, attributes["NORMAL"].asInt(), normals) || normals.count < positions.count || normals.components != 3))
+		|| (primitive.has_uvs && (!gltfAccessor(document, attributes["TEXCOORD_0"].asInt(), uvs) || uvs.count < positions.count || uvs.components != 2))
+		|| (json.contains("indices") && !gltfAccessor(document, json["indices"].asInt(), indices)))
+		return;
+
+	glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(primitive.transform)));
+	primitive.vertices.resize(positions.count);
+	for (size_t i = 0; i < positions.count; i++) {
+		MeshVertex& vertex = primitive.vertices[i];
+		glm::vec4 position = primitive.transform * glm::vec4(gltfComponent(positions, i, 0), gltfComponent(positions, i, 1), gltfComponent(positions, i, 2), 1.0f);
+		glm::vec3 normal(0.0f);
+		if (primitive.has_normals)
+			normal = normal_matrix * glm::vec3(gltfComponent(normals, i, 0), gltfComponent(normals, i, 1), gltfComponent(normals, i, 2));
+		float length = glm::length(normal);
+		if (length > 0.0f)
+			normal /= length;
+		for (int c = 0; c < 3; c++) {
+			vertex.position[c] = position[c];
+			vertex.normal[c] = normal[c];
+		}
+		vertex.uv[0] = primitive.has_uvs ? gltfComponent(uvs, i, 0) : 0.0f;
+		vertex.uv[1] = primitive.has_uvs ? 1.0f - gltfComponent(uvs, i, 1) : 0.0f; // glTF puts v = 0 at the top of the image
+	}
+
+	// a mirroring transform turns the triangles inside out, swap two corners to keep them facing the same way
+	bool mirrored = glm::determinant(glm::mat3(primitive.transform)) < 0.0f;
+	size_t count = json.contains("indices") ? indices.count : positions.count;
+	auto corner = [&](size_t i) { return json.contains("indices") ? gltfIndex(indices, i) : (uint32_t)i; };
+	auto emit = [&](uint32_t a, uint32_t b, uint32_t c) {
+		primitive.indices.push_back(a);
+		primitive.indices.push_back(mirrored ? c : b);
+		primitive.indices.push_back(mirrored ? b : c);
+	};
+	if (mode == 4)
+		for (size_t i = 0; i + 2 < count; i += 3)
+			emit(corner(i), corner(i + 1), corner(i + 2));
+	else if (mode == 5)
+		for (size_t i = 0; i + 2 < count; i++) // every other strip triangle is wound the other way
+			emit(corner(i), corner(i + 1 + (i & 1)), corner(i + 2 - (i & 1)));
+	else
+		for (size_t i = 1; i + 1 < count; i++)
+			emit(corner(0), corner(i), corner(i + 1));
+	for (uint32_t index : primitive.indices)
+		if (index >= positions.count) {
+			std::cout << "ERROR::GLTF::INDEX_OUT_OF_RANGE: " << index << std::endl;
+			return;
+		}
+	primitive.ok = true;
+}
+
+// every primitive of the default scene merged into 'mesh'
+inline bool loadGltf(JobSystem& jobs, const std::string& path, MeshData& mesh) {
+	GltfDocument document;
+	if (!loadGltfDocument(path, document))
+		return false;
+
+	// the default scene's node trees, all root nodes without scenes, every mesh once without nodes
+	std::vector<GltfPrimitive> primitives;
+	const JsonValue& json = document.json;
+	if (json["scenes"].size() > 0) {
+		const JsonValue& roots = json["scenes"][json["scene"].asInt(0)]["nodes"];
+		for (size_t i = 0; i < roots.size(); i++)
+			collectGltfPrimitives(document, roots[i].asInt(), glm::mat4(1.0f), 0, primitives);
+	}
+	else if (json["nodes"].size() > 0) {
+		std::vector<bool> child(json["nodes"].size(), false);
+		for (size_t i = 0; i < json["nodes"].size(); i++)
+			for (size_t c = 0; c < json["nodes"][i]["children"].size(); c++)
+				if ((size_t)json["nodes"][i]["children"][c].asInt() < child.size())
+					child[json["nodes"][i]["children"][c].asInt()] = true;
+		for (size_t i = 0; i < child.size(); i++)
+			if (!child[i])
+				collectGltfPrimitives(document, (int)i, glm::mat4(1.0f), 0, primitives);
+	}
+	else
+		for (size_t m = 0; m < json["meshes"].size(); m++)
+			for (size_t i = 0; i < json["meshes"][m]["primitives"].size(); i++) {
+				primitives.emplace_back();
+				primitives.back().json = &json["meshes"][m]["primitives"][i];
+			}
+
+	jobs.parallelFor(primitives.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			decodeGltfPrimitive(document, primitives[i]);
+	});
+
+	// every vertex a primitive uses is looked up once, on first use, its triangles then go through the remap
+	mesh = MeshData();
+	size_t expected = 0, index_count = 0;
+	for (const GltfPrimitive& primitive : primitives) {
+		if (!primitive.ok) {
+			std::cout << "ERROR::GLTF::BAD_PRIMITIVE: " << path << std::endl;
+			return false;
+		}
+		expected += primitive.vertices.size();
+		index_count += primitive.indices.size();
+	}
+	mesh.indices.reserve(index_count);
+	VertexDeduplicator unique(mesh.vertices, expected);
+	bool all_normals = true, all_uvs = true;
+	std::vector<uint32_t> remap;
+	for (GltfPrimitive& primitive : primitives) {
+		if (primitive.indices.empty())
+			continue;
+		remap.assign(primitive.vertices.size(), UINT32_MAX);
+		for (uint32_t index : primitive.indices) {
+			if (remap[index] == UINT32_MAX)
+				remap[index] = unique.add(primitive.vertices[index]);
+			mesh.indices.push_back(remap[index]);
+		}
+		all_normals &= primitive.has_normals;
+		all_uvs &= primitive.has_uvs;
+		std::vector<MeshVertex>().swap(primitive.vertices);
+	}
+
+	mesh.has_uvs = all_uvs && !mesh.indices.empty();
+	mesh.has_normals = all_normals && !mesh.indices.empty();
+	if (!mesh.has_normals)
+		computeNormals(mesh);
+	computeBounds(mesh);
+	return true;
+}
@@ -0,0 +1,341 @@
+#pragma once
+// GPU culling defined here
+// the whole visibility pass on the GPU: every object's world box lives in a storage buffer, a compute shader
+// (glsl/cull_objects_compute.glsl) tests it against the frustum and against last frame's depth pyramid, and appends a
+// draw command for each object that survives to an indirect buffer a MeshPool draws with one
+// glMultiDrawElementsIndirectCount(). the CPU sets a few uniforms, clears the count, dispatches and draws, the same
+// handful of calls for ten objects or a million, and never reads anything back
+//
+// DepthPyramid is the occlusion side: a R32F mip chain of the depth buffer where every texel holds the farthest depth
+// under it (glsl/depth_pyramid_compute.glsl), built after the frame is drawn along with the view projection it was drawn
+// with. the next frame projects each box with that view projection, picks the level where the box covers at most two by
+// two texels and culls it when its nearest point is behind all four. an object that was hidden last frame and comes
+// into view is drawn a frame late, what culling against last frame's depth costs
+//
+// without GL 4.6 the command buffer is cleared each frame and drawn whole with glMultiDrawElementsIndirect(), the
+// commands past the count draw nothing. cullObjectReference() is the same test on the CPU, to check the shader against
+//
+// storage buffer bindings, matching the shader, after the pool's (mesh_pool.h):
+//   2  objects   GpuCullObject[]
+//   3  meshes    PooledMesh[], the pool's mesh table
+//   4  commands  DrawElementsIndirectCommand[], written
+//   5  count     uint, the number of commands written
+
+#include <glad/glad.h>
+
+#include <batch_math.h>
+#include <camera.h>
+#include <mesh_pool.h>
+#include <shader.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+const GLuint CULL_OBJECT_BINDING = 2;
+const GLuint CULL_MESH_BINDING = 3;
+const GLuint CULL_COMMAND_BINDING = 4;
+const GLuint CULL_COUNT_BINDING = 5;
+const GLuint CULL_PYRAMID_UNIT = 0;
+
+// objects per work group, the shader's local_size_x
+const size_t CULL_GROUP_SIZE = 64;
+
+// an object as the culling shader reads it, std430 with each vec3 padded out by a uint
+struct GpuCullObject {
+	PackedVec3 center; // of its world box
+	uint32_t mesh;     // into the pool's meshes
+	PackedVec3 extent; // half the world box
+	uint32_t transform; // the instance its draw reads, base_instance of the command
+};
+
+static_assert(sizeof(GpuCullObject) == 32 && sizeof(DrawElementsIndirectCommand) == 20, "the shader's layouts");
+
+// a pyramid level read back, row by row
+struct DepthLevel {
+	int width = 0;
+	int height = 0;
+	std::vector<float> texels;
+};
+
+class DepthPyramid {
+public:
+	unsigned int texture = 0;
+
+	DepthPyramid(int width, int height) : shader("glsl/depth_pyramid_compute.glsl") {
+		source_level_location = glGetUniformLocation(shader.program, "source_level");
+		source_size_location = glGetUniformLocation(shader.program, "source_size");
+		glProgramUniform1i(shader.program, glGetUniformLocation(shader.program, "source"), (GLint)CULL_PYRAMID_UNIT);
+		// texelFetch() only needs the levels to be complete, the depth buffer has one and the pyramid all of them
+		glCreateSamplers(1, &depth_sampler);
+		glSamplerParameteri(depth_sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glSamplerParameteri(depth_sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glCreateSamplers(1, &level_sampler);
+		glSamplerParameteri(level_sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glSamplerParameteri(level_sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		resize(width, height);
+	}
+
+	~DepthPyramid() {
+		glDeleteTextures(1, &texture);
+		glDeleteSamplers(1, &depth_sampler);
+		glDeleteSamplers(1, &level_sampler);
+		glDeleteProgram(shader.program);
+	}
+
+	DepthPyramid(const DepthPyramid&) = delete;
+	DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+	// the depth buffer's size, the next build() starts over
+	void resize(int width, int height) {
+		size = glm::ivec2(std::max(width, 1), std::max(height, 1));
+		levels = 1;
+		while ((std::max(size.x, size.y) >> levels) > 0)
+			levels++;
+		glDeleteTextures(1, &texture);
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, levels, GL_R32F, size.x, size.y);
+		built = false;
+	}
+
+	// every level from 'depth_texture', a GL_DEPTH_COMPONENT texture of the pyramid's size the frame drawn with
+	// 'view_projection' wrote
+	void build(unsigned int depth_texture, const glm::mat4& view_projection) {
+		shader.use();
+		glm::ivec2 source_size = size;
+		for (int level = 0; level < levels; level++) {
+			glm::ivec2 level_size = glm::max(size >> level, glm::ivec2(1));
+			glBindTextureUnit(CULL_PYRAMID_UNIT, level == 0 ? depth_texture : texture);
+			glBindSampler(CULL_PYRAMID_UNIT, level == 0 ? depth_sampler : level_sampler);
+			glBindImageTexture(0, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			glUniform1i(source_level_location, level - 1);
+			glUniform2i(source_size_location, source_size.x, source_size.y);
+			glDispatchCompute((level_size.x + 7) / 8, (level_size.y + 7) / 8, 1);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+			source_size = level_size;
+		}
+		glBindSampler(CULL_PYRAMID_UNIT, 0);
+		pyramid_view_projection = view_projection;
+		built = true;
+	}
+
+	// on 'unit' for the culling shader
+	void bind(GLuint unit) const {
+		glBindTextureUnit(unit, texture);
+		glBindSampler(unit, level_sampler);
+	}
+
+	// every level, for the CPU reference
+	std::vector<DepthLevel> readBack() const {
+		std::vector<DepthLevel> result(levels);
+		for (int level = 0; level < levels; level++) {
+			DepthLevel& out = result[level];
+			out.width = std::max(size.x >> level, 1);
+			out.height = std::max(size.y >> level, 1);
+			out.texels.resize((size_t)out.width * out.height);
+			glGetTextureImage(texture, level, GL_RED, GL_FLOAT, (GLsizei)(out.texels.size() * sizeof(float)), out.texels.data());
+		}
+		return result;
+	}
+
+	bool isBuilt() const {
+		return built;
+	}
+
+	glm::ivec2 baseSize() const {
+		return size;
+	}
+
+	int levelCount() const {
+		return levels;
+	}
+
+	// what the pyramid was drawn with
+	const glm::mat4& viewProjection() const {
+		return pyramid_view_projection;
+	}
+
+private:
+	Shader shader;
+	GLint source_level_location = -1, source_size_location = -1;
+	unsigned int depth_sampler = 0, level_sampler = 0;
+	glm::ivec2 size = glm::ivec2(1);
+	int levels = 1;
+	glm::mat4 pyramid_view_projection = glm::mat4(1.0f);
+	bool built = false;
+};
+
+class GpuCuller {
+public:
+	unsigned int object_buffer = 0, mesh_buffer = 0, command_buffer = 0, count_buffer = 0;
+
+	// culls into draws of 'pool''s meshes, which have to be uploaded
+	explicit GpuCuller(const MeshPool& pool) : shader("glsl/cull_objects_compute.glsl") {
+		glCreateBuffers(1, &mesh_buffer);
+		glNamedBufferStorage(mesh_buffer, std::max(pool.meshes.size(), (size_t)1) * sizeof(PooledMesh), pool.meshes.empty() ? nullptr : pool.meshes.data(), 0);
+		glCreateBuffers(1, &count_buffer);
+		glNamedBufferStorage(count_buffer, sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		draw_count_supported = GLAD_GL_VERSION_4_6 && glMultiDrawElementsIndirectCount != nullptr;
+
+		object_count_location = glGetUniformLocation(shader.program, "object_count");
+		planes_location = glGetUniformLocation(shader.program, "planes");
+		occlusion_location = glGetUniformLocation(shader.program, "occlusion");
+		pyramid_view_projection_location = glGetUniformLocation(shader.program, "pyramid_view_projection");
+		pyramid_size_location = glGetUniformLocation(shader.program, "pyramid_size");
+		pyramid_levels_location = glGetUniformLocation(shader.program, "pyramid_levels");
+		glProgramUniform1i(shader.program, glGetUniformLocation(shader.program, "pyramid"), (GLint)CULL_PYRAMID_UNIT);
+	}
+
+	~GpuCuller() {
+		unsigned int buffers[4] = { object_buffer, mesh_buffer, command_buffer, count_buffer };
+		glDeleteBuffers(4, buffers);
+		glDeleteProgram(shader.program);
+	}
+
+	GpuCuller(const GpuCuller&) = delete;
+	GpuCuller& operator=(const GpuCuller&) = delete;
+
+	// the objects to cull, replacing the last ones. what changes per frame is the camera, not this
+	void setObjects(const GpuCullObject* objects, size_t count) {
+		if (count > object_capacity) {
+			object_capacity = std::max(count, object_capacity * 2);
+			unsigned int buffers[2] = { object_buffer, command_buffer };
+			glDeleteBuffers(2, buffers);
+			glCreateBuffers(1, &object_buffer);
+			glNamedBufferStorage(object_buffer, object_capacity * sizeof(GpuCullObject), nullptr, GL_DYNAMIC_STORAGE_BIT);
+			glCreateBuffers(1, &command_buffer);
+			glNamedBufferStorage(command_buffer, object_capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		}
+		if (count > 0)
+			glNamedBufferSubData(object_buffer, 0, count * sizeof(GpuCullObject), objects);
+		object_count = count;
+	}
+
+	// fill the command buffer with a draw for every object 'frustum' sees and 'pyramid', when it has been built, does
+	// not hide. nothing here depends on the number of objects
+	void cull(const Frustum& frustum, const DepthPyramid* pyramid = nullptr) {
+		GLuint zero = 0;
+		glClearNamedBufferSubData(count_buffer, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		if (!draw_count_supported && object_count > 0)
+			glClearNamedBufferSubData(command_buffer, GL_R32UI, 0, object_count * sizeof(DrawElementsIndirectCommand), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		if (object_count == 0)
+			return;
+
+		shader.use();
+		glUniform1ui(object_count_location, (GLuint)object_count);
+		glUniform4fv(planes_location, FRUSTUM_PLANES, glm::value_ptr(frustum.planes[0]));
+		bool occlusion = pyramid != nullptr && pyramid->isBuilt();
+		glUniform1i(occlusion_location, occlusion);
+		if (occlusion) {
+			glUniformMatrix4fv(pyramid_view_projection_location, 1, GL_FALSE, glm::value_ptr(pyramid->viewProjection()));
+			glUniform2i(pyramid_size_location, pyramid->baseSize().x, pyramid->baseSize().y);
+			glUniform1i(pyramid_levels_location, pyramid->levelCount());
+			pyramid->bind(CULL_PYRAMID_UNIT);
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_OBJECT_BINDING, object_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_MESH_BINDING, mesh_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COMMAND_BINDING, command_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COUNT_BINDING, count_buffer);
+		glDispatchCompute((GLuint)((object_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+		if (occlusion)
+			glBindSampler(CULL_PYRAMID_UNIT, 0);
+		// the draw reads the commands and the count as indirect parameters
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// every command cull() wrote, after pool.bind()
+	void draw(const MeshPool& pool) const {
+		if (object_count == 0)
+			return;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+		if (draw_count_supported) {
+			glBindBuffer(GL_PARAMETER_BUFFER, count_buffer);
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, (GLsizei)object_count, 0);
+		}
+		else
+			pool.drawIndirect(command_buffer, 0, object_count);
+	}
+
+	// how many draws the last cull() wrote, reading it back waits for the GPU: for tests, not for frames
+	size_t readDrawCount() const {
+		GLuint count = 0;
+		glGetNamedBufferSubData(count_buffer, 0, sizeof(GLuint), &count);
+		return count;
+	}
+
+	size_t objectCount() const {
+		return object_count;
+	}
+
+	bool drawCountSupported() const {
+		return draw_count_supported;
+	}
+
+private:
+	Shader shader;
+	size_t object_count = 0, object_capacity = 0;
+	bool draw_count_supported = false;
+	GLint object_count_location = -1, planes_location = -1, occlusion_location = -1;
+	GLint pyramid_view_projection_location = -1, pyramid_size_location = -1, pyramid_levels_location = -1;
+};
+
+// the culling shader's decision for 'object' on the CPU, true when it is drawn. 'pyramid' is what
+// DepthPyramid::readBack() returns, empty to test the frustum only. 'borderline' is set when the decision comes down to
+// a difference within rounding, a plane or depth comparison that close or a rectangle edge that close to a texel edge,
+// where the GPU may fairly go the other way
+inline bool cullObjectReference(const GpuCullObject& object, const Frustum& frustum, const glm::mat4& pyramid_view_projection,
+	const std::vector<DepthLevel>& pyramid, bool& borderline) {
+	const float EPSILON = 1e-4f;
+	borderline = false;
+	glm::vec3 center = object.center, extent = object.extent;
+	for (const glm::vec4& plane : frustum.planes) {
+		float distance = (plane.x * center.x + plane.y * center.y) + (plane.z * center.z + plane.w);
+		float reach = (std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y) + std::abs(plane.z) * extent.z;
+		borderline = borderline || std::abs(distance + reach) <= EPSILON * std::max(1.0f, std::abs(distance) + reach);
+		if (distance + reach < 0.0f)
+			return false;
+	}
+	if (pyramid.empty())
+		return true;
+
+	glm::vec3 ndc_min(3.4e38f), ndc_max(-3.4e38f);
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 side((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+		glm::vec4 clip = pyramid_view_projection * glm::vec4(center + extent * side, 1.0f);
+		borderline = borderline || std::abs(clip.w - 1e-5f) <= EPSILON;
+		if (clip.w <= 1e-5f)
+			return true;
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndc_min = glm::min(ndc_min, ndc);
+		ndc_max = glm::max(ndc_max, ndc);
+	}
+	for (int axis = 0; axis < 2; axis++)
+		borderline = borderline || std::abs(ndc_max[axis] + 1.0f) <= EPSILON || std::abs(ndc_min[axis] - 1.0f) <= EPSILON;
+	if (ndc_max.x < -1.0f || ndc_max.y < -1.0f || ndc_min.x > 1.0f || ndc_min.y > 1.0f)
+		return true;
+
+	float nearest = ndc_min.z * 0.5f + 0.5f;
+	glm::ivec2 base(pyramid[0].width, pyramid[0].height);
+	glm::ivec2 low, high;
+	for (int axis = 0; axis < 2; axis++) {
+		float edges[2] = { glm::clamp(ndc_min[axis] * 0.5f + 0.5f, 0.0f, 1.0f) * base[axis], glm::clamp(ndc_max[axis] * 0.5f + 0.5f, 0.0f, 1.0f) * base[axis] };
+		for (float edge : edges)
+			borderline = borderline || (std::abs(edge - std::round(edge)) <= 1e-2f && edge > 0.0f && edge < (float)base[axis]);
+		low[axis] = std::min((int)edges[0], base[axis] - 1);
+		high[axis] = std::min((int)edges[1], base[axis] - 1);
+	}
+	int level = 0;
+	while (level < (int)pyramid.size() - 1 && ((high.x >> level) - (low.x >> level) > 1 || (high.y >> level) - (low.y >> level) > 1))
+		level++;
+	const DepthLevel& depth = pyramid[level];
+	float farthest = 0.0f;
+	for (int y = std::min(low.y >> level, depth.height - 1); y <= std::min(high.y >> level, depth.height - 1); y++)
+		for (int x = std::min(low.x >> level, depth.width - 1); x <= std::min(high.x >> level, depth.width - 1); x++)
+			farthest = std::max(farthest, depth.texels[(size_t)y * depth.width + x]);
+	borderline = borderline || std::abs(nearest - farthest) <= 1e-5f;
+	return !(nearest > farthest);
+}
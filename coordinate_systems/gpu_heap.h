@@ -0,0 +1,183 @@
+#pragma once
+// GPU buffer heap defined here
+// a few large immutable buffer objects carved up by a TlsfAllocator (tlsf_allocator.h) each, so thousands of vertex,
+// index and uniform ranges share a handful of GL buffers instead of one glCreateBuffers() and glBufferData() each. a
+// new buffer of 'block_size' bytes is only created when none of the existing ones has room
+//
+// ranges are written with glNamedBufferSubData(), which the GL orders with every draw around it, so a freed range can
+// be handed out and overwritten straight away without waiting on the frames that still read it. compact() slides
+// allocations down over the holes, a budget of bytes per call, their offsets change but their GpuAllocation does not,
+// so look the offset up when drawing instead of keeping it
+
+#include <glad/glad.h>
+
+#include <tlsf_allocator.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+struct GpuAllocation {
+	uint32_t buffer = TlsfAllocator::NONE; // index into the heap's buffers
+	uint32_t id = TlsfAllocator::NONE;     // the allocator's id
+
+	explicit operator bool() const {
+		return id != TlsfAllocator::NONE;
+	}
+};
+
+struct GpuHeapStats {
+	size_t buffers = 0;
+	TlsfStats memory;    // all buffers added up, 'largest_free' is the largest in any one
+	uint64_t largest_free_total = 0; // every buffer's largest free block added up
+	uint64_t moved = 0;  // bytes compact() has copied so far
+
+	// TlsfStats::fragmentation() over the whole heap, free space outside the largest block of its buffer
+	double fragmentation() const {
+		return memory.free() > 0 ? 1.0 - (double)largest_free_total / (double)memory.free() : 0.0;
+	}
+};
+
+class GpuBufferHeap {
+public:
+	static constexpr uint64_t DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	explicit GpuBufferHeap(uint64_t block_size = DEFAULT_BLOCK_SIZE) : block_size(block_size) {}
+
+	~GpuBufferHeap() {
+		for (const Block& block : blocks)
+			glDeleteBuffers(1, &block.buffer);
+		if (scratch_buffer != 0)
+			glDeleteBuffers(1, &scratch_buffer);
+	}
+
+	GpuBufferHeap(const GpuBufferHeap&) = delete;
+	GpuBufferHeap& operator=(const GpuBufferHeap&) = delete;
+
+	// 'size' bytes at an 'alignment' multiple (a power of two), filled from 'data' when it is given. empty when it
+	// could not be allocated, nothing is written then
+	GpuAllocation allocate(uint64_t size, uint64_t alignment = 16, const void* data = nullptr) {
+		GpuAllocation allocation;
+		for (uint32_t b = 0; b < blocks.size() && !allocation; b++) {
+			uint32_t id = blocks[b].allocator->allocate(size, alignment);
+			if (id != TlsfAllocator::NONE)
+				allocation = { b, id };
+		}
+		if (!allocation) {
+			Block block;
+			// a request past the block size gets a buffer of its own, large enough for its size class
+			uint64_t capacity = std::max(block_size, TlsfAllocator::capacityFor(size, alignment));
+			glCreateBuffers(1, &block.buffer);
+			glNamedBufferStorage(block.buffer, capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+			block.allocator = std::make_unique<TlsfAllocator>(capacity);
+			blocks.push_back(std::move(block));
+			allocation = { (uint32_t)blocks.size() - 1, blocks.back().allocator->allocate(size, alignment) };
+		}
+		if (!allocation) {
+			std::cout << "ERROR::GPU_HEAP::ALLOCATION_FAILED: " << size << " bytes" << std::endl;
+			return GpuAllocation();
+		}
+		if (data != nullptr)
+			write(allocation, 0, size, data);
+		return allocation;
+	}
+
+	// 'allocation' is empty afterwards
+	void free(GpuAllocation& allocation) {
+		if (!allocation)
+			return;
+		blocks[allocation.buffer].allocator->free(allocation.id);
+		allocation = GpuAllocation();
+	}
+
+	void write(const GpuAllocation& allocation, uint64_t offset, uint64_t size, const void* data) {
+		glNamedBufferSubData(buffer(allocation), (GLintptr)(this->offset(allocation) + offset), (GLsizeiptr)size, data);
+	}
+
+	unsigned int buffer(const GpuAllocation& allocation) const {
+		return blocks[allocation.buffer].buffer;
+	}
+
+	GLintptr offset(const GpuAllocation& allocation) const {
+		return (GLintptr)blocks[allocation.buffer].allocator->offset(allocation.id);
+	}
+
+	// slide allocations down over free space until about 'max_bytes' have been copied or nothing is left to move, and
+	// return the bytes copied. meant to run a little every frame
+	uint64_t compact(uint64_t max_bytes) {
+		uint64_t copied = 0;
+		for (Block& block : blocks) {
+			TlsfMove move;
+			while (copied < max_bytes && block.allocator->nextMove(move)) {
+				if (move.overlaps()) {
+					// the GL refuses overlapping copies within one buffer
+					reserveScratch(move.size);
+					glCopyNamedBufferSubData(block.buffer, scratch_buffer, (GLintptr)move.from, 0, (GLsizeiptr)move.size);
+					glCopyNamedBufferSubData(scratch_buffer, block.buffer, 0, (GLintptr)move.to, (GLsizeiptr)move.size);
+				}
+				else
+					glCopyNamedBufferSubData(block.buffer, block.buffer, (GLintptr)move.from, (GLintptr)move.to, (GLsizeiptr)move.size);
+				block.allocator->moveTo(move);
+				copied += move.size;
+			}
+		}
+		moved += copied;
+		return copied;
+	}
+
+	GpuHeapStats stats() const {
+		GpuHeapStats s;
+		s.buffers = blocks.size();
+		s.moved = moved;
+		for (const Block& block : blocks) {
+			TlsfStats b = block.allocator->stats();
+			s.memory.capacity += b.capacity;
+			s.memory.used += b.used;
+			s.memory.largest_free = std::max(s.memory.largest_free, b.largest_free);
+			s.largest_free_total += b.largest_free;
+			s.memory.allocations += b.allocations;
+			s.memory.free_blocks += b.free_blocks;
+		}
+		return s;
+	}
+
+	void printStats() const {
+		GpuHeapStats s = stats();
+		std::cout << "\nGPU heap statistics:" << std::endl
+			<< "\tBuffers        : " << s.buffers << " (" << s.memory.capacity / (1024.0 * 1024.0) << " MiB)" << std::endl
+			<< "\tAllocations    : " << s.memory.allocations << " (" << s.memory.used / (1024.0 * 1024.0) << " MiB)" << std::endl
+			<< "\tFree ranges    : " << s.memory.free_blocks << ", largest " << s.memory.largest_free / (1024.0 * 1024.0) << " MiB" << std::endl
+			<< "\tFragmentation  : " << s.fragmentation() * 100.0 << "%" << std::endl
+			<< "\tCompacted      : " << s.moved / (1024.0 * 1024.0) << " MiB" << std::endl;
+	}
+
+	// what uniform buffer ranges have to be aligned to on this context
+	static uint64_t uniformAlignment() {
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		return (uint64_t)std::max(alignment, 16);
+	}
+
+private:
+	struct Block {
+		unsigned int buffer = 0;
+		std::unique_ptr<TlsfAllocator> allocator;
+	};
+
+	uint64_t block_size;
+	std::vector<Block> blocks;
+	unsigned int scratch_buffer = 0;
+	uint64_t scratch_size = 0;
+	uint64_t moved = 0;
+
+	void reserveScratch(uint64_t size) {
+		if (size <= scratch_size)
+			return;
+		scratch_size = std::max(size, scratch_size * 2);
+		glDeleteBuffers(1, &scratch_buffer);
+		glCreateBuffers(1, &scratch_buffer);
+		glNamedBufferStorage(scratch_buffer, scratch_size, nullptr, 0);
+	}
+};
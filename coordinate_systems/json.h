@@ -0,0 +1,300 @@
+#pragma once
+// json value class and parser defined here
+// enough of JSON for glTF: a document is parsed once into a tree of JsonValue and read through operator[], which
+// returns a shared null value for anything missing so lookups can be chained without checks
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class JsonValue {
+public:
+	enum class Type {
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object,
+	};
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object; // in document order
+
+	bool isNull() const {
+		return type == Type::Null;
+	}
+
+	size_t size() const {
+		return type == Type::Array ? array.size() : type == Type::Object ? object.size() : 0;
+	}
+
+	bool contains(const char* key) const {
+		return !(*this)[key].isNull();
+	}
+
+	const JsonValue& operator[](size_t index) const {
+		return type == Type::Array && index < array.size() ? array[index] : null();
+	}
+
+	// literal 0 would be ambiguous between an index and a key without this one
+	const JsonValue& operator[](int index) const {
+		return index >= 0 ? (*this)[(size_t)index] : null();
+	}
+
+	const JsonValue& operator[](const char* key) const {
+		if (type == Type::Object)
+			for (const auto& member : object)
+				if (member.first == key)
+					return member.second;
+		return null();
+	}
+
+	double asNumber(double fallback = 0.0) const {
+		return type == Type::Number ? number : fallback;
+	}
+
+	int asInt(int fallback = -1) const {
+		return type == Type::Number && number >= -2147483648.0 && number <= 2147483647.0 ? (int)number : fallback;
+	}
+
+	// sizes and offsets, 0 for anything negative or not a number
+	size_t asSize() const {
+		return type == Type::Number && number >= 0.0 && number <= 9007199254740992.0 ? (size_t)number : 0;
+	}
+
+	const std::string& asString() const {
+		return string; // empty for anything but a string
+	}
+
+private:
+	static const JsonValue& null() {
+		static const JsonValue value;
+		return value;
+	}
+};
+
+// recursive descent over the text, nesting is limited so hostile files cannot overflow the stack
+class JsonParser {
+public:
+	// false (and an error printed) when the text is not valid JSON
+	static bool parse(const char* text, size_t length, JsonValue& out) {
+		JsonParser parser(text, text + length);
+		parser.skipSpace();
+		if (!parser.parseValue(out, 0)) {
+			std::cout << "ERROR::JSON::PARSE_FAILED: at byte " << parser.p - text << std::endl;
+			return false;
+		}
+		parser.skipSpace();
+		if (parser.p != parser.end) {
+			std::cout << "ERROR::JSON::TRAILING_DATA: at byte " << parser.p - text << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+private:
+	static const int MAX_DEPTH = 128;
+
+	const char* p;
+	const char* end;
+
+	JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+	void skipSpace() {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+			p++;
+	}
+
+	bool literal(const char* word) {
+		size_t length = std::strlen(word);
+		if ((size_t)(end - p) < length || std::memcmp(p, word, length) != 0)
+			return false;
+		p += length;
+		return true;
+	}
+
+	bool parseValue(JsonValue& value, int depth) {
+		if (p >= end || depth > MAX_DEPTH)
+			return false;
+		switch (*p) {
+		case '{': return parseObject(value, depth);
+		case '[': return parseArray(value, depth);
+		case '"':
+			value.type = JsonValue::Type::String;
+			return parseString(value.string);
+		case 't':
+			value.type = JsonValue::Type::Bool;
+			value.boolean = true;
+			return literal("true");
+		case 'f':
+			value.type = JsonValue::Type::Bool;
+			return literal("false");
+		case 'n':
+			return literal("null");
+		default:
+			return parseNumber(value);
+		}
+	}
+
+	bool parseNumber(JsonValue& value) {
+		// strtod wants a terminated string, numbers are short so copy the candidate characters out
+		char buffer[64];
+		size_t length = 0;
+		while (p + length < end && length < sizeof(buffer) - 1 && std::strchr("+-.0123456789eE", p[length]) != nullptr && p[length] != '\0')
+			length++;
+		if (length == 0)
+			return false;
+		std::memcpy(buffer, p, length);
+		buffer[length] = '\0';
+		char* parsed;
+		value.type = JsonValue::Type::Number;
+		value.number = std::strtod(buffer, &parsed);
+		if (parsed == buffer)
+			return false;
+		p += parsed - buffer;
+		return true;
+	}
+
+	static void appendUtf8(std::string& out, unsigned int code) {
+		if (code < 0x80)
+			out += (char)code;
+		else if (code < 0x800) {
+			out += (char)(0xC0 | (code >> 6));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000) {
+			out += (char)(0xE0 | (code >> 12));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else {
+			out += (char)(0xF0 | (code >> 18));
+			out += (char)(0x80 | ((code >> 12) & 0x3F));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool parseHex4(unsigned int& code) {
+		if (end - p < 4)
+			return false;
+		code = 0;
+		for (int i = 0; i < 4; i++, p++) {
+			char c = *p;
+			int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+			if (digit < 0)
+				return false;
+			code = code * 16 + digit;
+		}
+		return true;
+	}
+
+	bool parseString(std::string& out) {
+		p++; // opening quote
+		while (p < end && *p != '"') {
+			if (*p != '\\') {
+				out += *p++;
+				continue;
+			}
+			if (++p >= end)
+				return false;
+			char escape = *p++;
+			switch (escape) {
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				unsigned int code;
+				if (!parseHex4(code))
+					return false;
+				// a surrogate pair encodes one code point above the basic plane
+				if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+					p += 2;
+					unsigned int low;
+					if (!parseHex4(low))
+						return false;
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(out, code);
+				break;
+			}
+			default: out += escape; break; // \" \\ \/
+			}
+		}
+		if (p >= end)
+			return false;
+		p++; // closing quote
+		return true;
+	}
+
+	bool parseArray(JsonValue& value, int depth) {
+		value.type = JsonValue::Type::Array;
+		p++;
+		skipSpace();
+		if (p < end && *p == ']') {
+			p++;
+			return true;
+		}
+		while (true) {
+			value.array.emplace_back();
+			skipSpace();
+			if (!parseValue(value.array.back(), depth + 1))
+				return false;
+			skipSpace();
+			if (p < end && *p == ',') {
+				p++;
+				continue;
+			}
+			if (p < end && *p == ']') {
+				p++;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	bool parseObject(JsonValue& value, int depth) {
+		value.type = JsonValue::Type::Object;
+		p++;
+		skipSpace();
+		if (p < end && *p == '}') {
+			p++;
+			return true;
+		}
+		while (true) {
+			skipSpace();
+			if (p >= end || *p != '"')
+				return false;
+			value.object.emplace_back();
+			if (!parseString(value.object.back().first))
+				return false;
+			skipSpace();
+			if (p >= end || *p != ':')
+				return false;
+			p++;
+			skipSpace();
+			if (!parseValue(value.object.back().second, depth + 1))
+				return false;
+			skipSpace();
+			if (p < end && *p == ',') {
+				p++;
+				continue;
+			}
+			if (p < end && *p == '}') {
+				p++;
+				return true;
+			}
+			return false;
+		}
+	}
+};
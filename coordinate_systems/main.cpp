@@ -2,17 +2,100 @@
 
 	Successfully import GLM libraries
 
+	- Meshes are imported from obj and gltf files, parsed on every core and folded into unique indexed vertices
+		'--mesh model.obj|model.gltf|model.glb'         draws the model turning in front of the camera
+		'--bench-import a.obj b.glb ...'                MB/s and triangles per second of the importer on those files, a
+		                                                generated 1M triangle torus when no file is given
+
+	- Imported meshes are reordered for the GPU: triangles for the vertex cache and then for overdraw, vertices for fetch
+	  locality. ACMR and ATVR before and after are printed
+		'--no-optimize'                                 draws the mesh in file order
+		'--bench-optimize a.obj b.glb ...'              vertex cache and fetch figures of those files before and after, as
+		                                                written and with shuffled triangles
+
+	- Mesh vertices can be packed from 32 to 16 bytes: half or 16 bit normalized positions, octahedral normals, 16 bit uvs
+		'--packed half|snorm16'                         draws the mesh with packed vertices
+		'--split-streams'                               positions in one buffer and the other attributes in a second
+		'--bench-vertex a.obj ...'                      size, packing error and vertex throughput of every format and
+		                                                stream layout
+
+	- Meshes can be cooked offline into files holding the GPU buffers as they are, memory mapped and uploaded without a parse
+		'--cook-mesh model.obj model.mesh'              imports, writes the cooked file and exits, '--mesh model.mesh' draws it
+		'--bench-cooked a.obj b.glb ...'                time to drawable buffers importing each file against its cooked version
+
+	- Meshes can be drawn with programmable vertex pulling, vertices in a storage buffer the vertex shader reads by
+	  gl_VertexID, every draw through one VAO without attributes and a whole frame in one multi-draw
+		'--pulled'                                      draws the mesh from a mesh pool
+		'--bench-pulling 4096 64'                       4096 objects of 64 meshes drawn with a VAO per mesh, a VAO per
+		                                                layout and pulled, per object, multi-draw and instanced
+
+	- Mesh buffers can be ranges of a few large GL buffers, handed out by a TLSF allocator and compacted a little at a time
+		'--heap'                                        puts the mesh's buffers in a GPU heap and prints its statistics
+		'--bench-heap 10000'                            10000 meshes in buffers of their own against heap ranges, then
+		                                                fragmentation while half of them are freed and the heap compacted
+
+	- Per frame data comes from bump allocators: a scratch arena on the CPU and a double buffered, persistently mapped
+	  frame arena the GPU reads transforms and commands from. once warm the render loop allocates nothing
+		'--check-allocations 300'                       counts operator new in 300 frames after a warm up, then exits,
+		                                                with -1 if there were any
+		'--bench-arena 10000'                           10000 objects' transforms and commands built every frame in
+		                                                std::vectors, the scratch arena and the frame arena
+
+	- Transforms and bounds of many objects go through batch kernels instead of one glm call each, AVX2 picked at
+	  startup and returning glm's results bit for bit
+		'--bench-math 10000000'                         ns per element of glm and the AVX2 and FMA kernels from 1k
+		                                                elements up to that many, and whether they agree with glm
+
+	- GLM itself can be built with its intrinsics: the ReleaseSIMD configuration defines GLM_FORCE_<ISA> and
+	  GLM_FORCE_DEFAULT_ALIGNED_GENTYPES, the instruction set is the GlmSimdIsa property (SSE2, SSE41, AVX or AVX2)
+		'--bench-glm 100000'                            ns per call of mat4 products, inverse, lookAt, perspective and
+		                                                quaternion operations in GLM's scalar and SIMD code over that
+		                                                many inputs and the SIMD error, -1 when it is past tolerance
+
+	- Scene transforms form a hierarchy stored depth first in flat arrays. only dirty subtrees are recomputed, in parallel,
+	  and world matrices go straight into a persistently mapped buffer with a region per frame in flight
+		'--bench-hierarchy 1000000'                     ms per update of that many nodes with 1%, 10% and 100% of them
+		                                                set, on one thread, every core and writing the GPU buffer
+
+	- The camera keeps its view, projection and view projection and rebuilds them only when its inputs change, along with
+	  the frustum planes. boxes and spheres kept SoA are culled against them eight at a time into a list of visible indices
+		'--bench-culling 1000000'                       ms to cull that many boxes and spheres with the scalar and AVX2
+		                                                kernels and on every thread, and whether they agree
+
+	- Objects can be culled on the GPU: their bounds in a storage buffer, a compute pass tests them against the frustum and
+	  last frame's depth pyramid and writes the draw commands of the survivors for one indirect multi-draw
+		'--bench-gpu-culling 100000'                    CPU and GPU time per frame at a hundredth, a tenth and all of that
+		                                                many objects, and whether the GPU drew what a CPU reference would,
+		                                                -1 when it did not
+
 */
 
+// the counting operator new lives here, defined before benchmarks.h includes the header without it
+#define ALLOCATION_COUNTER_IMPLEMENTATION
+#include <allocation_counter.h>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <shader.h>
+#include <camera.h>
+#include <job_system.h>
+#include <mesh.h>
+#include <mesh_pool.h>
+#include <cooked_mesh.h>
+#include <frame_arena.h>
+#include <benchmarks.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
 
 void frameBufferSizeCallback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -21,12 +104,119 @@ void printMatrix(const glm::mat4& matrix);
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
-int main() {
+// frames '--check-allocations' lets pass first, shaders and driver state settle and buffers reach their size
+const int ALLOCATION_WARMUP_FRAMES = 30;
+
+int main(int argc, char** argv) {
+
+	// parse command line
+	std::string mesh_path;
+	bool optimize = true;
+	std::string packed_format;
+	VertexStreams streams = VertexStreams::Interleaved;
+	bool bench_vertex = false;
+	std::vector<std::string> bench_vertex_files;
+	bool bench_cooked = false;
+	std::vector<std::string> bench_cooked_files;
+	bool pulled = false;
+	int bench_pulling_objects = 0, bench_pulling_meshes = 0;
+	bool use_heap = false;
+	int bench_heap_meshes = 0;
+	int check_allocation_frames = 0;
+	int bench_arena_objects = 0;
+	int bench_hierarchy_nodes = 0;
+	int bench_gpu_culling_objects = 0;
+	for (int i = 1; i < argc; i++) {
+		int remaining = argc - i - 1; // values left after this option
+		if (std::strcmp(argv[i], "--mesh") == 0 && remaining >= 1)
+			mesh_path = argv[++i];
+		else if (std::strcmp(argv[i], "--bench-import") == 0) {
+			// no context needed, every argument after it is a file
+			benchmarkMeshImport(std::vector<std::string>(argv + i + 1, argv + argc));
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--no-optimize") == 0)
+			optimize = false;
+		else if (std::strcmp(argv[i], "--packed") == 0 && remaining >= 1)
+			packed_format = argv[++i];
+		else if (std::strcmp(argv[i], "--split-streams") == 0)
+			streams = VertexStreams::Split;
+		else if (std::strcmp(argv[i], "--bench-vertex") == 0) {
+			// every argument after it is a file, the draws need the context
+			bench_vertex = true;
+			bench_vertex_files.assign(argv + i + 1, argv + argc);
+			break;
+		}
+		else if (std::strcmp(argv[i], "--bench-optimize") == 0) {
+			// no context needed, every argument after it is a file
+			benchmarkMeshOptimize(std::vector<std::string>(argv + i + 1, argv + argc));
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--cook-mesh") == 0 && remaining >= 2) {
+			// offline tool, runs without a window
+			JobSystem jobs;
+			MeshData mesh;
+			return importMesh(jobs, argv[i + 1], mesh, optimize) && cookMesh(mesh, argv[i + 2]) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--bench-cooked") == 0) {
+			// every argument after it is a file, the upload needs the context
+			bench_cooked = true;
+			bench_cooked_files.assign(argv + i + 1, argv + argc);
+			break;
+		}
+		else if (std::strcmp(argv[i], "--pulled") == 0)
+			pulled = true;
+		else if (std::strcmp(argv[i], "--bench-pulling") == 0 && remaining >= 2) {
+			bench_pulling_objects = std::atoi(argv[++i]);
+			bench_pulling_meshes = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--heap") == 0)
+			use_heap = true;
+		else if (std::strcmp(argv[i], "--bench-heap") == 0 && remaining >= 1)
+			bench_heap_meshes = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--check-allocations") == 0 && remaining >= 1)
+			check_allocation_frames = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--bench-arena") == 0 && remaining >= 1)
+			bench_arena_objects = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--bench-hierarchy") == 0 && remaining >= 1)
+			bench_hierarchy_nodes = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--bench-gpu-culling") == 0 && remaining >= 1)
+			bench_gpu_culling_objects = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--bench-math") == 0) {
+			// no context needed
+			benchmarkBatchMath(remaining >= 1 ? std::strtoull(argv[i + 1], nullptr, 10) : 10000000);
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-glm") == 0) {
+			// no context needed
+			return benchmarkGlm(remaining >= 1 ? std::strtoull(argv[i + 1], nullptr, 10) : 100000) ? 0 : -1;
+		}
+		else if (std::strcmp(argv[i], "--bench-culling") == 0) {
+			// no context needed
+			benchmarkFrustumCulling(remaining >= 1 ? std::strtoull(argv[i + 1], nullptr, 10) : 1000000);
+			return 0;
+		}
+	}
+
+	// import before the window opens, the parse does not need the context. cooked meshes are only mapped here and
+	// uploaded from the mapping once the context exists, unless they go into a mesh pool
+	JobSystem jobs;
+	MeshData mesh_data;
+	CookedMesh cooked_mesh;
+	if (!mesh_path.empty()) {
+		MeshOptimizeStats optimize_stats;
+		bool cooked = meshExtension(mesh_path) == ".mesh" && !pulled;
+		bool loaded = cooked ? cooked_mesh.open(mesh_path) : importMesh(jobs, mesh_path, mesh_data, optimize, &optimize_stats);
+		if (!loaded)
+			return -1;
+		if (!cooked && optimize)
+			printMeshOptimizeStats(optimize_stats);
+	}
 
 	// initialize and configure glfw
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// glfw, create window
@@ -45,29 +235,161 @@ int main() {
 		return -1;
 	}
 
+	// benchmarks only need the context
+	if (bench_cooked || bench_vertex || bench_pulling_objects > 0 || bench_heap_meshes > 0 || bench_arena_objects > 0
+		|| bench_hierarchy_nodes > 0 || bench_gpu_culling_objects > 0) {
+		int result = 0;
+		if (bench_cooked)
+			benchmarkCookedMesh(bench_cooked_files);
+		if (bench_vertex)
+			benchmarkVertexFormats(bench_vertex_files);
+		if (bench_pulling_objects > 0)
+			benchmarkVertexPulling(bench_pulling_objects, bench_pulling_meshes);
+		if (bench_heap_meshes > 0)
+			benchmarkGpuHeap(bench_heap_meshes);
+		if (bench_arena_objects > 0)
+			benchmarkFrameArena(bench_arena_objects);
+		if (bench_hierarchy_nodes > 0)
+			benchmarkTransformHierarchy(bench_hierarchy_nodes);
+		if (bench_gpu_culling_objects > 0 && !benchmarkGpuCulling(bench_gpu_culling_objects))
+			result = -1;
+		glfwTerminate();
+		return result;
+	}
+
 	// GLM test
 	glm::mat4 model = glm::mat4(1.0f); // Identity matrix
-	glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f)); // Translate camera
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f); // Perspective projection
+	Camera camera(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), 45.0f, (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f); // 5 units back, looking at the origin
 
 	// Print matrices to verify GLM functionality
 	std::cout << "Model Matrix:" << std::endl;
 	printMatrix(model);
 	std::cout << "View Matrix:" << std::endl;
-	printMatrix(view);
+	printMatrix(camera.view());
 	std::cout << "Projection Matrix:" << std::endl;
-	printMatrix(projection);
+	printMatrix(camera.projection());
+
+	// imported mesh, centered and scaled so its bounds fit a sphere of radius 1.5 in front of the camera
+	VertexArrayCache vertex_arrays;
+	std::unique_ptr<GpuBufferHeap> heap = use_heap ? std::make_unique<GpuBufferHeap>() : nullptr;
+	GpuBufferHeap* mesh_heap = heap.get();
+	std::unique_ptr<Mesh> mesh;
+	std::unique_ptr<MeshPool> pool; // '--pulled' instead of 'mesh'
+	std::unique_ptr<GpuFrameArena> frame_arena; // the pool's per frame transforms
+	std::unique_ptr<Shader> mesh_shader;
+	glm::mat4 mesh_fit = glm::mat4(1.0f);
+	if (!mesh_data.vertices.empty() || cooked_mesh.isOpen()) {
+		glm::vec3 bounds_min, bounds_max;
+		if (cooked_mesh.isOpen()) {
+			bounds_min = glm::make_vec3(cooked_mesh.header.bounds_min);
+			bounds_max = glm::make_vec3(cooked_mesh.header.bounds_max);
+			std::cout << "Mesh: " << cooked_mesh.header.index_count / 3 << " triangles, " << cooked_mesh.header.vertex_count << " vertices (cooked)" << std::endl;
+			mesh = std::make_unique<Mesh>(vertex_arrays, cooked_mesh, mesh_heap);
+			cooked_mesh.close(); // on the GPU now
+		}
+		else {
+			bounds_min = glm::make_vec3(mesh_data.bounds_min);
+			bounds_max = glm::make_vec3(mesh_data.bounds_max);
+			std::cout << "Mesh: " << mesh_data.triangleCount() << " triangles, " << mesh_data.vertices.size() << " vertices" << std::endl;
+			if (pulled) {
+				pool = std::make_unique<MeshPool>();
+				pool->add(mesh_data);
+				pool->upload();
+				frame_arena = std::make_unique<GpuFrameArena>(64 * 1024);
+			}
+			else if (packed_format.empty())
+				mesh = std::make_unique<Mesh>(vertex_arrays, mesh_data, streams, mesh_heap);
+			else {
+				PositionEncoding encoding = packed_format == "half" ? PositionEncoding::Half : PositionEncoding::Snorm16;
+				mesh = std::make_unique<Mesh>(vertex_arrays, packMesh(mesh_data, encoding), streams, mesh_heap);
+			}
+			std::cout << "Vertex buffers: " << (pool ? pool->bytes() : mesh->vertex_bytes) / 1024 << " KB" << std::endl;
+			mesh_data = MeshData(); // on the GPU now
+		}
+		float radius = glm::length(bounds_max - bounds_min) * 0.5f;
+		mesh_fit = glm::scale(glm::mat4(1.0f), glm::vec3(1.5f / (radius > 0.0f ? radius : 1.0f)));
+		mesh_fit = glm::translate(mesh_fit, -(bounds_min + bounds_max) * 0.5f);
+
+		if (pool)
+			mesh_shader = std::make_unique<Shader>("glsl/mesh_pulled_vertex.glsl", "glsl/mesh_fragment.glsl");
+		else {
+			mesh_shader = mesh->packed
+				? std::make_unique<Shader>("glsl/mesh_packed_vertex.glsl", "glsl/mesh_fragment.glsl")
+				: std::make_unique<Shader>("glsl/mesh_vertex.glsl", "glsl/mesh_fragment.glsl");
+			checkVertexLayout(mesh_shader->program, mesh->attributes, mesh->attribute_count);
+		}
+		glEnable(GL_DEPTH_TEST);
+		if (heap)
+			heap->printStats();
+	}
 
 	// render loop
+	int frame = 0;
 	while (!glfwWindowShouldClose(window)) {
+		if (check_allocation_frames > 0 && frame == ALLOCATION_WARMUP_FRAMES)
+			startAllocationCount();
 		processInput(window);
 
+		if (mesh || pool) {
+			glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+			camera.setAspect(width, height); // only rebuilds the projection on a resize
+			model = glm::rotate(glm::mat4(1.0f), (float)glfwGetTime() * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f)) * mesh_fit;
+
+			mesh_shader->use();
+			mesh_shader->setMat4("model", model);
+			if (mesh && mesh->packed) {
+				mesh_shader->setMat4("dequantize", mesh->dequantize);
+				mesh_shader->setVec4("uv_transform", glm::make_vec4(mesh->uv_transform));
+			}
+			mesh_shader->setMat4("view", camera.view());
+			mesh_shader->setMat4("projection", camera.projection());
+			mesh_shader->setVec3("light_direction", glm::vec3(0.4f, 0.8f, 0.6f));
+			mesh_shader->setVec3("color", glm::vec3(0.8f, 0.75f, 0.7f));
+			if (pool) {
+				// the one instance reads its model matrix from this frame's region of the frame arena
+				frame_arena->beginFrame();
+				GpuFrameAllocation transform = frame_arena->allocate(sizeof(glm::mat4));
+				std::memcpy(transform.data, glm::value_ptr(model), sizeof(glm::mat4));
+				pool->bind();
+				pool->bindTransforms(frame_arena->buffer, transform.offset, sizeof(glm::mat4));
+				pool->draw(pool->command(0, 0));
+				frame_arena->endFrame();
+			}
+			else
+				mesh->draw();
+		}
+
 		// swap buffers and poll IO events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		if (check_allocation_frames > 0 && ++frame == ALLOCATION_WARMUP_FRAMES + check_allocation_frames)
+			break;
 	}
+	AllocationCount loop_allocations = stopAllocationCount();
 
+	// GL objects go before the context
+	mesh.reset();
+	pool.reset();
+	frame_arena.reset();
+	heap.reset();
+	vertex_arrays.clear();
+	if (mesh_shader)
+		glDeleteProgram(mesh_shader->program);
 	glfwTerminate();
+
+	if (check_allocation_frames > 0) {
+		if (loop_allocations.allocations > 0) {
+			std::cout << "ERROR::RENDER_LOOP::ALLOCATED: " << loop_allocations.allocations << " allocations of "
+				<< loop_allocations.bytes << " bytes in " << check_allocation_frames << " frames after warm up" << std::endl;
+			return -1;
+		}
+		std::cout << "Render loop: no allocations in " << check_allocation_frames << " frames after warm up" << std::endl;
+	}
 	return 0;
 }
 
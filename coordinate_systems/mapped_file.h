@@ -0,0 +1,108 @@
+#pragma once
+// mapped file class defined here
+// the class from bouncing_dvd's asset_pack.h, cooked meshes (cooked_mesh.h) are read through it
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifdef APIENTRY
+#undef APIENTRY // glad's definition, windows.h defines the same thing again
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+
+// read only view of a whole file through the OS page cache
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile() {
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+			memory = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (memory == nullptr) {
+			close();
+			return false;
+		}
+		length = (size_t)file_size.QuadPart;
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return false;
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+			::close(descriptor);
+			return false;
+		}
+		void* address = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		::close(descriptor); // the mapping keeps its own reference to the file
+		if (address == MAP_FAILED)
+			return false;
+		memory = (const unsigned char*)address;
+		length = (size_t)status.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (memory != nullptr)
+			UnmapViewOfFile(memory);
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (memory != nullptr)
+			munmap((void*)memory, length);
+#endif
+		memory = nullptr;
+		length = 0;
+	}
+
+	const unsigned char* data() const {
+		return memory;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+private:
+	const unsigned char* memory = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+};
+
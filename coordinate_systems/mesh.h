@@ -0,0 +1,214 @@
+#pragma once
+// mesh class defined here
+// imported geometry on the GPU: one interleaved VBO and an EBO drawn through the VAO a VertexArrayCache (vertex_layout.h)
+// keeps for the mesh's layout, indices 16 bit whenever the vertex count allows. the buffers are immutable storage, filled
+// once from the imported MeshData, its PackedMeshData (vertex_format.h) or straight from the pages of a mapped cooked
+// file (cooked_mesh.h), either the mesh's own or ranges of a GpuBufferHeap (gpu_heap.h) shared with other meshes.
+// vertices can also be split into a position stream and an attribute stream
+//
+// importMesh() picks the loader from the file extension, .obj (obj_loader.h), .gltf / .glb (gltf_loader.h) or .mesh
+// (cooked_mesh.h), then reorders source files for the GPU (mesh_optimizer.h)
+
+#include <glad/glad.h>
+
+#include <cooked_mesh.h>
+#include <gpu_heap.h>
+#include <gltf_loader.h>
+#include <job_system.h>
+#include <mesh_data.h>
+#include <mesh_optimizer.h>
+#include <obj_loader.h>
+#include <vertex_format.h>
+#include <vertex_layout.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// lower case, with the dot
+inline std::string meshExtension(const std::string& path) {
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension;
+}
+
+// false for unknown extensions and files the loader rejects, 'mesh' is left empty then. 'optimize' runs optimizeMesh()
+// on obj and gltf files, cooked files keep the order they were cooked in. 'stats' receives what it did
+inline bool importMesh(JobSystem& jobs, const std::string& path, MeshData& mesh, bool optimize = true, MeshOptimizeStats* stats = nullptr) {
+	std::string extension = meshExtension(path);
+	bool loaded = false;
+	if (extension == ".obj")
+		loaded = loadObj(jobs, path, mesh);
+	else if (extension == ".gltf" || extension == ".glb")
+		loaded = loadGltf(jobs, path, mesh);
+	else if (extension == ".mesh")
+		loaded = loadCookedMesh(path, mesh);
+	else
+		std::cout << "ERROR::MESH::UNKNOWN_FORMAT: " << path << std::endl;
+	if (!loaded)
+		mesh = MeshData();
+	else if (optimize && extension != ".mesh") {
+		MeshOptimizeStats optimized = optimizeMesh(mesh);
+		if (stats != nullptr)
+			*stats = optimized;
+	}
+	return loaded;
+}
+
+enum class VertexStreams {
+	Interleaved, // one buffer with every attribute
+	Split,       // positions in one buffer, everything else in a second
+};
+
+class Mesh {
+public:
+	unsigned int VAO, VBO, EBO;  // handles, VBO holds only the positions with split streams. the VAO belongs to the
+	                             // VertexArrayCache and is shared by every mesh with the same layout
+	unsigned int attribute_buffer = 0; // split streams, everything but the position
+	GLsizei index_count;
+	GLenum index_type;           // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	bool packed = false;         // PackedVertex, drawn with glsl/mesh_packed_vertex.glsl
+	glm::mat4 dequantize = glm::mat4(1.0f);          // for the 'dequantize' uniform, or the model matrix of a depth only pass
+	float uv_transform[4] = { 0.0f, 0.0f, 1.0f, 1.0f }; // offset and scale for the 'uv_transform' uniform
+	size_t vertex_bytes = 0;     // every vertex buffer together
+	const VertexAttribute* attributes = nullptr; // the layout's, for checkVertexLayout()
+	size_t attribute_count = 0;
+
+	// 'vertex_arrays' has to outlive the mesh, and so does 'heap' when the buffers are ranges of it rather than the
+	// mesh's own
+	Mesh(VertexArrayCache& vertex_arrays, const MeshData& data, VertexStreams streams = VertexStreams::Interleaved,
+		GpuBufferHeap* heap = nullptr) : heap(heap) {
+		std::vector<unsigned char> indices = packIndices(data);
+		setup<MeshVertexLayout>(vertex_arrays, data.vertices.data(), data.vertices.size(),
+			streams == VertexStreams::Split ? MESH_VERTEX_POSITION_BYTES : 0, indices.data(), indices.size(),
+			(GLsizei)data.indices.size(), data.wideIndices() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT);
+	}
+
+	Mesh(VertexArrayCache& vertex_arrays, const PackedMeshData& data, VertexStreams streams = VertexStreams::Interleaved,
+		GpuBufferHeap* heap = nullptr) : heap(heap) {
+		std::vector<unsigned char> indices = packIndices(data.indices, data.wideIndices());
+		packed = true;
+		dequantize = data.dequantize;
+		std::memcpy(uv_transform, data.uv_transform, sizeof(uv_transform));
+		GLuint split = streams == VertexStreams::Split ? PACKED_VERTEX_POSITION_BYTES : 0;
+		GLenum type = data.wideIndices() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+		if (data.position_encoding == PositionEncoding::Half)
+			setup<PackedVertexLayoutHalf>(vertex_arrays, data.vertices.data(), data.vertices.size(), split, indices.data(),
+				indices.size(), (GLsizei)data.indices.size(), type);
+		else
+			setup<PackedVertexLayoutSnorm16>(vertex_arrays, data.vertices.data(), data.vertices.size(), split, indices.data(),
+				indices.size(), (GLsizei)data.indices.size(), type);
+	}
+
+	// upload from the mapping, the cooked file can be closed once this returns
+	Mesh(VertexArrayCache& vertex_arrays, const CookedMesh& cooked, GpuBufferHeap* heap = nullptr) : heap(heap) {
+		const CookedMeshHeader& header = cooked.header;
+		setup<MeshVertexLayout>(vertex_arrays, cooked.vertices(), header.vertex_count, 0, cooked.indices(),
+			(size_t)header.index_bytes, (GLsizei)header.index_count, header.index_size == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT);
+	}
+
+	~Mesh() {
+		if (heap != nullptr) {
+			heap->free(vertex_range);
+			heap->free(attribute_range);
+			heap->free(index_range);
+			return;
+		}
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		if (attribute_buffer != 0)
+			glDeleteBuffers(1, &attribute_buffer);
+	}
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// point the shared VAO at this mesh's buffers, the attribute format on it stays as it is. heap ranges are looked up
+	// every time, compaction may have moved them
+	void draw() const {
+		GLintptr vertex_offset = 0, attribute_offset = 0, index_offset = 0;
+		if (heap != nullptr) {
+			vertex_offset = heap->offset(vertex_range);
+			attribute_offset = attribute_range ? heap->offset(attribute_range) : 0;
+			index_offset = heap->offset(index_range);
+		}
+		if (attribute_buffer == 0)
+			glVertexArrayVertexBuffer(VAO, 0, VBO, vertex_offset, stride);
+		else {
+			glVertexArrayVertexBuffer(VAO, 0, VBO, vertex_offset, (GLsizei)position_bytes);
+			glVertexArrayVertexBuffer(VAO, 1, attribute_buffer, attribute_offset, stride - (GLsizei)position_bytes);
+		}
+		glVertexArrayElementBuffer(VAO, EBO);
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, index_count, index_type, (const void*)index_offset);
+	}
+
+private:
+	GLsizei stride = 0;
+	GLuint position_bytes = 0;
+	GpuBufferHeap* heap;
+	GpuAllocation vertex_range, attribute_range, index_range;
+
+	// 'split_bytes' above 0 splits the vertices into two streams there
+	template <typename Layout>
+	void setup(VertexArrayCache& vertex_arrays, const void* vertices, size_t vertex_count, GLuint split_bytes,
+		const void* indices, size_t index_bytes, GLsizei count, GLenum type) {
+		index_count = count;
+		index_type = type;
+		stride = Layout::stride;
+		position_bytes = split_bytes;
+		vertex_bytes = vertex_count * Layout::stride;
+		attributes = Layout::attributes.data();
+		attribute_count = Layout::count;
+		VAO = vertex_arrays.get<Layout>(position_bytes);
+
+		std::vector<unsigned char> positions, rest;
+		const void* first = vertices; // what binding 0 reads
+		size_t first_bytes = vertex_bytes;
+		if (position_bytes > 0) {
+			splitVertexStreams((const unsigned char*)vertices, vertex_count, Layout::stride, position_bytes, positions, rest);
+			first = positions.data();
+			first_bytes = positions.size();
+		}
+
+		// ranges of the heap's shared buffers, the buffer objects stay fixed and only the offsets can move
+		if (heap != nullptr) {
+			vertex_range = heap->allocate(first_bytes, 16, first);
+			if (position_bytes > 0)
+				attribute_range = heap->allocate(rest.size(), 16, rest.data());
+			index_range = heap->allocate(index_bytes, 16, indices);
+			if (vertex_range && index_range && (position_bytes == 0 || attribute_range)) {
+				VBO = heap->buffer(vertex_range);
+				if (position_bytes > 0)
+					attribute_buffer = heap->buffer(attribute_range);
+				EBO = heap->buffer(index_range);
+				return;
+			}
+			// the heap could not take them, the mesh gets buffers of its own
+			heap->free(vertex_range);
+			heap->free(attribute_range);
+			heap->free(index_range);
+			heap = nullptr;
+		}
+
+		// immutable storage, the driver copies straight from 'vertices' and 'indices', no staging copy on our side
+		glCreateBuffers(1, &VBO);
+		glCreateBuffers(1, &EBO);
+		if (vertex_bytes > 0)
+			glNamedBufferStorage(VBO, first_bytes, first, 0);
+		if (position_bytes > 0) {
+			glCreateBuffers(1, &attribute_buffer);
+			if (vertex_bytes > 0)
+				glNamedBufferStorage(attribute_buffer, rest.size(), rest.data(), 0);
+		}
+		if (index_bytes > 0)
+			glNamedBufferStorage(EBO, index_bytes, indices, 0);
+	}
+};
@@ -0,0 +1,157 @@
+#pragma once
+// mesh data struct and vertex deduplication defined here
+// what the importers (obj_loader.h, gltf_loader.h) produce and the Mesh class (mesh.h) uploads: one flat array of unique
+// vertices and a triangle list indexing it
+//
+// the importers emit one vertex per triangle corner, VertexDeduplicator folds identical corners into one vertex with an
+// open addressing hash table keyed on the vertex bytes
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// interleaved, 32 bytes
+struct MeshVertex {
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+struct MeshData {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices; // three per triangle
+	float bounds_min[3] = { 0.0f, 0.0f, 0.0f };
+	float bounds_max[3] = { 0.0f, 0.0f, 0.0f };
+	bool has_normals = false; // false when normals were generated, see computeNormals()
+	bool has_uvs = false;
+
+	size_t triangleCount() const {
+		return indices.size() / 3;
+	}
+
+	// 16 bit indices whenever every vertex fits, half the index memory and bandwidth
+	bool wideIndices() const {
+		return vertices.size() > 65536;
+	}
+
+	size_t indexSize() const {
+		return wideIndices() ? 4 : 2;
+	}
+};
+
+// copy the indices out at 16 or 32 bits each, what the index buffer holds
+inline std::vector<unsigned char> packIndices(const std::vector<uint32_t>& indices, bool wide) {
+	std::vector<unsigned char> packed(indices.size() * (wide ? 4 : 2));
+	if (wide)
+		std::memcpy(packed.data(), indices.data(), packed.size());
+	else {
+		uint16_t* narrow = (uint16_t*)packed.data();
+		for (size_t i = 0; i < indices.size(); i++)
+			narrow[i] = (uint16_t)indices[i];
+	}
+	return packed;
+}
+
+// at the width wideIndices() asks for
+inline std::vector<unsigned char> packIndices(const MeshData& mesh) {
+	return packIndices(mesh.indices, mesh.wideIndices());
+}
+
+inline void computeBounds(MeshData& mesh) {
+	for (int c = 0; c < 3; c++) {
+		mesh.bounds_min[c] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].position[c];
+		mesh.bounds_max[c] = mesh.bounds_min[c];
+	}
+	for (const MeshVertex& vertex : mesh.vertices)
+		for (int c = 0; c < 3; c++) {
+			mesh.bounds_min[c] = std::min(mesh.bounds_min[c], vertex.position[c]);
+			mesh.bounds_max[c] = std::max(mesh.bounds_max[c], vertex.position[c]);
+		}
+}
+
+// smooth normals for meshes that came without any, every triangle adds its area weighted normal to its corners
+inline void computeNormals(MeshData& mesh) {
+	for (MeshVertex& vertex : mesh.vertices)
+		vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		MeshVertex* corners[3] = { &mesh.vertices[mesh.indices[i]], &mesh.vertices[mesh.indices[i + 1]], &mesh.vertices[mesh.indices[i + 2]] };
+		float a[3], b[3];
+		for (int c = 0; c < 3; c++) {
+			a[c] = corners[1]->position[c] - corners[0]->position[c];
+			b[c] = corners[2]->position[c] - corners[0]->position[c];
+		}
+		float normal[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+		for (MeshVertex* corner : corners)
+			for (int c = 0; c < 3; c++)
+				corner->normal[c] += normal[c];
+	}
+	for (MeshVertex& vertex : mesh.vertices) {
+		float length = std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+		for (int c = 0; c < 3; c++)
+			vertex.normal[c] = length > 0.0f ? vertex.normal[c] / length : (c == 2 ? 1.0f : 0.0f);
+	}
+}
+
+// folds identical vertices into one, add() returns the index of the vertex in 'vertices'
+class VertexDeduplicator {
+public:
+	std::vector<MeshVertex>& vertices;
+
+	// 'expected' corners, the table is sized once for all of them so it never rehashes
+	VertexDeduplicator(std::vector<MeshVertex>& vertices, size_t expected) : vertices(vertices) {
+		size_t capacity = 16;
+		while (capacity < (expected + vertices.size()) * 2)
+			capacity *= 2;
+		rebuild(capacity); // vertices already there keep their indices
+	}
+
+	uint32_t add(const MeshVertex& vertex) {
+		return insert(vertex);
+	}
+
+private:
+	static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+	std::vector<uint32_t> table; // indices into 'vertices'
+	size_t mask = 0;
+
+	static uint64_t hash(const MeshVertex& vertex) {
+		uint64_t words[4];
+		std::memcpy(words, &vertex, sizeof(words));
+		uint64_t h = 0x9E3779B97F4A7C15ull;
+		for (uint64_t word : words) {
+			h ^= word;
+			h *= 0xFF51AFD7ED558CCDull;
+			h ^= h >> 32;
+		}
+		return h;
+	}
+
+	uint32_t insert(const MeshVertex& vertex) {
+		// grow when there are more unique vertices than expected, never the case for the importers here
+		if ((vertices.size() + 1) * 2 > table.size())
+			rebuild(table.size() * 2);
+		size_t slot = hash(vertex) & mask;
+		while (table[slot] != EMPTY) {
+			if (std::memcmp(&vertices[table[slot]], &vertex, sizeof(MeshVertex)) == 0)
+				return table[slot];
+			slot = (slot + 1) & mask;
+		}
+		table[slot] = (uint32_t)vertices.size();
+		vertices.push_back(vertex);
+		return table[slot];
+	}
+
+	void rebuild(size_t capacity) {
+		table.assign(capacity, EMPTY);
+		mask = table.size() - 1;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			size_t slot = hash(vertices[i]) & mask;
+			while (table[slot] != EMPTY)
+				slot = (slot + 1) & mask;
+			table[slot] = (uint32_t)i;
+		}
+	}
+};
@@ -0,0 +1,312 @@
+#pragma once
+// mesh optimizer functions defined here
+// reorder an imported mesh for the GPU without changing what it draws, three passes run in this order:
+//   vertex cache  triangles reordered with Tipsify (Sander, Nehab and Barczak 2007) so recently transformed vertices
+//                 are reused by the post-transform cache
+//   overdraw      the Tipsify clusters are split further where that costs little cache efficiency, then sorted so
+//                 clusters facing away from the mesh center draw first and hide what is behind them
+//   vertex fetch  vertices renumbered in the order the index buffer first uses them, so fetches walk memory forward
+//
+// analyzeVertexCache() measures the result: ACMR (transformed vertices per triangle, 0.5 is ideal for a closed grid)
+// and ATVR (transformed vertices per unique vertex, 1.0 is ideal) on a FIFO cache like the ones GPUs have
+
+#include <mesh_data.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+const unsigned int VERTEX_CACHE_SIZE = 16;     // FIFO entries simulated and optimized for
+const unsigned int VERTEX_FETCH_LINE = 64;     // bytes per memory line fetched
+const unsigned int VERTEX_FETCH_LINES = 256;   // lines in the simulated direct mapped fetch cache
+
+struct VertexCacheStats {
+	double acmr = 0.0;      // average cache miss ratio, vertex shader runs per triangle
+	double atvr = 0.0;      // average transformed vertex ratio, vertex shader runs per referenced vertex
+	double overfetch = 0.0; // bytes read by vertex fetch per byte of referenced vertices
+};
+
+struct MeshOptimizeStats {
+	VertexCacheStats before, after;
+	size_t clusters = 0;    // after the overdraw split
+	double cache_ms = 0.0, overdraw_ms = 0.0, fetch_ms = 0.0;
+};
+
+// simulate a FIFO post-transform cache over 'indices' and a fetch cache over the vertex memory behind it
+inline VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, size_t vertex_stride,
+	unsigned int cache_size = VERTEX_CACHE_SIZE) {
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+	// a vertex is in the cache while fewer than 'cache_size' misses happened since it was loaded
+	std::vector<uint64_t> loaded(vertex_count, 0);
+	std::vector<uint64_t> lines(VERTEX_FETCH_LINES, UINT64_MAX);
+	std::vector<bool> referenced(vertex_count, false);
+	uint64_t misses = 0, fetched_lines = 0;
+	size_t unique = 0;
+	for (uint32_t index : indices) {
+		if (!referenced[index]) {
+			referenced[index] = true;
+			unique++;
+		}
+		if (loaded[index] != 0 && misses - loaded[index] < cache_size)
+			continue;
+		misses++;
+		loaded[index] = misses;
+
+		uint64_t first = (uint64_t)index * vertex_stride / VERTEX_FETCH_LINE, last = ((uint64_t)index * vertex_stride + vertex_stride - 1) / VERTEX_FETCH_LINE;
+		for (uint64_t line = first; line <= last; line++)
+			if (lines[line % VERTEX_FETCH_LINES] != line) {
+				lines[line % VERTEX_FETCH_LINES] = line;
+				fetched_lines++;
+			}
+	}
+	stats.acmr = (double)misses / (indices.size() / 3);
+	stats.atvr = (double)misses / unique;
+	stats.overfetch = (double)(fetched_lines * VERTEX_FETCH_LINE) / ((double)unique * vertex_stride);
+	return stats;
+}
+
+// triangles of every vertex, as offsets into one flat list
+struct TriangleAdjacency {
+	std::vector<uint32_t> offsets; // vertex_count + 1
+	std::vector<uint32_t> triangles;
+
+	TriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertex_count) : offsets(vertex_count + 1, 0), triangles(indices.size()) {
+		for (uint32_t index : indices)
+			offsets[index + 1]++;
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+};
+
+// Tipsify: fan around one vertex at a time, emitting all its remaining triangles, then move to the neighbour that is
+// still in the cache and has the most triangles left. 'clusters' receives the first triangle of every run that had to
+// restart away from the cache (a dead end), the hard boundaries the overdraw pass may reorder
+inline std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count,
+	std::vector<uint32_t>& clusters, unsigned int cache_size = VERTEX_CACHE_SIZE) {
+	size_t triangle_count = indices.size() / 3;
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	clusters.clear();
+	if (triangle_count == 0)
+		return result;
+
+	TriangleAdjacency adjacency(indices, vertex_count);
+	std::vector<uint32_t> live(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	std::vector<uint64_t> cached(vertex_count, 0); // time stamp of the last load
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<uint32_t> dead_ends, candidates;
+	uint64_t time = cache_size + 1;
+	size_t cursor = 0; // next vertex to scan when the dead end stack runs dry
+
+	// first vertex that still has triangles
+	auto nextLive = [&]() -> int64_t {
+		while (!dead_ends.empty()) {
+			uint32_t vertex = dead_ends.back();
+			dead_ends.pop_back();
+			if (live[vertex] > 0)
+				return vertex;
+		}
+		for (; cursor < vertex_count; cursor++)
+			if (live[cursor] > 0)
+				return (int64_t)cursor;
+		return -1;
+	};
+
+	int64_t fan = nextLive();
+	clusters.push_back(0);
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; a++) {
+			uint32_t triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+			emitted[triangle] = true;
+			for (int c = 0; c < 3; c++) {
+				uint32_t vertex = indices[triangle * 3 + c];
+				result.push_back(vertex);
+				dead_ends.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (time - cached[vertex] > cache_size)
+					cached[vertex] = time++;
+			}
+		}
+
+		// the candidate that stays in the cache after its own fan is emitted and has been there longest wins, that uses
+		// the cache best. candidates whose fan would push them out count as 0, anything live beats nothing
+		int64_t best = -1, best_priority = -1;
+		for (uint32_t vertex : candidates)
+			if (live[vertex] > 0) {
+				int64_t priority = 0;
+				if (time - cached[vertex] + 2 * live[vertex] <= cache_size)
+					priority = (int64_t)(time - cached[vertex]);
+				if (priority > best_priority) {
+					best_priority = priority;
+					best = vertex;
+				}
+			}
+		if (best < 0) {
+			best = nextLive();
+			if (best >= 0 && result.size() / 3 < triangle_count)
+				clusters.push_back((uint32_t)(result.size() / 3));
+		}
+		fan = best;
+	}
+	return result;
+}
+
+// split every cluster where the cache misses so far are already within 'threshold' of the whole cluster's ratio, then
+// sort the clusters so the ones facing outwards from the mesh center come first. a threshold of 1.05 gives up at most
+// about 5% ACMR for the freedom to reorder
+inline std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices,
+	const std::vector<uint32_t>& hard_clusters, size_t& cluster_count, float threshold = 1.05f,
+	unsigned int cache_size = VERTEX_CACHE_SIZE) {
+	size_t triangle_count = indices.size() / 3;
+	cluster_count = 0;
+	if (triangle_count == 0)
+		return indices;
+
+	// soft boundaries inside every hard cluster
+	std::vector<uint32_t> clusters;
+	std::vector<uint64_t> loaded(vertices.size(), 0);
+	uint64_t misses = 0;
+	auto miss = [&](uint32_t vertex) {
+		if (loaded[vertex] != 0 && misses - loaded[vertex] < cache_size)
+			return 0;
+		loaded[vertex] = ++misses;
+		return 1;
+	};
+	for (size_t h = 0; h < hard_clusters.size(); h++) {
+		size_t begin = hard_clusters[h], end = h + 1 < hard_clusters.size() ? hard_clusters[h + 1] : triangle_count;
+		// the cluster's own ratio, simulated from a cold cache
+		misses += cache_size + 1;
+		uint64_t cluster_misses = 0;
+		for (size_t t = begin; t < end; t++)
+			for (int c = 0; c < 3; c++)
+				cluster_misses += miss(indices[t * 3 + c]);
+		double limit = threshold * (double)cluster_misses / (double)(end - begin);
+
+		misses += cache_size + 1;
+		clusters.push_back((uint32_t)begin);
+		uint64_t run_misses = 0;
+		size_t run_begin = begin;
+		for (size_t t = begin; t < end; t++) {
+			for (int c = 0; c < 3; c++)
+				run_misses += miss(indices[t * 3 + c]);
+			if (t + 1 < end && (double)run_misses / (double)(t + 1 - run_begin) <= limit) {
+				clusters.push_back((uint32_t)(t + 1));
+				run_begin = t + 1;
+				run_misses = 0;
+				misses += cache_size + 1; // a reordered cluster cannot count on the previous one's vertices
+			}
+		}
+	}
+	cluster_count = clusters.size();
+
+	// area weighted center of the mesh, then every cluster's center and normal
+	auto corner = [&](size_t t, int c) { return vertices[indices[t * 3 + c]].position; };
+	double mesh_center[3] = { 0.0, 0.0, 0.0 }, mesh_area = 0.0;
+	std::vector<float> sort_keys(clusters.size());
+	std::vector<double> cluster_data(clusters.size() * 7, 0.0); // center * area (3), area, normal (3)
+	for (size_t k = 0; k < clusters.size(); k++) {
+		size_t begin = clusters[k], end = k + 1 < clusters.size() ? clusters[k + 1] : triangle_count;
+		double* data = &cluster_data[k * 7];
+		for (size_t t = begin; t < end; t++) {
+			const float* p0 = corner(t, 0);
+			const float* p1 = corner(t, 1);
+			const float* p2 = corner(t, 2);
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] }, e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * 0.5;
+			for (int c = 0; c < 3; c++) {
+				data[c] += area * (p0[c] + p1[c] + p2[c]) / 3.0;
+				data[4 + c] += n[c];
+			}
+			data[3] += area;
+		}
+		for (int c = 0; c < 3; c++)
+			mesh_center[c] += data[c];
+		mesh_area += data[3];
+	}
+	for (int c = 0; c < 3; c++)
+		mesh_center[c] = mesh_area > 0.0 ? mesh_center[c] / mesh_area : 0.0;
+
+	// how far the cluster lies out along its own normal, the outermost ones occlude the most
+	for (size_t k = 0; k < clusters.size(); k++) {
+		const double* data = &cluster_data[k * 7];
+		double length = std::sqrt(data[4] * data[4] + data[5] * data[5] + data[6] * data[6]);
+		double key = 0.0;
+		if (data[3] > 0.0 && length > 0.0)
+			for (int c = 0; c < 3; c++)
+				key += (data[c] / data[3] - mesh_center[c]) * data[4 + c] / length;
+		sort_keys[k] = (float)key;
+	}
+	std::vector<uint32_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t k : order) {
+		size_t begin = clusters[k], end = k + 1 < clusters.size() ? clusters[k + 1] : triangle_count;
+		result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+	}
+	return result;
+}
+
+// renumber vertices in first use order and drop the ones no triangle uses
+inline void optimizeVertexFetch(MeshData& mesh) {
+	std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = (uint32_t)vertices.size();
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.vertices.swap(vertices);
+}
+
+// every pass in order, 'mesh' draws the same triangles afterwards. bounds are recomputed as unused vertices are dropped
+inline MeshOptimizeStats optimizeMesh(MeshData& mesh, float overdraw_threshold = 1.05f) {
+	MeshOptimizeStats stats;
+	stats.before = analyzeVertexCache(mesh.indices, mesh.vertices.size(), sizeof(MeshVertex));
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uint32_t> clusters;
+	mesh.indices = optimizeVertexCache(mesh.indices, mesh.vertices.size(), clusters);
+	stats.cache_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	mesh.indices = optimizeOverdraw(mesh.indices, mesh.vertices, clusters, stats.clusters, overdraw_threshold);
+	stats.overdraw_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	optimizeVertexFetch(mesh);
+	computeBounds(mesh);
+	stats.fetch_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	stats.after = analyzeVertexCache(mesh.indices, mesh.vertices.size(), sizeof(MeshVertex));
+	return stats;
+}
+
+inline void printMeshOptimizeStats(const MeshOptimizeStats& stats) {
+	std::cout << "\nMesh optimizer stats:" << std::endl
+		<< "\tACMR           : " << stats.before.acmr << " -> " << stats.after.acmr << std::endl
+		<< "\tATVR           : " << stats.before.atvr << " -> " << stats.after.atvr << std::endl
+		<< "\tOverfetch      : " << stats.before.overfetch << " -> " << stats.after.overfetch << std::endl
+		<< "\tClusters       : " << stats.clusters << std::endl
+		<< "\tPasses ms      : " << stats.cache_ms << " cache, " << stats.overdraw_ms << " overdraw, " << stats.fetch_ms << " fetch" << std::endl;
+}
@@ -0,0 +1,170 @@
+#pragma once
+// mesh pool defined here
+// programmable vertex pulling: every mesh added to the pool lives in one vertex shader storage buffer and one index
+// buffer, and glsl/mesh_pulled_vertex.glsl fetches its own vertex by gl_VertexID instead of having attributes fed to
+// it. with no attributes there is nothing to format, every draw of every mesh goes through the same VAO, which holds
+// nothing but the pool's index buffer, and a whole frame can be one glMultiDrawElementsIndirect() call
+//
+// the draws stay indexed so the post transform vertex cache still works: the command's 'first_index' and 'count' pick
+// the mesh's span of the index buffer, its 'base_vertex' is added to gl_VertexID. indices are stored 32 bit relative
+// to their mesh. instance transforms come from a second storage buffer, read at gl_BaseInstance + gl_InstanceID
+//
+// storage buffer bindings, matching the shader:
+//   0  vertices    MeshVertex[], read as two vec4
+//   1  transforms  mat4[]
+
+#include <glad/glad.h>
+
+#include <mesh_data.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+const GLuint PULLED_VERTEX_BINDING = 0;
+const GLuint PULLED_TRANSFORM_BINDING = 1;
+
+// the layout glMultiDrawElementsIndirect() reads
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+// where a mesh sits in the pool's buffers
+struct PooledMesh {
+	uint32_t first_index;
+	uint32_t index_count;
+	uint32_t base_vertex;
+	uint32_t vertex_count;
+};
+
+class MeshPool {
+public:
+	unsigned int VAO;            // no attributes, only the index buffer
+	unsigned int vertex_buffer = 0, index_buffer = 0, transform_buffer = 0, command_buffer = 0;
+	std::vector<PooledMesh> meshes;
+
+	MeshPool() {
+		glCreateVertexArrays(1, &VAO);
+	}
+
+	~MeshPool() {
+		glDeleteVertexArrays(1, &VAO);
+		unsigned int buffers[4] = { vertex_buffer, index_buffer, transform_buffer, command_buffer };
+		glDeleteBuffers(4, buffers); // zeros are ignored
+	}
+
+	MeshPool(const MeshPool&) = delete;
+	MeshPool& operator=(const MeshPool&) = delete;
+
+	// stage 'mesh' for upload() and return its index into 'meshes'
+	uint32_t add(const MeshData& mesh) {
+		PooledMesh pooled;
+		pooled.first_index = (uint32_t)staged_indices.size();
+		pooled.index_count = (uint32_t)mesh.indices.size();
+		pooled.base_vertex = (uint32_t)staged_vertices.size();
+		pooled.vertex_count = (uint32_t)mesh.vertices.size();
+		staged_vertices.insert(staged_vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		staged_indices.insert(staged_indices.end(), mesh.indices.begin(), mesh.indices.end());
+		meshes.push_back(pooled);
+		return (uint32_t)meshes.size() - 1;
+	}
+
+	// move everything staged into immutable storage buffers. once only, meshes cannot be added afterwards
+	bool upload() {
+		if (vertex_buffer != 0 || staged_vertices.empty() || staged_indices.empty()) {
+			std::cout << "ERROR::MESH_POOL::NOTHING_TO_UPLOAD" << std::endl;
+			return false;
+		}
+		glCreateBuffers(1, &vertex_buffer);
+		glCreateBuffers(1, &index_buffer);
+		glNamedBufferStorage(vertex_buffer, staged_vertices.size() * sizeof(MeshVertex), staged_vertices.data(), 0);
+		glNamedBufferStorage(index_buffer, staged_indices.size() * sizeof(uint32_t), staged_indices.data(), 0);
+		glVertexArrayElementBuffer(VAO, index_buffer);
+		vertex_bytes = staged_vertices.size() * sizeof(MeshVertex);
+		index_bytes = staged_indices.size() * sizeof(uint32_t);
+		staged_vertices = std::vector<MeshVertex>();
+		staged_indices = std::vector<uint32_t>();
+		return true;
+	}
+
+	// the transforms instances read, replacing the last ones
+	void setTransforms(const glm::mat4* transforms, size_t count) {
+		reserve(transform_buffer, transform_capacity, count * sizeof(glm::mat4));
+		glNamedBufferSubData(transform_buffer, 0, count * sizeof(glm::mat4), transforms);
+	}
+
+	// 'instance_count' instances of 'mesh' reading transforms from 'first_instance' on
+	DrawElementsIndirectCommand command(uint32_t mesh, uint32_t first_instance, uint32_t instance_count = 1) const {
+		const PooledMesh& pooled = meshes[mesh];
+		return { pooled.index_count, instance_count, pooled.first_index, (GLint)pooled.base_vertex, first_instance };
+	}
+
+	// read transforms from 'bytes' of 'buffer' at 'offset' instead, a GpuFrameArena (frame_arena.h) range say. setTransforms()
+	// and bind() go back to the pool's own
+	void bindTransforms(unsigned int buffer, GLintptr offset, size_t bytes) const {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, PULLED_TRANSFORM_BINDING, buffer, offset, (GLsizeiptr)bytes);
+	}
+
+	// the VAO and the storage buffers, for as long as nothing else rebinds them
+	void bind() const {
+		glBindVertexArray(VAO);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PULLED_VERTEX_BINDING, vertex_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PULLED_TRANSFORM_BINDING, transform_buffer);
+	}
+
+	// one draw, after bind()
+	void draw(const DrawElementsIndirectCommand& command) const {
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_INT,
+			(const void*)(command.first_index * sizeof(uint32_t)), (GLsizei)command.instance_count, command.base_vertex,
+			command.base_instance);
+	}
+
+	// every command in one call, after bind()
+	void drawMulti(const DrawElementsIndirectCommand* commands, size_t count) {
+		if (count == 0)
+			return;
+		size_t bytes = count * sizeof(DrawElementsIndirectCommand);
+		reserve(command_buffer, command_capacity, bytes);
+		glNamedBufferSubData(command_buffer, 0, bytes, commands);
+		drawIndirect(command_buffer, 0, count);
+	}
+
+	void drawMulti(const std::vector<DrawElementsIndirectCommand>& commands) {
+		drawMulti(commands.data(), commands.size());
+	}
+
+	// 'count' commands already in 'buffer' at 'offset', after bind()
+	void drawIndirect(unsigned int buffer, GLintptr offset, size_t count) const {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)offset, (GLsizei)count, 0);
+	}
+
+	size_t bytes() const {
+		return vertex_bytes + index_bytes;
+	}
+
+private:
+	std::vector<MeshVertex> staged_vertices;
+	std::vector<uint32_t> staged_indices;
+	size_t vertex_bytes = 0, index_bytes = 0;
+	size_t transform_capacity = 0, command_capacity = 0;
+
+	// immutable storage cannot grow, a bigger buffer replaces it. a new transform buffer is bound again straight away
+	void reserve(unsigned int& buffer, size_t& capacity, size_t bytes) {
+		if (bytes <= capacity)
+			return;
+		capacity = std::max(bytes, capacity * 2);
+		glDeleteBuffers(1, &buffer);
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		if (&buffer == &transform_buffer)
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PULLED_TRANSFORM_BINDING, transform_buffer);
+	}
+};
@@ -0,0 +1,270 @@
+#pragma once
+// obj loader functions defined here
+// wavefront obj, the subset meshes use: v, vt, vn and f with any number of corners (split into a fan) and negative
+// indices counting back from the latest entry. materials, groups, lines and points are skipped
+//
+// the file is split at line breaks into chunks that are parsed in parallel on the job system, each chunk collecting its
+// own positions, uvs, normals and face corners. prefix sums over the chunk counts then resolve every corner to global
+// indices, and the corners are folded into unique vertices by VertexDeduplicator
+
+#include <job_system.h>
+#include <mesh_data.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+const size_t OBJ_CHUNK_SIZE = 1 << 20; // bytes per parse job
+
+struct ObjChunk {
+	const char* begin;
+	const char* end;
+	std::vector<float> attributes[3];   // positions (3 floats each), uvs (2), normals (3)
+	std::vector<int32_t> corners;       // position, uv and normal index of every triangle corner, 0 based, -1 when absent
+	std::vector<uint32_t> relative;     // entries of 'corners' counting from the chunk's first attribute, negative in the file
+	size_t first[3] = { 0, 0, 0 };      // global index of the chunk's first position, uv and normal
+};
+
+const int OBJ_ATTRIBUTE_FLOATS[3] = { 3, 2, 3 };
+
+inline bool isObjSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// decimal float without locale or allocation. up to 19 significant digits are kept and scaled by an exact power of ten,
+// which rounds the same as strtof for everything an exporter writes
+inline const char* parseObjFloat(const char* p, const char* end, float& value) {
+	static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+'))
+		p++;
+	uint64_t mantissa = 0;
+	int exponent = 0, digits = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else
+			exponent++;
+	}
+	if (p < end && *p == '.')
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negative_exponent = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+'))
+			p++;
+		int written = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+			written = std::min(written * 10 + (*p - '0'), 1000);
+		exponent += negative_exponent ? -written : written;
+	}
+	double result = (double)mantissa;
+	if (exponent != 0 && mantissa != 0) {
+		if (exponent < -22 || exponent > 22)
+			result *= std::pow(10.0, exponent);
+		else
+			result = exponent < 0 ? result / POWERS[-exponent] : result * POWERS[exponent];
+	}
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+inline const char* parseObjInt(const char* p, const char* end, int64_t& value, bool& found) {
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+'))
+		p++;
+	value = 0;
+	found = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+		found = true;
+	}
+	if (negative)
+		value = -value;
+	return p;
+}
+
+// parse the lines in [chunk.begin, chunk.end), both at line starts
+inline void parseObjChunk(ObjChunk& chunk) {
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+	std::vector<int32_t> face;
+	std::vector<bool> face_counts_back;
+	while (p < end) {
+		while (p < end && isObjSpace(*p))
+			p++;
+		const char* line = p;
+		while (p < end && *p != '\n')
+			p++;
+		const char* line_end = p++;
+		if (line_end - line < 2)
+			continue;
+
+		int kind = -1;
+		const char* q = line + 2;
+		if (line[0] == 'v' && isObjSpace(line[1]))
+			kind = 0;
+		else if (line[0] == 'v' && line[1] == 't' && line_end - line > 2 && isObjSpace(line[2])) {
+			kind = 1;
+			q++;
+		}
+		else if (line[0] == 'v' && line[1] == 'n' && line_end - line > 2 && isObjSpace(line[2])) {
+			kind = 2;
+			q++;
+		}
+
+		if (kind >= 0) {
+			// extra values (w, vertex colors) are ignored, missing ones are 0
+			for (int i = 0; i < OBJ_ATTRIBUTE_FLOATS[kind]; i++) {
+				while (q < line_end && isObjSpace(*q))
+					q++;
+				float value = 0.0f;
+				q = parseObjFloat(q, line_end, value);
+				chunk.attributes[kind].push_back(value);
+			}
+		}
+		else if (line[0] == 'f' && isObjSpace(line[1])) {
+			// every corner is position[/uv][/normal], stored as three indices
+			face.clear();
+			face_counts_back.clear();
+			while (q < line_end) {
+				while (q < line_end && isObjSpace(*q))
+					q++;
+				if (q >= line_end)
+					break;
+				int32_t reference[3] = { -1, -1, -1 };
+				bool counts_back[3] = { false, false, false };
+				for (int part = 0; part < 3; part++) {
+					int64_t value;
+					bool found;
+					q = parseObjInt(q, line_end, value, found);
+					if (found && value > 0)
+						reference[part] = (int32_t)(value - 1);
+					else if (found && value < 0) {
+						reference[part] = (int32_t)((int64_t)(chunk.attributes[part].size() / OBJ_ATTRIBUTE_FLOATS[part]) + value);
+						counts_back[part] = true;
+					}
+					if (q >= line_end || *q != '/')
+						break;
+					q++;
+				}
+				while (q < line_end && !isObjSpace(*q))
+					q++; // anything unexpected in the corner
+
+				// fan out from the first corner: (0, n - 1, n) for every corner after the second
+				size_t corner = face.size() / 3;
+				face.insert(face.end(), reference, reference + 3);
+				face_counts_back.insert(face_counts_back.end(), counts_back, counts_back + 3);
+				if (corner >= 2)
+					for (size_t c : { (size_t)0, corner - 1, corner })
+						for (int part = 0; part < 3; part++) {
+							if (face_counts_back[c * 3 + part])
+								chunk.relative.push_back((uint32_t)chunk.corners.size());
+							chunk.corners.push_back(face[c * 3 + part]);
+						}
+			}
+		}
+	}
+}
+
+// parse an obj already in memory into 'mesh', false when a face refers to something the file does not have
+inline bool parseObj(JobSystem& jobs, const char* data, size_t size, MeshData& mesh) {
+	// chunk boundaries just after a line break, so no line is split between two jobs
+	std::vector<ObjChunk> chunks;
+	const char* end = data + size;
+	for (const char* begin = data; begin < end;) {
+		const char* split = begin + std::min(OBJ_CHUNK_SIZE, (size_t)(end - begin));
+		while (split < end && split[-1] != '\n')
+			split++;
+		chunks.emplace_back();
+		chunks.back().begin = begin;
+		chunks.back().end = split;
+		begin = split;
+	}
+	jobs.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			parseObjChunk(chunks[i]);
+	});
+
+	// every chunk's attributes into one array per kind, then corners to global indices
+	std::vector<float> attributes[3];
+	size_t counts[3] = { 0, 0, 0 }, corner_count = 0;
+	for (ObjChunk& chunk : chunks) {
+		for (int kind = 0; kind < 3; kind++) {
+			chunk.first[kind] = counts[kind];
+			counts[kind] += chunk.attributes[kind].size() / OBJ_ATTRIBUTE_FLOATS[kind];
+		}
+		corner_count += chunk.corners.size() / 3;
+	}
+	for (int kind = 0; kind < 3; kind++) {
+		attributes[kind].reserve(counts[kind] * OBJ_ATTRIBUTE_FLOATS[kind]);
+		for (ObjChunk& chunk : chunks) {
+			attributes[kind].insert(attributes[kind].end(), chunk.attributes[kind].begin(), chunk.attributes[kind].end());
+			std::vector<float>().swap(chunk.attributes[kind]);
+		}
+	}
+
+	// the same corner in every face becomes one vertex
+	mesh = MeshData();
+	mesh.indices.reserve(corner_count);
+	VertexDeduplicator unique(mesh.vertices, corner_count);
+	bool all_normals = true, all_uvs = true;
+	for (ObjChunk& chunk : chunks) {
+		for (uint32_t entry : chunk.relative) {
+			chunk.corners[entry] += (int32_t)chunk.first[entry % 3];
+			// one reaching before the first attribute is out of range, it must not land on -1 and read as absent
+			if (chunk.corners[entry] < 0)
+				chunk.corners[entry] = -2;
+		}
+		for (size_t i = 0; i < chunk.corners.size(); i += 3) {
+			MeshVertex vertex = {};
+			const int32_t* corner = &chunk.corners[i];
+			if (corner[0] < 0 || (size_t)corner[0] >= counts[0] || corner[1] < -1 || corner[1] >= (int64_t)counts[1]
+				|| corner[2] < -1 || corner[2] >= (int64_t)counts[2]) {
+				std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE: face corner " << corner[0] + 1 << "/" << corner[1] + 1 << "/" << corner[2] + 1 << std::endl;
+				mesh = MeshData();
+				return false;
+			}
+			std::memcpy(vertex.position, &attributes[0][corner[0] * 3], sizeof(vertex.position));
+			if (corner[1] >= 0)
+				std::memcpy(vertex.uv, &attributes[1][corner[1] * 2], sizeof(vertex.uv));
+			if (corner[2] >= 0)
+				std::memcpy(vertex.normal, &attributes[2][corner[2] * 3], sizeof(vertex.normal));
+			all_uvs &= corner[1] >= 0;
+			all_normals &= corner[2] >= 0;
+			mesh.indices.push_back(unique.add(vertex));
+		}
+		std::vector<int32_t>().swap(chunk.corners);
+	}
+
+	mesh.has_uvs = all_uvs && !mesh.indices.empty();
+	mesh.has_normals = all_normals && !mesh.indices.empty();
+	if (!mesh.has_normals)
+		computeNormals(mesh);
+	computeBounds(mesh);
+	return true;
+}
+
+inline bool loadObj(JobSystem& jobs, const std::string& path, MeshData& mesh) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::OBJ::FILE_NOT_FOUND: " << path << std::endl;
+		return false;
+	}
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return parseObj(jobs, data.data(), data.size(), mesh);
+}
@@ -4,6 +4,9 @@
 
 #include <glad/glad.h>
 
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -76,23 +79,71 @@ public:
 		glDeleteShader(fragment);
 	}
 
+	// constructor to build a compute shader program
+	explicit Shader(const char* compute_path) {
+
+		std::string compute_code;
+		std::ifstream c_shader_file;
+		c_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+		try {
+			c_shader_file.open(compute_path);
+			std::stringstream c_shader_stream;
+			c_shader_stream << c_shader_file.rdbuf();
+			c_shader_file.close();
+			compute_code = c_shader_stream.str();
+
+			std::cout << "\n** compute shader source code **" << std::endl;
+			std::cout << compute_code << std::endl;
+		}
+		catch (std::ifstream::failure& e) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+		}
+
+		const char* c_shader_code = compute_code.c_str();
+
+		unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(compute, 1, &c_shader_code, NULL);
+		glCompileShader(compute);
+		checkCompileErrors(compute, "COMPUTE");
+
+		program = glCreateProgram();
+		glAttachShader(program, compute);
+		glLinkProgram(program);
+		checkCompileErrors(program, "PROGRAM");
+
+		glDeleteShader(compute);
+	}
+
 	// activate shader
 	void use() {
 		glUseProgram(program);
 	}
 
 	// utility uniform functions, to change values within shader program
-	void setBool(const std::string& name, bool value) const
+	void setBool(const char* name, bool value) const
+	{
+		glUniform1i(glGetUniformLocation(program, name), (int)value);
+	}
+	void setInt(const char* name, int value) const
+	{
+		glUniform1i(glGetUniformLocation(program, name), value);
+	}
+	void setFloat(const char* name, float value) const
+	{
+		glUniform1f(glGetUniformLocation(program, name), value);
+	}
+	void setVec3(const char* name, const glm::vec3& value) const
 	{
-		glUniform1i(glGetUniformLocation(program, name.c_str()), (int)value);
+		glUniform3fv(glGetUniformLocation(program, name), 1, glm::value_ptr(value));
 	}
-	void setInt(const std::string& name, int value) const
+	void setVec4(const char* name, const glm::vec4& value) const
 	{
-		glUniform1i(glGetUniformLocation(program, name.c_str()), value);
+		glUniform4fv(glGetUniformLocation(program, name), 1, glm::value_ptr(value));
 	}
-	void setFloat(const std::string& name, float value) const
+	void setMat4(const char* name, const glm::mat4& value) const
 	{
-		glUniform1f(glGetUniformLocation(program, name.c_str()), value);
+		glUniformMatrix4fv(glGetUniformLocation(program, name), 1, GL_FALSE, glm::value_ptr(value));
 	}
 
 private:
@@ -0,0 +1,386 @@
+#pragma once
+// two level segregated fit allocator defined here
+// hands out aligned ranges of an address space it never touches, so the memory can live somewhere the CPU cannot see,
+// like a GL buffer (gpu_heap.h). every block header is kept on the CPU side in 'blocks'
+//
+// free blocks sit in one list per size class. the first level splits sizes by power of two, the second splits each
+// power of two into SECOND_LEVEL_COUNT linear steps, and two bitmaps say which lists are non empty, so finding a fitting
+// block is a couple of bit scans whatever the number of blocks: allocate() and free() are O(1). neighbouring free blocks
+// are merged when freed
+//
+// allocation ids stay the same while the block behind them moves, which is what compaction does: nextMove() picks the
+// allocation above the lowest hole, moveTo() re-points the id, the caller copies the bytes
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// index of the lowest and highest set bit, 'value' must not be 0
+inline int lowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (int)index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+inline int highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+struct TlsfStats {
+	uint64_t capacity = 0;
+	uint64_t used = 0;           // including alignment padding kept inside allocations
+	uint64_t largest_free = 0;
+	uint32_t allocations = 0;
+	uint32_t free_blocks = 0;
+
+	uint64_t free() const {
+		return capacity - used;
+	}
+
+	// 0 when all free space is one block, towards 1 as it breaks into pieces
+	double fragmentation() const {
+		return free() > 0 ? 1.0 - (double)largest_free / (double)free() : 0.0;
+	}
+};
+
+// one step of compaction, copy 'size' bytes from 'from' down to 'to'
+struct TlsfMove {
+	uint32_t allocation;
+	uint64_t from;
+	uint64_t to;
+	uint64_t size;
+
+	// the ranges overlap when the hole was smaller than the allocation, the copy has to go through a scratch range then
+	bool overlaps() const {
+		return to + size > from;
+	}
+};
+
+class TlsfAllocator {
+public:
+	static constexpr uint32_t NONE = UINT32_MAX;
+	static const int SECOND_LEVEL_LOG2 = 4;
+	static const int SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_LOG2;
+	static const int FIRST_LEVEL_COUNT = 64;
+
+	// 'granularity' is the smallest block and what every size rounds up to, a power of two of at least 16
+	explicit TlsfAllocator(uint64_t capacity, uint64_t granularity = 16) : granularity(std::max<uint64_t>(granularity, 16)) {
+		std::fill(&heads[0][0], &heads[0][0] + FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT, NONE);
+		std::fill(second_level, second_level + FIRST_LEVEL_COUNT, 0u);
+		this->capacity = capacity / this->granularity * this->granularity;
+		if (this->capacity > 0) {
+			uint32_t block = newBlock(0, this->capacity);
+			insertFree(block);
+		}
+	}
+
+	// the smallest capacity an empty allocator needs to hand out one allocation of 'size' bytes at 'alignment'.
+	// allocate() looks for a block of the size class above the request, so the request alone is not always enough
+	static uint64_t capacityFor(uint64_t size, uint64_t alignment = 16, uint64_t granularity = 16) {
+		granularity = std::max<uint64_t>(granularity, 16);
+		uint64_t search = roundUp(std::max<uint64_t>(size, 1), granularity) + std::max(alignment, granularity) - granularity;
+		int fl = highestBit(search);
+		return fl > SECOND_LEVEL_LOG2 ? roundUp(search, 1ull << (fl - SECOND_LEVEL_LOG2)) : roundUp(search, granularity);
+	}
+
+	// an allocation id, NONE when no free block fits. 'alignment' is a power of two
+	uint32_t allocate(uint64_t size, uint64_t alignment = 16) {
+		size = roundUp(std::max<uint64_t>(size, 1), granularity);
+		alignment = std::max(alignment, granularity);
+		uint64_t search = size + alignment - granularity; // room to align whatever block comes back
+		if (search > capacity)
+			return NONE;
+		uint32_t block = findFree(search);
+		if (block == NONE)
+			return NONE;
+		removeFree(block);
+		block = carve(block, roundUp(blocks[block].offset, alignment), size);
+		compact_cursor = NONE;
+
+		uint32_t allocation;
+		if (!free_allocations.empty()) {
+			allocation = free_allocations.back();
+			free_allocations.pop_back();
+		}
+		else {
+			allocation = (uint32_t)allocations.size();
+			allocations.emplace_back();
+		}
+		allocations[allocation] = { block, alignment };
+		blocks[block].allocation = allocation;
+		used += blocks[block].size;
+		allocation_count++;
+		return allocation;
+	}
+
+	void free(uint32_t allocation) {
+		uint32_t block = allocations[allocation].block;
+		used -= blocks[block].size;
+		allocation_count--;
+		allocations[allocation].block = NONE;
+		free_allocations.push_back(allocation);
+		release(block);
+		compact_cursor = NONE;
+	}
+
+	uint64_t offset(uint32_t allocation) const {
+		return blocks[allocations[allocation].block].offset;
+	}
+
+	uint64_t size(uint32_t allocation) const {
+		return blocks[allocations[allocation].block].size;
+	}
+
+	TlsfStats stats() const {
+		TlsfStats s;
+		s.capacity = capacity;
+		s.used = used;
+		s.allocations = allocation_count;
+		s.free_blocks = free_count;
+		// the largest block sits in the highest non empty list, which only holds blocks of one size class
+		if (first_level != 0) {
+			int fl = highestBit(first_level);
+			int sl = highestBit(second_level[fl]);
+			for (uint32_t block = heads[fl][sl]; block != NONE; block = blocks[block].next_free)
+				s.largest_free = std::max(s.largest_free, blocks[block].size);
+		}
+		return s;
+	}
+
+	// the next compaction step: slide the allocation just above the lowest free block down into it, which merges the
+	// hole with whatever is free above. repeated, every allocation ends up packed at the bottom and all free space in one
+	// block at the top. false when nothing can move. walks the blocks from the bottom, O(n) unlike the rest, but a run of
+	// steps with no allocate() or free() in between carries on from the last one
+	bool nextMove(TlsfMove& move) const {
+		uint32_t start_block = compact_cursor != NONE ? compact_cursor : first_block;
+		for (uint32_t hole = start_block; hole != NONE; hole = blocks[hole].next_physical) {
+			uint32_t block = blocks[hole].next_physical;
+			if (!blocks[hole].free || block == NONE)
+				continue;
+			const Block& candidate = blocks[block];
+			uint64_t start = roundUp(blocks[hole].offset, allocations[candidate.allocation].alignment);
+			if (start < candidate.offset) {
+				move = { candidate.allocation, candidate.offset, start, candidate.size };
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// carry out what nextMove() returned, the allocation's range is 'move.to' from now on
+	void moveTo(const TlsfMove& move) {
+		uint32_t block = allocations[move.allocation].block;
+		uint32_t hole = blocks[block].prev_physical;
+		removeFree(hole);
+		blocks[hole].size += blocks[block].size;
+		unlink(block);
+		block = carve(hole, move.to, move.size);
+		blocks[block].allocation = move.allocation;
+		allocations[move.allocation].block = block;
+		compact_cursor = block; // everything below is packed
+	}
+
+private:
+	struct Block {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prev_physical, next_physical; // neighbours in address order
+		uint32_t prev_free, next_free;         // the size class list, free blocks only
+		uint32_t allocation;                   // owner, used blocks only
+		bool free;
+	};
+
+	struct Allocation {
+		uint32_t block;
+		uint64_t alignment;
+	};
+
+	uint64_t capacity;
+	uint64_t granularity;
+	uint64_t used = 0;
+	uint32_t allocation_count = 0, free_count = 0;
+	std::vector<Block> blocks;
+	std::vector<uint32_t> unused_blocks; // headers to reuse
+	std::vector<Allocation> allocations;
+	std::vector<uint32_t> free_allocations;
+	uint32_t first_block = NONE, last_block = NONE;
+	uint32_t compact_cursor = NONE; // where the last compaction step left off
+	uint64_t first_level = 0;
+	uint32_t second_level[FIRST_LEVEL_COUNT];
+	uint32_t heads[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+
+	static uint64_t roundUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// size class of a block of 'size' bytes, at least 16
+	static void mapping(uint64_t size, int& fl, int& sl) {
+		fl = highestBit(size);
+		sl = (int)(size >> (fl - SECOND_LEVEL_LOG2)) ^ SECOND_LEVEL_COUNT;
+	}
+
+	// a free block of at least 'size' bytes. the size rounds up to the next class first, so any block of the class
+	// found fits and the list head can be taken without looking further
+	uint32_t findFree(uint64_t size) const {
+		int fl = highestBit(size);
+		if (fl > SECOND_LEVEL_LOG2)
+			size += (1ull << (fl - SECOND_LEVEL_LOG2)) - 1;
+		int sl;
+		mapping(size, fl, sl);
+		if (fl >= FIRST_LEVEL_COUNT)
+			return NONE;
+		uint32_t second = second_level[fl] & (~0u << sl);
+		if (second == 0) {
+			uint64_t first = fl + 1 < FIRST_LEVEL_COUNT ? first_level & (~0ull << (fl + 1)) : 0;
+			if (first == 0)
+				return NONE;
+			fl = lowestBit(first);
+			second = second_level[fl];
+		}
+		return heads[fl][lowestBit(second)];
+	}
+
+	uint32_t newBlock(uint64_t offset, uint64_t size) {
+		uint32_t block;
+		if (!unused_blocks.empty()) {
+			block = unused_blocks.back();
+			unused_blocks.pop_back();
+		}
+		else {
+			block = (uint32_t)blocks.size();
+			blocks.emplace_back();
+		}
+		blocks[block] = { offset, size, NONE, NONE, NONE, NONE, NONE, false };
+		if (first_block == NONE)
+			first_block = last_block = block;
+		return block;
+	}
+
+	// put 'block' in front of 'next' or behind 'prev' in address order
+	void linkBefore(uint32_t block, uint32_t next) {
+		blocks[block].next_physical = next;
+		blocks[block].prev_physical = blocks[next].prev_physical;
+		if (blocks[next].prev_physical != NONE)
+			blocks[blocks[next].prev_physical].next_physical = block;
+		else
+			first_block = block;
+		blocks[next].prev_physical = block;
+	}
+
+	void linkAfter(uint32_t block, uint32_t prev) {
+		blocks[block].prev_physical = prev;
+		blocks[block].next_physical = blocks[prev].next_physical;
+		if (blocks[prev].next_physical != NONE)
+			blocks[blocks[prev].next_physical].prev_physical = block;
+		else
+			last_block = block;
+		blocks[prev].next_physical = block;
+	}
+
+	void unlink(uint32_t block) {
+		Block& b = blocks[block];
+		if (b.prev_physical != NONE)
+			blocks[b.prev_physical].next_physical = b.next_physical;
+		else
+			first_block = b.next_physical;
+		if (b.next_physical != NONE)
+			blocks[b.next_physical].prev_physical = b.prev_physical;
+		else
+			last_block = b.prev_physical;
+		unused_blocks.push_back(block);
+	}
+
+	void insertFree(uint32_t block) {
+		int fl, sl;
+		mapping(blocks[block].size, fl, sl);
+		Block& b = blocks[block];
+		b.free = true;
+		b.allocation = NONE;
+		b.prev_free = NONE;
+		b.next_free = heads[fl][sl];
+		if (b.next_free != NONE)
+			blocks[b.next_free].prev_free = block;
+		heads[fl][sl] = block;
+		first_level |= 1ull << fl;
+		second_level[fl] |= 1u << sl;
+		free_count++;
+	}
+
+	void removeFree(uint32_t block) {
+		int fl, sl;
+		mapping(blocks[block].size, fl, sl);
+		Block& b = blocks[block];
+		if (b.prev_free != NONE)
+			blocks[b.prev_free].next_free = b.next_free;
+		else
+			heads[fl][sl] = b.next_free;
+		if (b.next_free != NONE)
+			blocks[b.next_free].prev_free = b.prev_free;
+		if (heads[fl][sl] == NONE) {
+			second_level[fl] &= ~(1u << sl);
+			if (second_level[fl] == 0)
+				first_level &= ~(1ull << fl);
+		}
+		b.free = false;
+		free_count--;
+	}
+
+	// take 'size' bytes at 'start' out of the free block 'block', already off its list. what is left in front and
+	// behind goes back as free blocks, both are multiples of the granularity. the space behind merges with a free block
+	// after it, which compaction leaves there
+	uint32_t carve(uint32_t block, uint64_t start, uint64_t size) {
+		uint64_t end = blocks[block].offset + blocks[block].size;
+		if (start > blocks[block].offset) {
+			uint32_t front = newBlock(blocks[block].offset, start - blocks[block].offset);
+			linkBefore(front, block);
+			insertFree(front);
+			blocks[block].offset = start;
+			blocks[block].size = end - start;
+		}
+		if (end > start + size) {
+			uint32_t back = newBlock(start + size, end - start - size);
+			linkAfter(back, block);
+			uint32_t next = blocks[back].next_physical;
+			if (next != NONE && blocks[next].free) {
+				removeFree(next);
+				blocks[back].size += blocks[next].size;
+				unlink(next);
+			}
+			insertFree(back);
+			blocks[block].size = size;
+		}
+		blocks[block].free = false;
+		return block;
+	}
+
+	// a used block back to free, merged with free neighbours
+	void release(uint32_t block) {
+		uint32_t prev = blocks[block].prev_physical, next = blocks[block].next_physical;
+		if (next != NONE && blocks[next].free) {
+			removeFree(next);
+			blocks[block].size += blocks[next].size;
+			unlink(next);
+		}
+		if (prev != NONE && blocks[prev].free) {
+			removeFree(prev);
+			blocks[prev].size += blocks[block].size;
+			unlink(block);
+			block = prev;
+		}
+		insertFree(block);
+	}
+};
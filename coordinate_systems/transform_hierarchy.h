@@ -0,0 +1,322 @@
+#pragma once
+// transform hierarchy defined here
+// a scene graph of translation, rotation and scale nodes kept as flat arrays, one per field, in depth first order: a
+// node comes right before its children and its whole subtree is the contiguous range [node, subtreeEnd(node)). parents
+// therefore always come before their children, and a subtree can be recomputed by sweeping its range front to back
+//
+// setting a node's local transform only marks it dirty. update() sorts the dirty nodes, drops those inside another
+// dirty subtree, and recomputes the world matrices of the remaining subtrees and nothing else. those subtrees share no
+// nodes, so they run in parallel on a JobSystem. a subtree too large for one job has its root done first and its
+// children's subtrees handed out instead
+//
+// world matrices are kept on the CPU, children read their parent's, and can also be written into a WorldMatrixBuffer,
+// a persistently mapped GL buffer with one region per frame in flight. each region only receives what changed since the
+// last frame it was written, the update writes the current region as it goes and copies in the ranges the region
+// missed while the GPU was reading it
+
+#include <glad/glad.h>
+
+#include <batch_math.h>
+#include <frame_arena.h>
+#include <job_system.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+class WorldMatrixBuffer {
+public:
+	unsigned int buffer = 0;
+
+	// room for 'capacity' matrices in each of 'frames' regions
+	explicit WorldMatrixBuffer(size_t capacity, int frames = GpuFrameArena::DEFAULT_FRAMES)
+		: capacity(capacity), fences(std::max(frames, 1), nullptr), frame(std::max(frames, 1) - 1) {
+		GLint alignment = 256;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		size_t align = (size_t)std::max(alignment, 64);
+		region_bytes = (std::max(capacity, (size_t)1) * sizeof(glm::mat4) + align - 1) / align * align;
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, (GLsizeiptr)(region_bytes * fences.size()), nullptr, flags);
+		mapped = (char*)glMapNamedBufferRange(buffer, 0, (GLsizeiptr)(region_bytes * fences.size()), flags);
+		if (mapped == nullptr)
+			std::cout << "ERROR::WORLD_MATRIX_BUFFER::MAP_FAILED" << std::endl;
+	}
+
+	~WorldMatrixBuffer() {
+		for (GLsync fence : fences)
+			glDeleteSync(fence);
+		glDeleteBuffers(1, &buffer);
+	}
+
+	WorldMatrixBuffer(const WorldMatrixBuffer&) = delete;
+	WorldMatrixBuffer& operator=(const WorldMatrixBuffer&) = delete;
+
+	// move on to the next region, once the GPU has finished reading it
+	void beginFrame() {
+		frame = (frame + 1) % fences.size();
+		GLsync& fence = fences[frame];
+		if (fence == nullptr)
+			return;
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// after the frame's last draw reading the region
+	void endFrame() {
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// the current region, null when the buffer could not be mapped
+	glm::mat4* matrices() const {
+		return mapped != nullptr ? (glm::mat4*)(mapped + frame * region_bytes) : nullptr;
+	}
+
+	// where the current region starts, for glBindBufferRange()
+	GLintptr offset() const {
+		return (GLintptr)(frame * region_bytes);
+	}
+
+	size_t size() const {
+		return capacity;
+	}
+
+	size_t regions() const {
+		return fences.size();
+	}
+
+	size_t region() const {
+		return frame;
+	}
+
+private:
+	size_t capacity;
+	size_t region_bytes = 0;
+	std::vector<GLsync> fences;
+	size_t frame;
+	char* mapped = nullptr;
+};
+
+class TransformHierarchy {
+public:
+	static const uint32_t NONE = 0xFFFFFFFFu;
+	// a subtree with more nodes than this is split between jobs
+	static const uint32_t JOB_NODES = 4096;
+
+	// a node under 'parent' (NONE for a root), its index or NONE. nodes are added depth first: 'parent' has to be the
+	// last node added or one of its ancestors, so that every subtree stays contiguous
+	uint32_t add(uint32_t parent, const PackedVec3& position = PackedVec3(0.0f),
+		const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const PackedVec3& scale = PackedVec3(1.0f)) {
+		uint32_t index = (uint32_t)parents.size();
+		if (parent != NONE && (parent >= index || subtree_ends[parent] != index)) {
+			std::cout << "ERROR::TRANSFORM_HIERARCHY::NOT_DEPTH_FIRST: the subtree of node " << parent << " is already closed" << std::endl;
+			return NONE;
+		}
+		parents.push_back(parent);
+		subtree_ends.push_back(index + 1);
+		for (uint32_t ancestor = parent; ancestor != NONE; ancestor = parents[ancestor])
+			subtree_ends[ancestor] = index + 1;
+		positions.push_back(position);
+		rotations.push_back(rotation);
+		scales.push_back(scale);
+		worlds.emplace_back(1.0f);
+		dirty.push_back(0);
+		markDirty(index);
+		return index;
+	}
+
+	void setPosition(uint32_t node, const PackedVec3& position) {
+		positions[node] = position;
+		markDirty(node);
+	}
+
+	void setRotation(uint32_t node, const glm::quat& rotation) {
+		rotations[node] = rotation;
+		markDirty(node);
+	}
+
+	void setScale(uint32_t node, const PackedVec3& scale) {
+		scales[node] = scale;
+		markDirty(node);
+	}
+
+	void setLocal(uint32_t node, const PackedVec3& position, const glm::quat& rotation, const PackedVec3& scale) {
+		positions[node] = position;
+		rotations[node] = rotation;
+		scales[node] = scale;
+		markDirty(node);
+	}
+
+	// recompute the world matrix of every dirty node and everything under it, on 'jobs' when given, and write them to
+	// the current region of 'gpu' when given. returns how many nodes were recomputed
+	size_t update(JobSystem* jobs = nullptr, WorldMatrixBuffer* gpu = nullptr) {
+		ranges.clear();
+		std::sort(dirty_nodes.begin(), dirty_nodes.end());
+		uint32_t covered = 0;
+		for (uint32_t node : dirty_nodes) {
+			dirty[node] = 0;
+			if (node >= covered) {
+				ranges.push_back({ node, subtree_ends[node] });
+				covered = subtree_ends[node];
+			}
+		}
+		dirty_nodes.clear();
+
+		glm::mat4* out = nullptr;
+		if (gpu != nullptr && gpu->size() < parents.size())
+			std::cout << "ERROR::TRANSFORM_HIERARCHY::GPU_BUFFER_TOO_SMALL: " << parents.size() << " nodes" << std::endl;
+		else if (gpu != nullptr)
+			out = gpu->matrices();
+
+		// subtrees small enough for one job, under roots done up front
+		spine.clear();
+		tasks.clear();
+		size_t recomputed = 0;
+		for (const Range& range : ranges) {
+			recomputed += range.end - range.begin;
+			stack.push_back(range.begin);
+			while (!stack.empty()) {
+				uint32_t node = stack.back();
+				stack.pop_back();
+				if (jobs == nullptr || subtree_ends[node] - node <= JOB_NODES) {
+					tasks.push_back(node);
+					continue;
+				}
+				spine.push_back(node);
+				size_t first_child = stack.size();
+				for (uint32_t child = node + 1; child < subtree_ends[node]; child = subtree_ends[child])
+					stack.push_back(child);
+				std::reverse(stack.begin() + first_child, stack.end());
+			}
+		}
+		for (uint32_t node : spine)
+			computeWorld(node, out);
+		auto sweep = [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++)
+				for (uint32_t node = tasks[t]; node < subtree_ends[tasks[t]]; node++)
+					computeWorld(node, out);
+		};
+		if (jobs != nullptr && tasks.size() > 1)
+			jobs->parallelFor(tasks.size(), std::max((size_t)1, tasks.size() * JOB_NODES / std::max(recomputed, (size_t)1)), sweep);
+		else
+			sweep(0, tasks.size());
+
+		if (out != nullptr)
+			catchUp(*gpu, out);
+		else
+			queueForRegions(backlogs.size());
+		return recomputed;
+	}
+
+	size_t size() const {
+		return parents.size();
+	}
+
+	uint32_t parent(uint32_t node) const {
+		return parents[node];
+	}
+
+	// one past the last node under 'node'
+	uint32_t subtreeEnd(uint32_t node) const {
+		return subtree_ends[node];
+	}
+
+	// as of the last update()
+	const glm::mat4& world(uint32_t node) const {
+		return worlds[node];
+	}
+
+	const glm::mat4* worldMatrices() const {
+		return worlds.data();
+	}
+
+	// the local matrix, translate * rotate * scale
+	glm::mat4 local(uint32_t node) const {
+		glm::mat4 matrix = glm::mat4_cast(rotations[node]);
+		matrix[0] *= scales[node].x;
+		matrix[1] *= scales[node].y;
+		matrix[2] *= scales[node].z;
+		matrix[3] = glm::vec4(positions[node], 1.0f);
+		return matrix;
+	}
+
+private:
+	struct Range {
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> subtree_ends;
+	std::vector<PackedVec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<PackedVec3> scales;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+	std::vector<uint32_t> dirty_nodes; // each dirty node once, in the order they were set
+
+	// update() scratch, kept so a warm update allocates nothing
+	std::vector<Range> ranges;
+	std::vector<uint32_t> spine, tasks, stack;
+
+	// per region of the buffer last written, the ranges recomputed since that region was
+	const WorldMatrixBuffer* backlog_buffer = nullptr;
+	std::vector<std::vector<Range>> backlogs;
+
+	void markDirty(uint32_t node) {
+		if (dirty[node])
+			return;
+		dirty[node] = 1;
+		dirty_nodes.push_back(node);
+	}
+
+	void computeWorld(uint32_t node, glm::mat4* out) {
+		uint32_t parent = parents[node];
+		worlds[node] = parent == NONE ? local(node) : worlds[parent] * local(node);
+		if (out != nullptr)
+			std::memcpy(&out[node], &worlds[node], sizeof(glm::mat4));
+	}
+
+	// bring the current region up to date with what the other regions were given while it was in use, or every update
+	// made without the buffer, and queue what this update wrote for the others
+	void catchUp(const WorldMatrixBuffer& gpu, glm::mat4* out) {
+		if (backlog_buffer != &gpu || backlogs.size() != gpu.regions()) {
+			backlog_buffer = &gpu;
+			backlogs.assign(gpu.regions(), std::vector<Range>(1, Range{ 0, (uint32_t)parents.size() }));
+		}
+		std::vector<Range>& current = backlogs[gpu.region()];
+		for (const Range& range : current)
+			std::memcpy(&out[range.begin], &worlds[range.begin], (range.end - range.begin) * sizeof(glm::mat4));
+		current.clear();
+		queueForRegions(gpu.region());
+	}
+
+	// this update's ranges onto the backlog of every region but 'skip'. a region that missed more than half the nodes
+	// is rewritten whole
+	void queueForRegions(size_t skip) {
+		size_t recomputed = 0;
+		for (const Range& range : ranges)
+			recomputed += range.end - range.begin;
+		for (size_t r = 0; r < backlogs.size(); r++) {
+			if (r == skip)
+				continue;
+			std::vector<Range>& backlog = backlogs[r];
+			size_t nodes = recomputed;
+			for (const Range& range : backlog)
+				nodes += range.end - range.begin;
+			if (nodes > parents.size() / 2)
+				backlog.assign(1, Range{ 0, (uint32_t)parents.size() });
+			else
+				backlog.insert(backlog.end(), ranges.begin(), ranges.end());
+		}
+	}
+};
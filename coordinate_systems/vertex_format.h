@@ -0,0 +1,243 @@
+#pragma once
+// vertex formats and quantization defined here
+// MeshVertex spends 32 bytes on a vertex, PackedVertex stores the same attributes in 16:
+//   position  half floats around the mesh center, or 16 bit normalized integers over the mesh bounds. either way the
+//             shader reads a vec3 and undoes it with the 'dequantize' uniform (PackedMeshData::dequantize)
+//   normal    octahedral encoding (the unit sphere folded onto a square), two 16 bit normalized integers
+//   uv        16 bit unsigned normalized over the mesh's uv range, undone by the 'uv_transform' uniform
+// colors, where a vertex has them, fit RGBA8 unorm (packUnorm8x4)
+//
+// the vertex layouts (vertex_layout.h) describe both, either interleaved in one buffer or as split streams, positions
+// in one buffer and everything else in a second, so position only passes fetch less
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <mesh_data.h>
+#include <vertex_layout.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+enum class PositionEncoding {
+	Half,
+	Snorm16,
+};
+
+// 16 bytes, position first so split streams cut it off after 8 bytes
+struct PackedVertex {
+	uint16_t position[4]; // half floats or snorm16, the fourth is padding
+	int16_t normal[2];    // octahedral, snorm16
+	uint16_t uv[2];       // unorm16
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+struct PackedMeshData {
+	std::vector<PackedVertex> vertices;
+	std::vector<uint32_t> indices;
+	PositionEncoding position_encoding = PositionEncoding::Snorm16;
+	glm::mat4 dequantize = glm::mat4(1.0f);          // packed position to model space
+	float uv_transform[4] = { 0.0f, 0.0f, 1.0f, 1.0f }; // offset and scale, uv = offset + scale * packed
+
+	bool wideIndices() const {
+		return vertices.size() > 65536;
+	}
+};
+
+// IEEE half, rounded to nearest even, overflow to infinity
+inline uint16_t floatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, 4);
+	uint32_t sign = (bits >> 16) & 0x8000, exponent = (bits >> 23) & 0xFF, mantissa = bits & 0x7FFFFF;
+	if (exponent == 0xFF) // infinity, nan keeps a mantissa bit
+		return (uint16_t)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+	int half_exponent = (int)exponent - 127 + 15;
+	if (half_exponent >= 31)
+		return (uint16_t)(sign | 0x7C00);
+	if (half_exponent <= 0) {
+		// subnormal half, or zero when even the implicit bit shifts out
+		if (half_exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		int shift = 14 - half_exponent;
+		uint32_t half_mantissa = mantissa >> shift, rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half_mantissa & 1)))
+			half_mantissa++;
+		return (uint16_t)(sign | half_mantissa);
+	}
+	uint32_t half = sign | ((uint32_t)half_exponent << 10) | (mantissa >> 13), rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++; // a carry into the exponent is still the right answer
+	return (uint16_t)half;
+}
+
+inline float halfToFloat(uint16_t half) {
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16, exponent = (half >> 10) & 0x1F, mantissa = half & 0x3FF;
+	uint32_t bits;
+	if (exponent == 0x1F)
+		bits = sign | 0x7F800000 | (mantissa != 0 ? 0x400000 | (mantissa << 13) : 0); // nan comes out quiet
+	else if (exponent != 0)
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	else if (mantissa == 0)
+		bits = sign;
+	else {
+		// subnormal half, normalize it
+		int shift = 0;
+		while ((mantissa & 0x400) == 0) {
+			mantissa <<= 1;
+			shift++;
+		}
+		bits = sign | ((uint32_t)(127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3FF) << 13);
+	}
+	float value;
+	std::memcpy(&value, &bits, 4);
+	return value;
+}
+
+// the GL conversions: snorm c / 32767 clamped to -1, unorm c / 65535 or c / 255
+inline int16_t quantizeSnorm16(float value) {
+	return (int16_t)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+}
+
+inline uint16_t quantizeUnorm16(float value) {
+	return (uint16_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+}
+
+inline uint32_t packUnorm8x4(const float* rgba) {
+	uint32_t packed = 0;
+	for (int c = 0; c < 4; c++)
+		packed |= (uint32_t)std::lround(std::min(std::max(rgba[c], 0.0f), 1.0f) * 255.0f) << (8 * c);
+	return packed;
+}
+
+// unit vector to the octahedron's square, both results in [-1, 1]
+inline void encodeOctahedral(const float* normal, float* out) {
+	float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+	if (length == 0.0f) {
+		out[0] = out[1] = 0.0f;
+		return;
+	}
+	float x = normal[0] / length, y = normal[1] / length;
+	if (normal[2] < 0.0f) {
+		// fold the lower half over the diagonals
+		float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = folded_x;
+		y = folded_y;
+	}
+	out[0] = x;
+	out[1] = y;
+}
+
+// what glsl/mesh_packed_vertex.glsl does
+inline void decodeOctahedral(const float* encoded, float* normal) {
+	float x = encoded[0], y = encoded[1], z = 1.0f - std::fabs(x) - std::fabs(y);
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+	float length = std::sqrt(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+// pack every vertex of 'mesh', indices are copied as they are
+inline PackedMeshData packMesh(const MeshData& mesh, PositionEncoding encoding) {
+	PackedMeshData packed;
+	packed.position_encoding = encoding;
+	packed.indices = mesh.indices;
+	packed.vertices.resize(mesh.vertices.size());
+
+	glm::vec3 low(mesh.bounds_min[0], mesh.bounds_min[1], mesh.bounds_min[2]);
+	glm::vec3 high(mesh.bounds_max[0], mesh.bounds_max[1], mesh.bounds_max[2]);
+	glm::vec3 center = (low + high) * 0.5f, extent = (high - low) * 0.5f;
+	for (int c = 0; c < 3; c++)
+		if (extent[c] <= 0.0f)
+			extent[c] = 1.0f; // flat along this axis, any scale works
+	// half floats keep their own scale, centering them spends the precision on the mesh instead of its offset
+	packed.dequantize = glm::translate(glm::mat4(1.0f), center);
+	if (encoding == PositionEncoding::Snorm16)
+		packed.dequantize = glm::scale(packed.dequantize, extent);
+
+	float uv_low[2] = { 0.0f, 0.0f }, uv_high[2] = { 1.0f, 1.0f };
+	if (!mesh.vertices.empty())
+		for (int c = 0; c < 2; c++) {
+			uv_low[c] = uv_high[c] = mesh.vertices[0].uv[c];
+			for (const MeshVertex& vertex : mesh.vertices) {
+				uv_low[c] = std::min(uv_low[c], vertex.uv[c]);
+				uv_high[c] = std::max(uv_high[c], vertex.uv[c]);
+			}
+		}
+	for (int c = 0; c < 2; c++) {
+		packed.uv_transform[c] = uv_low[c];
+		packed.uv_transform[2 + c] = uv_high[c] > uv_low[c] ? uv_high[c] - uv_low[c] : 1.0f;
+	}
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const MeshVertex& vertex = mesh.vertices[i];
+		PackedVertex& out = packed.vertices[i];
+		for (int c = 0; c < 3; c++) {
+			float relative = vertex.position[c] - center[c];
+			out.position[c] = encoding == PositionEncoding::Half ? floatToHalf(relative) : (uint16_t)quantizeSnorm16(relative / extent[c]);
+		}
+		out.position[3] = 0;
+		float octahedral[2];
+		encodeOctahedral(vertex.normal, octahedral);
+		out.normal[0] = quantizeSnorm16(octahedral[0]);
+		out.normal[1] = quantizeSnorm16(octahedral[1]);
+		for (int c = 0; c < 2; c++)
+			out.uv[c] = quantizeUnorm16((vertex.uv[c] - packed.uv_transform[c]) / packed.uv_transform[2 + c]);
+	}
+	return packed;
+}
+
+// one vertex back to floats, for checking the error against the source
+inline MeshVertex unpackVertex(const PackedMeshData& mesh, const PackedVertex& vertex) {
+	MeshVertex out;
+	glm::vec4 position;
+	for (int c = 0; c < 3; c++)
+		position[c] = mesh.position_encoding == PositionEncoding::Half ? halfToFloat(vertex.position[c])
+			: std::max((int16_t)vertex.position[c] / 32767.0f, -1.0f);
+	position[3] = 1.0f;
+	position = mesh.dequantize * position;
+	for (int c = 0; c < 3; c++)
+		out.position[c] = position[c];
+	float octahedral[2] = { std::max(vertex.normal[0] / 32767.0f, -1.0f), std::max(vertex.normal[1] / 32767.0f, -1.0f) };
+	decodeOctahedral(octahedral, out.normal);
+	for (int c = 0; c < 2; c++)
+		out.uv[c] = mesh.uv_transform[c] + mesh.uv_transform[2 + c] * (vertex.uv[c] / 65535.0f);
+	return out;
+}
+
+// the layouts the mesh shaders read, location 0 position, 1 normal, 2 uv (vertex_layout.h). 'position bytes' is where
+// split streams cut
+using MeshVertexLayout = VertexLayout<Position3f, Normal3f, UV2f>;
+using PackedVertexLayoutHalf = VertexLayout<Position3Half, NormalOctSnorm16, UV2Unorm16>;
+using PackedVertexLayoutSnorm16 = VertexLayout<Position3Snorm16, NormalOctSnorm16, UV2Unorm16>;
+const GLuint MESH_VERTEX_POSITION_BYTES = MeshVertexLayout::offset(1);
+const GLuint PACKED_VERTEX_POSITION_BYTES = PackedVertexLayoutHalf::offset(1);
+
+static_assert(MeshVertexLayout::stride == sizeof(MeshVertex) && MeshVertexLayout::offset(1) == offsetof(MeshVertex, normal)
+	&& MeshVertexLayout::offset(2) == offsetof(MeshVertex, uv), "MeshVertexLayout must match MeshVertex");
+static_assert(PackedVertexLayoutHalf::stride == sizeof(PackedVertex) && PackedVertexLayoutHalf::offset(1) == offsetof(PackedVertex, normal)
+	&& PackedVertexLayoutHalf::offset(2) == offsetof(PackedVertex, uv), "PackedVertexLayoutHalf must match PackedVertex");
+static_assert(PackedVertexLayoutSnorm16::stride == sizeof(PackedVertex) && PackedVertexLayoutSnorm16::offset(1) == offsetof(PackedVertex, normal)
+	&& PackedVertexLayoutSnorm16::offset(2) == offsetof(PackedVertex, uv), "PackedVertexLayoutSnorm16 must match PackedVertex");
+
+// split interleaved vertices into the two streams, the first 'position_bytes' of each vertex and the rest
+inline void splitVertexStreams(const unsigned char* vertices, size_t count, size_t stride, size_t position_bytes,
+	std::vector<unsigned char>& positions, std::vector<unsigned char>& attributes) {
+	positions.resize(count * position_bytes);
+	attributes.resize(count * (stride - position_bytes));
+	for (size_t i = 0; i < count; i++) {
+		std::memcpy(&positions[i * position_bytes], vertices + i * stride, position_bytes);
+		std::memcpy(&attributes[i * (stride - position_bytes)], vertices + i * stride + position_bytes, stride - position_bytes);
+	}
+}
@@ -0,0 +1,219 @@
+#pragma once
+// compile time vertex layouts defined here
+// a layout lists the attributes of one interleaved vertex in location order, VertexLayout<Position3f, Color3f, UV2f> is
+// location 0 position, 1 color, 2 uv. stride, offsets and a hash of the whole format are worked out at compile time, so
+// no demo writes 8 * sizeof(float) or (void*)(6 * sizeof(float)) by hand anymore
+//
+// the format goes on a VAO through the separate attribute format and buffer binding calls (ARB_vertex_attrib_binding,
+// core since 4.3): the attributes are described once, and drawing another buffer with the same layout is a single
+// glVertexArrayVertexBuffer() on binding 0 with nothing respecified. VertexArrayCache keeps one VAO per layout hash for
+// exactly that, and checkVertexLayout() compares a layout with the inputs a linked program actually declares
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+struct VertexAttribute {
+	GLuint location;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLuint offset;
+};
+
+constexpr GLuint vertexTypeBytes(GLenum type) {
+	return type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1
+		: type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT ? 2
+		: type == GL_DOUBLE ? 8
+		: 4;
+}
+
+// one attribute of a layout. 'Bytes' is what it takes up in the vertex, more than its components when it is padded
+template <GLint Size, GLenum Type, GLboolean Normalized = GL_FALSE, GLuint Bytes = Size * vertexTypeBytes(Type)>
+struct VertexElement {
+	static constexpr GLint size = Size;
+	static constexpr GLenum type = Type;
+	static constexpr GLboolean normalized = Normalized;
+	static constexpr GLuint bytes = Bytes;
+};
+
+// the elements the projects use, the name only says what the shader makes of it
+using Position3f = VertexElement<3, GL_FLOAT>;
+using Normal3f = VertexElement<3, GL_FLOAT>;
+using Color3f = VertexElement<3, GL_FLOAT>;
+using UV2f = VertexElement<2, GL_FLOAT>;
+using ColorRGBA8 = VertexElement<4, GL_UNSIGNED_BYTE, GL_TRUE>;
+using Position3Half = VertexElement<3, GL_HALF_FLOAT, GL_FALSE, 8>; // padded to 4 halves
+using Position3Snorm16 = VertexElement<3, GL_SHORT, GL_TRUE, 8>;    // padded to 4 shorts
+using NormalOctSnorm16 = VertexElement<2, GL_SHORT, GL_TRUE>;      // octahedral
+using UV2Unorm16 = VertexElement<2, GL_UNSIGNED_SHORT, GL_TRUE>;
+
+template <typename... Elements>
+struct VertexLayout {
+	static constexpr size_t count = sizeof...(Elements);
+	static constexpr GLsizei stride = (0 + ... + Elements::bytes);
+	static constexpr std::array<VertexAttribute, sizeof...(Elements)> attributes = [] {
+		std::array<VertexAttribute, sizeof...(Elements)> out{};
+		GLuint location = 0, offset = 0;
+		((out[location] = VertexAttribute{ location, Elements::size, Elements::type, Elements::normalized, offset },
+			location++, offset += Elements::bytes), ...);
+		return out;
+	}();
+	// FNV-1a over the stride and every attribute, equal layouts hash equal whatever their elements are called
+	static constexpr uint64_t hash = [] {
+		uint64_t h = 14695981039346656037ull;
+		auto mix = [&h](uint64_t value) { h = (h ^ value) * 1099511628211ull; };
+		mix((uint64_t)stride);
+		for (const VertexAttribute& attribute : attributes) {
+			mix(attribute.location);
+			mix((uint64_t)attribute.size);
+			mix(attribute.type);
+			mix(attribute.normalized);
+			mix(attribute.offset);
+		}
+		return h;
+	}();
+
+	static constexpr GLuint offset(size_t location) {
+		return attributes[location].offset;
+	}
+};
+
+// format the attributes on 'vao'. interleaved, everything reads binding 0; split (position_bytes > 0), attributes
+// inside the first 'position_bytes' read binding 0 and the rest binding 1, offsets rebased to that stream
+inline void formatVertexAttributes(unsigned int vao, const VertexAttribute* attributes, size_t count, GLuint position_bytes = 0) {
+	for (size_t i = 0; i < count; i++) {
+		const VertexAttribute& attribute = attributes[i];
+		bool second = position_bytes > 0 && attribute.offset >= position_bytes;
+		glEnableVertexArrayAttrib(vao, attribute.location);
+		glVertexArrayAttribFormat(vao, attribute.location, attribute.size, attribute.type, attribute.normalized,
+			second ? attribute.offset - position_bytes : attribute.offset);
+		glVertexArrayAttribBinding(vao, attribute.location, second ? 1 : 0);
+	}
+}
+
+// components per location and whether the shader reads integers, false for types a vertex input cannot have
+inline bool vertexInputShape(GLenum type, GLint& components, GLint& locations, bool& integer) {
+	locations = 1;
+	integer = false;
+	switch (type) {
+	case GL_FLOAT: case GL_DOUBLE: components = 1; return true;
+	case GL_FLOAT_VEC2: case GL_DOUBLE_VEC2: components = 2; return true;
+	case GL_FLOAT_VEC3: case GL_DOUBLE_VEC3: components = 3; return true;
+	case GL_FLOAT_VEC4: case GL_DOUBLE_VEC4: components = 4; return true;
+	case GL_FLOAT_MAT2: components = 2; locations = 2; return true;
+	case GL_FLOAT_MAT3: components = 3; locations = 3; return true;
+	case GL_FLOAT_MAT4: components = 4; locations = 4; return true;
+	case GL_INT: case GL_UNSIGNED_INT: components = 1; integer = true; return true;
+	case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: components = 2; integer = true; return true;
+	case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: components = 3; integer = true; return true;
+	case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: components = 4; integer = true; return true;
+	}
+	return false;
+}
+
+// check 'attributes' against the vertex inputs of the linked 'program', through the program interface query. every
+// input needs an attribute at its location with as many components, or the shader silently reads 0 and 1 for the
+// missing ones. integer inputs are reported too, layouts only ever set float formats. attributes the program does not
+// read are fine, a depth only pass reads less of the same vertex
+inline bool checkVertexLayout(unsigned int program, const VertexAttribute* attributes, size_t count) {
+	GLint inputs = 0;
+	glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &inputs);
+	bool matches = true;
+	for (GLint i = 0; i < inputs; i++) {
+		const GLenum properties[3] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+		GLint values[3] = { -1, 0, 1 };
+		glGetProgramResourceiv(program, GL_PROGRAM_INPUT, (GLuint)i, 3, properties, 3, nullptr, values);
+		if (values[0] < 0)
+			continue; // built in, gl_VertexID and the like
+		char name[64];
+		glGetProgramResourceName(program, GL_PROGRAM_INPUT, (GLuint)i, sizeof(name), nullptr, name);
+
+		GLint components, locations;
+		bool integer;
+		if (!vertexInputShape((GLenum)values[1], components, locations, integer) || integer) {
+			std::cout << "ERROR::VERTEX_LAYOUT::UNSUPPORTED_INPUT_TYPE: " << name << std::endl;
+			matches = false;
+			continue;
+		}
+		for (GLint l = 0; l < locations * values[2]; l++) {
+			const VertexAttribute* found = nullptr;
+			for (size_t a = 0; a < count; a++)
+				if (attributes[a].location == (GLuint)(values[0] + l))
+					found = &attributes[a];
+			if (found == nullptr) {
+				std::cout << "ERROR::VERTEX_LAYOUT::MISSING_ATTRIBUTE: " << name << " at location " << values[0] + l << std::endl;
+				matches = false;
+			}
+			else if (found->size != components) {
+				std::cout << "ERROR::VERTEX_LAYOUT::SIZE_MISMATCH: " << name << " reads " << components << " components, the layout has " << found->size << std::endl;
+				matches = false;
+			}
+		}
+	}
+	return matches;
+}
+
+template <typename Layout>
+bool checkVertexLayout(unsigned int program) {
+	return checkVertexLayout(program, Layout::attributes.data(), Layout::count);
+}
+
+// one VAO per vertex format. the VAO holds only the format, callers point binding 0 (and 1 for split streams) and the
+// element buffer at their own buffers before drawing. has to be cleared or destroyed while the context is current
+class VertexArrayCache {
+public:
+	VertexArrayCache() = default;
+	VertexArrayCache(const VertexArrayCache&) = delete;
+	VertexArrayCache& operator=(const VertexArrayCache&) = delete;
+
+	~VertexArrayCache() {
+		clear();
+	}
+
+	// the VAO for 'Layout', created and formatted on first use. 'position_bytes' above 0 splits it into two streams
+	template <typename Layout>
+	unsigned int get(GLuint position_bytes = 0) {
+		return get(Layout::hash, Layout::attributes.data(), Layout::count, position_bytes);
+	}
+
+	unsigned int get(uint64_t hash, const VertexAttribute* attributes, size_t count, GLuint position_bytes = 0) {
+		uint64_t key = hash ^ ((uint64_t)position_bytes * 0x9E3779B97F4A7C15ull);
+		auto found = vertex_arrays.find(key);
+		if (found != vertex_arrays.end())
+			return found->second;
+		unsigned int vao;
+		glCreateVertexArrays(1, &vao);
+		formatVertexAttributes(vao, attributes, count, position_bytes);
+		vertex_arrays.emplace(key, vao);
+		return vao;
+	}
+
+	// the VAO for 'Layout' reading 'buffer' from 'offset', bound and ready to draw
+	template <typename Layout>
+	unsigned int bind(unsigned int buffer, GLintptr offset = 0, unsigned int element_buffer = 0) {
+		unsigned int vao = get<Layout>();
+		glVertexArrayVertexBuffer(vao, 0, buffer, offset, Layout::stride);
+		glVertexArrayElementBuffer(vao, element_buffer);
+		glBindVertexArray(vao);
+		return vao;
+	}
+
+	size_t size() const {
+		return vertex_arrays.size();
+	}
+
+	void clear() {
+		for (auto& entry : vertex_arrays)
+			glDeleteVertexArrays(1, &entry.second);
+		vertex_arrays.clear();
+	}
+
+private:
+	std::unordered_map<uint64_t, unsigned int> vertex_arrays; // layout hash to VAO
+};
@@ -82,17 +82,17 @@ public:
 	}
 
 	// utility uniform functions, to change values within shader program
-	void setBool(const std::string& name, bool value) const
+	void setBool(const char* name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(program, name.c_str()), (int)value);
+		glUniform1i(glGetUniformLocation(program, name), (int)value);
 	}
-	void setInt(const std::string& name, int value) const
+	void setInt(const char* name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(program, name.c_str()), value);
+		glUniform1i(glGetUniformLocation(program, name), value);
 	}
-	void setFloat(const std::string& name, float value) const
+	void setFloat(const char* name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(program, name.c_str()), value);
+		glUniform1f(glGetUniformLocation(program, name), value);
 	}
 
 private:
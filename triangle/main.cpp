@@ -12,6 +12,7 @@
 #include <GLFW/glfw3.h>
 
 #include "shader.h"
+#include "vertex_layout.h"
 
 #include <iostream>
 
@@ -56,20 +57,19 @@ int main() {
 		 0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f  // top vertex
 	};
 
-	unsigned int VBO, VAO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
+	// position at location 0, color at location 1, stride and offsets follow from the layout
+	using TriangleVertexLayout = VertexLayout<Position3f, Color3f>;
+	static_assert(sizeof(vertices) == 3 * TriangleVertexLayout::stride, "TriangleVertexLayout must match vertices");
+	checkVertexLayout<TriangleVertexLayout>(base_shader.program);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	unsigned int VBO;
+	glCreateBuffers(1, &VBO);
+	glNamedBufferStorage(VBO, sizeof(vertices), vertices, 0);
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	// the cached VAO only holds the format, the buffer is attached to its binding
+	VertexArrayCache vertex_arrays;
+	unsigned int VAO = vertex_arrays.get<TriangleVertexLayout>();
+	glVertexArrayVertexBuffer(VAO, 0, VBO, 0, TriangleVertexLayout::stride);
 
 	// render loop
 	while (!glfwWindowShouldClose(window)) {
@@ -89,7 +89,7 @@ int main() {
 	}
 
 	// clean
-	glDeleteVertexArrays(1, &VAO);
+	vertex_arrays.clear();
 	glDeleteBuffers(1, &VBO);
 
 	glfwTerminate();